@@ -188,6 +188,10 @@ bool VgmstreamPlugin::play(const char *filename, VFSFile &file) {
         return false;
     }
 
+    // save decoder state while playing, for faster backwards seeking
+    vgmstream_enable_checkpoints(vgmstream, 0, 0);
+    vgmstream_enable_block_index(vgmstream);
+
     short buffer[MIN_BUFFER_SIZE * vgmstream->channels];
     int max_buffer_samples = sizeof(buffer) / sizeof(buffer[0]) / vgmstream->channels;
 
@@ -250,34 +254,11 @@ void VgmstreamPlugin::seek(int seek_value, int &current_sample_pos) {
 
     // compute from ms to samples
     int seek_needed_samples = (long long)seek_value * vgmstream->sample_rate / 1000L;
-    short buffer[MIN_BUFFER_SIZE * vgmstream->channels];
-    int max_buffer_samples = sizeof(buffer) / sizeof(buffer[0]) / vgmstream->channels;
-
-    int samples_to_do = 0;
-    if (seek_needed_samples < current_sample_pos) {
-        // go back in time, reopen file
-        debugMessage("reopen file to seek backward");
-        reset_vgmstream(vgmstream);
-        current_sample_pos = 0;
-        samples_to_do = seek_needed_samples;
-    } else if (current_sample_pos < seek_needed_samples) {
-        // go forward in time
-        samples_to_do = seek_needed_samples - current_sample_pos;
-    }
-
-    // do the actual seeking
-    if (samples_to_do >= 0) {
-        debugMessage("render forward");
 
-        // render till seeked sample
-        while (samples_to_do > 0) {
-            int seek_samples = std::min(max_buffer_samples, samples_to_do);
-            current_sample_pos += seek_samples;
-            samples_to_do -= seek_samples;
-            render_vgmstream(buffer, seek_samples, vgmstream);
-        }
-        debugMessage("after render vgmstream");
-    }
+    // the library picks the fastest way to get there (and handles loops)
+    vgmstream_seek(vgmstream, seek_needed_samples);
+    current_sample_pos = seek_needed_samples;
+    debugMessage("after seek");
 }
 
 void debugMessage(const char *str) {
@@ -76,9 +76,10 @@ struct params {
     double fade_time;
     double fade_delay;
     int stream_index;
+    double start_time;
 };
 
-#define DEFAULT_PARAMS { 2, -1, 10.0, 0.0, 0 }
+#define DEFAULT_PARAMS { 2, -1, 10.0, 0.0, 0, 0.0 }
 
 static const char *out_filename = NULL;
 static int driver_id;
@@ -162,6 +163,7 @@ static void usage(const char *progname) {
         "    -r          Repeat playback indefinitely\n"
         "    -v          Display stream metadata and playback progress\n"
         "    -S N        Play substream with index N [%d]\n"
+        "    -s START    Start playback at START seconds\n"
         "\n"
         "Options for looped streams:\n"
         "    -L N        Play loop N times [%d]\n"
@@ -236,6 +238,7 @@ static int play_vgmstream(const char *filename, struct params *par) {
     STREAMFILE *sf;
     VGMSTREAM *vgms;
     FILE *save_fps[4];
+    vgmstream_play_config play = {0};
     int loop_count;
     int64_t total_samples;
     size_t buffer_size;
@@ -307,7 +310,13 @@ static int play_vgmstream(const char *filename, struct params *par) {
         if (loop_count < 1) loop_count = 1;
     }
 
-    total_samples = get_vgmstream_play_samples(loop_count, par->fade_time, par->fade_delay, vgms);
+    /* loops and fade are applied when rendering */
+    play.loop_count = loop_count;
+    play.fade_time = par->fade_time;
+    play.fade_delay = par->fade_delay;
+    vgmstream_set_play_config(vgms, &play);
+
+    total_samples = vgmstream_get_play_samples(vgms);
 
     {
         double total = (double)total_samples / vgms->sample_rate;
@@ -336,7 +345,19 @@ static int play_vgmstream(const char *filename, struct params *par) {
     if (fade_start < 0)
         fade_start = total_samples;
 
-    for (s = 0; s < total_samples && !interrupted; s += buffer_samples) {
+    /* Skip to the start position, if set
+     */
+    s = (int64_t)(par->start_time * vgms->sample_rate);
+    if (s < 0)
+        s = 0;
+    if (s > total_samples)
+        s = total_samples;
+    if (s > 0) {
+        vgmstream_build_block_index(vgms);
+        vgmstream_seek(vgms, (int32_t)s);
+    }
+
+    for (; s < total_samples && !interrupted; s += buffer_samples) {
         int64_t buffer_used_samples = MIN(buffer_samples, total_samples - s);
         char *suffix = "";
 
@@ -346,17 +367,8 @@ static int play_vgmstream(const char *filename, struct params *par) {
         swap_samples_le(buffer, vgms->channels * buffer_used_samples);
 #endif
 
-        if (vgms->loop_flag && fade_time_samples > 0 && s >= fade_start) {
-            /* Got to do the fade-out ourselves :p */
-            int64_t b;
-            for (b = 0; b < buffer_used_samples; b++) {
-                double factor = 1.0 - (double)(s + b - fade_start) / fade_time_samples;
-                int c;
-                for (c = 0; c < vgms->channels; c++)
-                    buffer[vgms->channels * b + c] *= factor;
-            }
+        if (vgms->loop_flag && fade_time_samples > 0 && s >= fade_start)
             suffix = " (fading)";
-        }
 
         if (verbose && !out_filename) {
             double played = (double)s / vgms->sample_rate;
@@ -635,7 +647,7 @@ int main(int argc, char **argv) {
         memcpy(&par, &default_par, sizeof(par));
     }
 
-    while ((opt = getopt(argc, argv, "-D:F:L:M:S:b:d:f:o:@:hrv")) != -1) {
+    while ((opt = getopt(argc, argv, "-D:F:L:M:S:b:d:f:o:s:@:hrv")) != -1) {
         switch (opt) {
             case 1:
                 if (play_file(optarg, &par)) {
@@ -665,6 +677,9 @@ int main(int argc, char **argv) {
             case 'S':
                 par.stream_index = atoi(optarg);
                 break;
+            case 's':
+                par.start_time = atof(optarg);
+                break;
             case 'b':
                 if (!buffer)
                     buffer_size_kb = atoi(optarg);
@@ -2,6 +2,7 @@
 #include <getopt.h>
 #include "../src/vgmstream.h"
 #include "../src/util.h"
+#include "../src/threads.h"
 #ifdef WIN32
 #include <io.h>
 #include <fcntl.h>
@@ -21,19 +22,21 @@
 #endif
 
 #define BUFFER_SAMPLES 0x8000
+#define LAYER_BUFFER_SAMPLES 0x1000
 
 /* getopt globals (the horror...) */
 extern char * optarg;
 extern int optind, opterr, optopt;
 
 
-static size_t make_wav_header(uint8_t * buf, size_t buf_size, int32_t sample_count, int32_t sample_rate, int channels, int smpl_chunk, int32_t loop_start, int32_t loop_end);
+static size_t make_wav_header(uint8_t * buf, size_t buf_size, int32_t sample_count, int32_t sample_rate, int channels, int smpl_chunk, int32_t loop_start, int32_t loop_end, int float_wav);
 
 static void usage(const char * name) {
     fprintf(stderr,"vgmstream CLI decoder " VERSION " " __DATE__ "\n"
-            "Usage: %s [-o outfile.wav] [options] infile\n"
+            "Usage: %s [-o outfile.wav] [options] infile [infile2 ...]\n"
             "Options:\n"
             "    -o outfile.wav: name of output .wav file, default infile.wav\n"
+            "       wildcards can be used: ?f=infile, ?n=stream name, ?s=subsong\n"
             "    -l loop count: loop count, default 2.0\n"
             "    -f fade time: fade time in seconds after N loops, default 10.0\n"
             "    -d fade delay: fade delay in seconds, default 0.0\n"
@@ -42,16 +45,23 @@ static void usage(const char * name) {
             "    -e: force end-to-end looping\n"
             "    -E: force end-to-end looping even if file has real loop points\n"
             "    -s N: select subsong N, if the format supports multiple subsongs\n"
+            "    -S N: export subsongs from -s (default 1) to N (0 = all) in batch mode\n"
+            "    -k N: seek to N samples before decoding (skips the start)\n"
             "    -m: print metadata only, don't decode\n"
             "    -L: append a smpl chunk and create a looping wav\n"
             "    -2 N: only output the Nth (first is 0) set of stereo channels\n"
+            "    -w: write a 32-bit float .wav (no 16-bit conversion for lossy codecs)\n"
             "    -p: output to stdout (for piping into another program)\n"
             "    -P: output to stdout even if stdout is a terminal\n"
             "    -c: loop forever (continuously) to stdout\n"
             "    -x: decode and print adxencd command line to encode as ADX\n"
             "    -g: decode and print oggenc command line to encode as OGG\n"
             "    -b: decode and print batch variable commands\n"
-            "    -r: output a second file after resetting (for testing)\n"
+            "    -r: output a second file after seeking back (for testing)\n"
+            "    -j N: batch mode threads, default one per CPU\n"
+            "    -A N: prepare the next segment N samples ahead in another thread (segmented files)\n"
+            "Batch mode: with multiple infiles (or - to read a list of files from stdin) files are decoded\n"
+            "in parallel, using -o with wildcards for output names (default ?f.wav, or ?s_?n.wav with -S)\n"
             , name);
 }
 
@@ -72,7 +82,17 @@ typedef struct {
     int test_reset;
     int write_lwav;
     int only_stereo;
+    int float_wav;
     int stream_index;
+    int32_t seek_samples;
+    char ** infilenames;
+    int infilename_count;
+    int batch_list;
+    int batch_threads;
+    int segment_prefetch;
+    int batch_mode;
+    int export_subsongs;
+    int subsong_end;
     double loop_count;
     double fade_time;
     double fade_delay;
@@ -96,7 +116,7 @@ static int parse_config(cli_config *cfg, int argc, char ** argv) {
     opterr = 0;
 
     /* read config */
-    while ((opt = getopt(argc, argv, "o:l:f:d:ipPcmxeLEFrgb2:s:")) != -1) {
+    while ((opt = getopt(argc, argv, "o:l:f:d:ipPcmxeLEFrgb2:s:S:k:wj:A:")) != -1) {
         switch (opt) {
             case 'o':
                 cfg->outfilename = optarg;
@@ -156,6 +176,22 @@ static int parse_config(cli_config *cfg, int argc, char ** argv) {
             case 's':
                 cfg->stream_index = atoi(optarg);
                 break;
+            case 'S':
+                cfg->export_subsongs = 1;
+                cfg->subsong_end = atoi(optarg);
+                break;
+            case 'k':
+                cfg->seek_samples = atoi(optarg);
+                break;
+            case 'w':
+                cfg->float_wav = 1;
+                break;
+            case 'j':
+                cfg->batch_threads = atoi(optarg);
+                break;
+            case 'A':
+                cfg->segment_prefetch = atoi(optarg);
+                break;
             case '?':
                 fprintf(stderr, "Unknown option -%c found\n", optopt);
                 goto fail;
@@ -165,12 +201,17 @@ static int parse_config(cli_config *cfg, int argc, char ** argv) {
         }
     }
 
-    /* filename goes last */
-    if (optind != argc - 1) {
+    /* filenames go last (more than one, or a list in stdin, for batch mode) */
+    if (optind >= argc) {
         usage(argv[0]);
         goto fail;
     }
     cfg->infilename = argv[optind];
+    cfg->infilenames = &argv[optind];
+    cfg->infilename_count = argc - optind;
+    if (cfg->infilename_count == 1 && strcmp(cfg->infilename, "-") == 0)
+        cfg->batch_list = 1;
+    cfg->batch_mode = cfg->infilename_count > 1 || cfg->batch_list || cfg->export_subsongs;
 
 
     return 1;
@@ -203,12 +244,48 @@ static int validate_config(cli_config *cfg) {
         fprintf(stderr,"either -p or -o, make up your mind\n");
         goto fail;
     }
+    if (cfg->seek_samples < 0) {
+        fprintf(stderr,"-k must be positive\n");
+        goto fail;
+    }
+    if (cfg->export_subsongs && (cfg->infilename_count > 1 || cfg->batch_list)) {
+        fprintf(stderr,"-S needs a single infile\n");
+        goto fail;
+    }
+    if (cfg->subsong_end < 0) {
+        fprintf(stderr,"-S must be positive\n");
+        goto fail;
+    }
+    if (cfg->segment_prefetch < 0) {
+        fprintf(stderr,"-A must be positive\n");
+        goto fail;
+    }
+    if (cfg->batch_mode) {
+        if (cfg->play_sdtout || cfg->print_metaonly || cfg->print_adxencd || cfg->print_oggenc || cfg->print_batchvar || cfg->test_reset || cfg->segment_prefetch) {
+            fprintf(stderr,"-p, -P, -c, -m, -x, -g, -b, -r and -A can't be used in batch mode\n");
+            goto fail;
+        }
+        if (cfg->outfilename && !strchr(cfg->outfilename, '?')) {
+            fprintf(stderr,"-o needs wildcards (?f, ?n or ?s) in batch mode\n");
+            goto fail;
+        }
+    }
 
     return 1;
 fail:
     return 0;
 }
 
+static void print_segment_stats(VGMSTREAM * vgmstream) {
+    segmented_prefetch_stats stats;
+
+    if (!vgmstream_get_segment_stats(vgmstream, &stats))
+        return;
+
+    printf("segment prefetch: %i prepared, %i ready, %i waited, %i missed (prepare time max %u us, total %u us)\n",
+            stats.prepared, stats.ready, stats.waited, stats.missed, stats.prepare_us_max, stats.prepare_us_total);
+}
+
 static void print_info(VGMSTREAM * vgmstream, cli_config *cfg) {
     if (!cfg->play_sdtout) {
         if (cfg->print_adxencd) {
@@ -253,74 +330,465 @@ static void print_info(VGMSTREAM * vgmstream, cli_config *cfg) {
 }
 
 static void apply_config(VGMSTREAM * vgmstream, cli_config *cfg) {
+    vgmstream_play_config play = {0};
+
+    /* final length, loops and fade are handled when rendering (TXTP's suggested config takes priority) */
+    play.loop_count = cfg->loop_count;
+    play.fade_time = cfg->fade_time;
+    play.fade_delay = cfg->fade_delay;
+    play.ignore_loop = cfg->ignore_loop;
+    play.force_loop = cfg->force_loop;
+    play.really_force_loop = cfg->really_force_loop;
+    play.ignore_fade = cfg->ignore_fade;
+    play.play_forever = cfg->play_forever;
+    vgmstream_set_play_config(vgmstream, &play);
+
+    /* write loops in the wav, but don't actually loop it */
+    if (cfg->write_lwav) {
+        cfg->lwav_loop_start = vgmstream->loop_start_sample;
+        cfg->lwav_loop_end = vgmstream->loop_end_sample;
+        play.ignore_loop = 1;
+        play.play_forever = 0;
+        vgmstream_set_play_config(vgmstream, &play);
+    }
+}
 
-    /* honor suggested config, if any (defined order matters)
-     * note that ignore_fade and play_forever should take priority */
-    if (vgmstream->config_loop_count) {
-        cfg->loop_count = vgmstream->config_loop_count;
+/* renders to_get samples in the selected output format and writes them */
+static void render_and_write(VGMSTREAM * vgmstream, cli_config * cfg, void * buf, int to_get, FILE * outfile) {
+    size_t sample_size = cfg->float_wav ? sizeof(float) : sizeof(sample);
+    int j;
+
+    if (cfg->float_wav) {
+        render_vgmstream_f32(buf,to_get,vgmstream);
+        swap_samples_le_f32(buf,vgmstream->channels*to_get); /* write PC endian */
     }
-    if (vgmstream->config_fade_delay) {
-        cfg->fade_delay = vgmstream->config_fade_delay;
+    else {
+        render_vgmstream(buf,to_get,vgmstream);
+        swap_samples_le(buf,vgmstream->channels*to_get); /* write PC endian */
     }
-    if (vgmstream->config_fade_delay) {
-        cfg->fade_time = vgmstream->config_fade_time;
+
+    if (cfg->only_stereo != -1) {
+        for (j = 0; j < to_get; j++) {
+            fwrite((uint8_t*)buf + (j*vgmstream->channels+(cfg->only_stereo*2))*sample_size,sample_size,2,outfile);
+        }
+    } else {
+        fwrite(buf,sample_size*vgmstream->channels,to_get,outfile);
     }
-    if (vgmstream->config_force_loop) {
-        cfg->really_force_loop = 1;
+}
+
+static void write_wav_header(VGMSTREAM * vgmstream, cli_config * cfg, int32_t len_samples, FILE * outfile) {
+    uint8_t wav_buf[0x100];
+    int channels = (cfg->only_stereo != -1) ? 2 : vgmstream->channels;
+    size_t bytes_done;
+
+    bytes_done = make_wav_header(wav_buf,0x100,
+            len_samples - cfg->seek_samples, vgmstream->sample_rate, channels,
+            cfg->write_lwav, cfg->lwav_loop_start, cfg->lwav_loop_end, cfg->float_wav);
+
+    fwrite(wav_buf,sizeof(uint8_t),bytes_done,outfile);
+}
+
+/* writes a .wav with the stream from the current position (seek_samples) to the end */
+static void write_wav(VGMSTREAM * vgmstream, cli_config * cfg, void * buf, int32_t len_samples, FILE * outfile) {
+    int32_t i;
+
+    /* slap on a .wav header */
+    write_wav_header(vgmstream, cfg, len_samples, outfile);
+
+    /* decode */
+    for (i = cfg->seek_samples; i < len_samples; i += BUFFER_SAMPLES) {
+        int to_get = BUFFER_SAMPLES;
+        if (i + BUFFER_SAMPLES > len_samples)
+            to_get = len_samples - i;
+
+        render_and_write(vgmstream, cfg, buf, to_get, outfile);
     }
-    if (vgmstream->config_ignore_loop) {
-        cfg->ignore_loop = 1;
+}
+
+/* copies src into dst (at *pos) as a file name part, replacing characters not allowed in names */
+static void append_name(char * dst, size_t dst_size, size_t * pos, const char * src, int is_path) {
+    while (*src && *pos + 1 < dst_size) {
+        char c = *src++;
+        if (!is_path && (c == '/' || c == '\\' || c == ':' || c == '*' || c == '?' || c == '"' || c == '<' || c == '>' || c == '|'))
+            c = '_';
+        dst[(*pos)++] = c;
     }
-    if (vgmstream->config_ignore_fade) {
-        cfg->ignore_fade = 1;
+}
+
+/* Makes an output filename from a pattern with wildcards: ?f = infile, ?n = stream name (infile
+ * without path and extension if not set), ?s = subsong number. */
+static void make_outfilename(char * dst, size_t dst_size, const char * pattern, const char * infilename, VGMSTREAM * vgmstream) {
+    size_t pos = 0;
+
+    while (*pattern && pos + 1 < dst_size) {
+        if (pattern[0] == '?' && pattern[1] == 'f') {
+            append_name(dst, dst_size, &pos, infilename, 1);
+            pattern += 2;
+        }
+        else if (pattern[0] == '?' && pattern[1] == 'n') {
+            if (vgmstream->stream_name[0] != '\0') {
+                append_name(dst, dst_size, &pos, vgmstream->stream_name, 0);
+            }
+            else {
+                char name[PATH_LIMIT];
+                const char * base = strrchr(infilename, DIR_SEPARATOR);
+                char * ext;
+
+                strncpy(name, base ? base + 1 : infilename, PATH_LIMIT - 1);
+                name[PATH_LIMIT - 1] = '\0';
+                ext = strrchr(name, '.');
+                if (ext && ext != name)
+                    *ext = '\0';
+                append_name(dst, dst_size, &pos, name, 0);
+            }
+            pattern += 2;
+        }
+        else if (pattern[0] == '?' && pattern[1] == 's') {
+            char num[16];
+            sprintf(num, "%d", vgmstream->stream_index > 0 ? vgmstream->stream_index : 1);
+            append_name(dst, dst_size, &pos, num, 0);
+            pattern += 2;
+        }
+        else {
+            dst[pos++] = *pattern++;
+        }
     }
+    dst[pos] = '\0';
+}
+
+
+/* ************************************************************ */
+/* BATCH MODE                                                   */
+/* ************************************************************ */
+
+/* Many files are decoded in the shared worker pool, a few at a time (one per thread), each in its own
+ * task with its own stream so a bad file only fails itself. Results are printed in order.
+ * Only decoding runs in parallel: opening and closing are done one file at a time, as metas and codec
+ * setup may use global caches and tables that aren't locked (only a few are).
+ * Subsongs of a bank are exported the same way, each task opening its subsong from its own handle
+ * with the format of the first one (so the bank isn't tested against every format again).
+ *
+ * Output names are only known once a file is open (?n), and different files may get the same one, so
+ * each task writes a temp file that is renamed when reported. Names are taken in order then, and
+ * repeated ones get a number (name_2.wav), so results don't depend on which file finished first. */
+
+typedef struct {
+    cli_config cfg;             /* per file copy, as apply_config writes to it */
+    char infilename[PATH_LIMIT];
+    char outfilename[PATH_LIMIT];
+    char tempfilename[PATH_LIMIT];
+    VGMSTREAM * bank;           /* subsong export: first subsong (shared, only read) */
+    vgm_mutex * open_lock;      /* shared, taken when opening and closing */
+    int subsong;
+    int index;
+    const char * error;         /* NULL if decoded ok */
+    int32_t samples;
+    size_t bytes;
+    vgm_task task;
+} batch_file;
+
+static void batch_decode(void * arg) {
+    batch_file * bf = arg;
+    cli_config * cfg = &bf->cfg;
+    VGMSTREAM * vgmstream = NULL;
+    FILE * outfile = NULL;
+    void * buf = NULL;
+    int32_t len_samples;
+    size_t sample_size = cfg->float_wav ? sizeof(float) : sizeof(sample);
+    int channels;
+
+    {
+        STREAMFILE *streamFile = open_stdio_streamfile(bf->infilename);
+        if (!streamFile) {
+            bf->error = "file not found";
+            goto fail;
+        }
 
-    /* remove non-compatible options */
-    if (cfg->play_forever) {
-        cfg->ignore_fade = 0;
-        cfg->ignore_loop = 0;
+        vgm_mutex_lock(bf->open_lock);
+        if (bf->bank) {
+            vgmstream = init_vgmstream_subsong(bf->bank, streamFile, bf->subsong);
+        }
+        else {
+            streamFile->stream_index = cfg->stream_index;
+            vgmstream = init_vgmstream_from_STREAMFILE(streamFile);
+        }
+        close_streamfile(streamFile);
+        vgm_mutex_unlock(bf->open_lock);
+
+        if (!vgmstream) {
+            bf->error = "failed opening";
+            goto fail;
+        }
     }
 
-    /* change vgmstream's loop stuff (ignore loop goes last) */
-    if (cfg->force_loop && !vgmstream->loop_flag) {
-        vgmstream_force_loop(vgmstream, 1, 0,vgmstream->num_samples);
+    apply_config(vgmstream, cfg);
+
+    /* layer threads aren't used, as files already take all threads */
+    if (!cfg->float_wav)
+        vgmstream_enable_loop_cache(vgmstream, 0);
+
+    make_outfilename(bf->outfilename, PATH_LIMIT, cfg->outfilename ? cfg->outfilename : (bf->bank ? "?s_?n.wav" : "?f.wav"), bf->infilename, vgmstream);
+    if (snprintf(bf->tempfilename, PATH_LIMIT, "%s.%d.tmp", bf->outfilename, bf->index) >= PATH_LIMIT) {
+        bf->error = "output name too long";
+        goto fail;
     }
-    if (cfg->really_force_loop) {
-        vgmstream_force_loop(vgmstream, 1, 0,vgmstream->num_samples);
+    outfile = fopen(bf->tempfilename,"wb");
+    if (!outfile) {
+        bf->error = "failed to open output";
+        goto fail;
     }
-    if (cfg->ignore_loop) {
-        vgmstream_force_loop(vgmstream, 0, 0,0);
+
+    buf = malloc(BUFFER_SAMPLES*sample_size*vgmstream->channels);
+    if (!buf) {
+        bf->error = "failed allocating output buffer";
+        goto fail;
     }
 
-    /* loop N times, but also play stream end instead of fading out */
-    if (cfg->loop_count > 0 && cfg->ignore_fade) {
-        vgmstream_set_loop_target(vgmstream, (int)cfg->loop_count);
-        cfg->fade_time = 0;
+    len_samples = vgmstream_get_play_samples(vgmstream);
+    if (cfg->seek_samples > len_samples)
+        cfg->seek_samples = len_samples;
+    if (cfg->seek_samples > 0) {
+        vgmstream_build_block_index(vgmstream);
+        vgmstream_seek(vgmstream, cfg->seek_samples);
     }
 
-    /* write loops in the wav, but don't actually loop it */
-    if (cfg->write_lwav) {
-        cfg->lwav_loop_start = vgmstream->loop_start_sample;
-        cfg->lwav_loop_end = vgmstream->loop_end_sample;
-        vgmstream_force_loop(vgmstream, 0, 0,0);
+    write_wav(vgmstream, cfg, buf, len_samples, outfile);
+    if (ferror(outfile)) {
+        bf->error = "failed writing output";
+        goto fail;
+    }
+
+    channels = (cfg->only_stereo != -1) ? 2 : vgmstream->channels;
+    bf->samples = len_samples - cfg->seek_samples;
+    bf->bytes = (size_t)bf->samples * channels * sample_size;
+
+fail:
+    if (outfile) {
+        fclose(outfile);
+        if (bf->error)
+            remove(bf->tempfilename);
     }
+    vgm_mutex_lock(bf->open_lock);
+    close_vgmstream(vgmstream);
+    vgm_mutex_unlock(bf->open_lock);
+    free(buf);
+}
+
+typedef struct {
+    char ** names;
+    int count;
+    int max;
+} batch_names;
+
+static int is_name_used(batch_names * used, const char * name) {
+    int i;
+    for (i = 0; i < used->count; i++) {
+        if (strcmp(used->names[i], name) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+/* Renames the temp file to the output name, or to name_N.ext if another file of the batch took it. */
+static const char * batch_rename_output(batch_names * used, batch_file * bf) {
+    char name[PATH_LIMIT];
+    char * copy;
+    int number = 1;
+
+    strcpy(name, bf->outfilename);
+    while (is_name_used(used, name)) {
+        const char * base = strrchr(bf->outfilename, DIR_SEPARATOR);
+        const char * ext = strrchr(base ? base : bf->outfilename, '.');
+        int len = ext ? (int)(ext - bf->outfilename) : (int)strlen(bf->outfilename);
+
+        number++;
+        if (snprintf(name, PATH_LIMIT, "%.*s_%d%s", len, bf->outfilename, number, ext ? ext : "") >= PATH_LIMIT)
+            return "output name too long";
+    }
+
+    if (used->count == used->max) {
+        int max = used->max ? used->max * 2 : 64;
+        char ** names = realloc(used->names, max * sizeof(char*));
+        if (!names) return "failed allocating output name";
+        used->names = names;
+        used->max = max;
+    }
+    copy = malloc(strlen(name) + 1);
+    if (!copy) return "failed allocating output name";
+    strcpy(copy, name);
+    used->names[used->count++] = copy;
+
+    /* overwritten like when writing it directly (rename may not replace files) */
+    remove(name);
+    if (rename(bf->tempfilename, name) != 0)
+        return "failed renaming output";
+
+    strcpy(bf->outfilename, name);
+    return NULL;
+}
+
+static void free_batch_names(batch_names * used) {
+    int i;
+    for (i = 0; i < used->count; i++) {
+        free(used->names[i]);
+    }
+    free(used->names);
+}
+
+/* gets the next input file (from args, stdin or the bank's subsongs), returns 0 when done */
+static int batch_next_file(cli_config * cfg, int index, batch_file * bf, VGMSTREAM * bank, int subsong_last) {
+    char * dst = bf->infilename;
+
+    if (bank) {
+        int subsong = bank->stream_index + index;
+        if (subsong > subsong_last)
+            return 0;
+        strncpy(dst, cfg->infilename, PATH_LIMIT - 1);
+        dst[PATH_LIMIT - 1] = '\0';
+        bf->bank = bank;
+        bf->subsong = subsong;
+        return 1;
+    }
+
+    if (cfg->batch_list) {
+        while (fgets(dst, PATH_LIMIT, stdin)) {
+            size_t len = strlen(dst);
+            while (len > 0 && (dst[len-1] == '\n' || dst[len-1] == '\r'))
+                dst[--len] = '\0';
+            if (len > 0)
+                return 1;
+        }
+        return 0;
+    }
+
+    if (index >= cfg->infilename_count)
+        return 0;
+    strncpy(dst, cfg->infilenames[index], PATH_LIMIT - 1);
+    dst[PATH_LIMIT - 1] = '\0';
+    return 1;
 }
 
-void apply_fade(sample * buf, VGMSTREAM * vgmstream, int to_get, int i, int len_samples, int fade_samples) {
-    if (vgmstream->loop_flag && fade_samples > 0) {
-        int samples_into_fade = i - (len_samples - fade_samples);
-        if (samples_into_fade + to_get > 0) {
-            int j, k;
-            for (j = 0; j < to_get; j++, samples_into_fade++) {
-                if (samples_into_fade > 0) {
-                    double fadedness = (double)(fade_samples - samples_into_fade) / fade_samples;
-                    for (k = 0; k < vgmstream->channels; k++) {
-                        buf[j*vgmstream->channels+k] = (sample)buf[j*vgmstream->channels+k]*fadedness;
-                    }
-                }
+static int batch_main(cli_config * cfg) {
+    vgm_pool * pool = NULL;
+    batch_file * files = NULL;
+    batch_names used = {0};
+    VGMSTREAM * bank = NULL;
+    int threads, count = 0, done = 0, failed = 0, eof = 0;
+    int subsong_last = 0;
+    double total_samples = 0, total_bytes = 0, seconds;
+    uint64_t clock_start;
+    vgm_mutex * open_lock = NULL;
+
+    /* open the bank once to get its subsongs and format */
+    if (cfg->export_subsongs) {
+        STREAMFILE *streamFile = open_stdio_streamfile(cfg->infilename);
+        if (!streamFile) {
+            fprintf(stderr,"file %s not found\n",cfg->infilename);
+            goto fail;
+        }
+
+        streamFile->stream_index = cfg->stream_index;
+        bank = init_vgmstream_from_STREAMFILE(streamFile);
+        close_streamfile(streamFile);
+
+        if (!bank) {
+            fprintf(stderr,"failed opening %s\n",cfg->infilename);
+            goto fail;
+        }
+
+        if (bank->stream_index <= 0)
+            bank->stream_index = 1;
+        subsong_last = bank->num_streams > 0 ? bank->num_streams : 1;
+        if (cfg->subsong_end > 0 && cfg->subsong_end < subsong_last)
+            subsong_last = cfg->subsong_end;
+        if (bank->stream_index > subsong_last) {
+            fprintf(stderr,"no subsongs to export (file has %d)\n", bank->num_streams);
+            goto fail;
+        }
+
+        printf("exporting subsongs %d to %d of %s\n", bank->stream_index, subsong_last, cfg->infilename);
+    }
+
+    pool = vgm_pool_acquire();
+    threads = cfg->batch_threads > 0 ? cfg->batch_threads : vgm_pool_threads(pool);
+
+    files = calloc(threads, sizeof(batch_file));
+    if (!files) goto fail;
+
+    open_lock = vgm_mutex_new();
+    if (!open_lock) goto fail;
+
+    clock_start = vgm_clock_us64();
+    while (1) {
+        /* fill free slots */
+        while (!eof && count - done < threads) {
+            batch_file * bf = &files[count % threads];
+
+            memset(bf, 0, sizeof(batch_file));
+            if (!batch_next_file(cfg, count, bf, bank, subsong_last)) {
+                eof = 1;
+                break;
+            }
+
+            bf->cfg = *cfg;
+            bf->index = count;
+            bf->open_lock = open_lock;
+            vgm_task_submit(pool, &bf->task, batch_decode, bf);
+            count++;
+        }
+
+        if (done == count)
+            break;
+
+        /* report the oldest file, so results are in order */
+        {
+            batch_file * bf = &files[done % threads];
+
+            vgm_task_wait(pool, &bf->task);
+
+            if (!bf->error) {
+                bf->error = batch_rename_output(&used, bf);
+                if (bf->error)
+                    remove(bf->tempfilename);
             }
+
+            if (bf->error) {
+                if (bf->bank)
+                    fprintf(stderr,"%s: %s (subsong %d)\n", bf->error, bf->infilename, bf->subsong);
+                else
+                    fprintf(stderr,"%s: %s\n", bf->error, bf->infilename);
+                failed++;
+            }
+            else {
+                printf("decoded %s (%d samples)\n", bf->outfilename, bf->samples);
+                total_samples += bf->samples;
+                total_bytes += bf->bytes;
+            }
+            done++;
         }
     }
+    seconds = (vgm_clock_us64() - clock_start) / 1000000.0;
+
+    printf("batch: %d files (%d failed) in %.2f seconds: %.2f files/s, %.0f samples/s, %.2f MB/s\n",
+            done, failed, seconds,
+            seconds > 0 ? done / seconds : 0,
+            seconds > 0 ? total_samples / seconds : 0,
+            seconds > 0 ? total_bytes / seconds / (1024*1024) : 0);
+
+    free(files);
+    free_batch_names(&used);
+    vgm_pool_release(pool);
+    vgm_mutex_free(open_lock);
+    close_vgmstream(bank);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+
+fail:
+    free(files);
+    free_batch_names(&used);
+    vgm_pool_release(pool);
+    vgm_mutex_free(open_lock);
+    close_vgmstream(bank);
+    return EXIT_FAILURE;
 }
 
 int main(int argc, char ** argv) {
@@ -328,10 +796,8 @@ int main(int argc, char ** argv) {
     FILE * outfile = NULL;
     char outfilename_temp[PATH_LIMIT];
 
-    sample * buf = NULL;
+    void * buf = NULL;
     int32_t len_samples;
-    int32_t fade_samples;
-    int i, j;
 
     cli_config cfg = {0};
     int res;
@@ -351,6 +817,8 @@ int main(int argc, char ** argv) {
     res = validate_config(&cfg);
     if (!res) goto fail;
 
+    if (cfg.batch_mode)
+        return batch_main(&cfg);
 
     /* open streamfile and pass subsong */
     {
@@ -375,6 +843,17 @@ int main(int argc, char ** argv) {
     /* modify the VGMSTREAM if needed */
     apply_config(vgmstream, &cfg);
 
+    /* layers are independent so output is the same, just faster (if threads are available) */
+    vgmstream_enable_layer_threads(vgmstream, LAYER_BUFFER_SAMPLES);
+
+    /* same for preparing the next segment (ignored if not segmented) */
+    if (cfg.segment_prefetch > 0)
+        vgmstream_enable_segment_prefetch(vgmstream, cfg.segment_prefetch);
+
+    /* loops after the second one are copied rather than decoded (ignored if not looping) */
+    if (!cfg.float_wav)
+        vgmstream_enable_loop_cache(vgmstream, 0);
+
     if (cfg.play_forever && (!vgmstream->loop_flag || vgmstream->loop_target > 0)) {
         fprintf(stderr,"I could play a nonlooped track forever, but it wouldn't end well.");
         goto fail;
@@ -386,12 +865,9 @@ int main(int argc, char ** argv) {
         outfile = stdout;
     }
     else if (!cfg.print_metaonly) {
-        if (!cfg.outfilename) {
-            /* note that outfilename_temp must persist outside this block, hence the external array */
-            strcpy(outfilename_temp, cfg.infilename);
-            strcat(outfilename_temp, ".wav");
-            cfg.outfilename = outfilename_temp;
-        }
+        /* note that outfilename_temp must persist outside this block, hence the external array */
+        make_outfilename(outfilename_temp, PATH_LIMIT, cfg.outfilename ? cfg.outfilename : "?f.wav", cfg.infilename, vgmstream);
+        cfg.outfilename = outfilename_temp;
 
         outfile = fopen(cfg.outfilename,"wb");
         if (!outfile) {
@@ -412,77 +888,50 @@ int main(int argc, char ** argv) {
 
 
     /* get final play config */
-    len_samples = get_vgmstream_play_samples(cfg.loop_count,cfg.fade_time,cfg.fade_delay,vgmstream);
-    fade_samples = (int32_t)(cfg.fade_time < 0 ? 0 : cfg.fade_time * vgmstream->sample_rate);
+    len_samples = vgmstream_get_play_samples(vgmstream);
 
     if (!cfg.play_sdtout && !cfg.print_adxencd && !cfg.print_oggenc && !cfg.print_batchvar) {
         printf("samples to play: %d (%.4lf seconds)\n", len_samples, (double)len_samples / vgmstream->sample_rate);
     }
 
+    if (cfg.seek_samples > len_samples)
+        cfg.seek_samples = len_samples;
+
 
     /* last init */
-    buf = malloc(BUFFER_SAMPLES*sizeof(sample)*vgmstream->channels);
+    buf = malloc(BUFFER_SAMPLES*(cfg.float_wav ? sizeof(float) : sizeof(sample))*vgmstream->channels);
     if (!buf) {
         fprintf(stderr,"failed allocating output buffer\n");
         goto fail;;
     }
 
-    /* slap on a .wav header */
-    {
-        uint8_t wav_buf[0x100];
-        int channels = (cfg.only_stereo != -1) ? 2 : vgmstream->channels;
-        size_t bytes_done;
-
-        bytes_done = make_wav_header(wav_buf,0x100,
-                len_samples, vgmstream->sample_rate, channels,
-                cfg.write_lwav, cfg.lwav_loop_start, cfg.lwav_loop_end);
-
-        fwrite(wav_buf,sizeof(uint8_t),bytes_done,outfile);
+    /* skip the start (also done when looping forever) */
+    if (cfg.seek_samples > 0) {
+        vgmstream_build_block_index(vgmstream); /* blocked layouts can jump to blocks (ignored if not supported) */
+        vgmstream_seek(vgmstream, cfg.seek_samples);
     }
 
 
     /* decode forever */
-    while (cfg.play_forever) {
-        int to_get = BUFFER_SAMPLES;
-
-        render_vgmstream(buf,to_get,vgmstream);
-
-        swap_samples_le(buf,vgmstream->channels*to_get); /* write PC endian */
-        if (cfg.only_stereo != -1) {
-            for (j = 0; j < to_get; j++) {
-                fwrite(buf+j*vgmstream->channels+(cfg.only_stereo*2),sizeof(sample),2,outfile);
-            }
-        } else {
-            fwrite(buf,sizeof(sample)*vgmstream->channels,to_get,outfile);
+    if (cfg.play_forever) {
+        write_wav_header(vgmstream, &cfg, len_samples, outfile);
+        while (1) {
+            render_and_write(vgmstream, &cfg, buf, BUFFER_SAMPLES, outfile);
         }
     }
 
 
     /* decode */
-    for (i = 0; i < len_samples; i += BUFFER_SAMPLES) {
-        int to_get = BUFFER_SAMPLES;
-        if (i + BUFFER_SAMPLES > len_samples)
-            to_get = len_samples - i;
-
-        render_vgmstream(buf,to_get,vgmstream);
-
-        apply_fade(buf, vgmstream, to_get, i, len_samples, fade_samples);
-
-        swap_samples_le(buf,vgmstream->channels*to_get); /* write PC endian */
-        if (cfg.only_stereo != -1) {
-            for (j = 0; j < to_get; j++) {
-                fwrite(buf+j*vgmstream->channels+(cfg.only_stereo*2),sizeof(sample),2,outfile);
-            }
-        } else {
-            fwrite(buf,sizeof(sample)*vgmstream->channels,to_get,outfile);
-        }
-    }
+    write_wav(vgmstream, &cfg, buf, len_samples, outfile);
 
     fclose(outfile);
     outfile = NULL;
 
+    if (cfg.segment_prefetch > 0 && !cfg.play_sdtout)
+        print_segment_stats(vgmstream);
+
 
-    /* try again with (for testing reset_vgmstream, simulates a seek to 0) */
+    /* try again after seeking back to the start position (for testing vgmstream_seek/reset) */
     if (cfg.test_reset) {
         char outfilename_temp[PATH_LIMIT];
         strcpy(outfilename_temp, cfg.outfilename);
@@ -494,44 +943,10 @@ int main(int argc, char ** argv) {
             goto fail;
         }
 
-        reset_vgmstream(vgmstream);
+        /* loop config set by apply_config is kept when seeking */
+        vgmstream_seek(vgmstream, cfg.seek_samples);
 
-        /* vgmstream manipulations are undone by reset */
-        apply_config(vgmstream, &cfg);
-
-
-        /* slap on a .wav header */
-        {
-            uint8_t wav_buf[0x100];
-            int channels = (cfg.only_stereo != -1) ? 2 : vgmstream->channels;
-            size_t bytes_done;
-
-            bytes_done = make_wav_header(wav_buf,0x100,
-                    len_samples, vgmstream->sample_rate, channels,
-                    cfg.write_lwav, cfg.lwav_loop_start, cfg.lwav_loop_end);
-
-            fwrite(wav_buf,sizeof(uint8_t),bytes_done,outfile);
-        }
-
-        /* decode */
-        for (i = 0; i < len_samples; i += BUFFER_SAMPLES) {
-            int to_get = BUFFER_SAMPLES;
-            if (i + BUFFER_SAMPLES > len_samples)
-                to_get = len_samples - i;
-
-            render_vgmstream(buf,to_get,vgmstream);
-
-            apply_fade(buf, vgmstream, to_get, i, len_samples, fade_samples);
-
-            swap_samples_le(buf,vgmstream->channels*to_get); /* write PC endian */
-            if (cfg.only_stereo != -1) {
-                for (j = 0; j < to_get; j++) {
-                    fwrite(buf+j*vgmstream->channels+(cfg.only_stereo*2),sizeof(sample),2,outfile);
-                }
-            } else {
-                fwrite(buf,sizeof(sample)*vgmstream->channels,to_get,outfile);
-            }
-        }
+        write_wav(vgmstream, &cfg, buf, len_samples, outfile);
         fclose(outfile);
         outfile = NULL;
     }
@@ -576,10 +991,11 @@ static void make_smpl_chunk(uint8_t * buf, int32_t loop_start, int32_t loop_end)
 }
 
 /* make a RIFF header for .wav */
-static size_t make_wav_header(uint8_t * buf, size_t buf_size, int32_t sample_count, int32_t sample_rate, int channels, int smpl_chunk, int32_t loop_start, int32_t loop_end) {
+static size_t make_wav_header(uint8_t * buf, size_t buf_size, int32_t sample_count, int32_t sample_rate, int channels, int smpl_chunk, int32_t loop_start, int32_t loop_end, int float_wav) {
     size_t data_size, header_size;
+    size_t sample_size = float_wav ? sizeof(float) : sizeof(sample);
 
-    data_size = sample_count*channels*sizeof(sample);
+    data_size = sample_count*channels*sample_size;
     header_size = 0x2c;
     if (smpl_chunk && loop_end)
         header_size += 0x3c+ 0x08;
@@ -594,12 +1010,12 @@ static size_t make_wav_header(uint8_t * buf, size_t buf_size, int32_t sample_cou
 
     memcpy(buf+0x0c, "fmt ", 4); /* WAVE fmt chunk */
     put_32bitLE(buf+0x10, 0x10); /* size of WAVE fmt chunk */
-    put_16bitLE(buf+0x14, 1); /* compression code 1=PCM */
+    put_16bitLE(buf+0x14, float_wav ? 3 : 1); /* compression code 1=PCM, 3=IEEE float */
     put_16bitLE(buf+0x16, channels); /* channel count */
     put_32bitLE(buf+0x18, sample_rate); /* sample rate */
-    put_32bitLE(buf+0x1c, sample_rate*channels*sizeof(sample)); /* bytes per second */
-    put_16bitLE(buf+0x20, (int16_t)(channels*sizeof(sample))); /* block align */
-    put_16bitLE(buf+0x22, sizeof(sample)*8); /* significant bits per sample */
+    put_32bitLE(buf+0x1c, sample_rate*channels*sample_size); /* bytes per second */
+    put_16bitLE(buf+0x20, (int16_t)(channels*sample_size)); /* block align */
+    put_16bitLE(buf+0x22, sample_size*8); /* significant bits per sample */
 
     if (smpl_chunk && loop_end) {
         make_smpl_chunk(buf+0x24, loop_start, loop_end);
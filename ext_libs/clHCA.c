@@ -34,6 +34,18 @@
 
 #define HCA_MAX_CHANNELS  16 /* internal max? in practice only 8 can be encoded */
 
+/* SIMD versions of the float loops, selected at compile time (SSE2 is always there in x86-64 and NEON in
+ * ARM64). They do the same float ops in the same order so output is bit-exact vs the scalar code, unless the
+ * compiler contracts the scalar code's mul+add into FMA (ex. some ARM builds), then it's within 1 ulp.
+ * Define HCA_NO_SIMD to force the scalar code. */
+#if !defined(HCA_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define HCA_SIMD_SSE2 1
+#elif !defined(HCA_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define HCA_SIMD_NEON 1
+#endif
+
 //--------------------------------------------------
 // Decoder config/state
 //--------------------------------------------------
@@ -119,6 +131,38 @@ typedef struct clData {
 } clData; 
 
 
+//--------------------------------------------------
+// SIMD helpers
+//--------------------------------------------------
+#if defined(HCA_SIMD_SSE2)
+#define HCA_SIMD 1
+typedef __m128 v4f;
+#define V_LOAD(p)       _mm_loadu_ps(p)
+#define V_STORE(p,v)    _mm_storeu_ps(p,v)
+#define V_SET1(f)       _mm_set1_ps(f)
+#define V_ADD(a,b)      _mm_add_ps(a,b)
+#define V_SUB(a,b)      _mm_sub_ps(a,b)
+#define V_MUL(a,b)      _mm_mul_ps(a,b)
+#define V_REVERSE(v)    _mm_shuffle_ps(v,v, _MM_SHUFFLE(0,1,2,3))
+#define V_EVEN(a,b)     _mm_shuffle_ps(a,b, _MM_SHUFFLE(2,0,2,0)) /* a0 a2 b0 b2 */
+#define V_ODD(a,b)      _mm_shuffle_ps(a,b, _MM_SHUFFLE(3,1,3,1)) /* a1 a3 b1 b3 */
+#elif defined(HCA_SIMD_NEON)
+#define HCA_SIMD 1
+typedef float32x4_t v4f;
+#define V_LOAD(p)       vld1q_f32(p)
+#define V_STORE(p,v)    vst1q_f32(p,v)
+#define V_SET1(f)       vdupq_n_f32(f)
+#define V_ADD(a,b)      vaddq_f32(a,b)
+#define V_SUB(a,b)      vsubq_f32(a,b)
+#define V_MUL(a,b)      vmulq_f32(a,b)
+#define V_REVERSE(v)    vcombine_f32(vget_high_f32(vrev64q_f32(v)), vget_low_f32(vrev64q_f32(v)))
+#define V_EVEN(a,b)     vuzpq_f32(a,b).val[0]
+#define V_ODD(a,b)      vuzpq_f32(a,b).val[1]
+#else
+#define HCA_SIMD 0
+#endif
+
+
 //--------------------------------------------------
 // Checksum
 //--------------------------------------------------
@@ -275,12 +319,72 @@ int clHCA_getInfo(clHCA *hca, clHCA_stInfo *info) {
     return 0;
 }
 
+#if defined(HCA_SIMD_SSE2) || defined(HCA_SIMD_NEON)
+/* clamp to +-1, scale and truncate, then saturate to 16-bit (same as scalar) */
+static void read_samples16_simd(clHCA *hca, signed short *samples) {
+    unsigned int i, j;
+#if defined(HCA_SIMD_SSE2)
+    const __m128 max = _mm_set1_ps(1.0f);
+    const __m128 min = _mm_set1_ps(-1.0f);
+    const __m128 scale = _mm_set1_ps(32768.0f);
+#define V_TO_S32(v) _mm_cvttps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(v, min), max), scale))
+#else
+    const float32x4_t max = vdupq_n_f32(1.0f);
+    const float32x4_t min = vdupq_n_f32(-1.0f);
+    const float32x4_t scale = vdupq_n_f32(32768.0f);
+#define V_TO_S32(v) vcvtq_s32_f32(vmulq_f32(vminq_f32(vmaxq_f32(v, min), max), scale))
+#endif
+
+    for (i = 0; i < HCA_SUBFRAMES_PER_FRAME; i++) {
+        const float *wave_l = hca->channel[0].wave[i];
+        const float *wave_r = hca->channel[1].wave[i];
+
+        for (j = 0; j < HCA_SAMPLES_PER_SUBFRAME; j += 4) {
+#if defined(HCA_SIMD_SSE2)
+            if (hca->channels == 1) {
+                __m128i s = V_TO_S32(_mm_loadu_ps(&wave_l[j]));
+                _mm_storel_epi64((__m128i*)samples, _mm_packs_epi32(s, s));
+                samples += 4;
+            }
+            else {
+                __m128i s_l = V_TO_S32(_mm_loadu_ps(&wave_l[j]));
+                __m128i s_r = V_TO_S32(_mm_loadu_ps(&wave_r[j]));
+                _mm_storeu_si128((__m128i*)samples, _mm_unpacklo_epi16(_mm_packs_epi32(s_l, s_l), _mm_packs_epi32(s_r, s_r)));
+                samples += 8;
+            }
+#else
+            if (hca->channels == 1) {
+                vst1_s16(samples, vqmovn_s32(V_TO_S32(vld1q_f32(&wave_l[j]))));
+                samples += 4;
+            }
+            else {
+                int16x4x2_t s;
+                s.val[0] = vqmovn_s32(V_TO_S32(vld1q_f32(&wave_l[j])));
+                s.val[1] = vqmovn_s32(V_TO_S32(vld1q_f32(&wave_r[j])));
+                vst2_s16(samples, s);
+                samples += 8;
+            }
+#endif
+        }
+    }
+#undef V_TO_S32
+}
+#endif
+
 void clHCA_ReadSamples16(clHCA *hca, signed short *samples) {
     const float scale = 32768.0f;
     float f;
     signed int s;
     unsigned int i, j, k;
 
+#if defined(HCA_SIMD_SSE2) || defined(HCA_SIMD_NEON)
+    /* most common layouts (multichannel is rarer and needs more shuffling) */
+    if (hca->channels == 1 || hca->channels == 2) {
+        read_samples16_simd(hca, samples);
+        return;
+    }
+#endif
+
     for (i = 0; i < HCA_SUBFRAMES_PER_FRAME; i++) {
         for (j = 0; j < HCA_SAMPLES_PER_SUBFRAME; j++) {
             for (k = 0; k < hca->channels; k++) {
@@ -300,6 +404,18 @@ void clHCA_ReadSamples16(clHCA *hca, signed short *samples) {
     }
 }
 
+void clHCA_ReadSamplesFloat(clHCA *hca, float *samples) {
+    unsigned int i, j, k;
+
+    for (i = 0; i < HCA_SUBFRAMES_PER_FRAME; i++) {
+        for (j = 0; j < HCA_SAMPLES_PER_SUBFRAME; j++) {
+            for (k = 0; k < hca->channels; k++) {
+                *samples++ = hca->channel[k].wave[i][j];
+            }
+        }
+    }
+}
+
 
 //--------------------------------------------------
 // Allocation and creation
@@ -1261,9 +1377,23 @@ static void decode2_dequantize_coefficients(stChannel *ch, clData *br) {
             qc = (float)signed_code;
         }
 
+#if HCA_SIMD
+        ch->spectra[i] = qc; /* applied below */
+#else
         /* dequantize coef with gain */
         ch->spectra[i] = ch->gain[i] * qc;
+#endif
+    }
+
+#if HCA_SIMD
+    /* dequantize coefs with gain */
+    for (i = 0; i + 4 <= csf_count; i += 4) {
+        V_STORE(&ch->spectra[i], V_MUL(V_LOAD(&ch->gain[i]), V_LOAD(&ch->spectra[i])));
+    }
+    for (; i < csf_count; i++) {
+        ch->spectra[i] = ch->gain[i] * ch->spectra[i];
     }
+#endif
 
     /* clean rest of spectra */
     memset(&ch->spectra[csf_count], 0, sizeof(ch->spectra[0]) * (HCA_SAMPLES_PER_SUBFRAME - csf_count));
@@ -1352,7 +1482,19 @@ static void decode4_apply_intensity_stereo(stChannel *ch_pair, int subframe,
         float *sp_r = ch_pair[1].spectra;
         unsigned int band;
 
-        for (band = base_band_count; band < total_band_count; band++) {
+        band = base_band_count;
+#if HCA_SIMD
+        {
+            v4f v_ratio_l = V_SET1(ratio_l);
+            v4f v_ratio_r = V_SET1(ratio_r);
+            for (; band + 4 <= total_band_count; band += 4) {
+                v4f l = V_LOAD(&sp_l[band]);
+                V_STORE(&sp_r[band], V_MUL(l, v_ratio_r));
+                V_STORE(&sp_l[band], V_MUL(l, v_ratio_l));
+            }
+        }
+#endif
+        for (; band < total_band_count; band++) {
             sp_r[band] = sp_l[band] * ratio_r;
             sp_l[band] = sp_l[band] * ratio_l;
         }
@@ -1543,7 +1685,21 @@ static void decoder5_run_imdct(stChannel *ch, int subframe) {
             float *d2 = &temp2a[count2a];
 
             for (j = 0; j < count1a; j++) {
-                for (k = 0; k < count2a; k++) {
+                k = 0;
+#if HCA_SIMD
+                for (; k + 4 <= count2a; k += 4) {
+                    v4f v0 = V_LOAD(temp1a + 0);
+                    v4f v1 = V_LOAD(temp1a + 4);
+                    v4f a = V_EVEN(v0, v1);
+                    v4f b = V_ODD(v0, v1);
+                    V_STORE(d1, V_ADD(b, a));
+                    V_STORE(d2, V_SUB(a, b));
+                    temp1a += 8;
+                    d1 += 4;
+                    d2 += 4;
+                }
+#endif
+                for (; k < count2a; k++) {
                     float a = *(temp1a++);
                     float b = *(temp1a++);
                     *(d1++) = b + a;
@@ -1574,7 +1730,24 @@ static void decoder5_run_imdct(stChannel *ch, int subframe) {
             const float *s2 = &temp1b[count2b];
 
             for (j = 0; j < count1b; j++) {
-                for (k = 0; k < count2b; k++) {
+                k = 0;
+#if HCA_SIMD
+                for (; k + 4 <= count2b; k += 4) {
+                    v4f a = V_LOAD(s1);
+                    v4f b = V_LOAD(s2);
+                    v4f sin = V_LOAD(sin_table);
+                    v4f cos = V_LOAD(cos_table);
+                    V_STORE(d1, V_SUB(V_MUL(a, sin), V_MUL(b, cos)));
+                    V_STORE(d2 - 3, V_REVERSE(V_ADD(V_MUL(a, cos), V_MUL(b, sin)))); /* d2 goes backwards */
+                    s1 += 4;
+                    s2 += 4;
+                    sin_table += 4;
+                    cos_table += 4;
+                    d1 += 4;
+                    d2 -= 4;
+                }
+#endif
+                for (; k < count2b; k++) {
                     float a = *(s1++);
                     float b = *(s2++);
                     float sin = *(sin_table++);
@@ -1606,12 +1779,33 @@ static void decoder5_run_imdct(stChannel *ch, int subframe) {
     {
         unsigned int i;
 
+#if HCA_SIMD
+        for (i = 0; i < half; i += 4) { /* half is a multiple of 4 */
+            /* reversed reads go from [x - 3] to [x] */
+            v4f dct_a = V_LOAD(&ch->dct[i + half]);
+            v4f dct_b = V_REVERSE(V_LOAD(&ch->dct[size - 1 - i - 3]));
+            v4f dct_c = V_REVERSE(V_LOAD(&ch->dct[half - i - 1 - 3]));
+            v4f dct_d = V_LOAD(&ch->dct[i]);
+            v4f win_a = V_LOAD(&decode5_imdct_window[i]);
+            v4f win_b = V_LOAD(&decode5_imdct_window[i + half]);
+            v4f win_c = V_REVERSE(V_LOAD(&decode5_imdct_window[size - 1 - i - 3]));
+            v4f win_d = V_REVERSE(V_LOAD(&decode5_imdct_window[half - i - 1 - 3]));
+            v4f prev_a = V_LOAD(&ch->imdct_previous[i]);
+            v4f prev_b = V_LOAD(&ch->imdct_previous[i + half]);
+
+            V_STORE(&ch->wave[subframe][i], V_ADD(V_MUL(win_a, dct_a), prev_a));
+            V_STORE(&ch->wave[subframe][i + half], V_SUB(V_MUL(win_b, dct_b), prev_b));
+            V_STORE(&ch->imdct_previous[i], V_MUL(win_c, dct_c));
+            V_STORE(&ch->imdct_previous[i + half], V_MUL(win_d, dct_d));
+        }
+#else
         for (i = 0; i < half; i++) {
             ch->wave[subframe][i] = decode5_imdct_window[i] * ch->dct[i + half] + ch->imdct_previous[i];
             ch->wave[subframe][i + half] = decode5_imdct_window[i + half] * ch->dct[size - 1 - i] - ch->imdct_previous[i + half];
             ch->imdct_previous[i] = decode5_imdct_window[size - 1 - i] * ch->dct[half - i - 1];
             ch->imdct_previous[i + half] = decode5_imdct_window[half - i - 1] * ch->dct[i];
         }
+#endif
 #if 0
         /* over-optimized IMDCT (for reference), barely noticeable even when decoding hundred of files */
         const float *imdct_window = decode5_imdct_window;
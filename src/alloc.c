@@ -0,0 +1,534 @@
+#include <stdlib.h>
+#include <string.h>
+#include "alloc.h"
+#include "threads.h"
+
+/* Each allocation is prefixed by a header with its size and scope, so frees (that may happen anywhere,
+ * ex. a layer's buffer freed on close) update the right counters and use the right allocator.
+ *
+ * While a stream is opened its scope uses a probe arena: small allocations are bumped from big chunks,
+ * and everything a failed meta allocated is dropped at once (including leaks). What the successful meta
+ * allocated stays in the chunks, which are freed with the scope.
+ *
+ * Each scope has its own lock (its stream may allocate from layer threads, and free from anywhere), taken
+ * once per call. Only the global scope uses the global lock. */
+
+#define ARENA_CHUNK_SIZE    0x20000     /* fits a few STREAMFILE buffers and most metas' data */
+#define ARENA_MAX_ALLOC     0x8000      /* bigger ones (ex. decode buffers) go to the allocator */
+#define ARENA_MAX_SIZE      0x200000    /* past this the arena stops growing */
+
+/* The current scope is per thread in all builds, as players open and decode from their own threads.
+ * Windows uses a TLS slot (__declspec(thread) fails in DLLs loaded at runtime before Vista, like
+ * plugins). Without any thread-local storage scopes are off: all goes to the global scope. */
+#if defined(_WIN32)
+  #include <windows.h>
+  #define ALLOC_TLS_SLOT
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+  #define VGM_THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__)
+  #define VGM_THREAD_LOCAL __thread
+#else
+  #define ALLOC_NO_SCOPES
+#endif
+
+typedef struct arena_chunk {
+    struct arena_chunk * prev;
+    size_t used;
+} arena_chunk;
+
+struct vgm_alloc_scope {
+    vgmstream_allocator allocator;
+    vgmstream_alloc_stats stats;
+    int refs;
+    vgm_mutex * lock;               /* NULL in the global scope */
+
+    /* probe arena */
+    int arena_active;
+    arena_chunk * arena_top;        /* newest chunk */
+    arena_chunk * arena_spare;      /* last chunk dropped by a rollback, for the next probe */
+    size_t arena_size;              /* chunks in use */
+    int32_t arena_count;            /* live allocations in the arena */
+    size_t arena_bytes;             /* live bytes in the arena */
+};
+
+typedef union {
+    struct {
+        vgm_alloc_scope * scope;
+        size_t size;
+    } info;
+    /* keep the data aligned like malloc's */
+    long double align_ld;
+    int64_t align_i64;
+    void * align_ptr;
+} alloc_header;
+
+/* arena blocks are a header plus the data, rounded to keep the next header aligned */
+#define ARENA_ALIGN(size)       ((((size) + sizeof(alloc_header) - 1) / sizeof(alloc_header)) * sizeof(alloc_header))
+#define ARENA_BLOCK_SIZE(size)  (sizeof(alloc_header) + ARENA_ALIGN(size))
+#define ARENA_CHUNK_DATA(chunk) ((uint8_t *)(chunk) + ARENA_ALIGN(sizeof(arena_chunk)))
+
+
+static void * default_malloc(void * ctx, size_t size) {
+    return malloc(size);
+}
+static void * default_realloc(void * ctx, void * ptr, size_t size) {
+    return realloc(ptr, size);
+}
+static void default_free(void * ctx, void * ptr) {
+    free(ptr);
+}
+
+static vgm_alloc_scope g_global_scope = { {default_malloc, default_realloc, default_free, NULL}, {0}, 1, NULL };
+
+static void scope_lock(vgm_alloc_scope * scope) {
+    if (scope->lock)
+        vgm_mutex_lock(scope->lock);
+    else
+        vgm_lock_alloc();
+}
+
+static void scope_unlock(vgm_alloc_scope * scope) {
+    if (scope->lock)
+        vgm_mutex_unlock(scope->lock);
+    else
+        vgm_unlock_alloc();
+}
+
+#if defined(ALLOC_TLS_SLOT)
+static volatile LONG g_scope_slot = (LONG)TLS_OUT_OF_INDEXES;
+
+static DWORD get_scope_slot(void) {
+    if (g_scope_slot == (LONG)TLS_OUT_OF_INDEXES) {
+        DWORD slot = TlsAlloc();
+        if (slot != TLS_OUT_OF_INDEXES && InterlockedCompareExchange(&g_scope_slot, (LONG)slot, (LONG)TLS_OUT_OF_INDEXES) != (LONG)TLS_OUT_OF_INDEXES)
+            TlsFree(slot); /* another thread got one first */
+    }
+    return (DWORD)g_scope_slot;
+}
+
+static vgm_alloc_scope * get_current_scope(void) {
+    DWORD slot = get_scope_slot();
+    return slot != TLS_OUT_OF_INDEXES ? TlsGetValue(slot) : NULL;
+}
+
+static void set_current_scope(vgm_alloc_scope * scope) {
+    DWORD slot = get_scope_slot();
+    if (slot != TLS_OUT_OF_INDEXES)
+        TlsSetValue(slot, scope);
+}
+#elif defined(ALLOC_NO_SCOPES)
+static vgm_alloc_scope * get_current_scope(void) { return NULL; }
+static void set_current_scope(vgm_alloc_scope * scope) { }
+#else
+static VGM_THREAD_LOCAL vgm_alloc_scope * t_current_scope = NULL;
+
+static vgm_alloc_scope * get_current_scope(void) { return t_current_scope; }
+static void set_current_scope(vgm_alloc_scope * scope) { t_current_scope = scope; }
+#endif
+
+
+void vgm_alloc_set_default(const vgmstream_allocator * allocator) {
+    vgmstream_allocator * dst = &g_global_scope.allocator;
+
+    if (allocator && allocator->malloc && allocator->realloc && allocator->free) {
+        *dst = *allocator;
+    }
+    else {
+        dst->malloc = default_malloc;
+        dst->realloc = default_realloc;
+        dst->free = default_free;
+        dst->ctx = NULL;
+    }
+}
+
+/* frees chunks newer than chunk (lock must be held) */
+static void arena_drop_chunks(vgm_alloc_scope * scope, arena_chunk * chunk, int keep_spare) {
+    while (scope->arena_top && scope->arena_top != chunk) {
+        arena_chunk * top = scope->arena_top;
+        scope->arena_top = top->prev;
+        scope->arena_size -= ARENA_CHUNK_SIZE;
+
+        if (keep_spare && !scope->arena_spare) {
+            scope->arena_spare = top;
+        }
+        else {
+            scope->allocator.free(scope->allocator.ctx, top);
+        }
+    }
+
+    if (!keep_spare && scope->arena_spare) {
+        scope->allocator.free(scope->allocator.ctx, scope->arena_spare);
+        scope->arena_spare = NULL;
+    }
+}
+
+/* lock must be held */
+static int is_scope_unused(vgm_alloc_scope * scope) {
+    return scope != &g_global_scope && scope->refs <= 0 && scope->stats.current_count <= 0;
+}
+
+/* once unused (lock must not be held, nothing else can reach it) */
+static void free_scope(vgm_alloc_scope * scope) {
+    arena_drop_chunks(scope, NULL, 0);
+    vgm_mutex_free(scope->lock);
+    scope->allocator.free(scope->allocator.ctx, scope);
+}
+
+vgm_alloc_scope * vgm_alloc_scope_new(const vgmstream_allocator * allocator, size_t max_bytes) {
+    vgm_alloc_scope * scope;
+
+    if (!allocator)
+        allocator = &g_global_scope.allocator;
+
+    scope = allocator->malloc(allocator->ctx, sizeof(vgm_alloc_scope)); /* not counted */
+    if (!scope) return NULL;
+
+    memset(scope, 0, sizeof(vgm_alloc_scope));
+    scope->allocator = *allocator;
+    scope->stats.max_bytes = max_bytes;
+    scope->refs = 1;
+
+    scope->lock = vgm_mutex_new();
+    if (!scope->lock) {
+        allocator->free(allocator->ctx, scope);
+        return NULL;
+    }
+    return scope;
+}
+
+void vgm_alloc_scope_ref(vgm_alloc_scope * scope) {
+    if (!scope) return;
+    scope_lock(scope);
+    scope->refs++;
+    scope_unlock(scope);
+}
+
+void vgm_alloc_scope_unref(vgm_alloc_scope * scope) {
+    int unused;
+    if (!scope) return;
+
+    scope_lock(scope);
+    scope->refs--;
+    unused = is_scope_unused(scope);
+    scope_unlock(scope);
+
+    if (unused)
+        free_scope(scope);
+}
+
+vgm_alloc_scope * vgm_alloc_scope_enter(vgm_alloc_scope * scope) {
+    vgm_alloc_scope * previous = get_current_scope();
+    set_current_scope(scope);
+    return previous;
+}
+
+void vgm_alloc_scope_leave(vgm_alloc_scope * previous) {
+    set_current_scope(previous);
+}
+
+vgm_alloc_scope * vgm_alloc_scope_current(void) {
+    return get_current_scope();
+}
+
+void vgm_alloc_scope_stats(vgm_alloc_scope * scope, vgmstream_alloc_stats * stats) {
+    if (!scope)
+        scope = &g_global_scope;
+    scope_lock(scope);
+    *stats = scope->stats;
+    scope_unlock(scope);
+}
+
+void vgm_alloc_scope_set_limit(vgm_alloc_scope * scope, size_t max_bytes) {
+    if (!scope)
+        scope = &g_global_scope;
+    scope_lock(scope);
+    scope->stats.max_bytes = max_bytes;
+    scope_unlock(scope);
+}
+
+
+/* bumps a block from the arena, NULL if it must come from the allocator (lock must be held) */
+static alloc_header * arena_alloc(vgm_alloc_scope * scope, size_t size) {
+    arena_chunk * chunk = scope->arena_top;
+    size_t block_size;
+    alloc_header * header;
+
+    if (!scope->arena_active || size > ARENA_MAX_ALLOC)
+        return NULL;
+
+    block_size = ARENA_BLOCK_SIZE(size);
+    if (!chunk || chunk->used + block_size > ARENA_CHUNK_SIZE) {
+        if (scope->arena_size + ARENA_CHUNK_SIZE > ARENA_MAX_SIZE)
+            return NULL;
+
+        if (scope->arena_spare) {
+            chunk = scope->arena_spare;
+            scope->arena_spare = NULL;
+        }
+        else {
+            chunk = scope->allocator.malloc(scope->allocator.ctx, ARENA_ALIGN(sizeof(arena_chunk)) + ARENA_CHUNK_SIZE);
+            if (!chunk) return NULL;
+            scope->stats.allocator_count++;
+        }
+
+        chunk->prev = scope->arena_top;
+        chunk->used = 0;
+        scope->arena_top = chunk;
+        scope->arena_size += ARENA_CHUNK_SIZE;
+    }
+
+    header = (alloc_header *)(ARENA_CHUNK_DATA(chunk) + chunk->used);
+    chunk->used += block_size;
+    scope->arena_count++;
+    scope->arena_bytes += size;
+    return header;
+}
+
+/* lock must be held */
+static int arena_owns(vgm_alloc_scope * scope, alloc_header * header) {
+    arena_chunk * chunk = scope->arena_top;
+    uint8_t * ptr = (uint8_t *)header;
+
+    while (chunk) {
+        if (ptr >= ARENA_CHUNK_DATA(chunk) && ptr < ARENA_CHUNK_DATA(chunk) + ARENA_CHUNK_SIZE)
+            return 1;
+        chunk = chunk->prev;
+    }
+    return 0;
+}
+
+/* blocks are only reused if freed in reverse order (ex. temp buffers), otherwise they stay until
+ * a rollback or the scope is freed (lock must be held) */
+static void arena_free(vgm_alloc_scope * scope, alloc_header * header, size_t size) {
+    arena_chunk * chunk = scope->arena_top;
+    uint8_t * ptr = (uint8_t *)header;
+    size_t block_size = ARENA_BLOCK_SIZE(size);
+
+    if (ptr >= ARENA_CHUNK_DATA(chunk) && ptr + block_size == ARENA_CHUNK_DATA(chunk) + chunk->used)
+        chunk->used -= block_size;
+    scope->arena_count--;
+    scope->arena_bytes -= size;
+}
+
+int vgm_alloc_arena_begin(vgm_alloc_scope * scope) {
+    int started = 0;
+    if (!scope) return 0;
+
+    scope_lock(scope);
+    if (!scope->arena_active) {
+        scope->arena_active = 1;
+        started = 1;
+    }
+    scope_unlock(scope);
+    return started;
+}
+
+void vgm_alloc_arena_end(vgm_alloc_scope * scope) {
+    if (!scope) return;
+
+    scope_lock(scope);
+    scope->arena_active = 0;
+    arena_drop_chunks(scope, scope->arena_count ? scope->arena_top : NULL, 0);
+    scope_unlock(scope);
+}
+
+void vgm_alloc_arena_mark(vgm_alloc_scope * scope, vgm_alloc_mark * mark) {
+    memset(mark, 0, sizeof(vgm_alloc_mark));
+    if (!scope) return;
+
+    scope_lock(scope);
+    if (scope->arena_active) {
+        mark->chunk = scope->arena_top;
+        mark->used = scope->arena_top ? scope->arena_top->used : 0;
+        mark->count = scope->arena_count;
+        mark->bytes = scope->arena_bytes;
+    }
+    scope_unlock(scope);
+}
+
+void vgm_alloc_arena_rollback(vgm_alloc_scope * scope, const vgm_alloc_mark * mark) {
+    if (!scope) return;
+
+    scope_lock(scope);
+    if (scope->arena_active) {
+        arena_drop_chunks(scope, mark->chunk, 1);
+        if (scope->arena_top)
+            scope->arena_top->used = mark->used;
+
+        /* whatever is left was leaked by the probe */
+        scope->stats.current_count -= scope->arena_count - mark->count;
+        scope->stats.current_bytes -= scope->arena_bytes - mark->bytes;
+        scope->arena_count = mark->count;
+        scope->arena_bytes = mark->bytes;
+    }
+    scope_unlock(scope);
+}
+
+
+/* counts bytes allocated in the scope, or fails if over its limit (lock must be held) */
+static int scope_add(vgm_alloc_scope * scope, size_t bytes, int is_new) {
+    vgmstream_alloc_stats * stats = &scope->stats;
+
+    if (stats->max_bytes && stats->current_bytes + bytes > stats->max_bytes) {
+        stats->failed_count++;
+        return 0;
+    }
+
+    stats->current_bytes += bytes;
+    if (stats->current_bytes > stats->peak_bytes)
+        stats->peak_bytes = stats->current_bytes;
+    if (is_new)
+        stats->current_count++;
+    stats->total_count++;
+    return 1;
+}
+
+/* returns if the scope may be freed now (lock must be held) */
+static int scope_sub(vgm_alloc_scope * scope, size_t bytes, int is_freed) {
+    vgmstream_alloc_stats * stats = &scope->stats;
+
+    stats->current_bytes -= bytes;
+    if (is_freed)
+        stats->current_count--;
+    return is_scope_unused(scope);
+}
+
+/* undoes scope_add after the allocator fails */
+static void scope_failed(vgm_alloc_scope * scope, size_t bytes, int is_new) {
+    int unused;
+
+    scope_lock(scope);
+    scope->stats.failed_count++;
+    unused = scope_sub(scope, bytes, is_new);
+    scope_unlock(scope);
+
+    if (unused)
+        free_scope(scope);
+}
+
+
+static void * scope_malloc(vgm_alloc_scope * scope, size_t size) {
+    alloc_header * header = NULL;
+    int ok;
+
+    if (size > (size_t)-1 - sizeof(alloc_header))
+        return NULL;
+
+    scope_lock(scope);
+    ok = scope_add(scope, size, 1);
+    if (ok) {
+        header = arena_alloc(scope, size);
+        if (!header)
+            scope->stats.allocator_count++;
+    }
+    scope_unlock(scope);
+    if (!ok)
+        return NULL;
+
+    if (!header) {
+        header = scope->allocator.malloc(scope->allocator.ctx, sizeof(alloc_header) + size);
+        if (!header) {
+            scope_failed(scope, size, 1);
+            return NULL;
+        }
+    }
+
+    header->info.scope = scope;
+    header->info.size = size;
+    return header + 1;
+}
+
+void * vgm_malloc(size_t size) {
+    vgm_alloc_scope * scope = get_current_scope();
+    return scope_malloc(scope ? scope : &g_global_scope, size);
+}
+
+void * vgm_calloc(size_t count, size_t size) {
+    void * ptr;
+
+    if (size && count > (size_t)-1 / size)
+        return NULL;
+
+    ptr = vgm_malloc(count * size);
+    if (ptr)
+        memset(ptr, 0, count * size);
+    return ptr;
+}
+
+void * vgm_realloc(void * ptr, size_t size) {
+    alloc_header * header, * new_header;
+    vgm_alloc_scope * scope;
+    size_t old_size;
+    int in_arena, ok = 1;
+
+    if (!ptr)
+        return vgm_malloc(size);
+    if (size > (size_t)-1 - sizeof(alloc_header))
+        return NULL;
+
+    /* stays in the original scope */
+    header = (alloc_header *)ptr - 1;
+    scope = header->info.scope;
+    old_size = header->info.size;
+
+    scope_lock(scope);
+    in_arena = scope->arena_top && arena_owns(scope, header);
+    if (!in_arena) {
+        if (size > old_size)
+            ok = scope_add(scope, size - old_size, 0);
+        if (ok)
+            scope->stats.allocator_count++;
+    }
+    scope_unlock(scope);
+
+    /* arena blocks can't be resized in place, so move them (to the arena if still probing) */
+    if (in_arena) {
+        void * new_ptr = scope_malloc(scope, size);
+        if (!new_ptr) return NULL;
+        memcpy(new_ptr, ptr, size < old_size ? size : old_size);
+        vgm_free(ptr);
+        return new_ptr;
+    }
+    if (!ok)
+        return NULL;
+
+    new_header = scope->allocator.realloc(scope->allocator.ctx, header, sizeof(alloc_header) + size);
+    if (!new_header) {
+        scope_failed(scope, size > old_size ? size - old_size : 0, 0);
+        return NULL;
+    }
+
+    /* the allocation is still live, so the scope can't be unused */
+    new_header->info.size = size;
+    if (size < old_size) {
+        scope_lock(scope);
+        scope_sub(scope, old_size - size, 0);
+        scope_unlock(scope);
+    }
+    return new_header + 1;
+}
+
+void vgm_free(void * ptr) {
+    alloc_header * header;
+    vgm_alloc_scope * scope;
+    size_t size;
+    int in_arena, unused;
+
+    if (!ptr) return;
+
+    header = (alloc_header *)ptr - 1;
+    scope = header->info.scope;
+    size = header->info.size;
+
+    scope_lock(scope);
+    in_arena = scope->arena_top && arena_owns(scope, header);
+    if (in_arena)
+        arena_free(scope, header, size);
+    unused = scope_sub(scope, size, 1);
+    scope_unlock(scope);
+
+    if (!in_arena)
+        scope->allocator.free(scope->allocator.ctx, header);
+    if (unused)
+        free_scope(scope);
+}
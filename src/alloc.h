@@ -0,0 +1,76 @@
+/*
+ * alloc.h - internal allocations, with custom allocators and per-stream accounting
+ */
+#ifndef _ALLOC_H
+#define _ALLOC_H
+
+#include <stddef.h>
+#include "streamtypes.h"
+
+/* Custom allocator for libvgmstream's internal allocations (all functions must be set).
+ * External libraries (FFmpeg, mpg123, etc) still use their own. */
+typedef struct {
+    void * (*malloc)(void * ctx, size_t size);
+    void * (*realloc)(void * ctx, void * ptr, size_t size);
+    void   (*free)(void * ctx, void * ptr);
+    void * ctx;
+} vgmstream_allocator;
+
+/* memory used by a stream (or by everything else when not tied to a stream) */
+typedef struct {
+    size_t current_bytes;   /* currently allocated */
+    size_t peak_bytes;      /* max allocated at once */
+    size_t max_bytes;       /* limit, allocations over it fail (0 = none) */
+    int32_t current_count;  /* live allocations */
+    int32_t total_count;    /* allocations done (including realloc) */
+    int32_t failed_count;   /* allocations that failed or went over the limit */
+    int32_t allocator_count;/* calls to the allocator (memory for many small allocations made while opening is
+                             * taken in big chunks, and reused by the next format tried if one fails) */
+} vgmstream_alloc_stats;
+
+
+/* Allocations are counted in the calling thread's current scope. Streams get one when opened (shared by
+ * their segments/layers) and enter it when decoding, so most memory a stream uses is attributed to it. */
+typedef struct vgm_alloc_scope vgm_alloc_scope;
+
+void * vgm_malloc(size_t size);
+void * vgm_calloc(size_t count, size_t size);
+void * vgm_realloc(void * ptr, size_t size);
+void vgm_free(void * ptr);
+
+/* Sets the allocator for scopes created after this (NULL = C library). */
+void vgm_alloc_set_default(const vgmstream_allocator * allocator);
+
+/* Creates a scope with a reference (allocator NULL = default, max_bytes 0 = no limit). */
+vgm_alloc_scope * vgm_alloc_scope_new(const vgmstream_allocator * allocator, size_t max_bytes);
+
+/* Adds/removes a reference. Scopes are freed once unreferenced and all their allocations are freed. */
+void vgm_alloc_scope_ref(vgm_alloc_scope * scope);
+void vgm_alloc_scope_unref(vgm_alloc_scope * scope);
+
+/* Makes scope current in this thread (NULL = none) and returns the previous one, to be restored after. */
+vgm_alloc_scope * vgm_alloc_scope_enter(vgm_alloc_scope * scope);
+void vgm_alloc_scope_leave(vgm_alloc_scope * previous);
+vgm_alloc_scope * vgm_alloc_scope_current(void);
+
+/* Probe arena: while active, small allocations of the scope are taken from big chunks. Marks save the
+ * arena's position, and rolling back to one drops everything allocated after it, freed or not (for
+ * failed format probes). Ending keeps allocations that are still live (the stream's) until the scope
+ * is freed. Begin returns 0 if the arena was already active (nested opens use the outer arena). */
+typedef struct {
+    void * chunk;
+    size_t used;
+    int32_t count;
+    size_t bytes;
+} vgm_alloc_mark;
+
+int vgm_alloc_arena_begin(vgm_alloc_scope * scope);
+void vgm_alloc_arena_end(vgm_alloc_scope * scope);
+void vgm_alloc_arena_mark(vgm_alloc_scope * scope, vgm_alloc_mark * mark);
+void vgm_alloc_arena_rollback(vgm_alloc_scope * scope, const vgm_alloc_mark * mark);
+
+/* Stats of a scope (NULL = allocations done outside any). */
+void vgm_alloc_scope_stats(vgm_alloc_scope * scope, vgmstream_alloc_stats * stats);
+void vgm_alloc_scope_set_limit(vgm_alloc_scope * scope, size_t max_bytes);
+
+#endif /* _ALLOC_H */
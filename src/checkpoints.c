@@ -0,0 +1,578 @@
+#include <stdlib.h>
+#include <string.h>
+#include "vgmstream.h"
+#include "layout/layout.h"
+#include "util.h"
+
+/* Seek checkpoints: snapshots of the decoder state taken every N samples during the first playthrough,
+ * so seeking can restore the closest one and decode a few frames, rather than decoding from the start.
+ *
+ * Only codecs whose state is fully kept in VGMSTREAMCHANNEL (offsets, histories, step indexes and so on)
+ * and simple layouts are supported, as codec_data can't be snapshotted in a generic way. Blocked layouts
+ * re-parse the checkpoint's block header on restore (to get coefs/sizes/etc) and then apply the state. */
+
+#define CHECKPOINT_DEFAULT_SECONDS  10
+#define CHECKPOINT_DEFAULT_MAX      256
+#define CHECKPOINT_FILE_ID          0x56474350 /* "VGCP" */
+#define CHECKPOINT_FILE_VERSION     2
+
+/* dynamic channel state (static values like streamfile or coefs set by the meta are in start_ch) */
+typedef struct {
+    off_t offset;
+    off_t frame_header_offset;
+    int32_t samples_left_in_frame;
+    int16_t adpcm_coef[16]; /* some decoders update them per frame (MSADPCM) */
+    int32_t adpcm_history1_32; /* 32b copies also contain the 16b union values */
+    int32_t adpcm_history2_32;
+    int32_t adpcm_history3_32;
+    int32_t adpcm_history4_32;
+    int32_t adpcm_step_index;
+    int32_t adpcm_scale;
+    uint16_t adx_xor;
+} checkpoint_channel;
+
+typedef struct {
+    int32_t current_sample;
+    int32_t samples_into_block;
+    off_t current_block_offset;
+    size_t current_block_size;
+    size_t current_block_samples;
+    off_t next_block_offset;
+    checkpoint_channel * ch;
+} checkpoint;
+
+struct checkpoint_data {
+    int channels;
+    int32_t interval;       /* min samples between checkpoints (doubles when max_count is reached) */
+    int max_count;          /* memory limit */
+
+    int count;
+    checkpoint * checkpoints; /* sorted by current_sample */
+    checkpoint_channel * channel_states; /* max_count * channels */
+
+    int has_loop;           /* loop start state, needed when restoring past the loop start */
+    checkpoint loop;
+    checkpoint_channel * loop_channel_states;
+};
+
+
+/* Returns if the VGMSTREAM's decoder state is fully contained in the channels and layout values. */
+int checkpoints_supported(VGMSTREAM * vgmstream) {
+    if (vgmstream->codec_data || vgmstream->layout_data)
+        return 0;
+    if (vgmstream->layout_type == layout_aix || vgmstream->layout_type == layout_segmented || vgmstream->layout_type == layout_layered)
+        return 0;
+
+    /* G721 has a big g72x_state, not worth saving */
+    return (get_codec_info(vgmstream->coding_type)->flags & CODEC_CHANNEL_STATE) != 0;
+}
+
+
+static void save_checkpoint(checkpoint * cp, VGMSTREAM * vgmstream, VGMSTREAMCHANNEL * channels,
+        int32_t current_sample, int32_t samples_into_block, off_t current_block_offset, size_t current_block_size,
+        size_t current_block_samples, off_t next_block_offset) {
+    int ch;
+
+    cp->current_sample = current_sample;
+    cp->samples_into_block = samples_into_block;
+    cp->current_block_offset = current_block_offset;
+    cp->current_block_size = current_block_size;
+    cp->current_block_samples = current_block_samples;
+    cp->next_block_offset = next_block_offset;
+
+    for (ch = 0; ch < vgmstream->channels; ch++) {
+        checkpoint_channel * cpch = &cp->ch[ch];
+        VGMSTREAMCHANNEL * vch = &channels[ch];
+
+        cpch->offset = vch->offset;
+        cpch->frame_header_offset = vch->frame_header_offset;
+        cpch->samples_left_in_frame = vch->samples_left_in_frame;
+        memcpy(cpch->adpcm_coef, vch->adpcm_coef, sizeof(cpch->adpcm_coef));
+        cpch->adpcm_history1_32 = vch->adpcm_history1_32;
+        cpch->adpcm_history2_32 = vch->adpcm_history2_32;
+        cpch->adpcm_history3_32 = vch->adpcm_history3_32;
+        cpch->adpcm_history4_32 = vch->adpcm_history4_32;
+        cpch->adpcm_step_index = vch->adpcm_step_index;
+        cpch->adpcm_scale = vch->adpcm_scale;
+        cpch->adx_xor = vch->adx_xor;
+    }
+}
+
+/* applies a checkpoint over the current (reset) state */
+static void load_checkpoint(checkpoint * cp, VGMSTREAM * vgmstream) {
+    int ch;
+
+    /* blocked layouts need block values that aren't saved (coefs, codec config, etc) */
+    if (is_blocked_layout(vgmstream->layout_type))
+        block_update(cp->current_block_offset, vgmstream);
+
+    vgmstream->current_sample = cp->current_sample;
+    vgmstream->samples_into_block = cp->samples_into_block;
+    vgmstream->current_block_offset = cp->current_block_offset;
+    vgmstream->current_block_size = cp->current_block_size;
+    vgmstream->current_block_samples = cp->current_block_samples;
+    vgmstream->next_block_offset = cp->next_block_offset;
+
+    for (ch = 0; ch < vgmstream->channels; ch++) {
+        checkpoint_channel * cpch = &cp->ch[ch];
+        VGMSTREAMCHANNEL * vch = &vgmstream->ch[ch];
+
+        vch->offset = cpch->offset;
+        vch->frame_header_offset = cpch->frame_header_offset;
+        vch->samples_left_in_frame = cpch->samples_left_in_frame;
+        memcpy(vch->adpcm_coef, cpch->adpcm_coef, sizeof(cpch->adpcm_coef));
+        vch->adpcm_history1_32 = cpch->adpcm_history1_32;
+        vch->adpcm_history2_32 = cpch->adpcm_history2_32;
+        vch->adpcm_history3_32 = cpch->adpcm_history3_32;
+        vch->adpcm_history4_32 = cpch->adpcm_history4_32;
+        vch->adpcm_step_index = cpch->adpcm_step_index;
+        vch->adpcm_scale = cpch->adpcm_scale;
+        vch->adx_xor = cpch->adx_xor;
+    }
+}
+
+/* find last checkpoint <= sample, or -1 */
+static int find_checkpoint(checkpoint_data * data, int32_t sample) {
+    int lo = 0, hi = data->count - 1, found = -1;
+
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (data->checkpoints[mid].current_sample <= sample) {
+            found = mid;
+            lo = mid + 1;
+        }
+        else {
+            hi = mid - 1;
+        }
+    }
+    return found;
+}
+
+/* copies a checkpoint into another slot (each slot has its own fixed channel storage) */
+static void copy_checkpoint(checkpoint_data * data, int dst, int src) {
+    checkpoint_channel * channels = data->checkpoints[dst].ch;
+
+    memcpy(channels, data->checkpoints[src].ch, sizeof(checkpoint_channel) * data->channels);
+    data->checkpoints[dst] = data->checkpoints[src];
+    data->checkpoints[dst].ch = channels;
+}
+
+/* drop every other checkpoint to make room, keeping the same coverage at half resolution */
+static void thin_checkpoints(checkpoint_data * data) {
+    int i, count = 0;
+
+    for (i = 0; i < data->count; i += 2) {
+        if (i != count)
+            copy_checkpoint(data, count, i);
+        count++;
+    }
+
+    data->count = count;
+    data->interval *= 2;
+}
+
+static void add_checkpoint(checkpoint_data * data, VGMSTREAM * vgmstream) {
+    int index, i;
+
+    index = find_checkpoint(data, vgmstream->current_sample);
+
+    /* keep a minimum distance to neighbors (also avoids duplicates) */
+    if (index >= 0 && vgmstream->current_sample - data->checkpoints[index].current_sample < data->interval)
+        return;
+    if (index + 1 < data->count && data->checkpoints[index + 1].current_sample - vgmstream->current_sample < data->interval)
+        return;
+
+    if (data->count == data->max_count) {
+        thin_checkpoints(data);
+        add_checkpoint(data, vgmstream);
+        return;
+    }
+
+    /* insert after index (usually the last, as decoding is sequential) */
+    index++;
+    for (i = data->count; i > index; i--) {
+        copy_checkpoint(data, i, i - 1);
+    }
+    data->count++;
+
+    save_checkpoint(&data->checkpoints[index], vgmstream, vgmstream->ch,
+            vgmstream->current_sample, vgmstream->samples_into_block, vgmstream->current_block_offset,
+            vgmstream->current_block_size, vgmstream->current_block_samples, vgmstream->next_block_offset);
+}
+
+
+checkpoint_data * init_checkpoints(int channels, int32_t interval, int max_count) {
+    checkpoint_data * data = NULL;
+    int i;
+
+    if (channels <= 0 || interval <= 0 || max_count <= 0)
+        goto fail;
+
+    data = vgm_calloc(1, sizeof(checkpoint_data));
+    if (!data) goto fail;
+
+    data->channels = channels;
+    data->interval = interval;
+    data->max_count = max_count;
+
+    data->checkpoints = vgm_calloc(max_count, sizeof(checkpoint));
+    if (!data->checkpoints) goto fail;
+
+    data->channel_states = vgm_calloc(max_count * channels, sizeof(checkpoint_channel));
+    if (!data->channel_states) goto fail;
+
+    data->loop_channel_states = vgm_calloc(channels, sizeof(checkpoint_channel));
+    if (!data->loop_channel_states) goto fail;
+
+    for (i = 0; i < max_count; i++) {
+        data->checkpoints[i].ch = data->channel_states + i * channels;
+    }
+    data->loop.ch = data->loop_channel_states;
+
+    return data;
+fail:
+    free_checkpoints(data);
+    return NULL;
+}
+
+void free_checkpoints(checkpoint_data * data) {
+    if (!data) return;
+
+    vgm_free(data->checkpoints);
+    vgm_free(data->channel_states);
+    vgm_free(data->loop_channel_states);
+    vgm_free(data);
+}
+
+/* Called after rendering, saves the current state if a new checkpoint is due. */
+void update_checkpoints(VGMSTREAM * vgmstream) {
+    checkpoint_data * data = vgmstream->checkpoint_data;
+
+    /* only the first playthrough (states after looping may differ, and loop_ch is modified) */
+    if (vgmstream->loop_count > 0 || vgmstream->current_sample >= vgmstream->num_samples)
+        return;
+
+    /* loop start values (must be saved before loop_ch is changed when reaching loop end) */
+    if (vgmstream->loop_flag && vgmstream->hit_loop && !data->has_loop) {
+        save_checkpoint(&data->loop, vgmstream, vgmstream->loop_ch,
+                vgmstream->loop_sample, vgmstream->loop_samples_into_block, vgmstream->loop_block_offset,
+                vgmstream->loop_block_size, vgmstream->loop_block_samples, vgmstream->loop_next_block_offset);
+        data->has_loop = 1;
+    }
+
+    add_checkpoint(data, vgmstream);
+}
+
+
+int vgmstream_enable_checkpoints(VGMSTREAM * vgmstream, int32_t interval, int max_count) {
+    checkpoint_data * data;
+    vgm_alloc_scope * previous;
+
+    if (!vgmstream || !checkpoints_supported(vgmstream))
+        return 0;
+    if (vgmstream->checkpoint_data)
+        return 1;
+
+    if (interval <= 0)
+        interval = vgmstream->sample_rate * CHECKPOINT_DEFAULT_SECONDS;
+    if (max_count <= 0)
+        max_count = CHECKPOINT_DEFAULT_MAX;
+
+    previous = vgm_alloc_scope_enter(vgmstream->alloc_scope);
+    data = init_checkpoints(vgmstream->channels, interval, max_count);
+    vgm_alloc_scope_leave(previous);
+    if (!data) return 0;
+
+    vgmstream->checkpoint_data = data;
+    ((VGMSTREAM*)vgmstream->start_vgmstream)->checkpoint_data = data; /* so resets keep it */
+    return 1;
+}
+
+int vgmstream_build_checkpoints(VGMSTREAM * vgmstream) {
+    checkpoint_data * data;
+    sample * buffer = NULL;
+    int32_t max_samples;
+
+    if (!vgmstream || !vgmstream->checkpoint_data)
+        return 0;
+    data = vgmstream->checkpoint_data;
+
+    reset_vgmstream(vgmstream);
+
+    /* decode in interval steps, so checkpoints are placed exactly */
+    max_samples = data->interval;
+    if (max_samples > 0x10000)
+        max_samples = 0x10000;
+    buffer = vgm_malloc(max_samples * vgmstream->channels * sizeof(sample));
+    if (!buffer) return 0;
+
+    while (vgmstream->current_sample < vgmstream->num_samples && vgmstream->loop_count == 0) {
+        int32_t samples_to_do = max_samples;
+        if (samples_to_do > vgmstream->num_samples - vgmstream->current_sample)
+            samples_to_do = vgmstream->num_samples - vgmstream->current_sample;
+        /* stop right at loop end, so the loop start state is saved before looping */
+        if (vgmstream->loop_flag && vgmstream->current_sample < vgmstream->loop_end_sample
+                && samples_to_do > vgmstream->loop_end_sample - vgmstream->current_sample)
+            samples_to_do = vgmstream->loop_end_sample - vgmstream->current_sample;
+
+        render_vgmstream_main(buffer, samples_to_do, vgmstream);
+    }
+
+    vgm_free(buffer);
+    reset_vgmstream(vgmstream);
+    return 1;
+}
+
+int32_t vgmstream_restore_checkpoint(VGMSTREAM * vgmstream, int32_t sample) {
+    checkpoint_data * data;
+    int index;
+
+    if (!vgmstream)
+        return 0;
+
+    reset_vgmstream(vgmstream);
+
+    data = vgmstream->checkpoint_data;
+    if (!data || sample <= 0)
+        return 0;
+
+    /* past loop end the position depends on loop count, so use the first loop end as the closest */
+    if (vgmstream->loop_flag && sample > vgmstream->loop_end_sample)
+        sample = vgmstream->loop_end_sample;
+
+    index = find_checkpoint(data, sample);
+
+    /* checkpoints after the loop start also need the loop state */
+    if (vgmstream->loop_flag && !data->has_loop) {
+        while (index >= 0 && data->checkpoints[index].current_sample > vgmstream->loop_start_sample)
+            index--;
+    }
+    if (index < 0)
+        return 0;
+
+    if (vgmstream->loop_flag && data->has_loop && data->checkpoints[index].current_sample > data->loop.current_sample) {
+        load_checkpoint(&data->loop, vgmstream);
+
+        /* same as vgmstream_do_loop when reaching the loop start */
+        copy_vgmstream_channels(vgmstream, vgmstream->loop_ch, vgmstream->ch);
+        vgmstream->loop_sample = vgmstream->current_sample;
+        vgmstream->loop_samples_into_block = vgmstream->samples_into_block;
+        vgmstream->loop_block_size = vgmstream->current_block_size;
+        vgmstream->loop_block_samples = vgmstream->current_block_samples;
+        vgmstream->loop_block_offset = vgmstream->current_block_offset;
+        vgmstream->loop_next_block_offset = vgmstream->next_block_offset;
+        vgmstream->hit_loop = 1;
+    }
+
+    load_checkpoint(&data->checkpoints[index], vgmstream);
+
+    return vgmstream->current_sample;
+}
+
+
+/* serialized format (LE): id, version, channels, stream info (to validate), interval, count, has_loop,
+ * then the loop checkpoint and each checkpoint */
+#define CHECKPOINT_HEADER_SIZE  0x28
+#define CHECKPOINT_ENTRY_SIZE   0x20
+#define CHECKPOINT_CHANNEL_SIZE 0x50
+
+static void put_64bitLE(uint8_t * buf, int64_t value) {
+    put_32bitLE(buf + 0x00, (int32_t)(value & 0xFFFFFFFF));
+    put_32bitLE(buf + 0x04, (int32_t)(value >> 32));
+}
+
+static size_t write_checkpoint(uint8_t * buf, checkpoint * cp, int channels) {
+    int ch, i;
+
+    put_32bitLE(buf + 0x00, cp->current_sample);
+    put_32bitLE(buf + 0x04, cp->samples_into_block);
+    put_64bitLE(buf + 0x08, cp->current_block_offset);
+    put_32bitLE(buf + 0x10, (int32_t)cp->current_block_size);
+    put_32bitLE(buf + 0x14, (int32_t)cp->current_block_samples);
+    put_64bitLE(buf + 0x18, cp->next_block_offset);
+    buf += CHECKPOINT_ENTRY_SIZE;
+
+    for (ch = 0; ch < channels; ch++) {
+        checkpoint_channel * cpch = &cp->ch[ch];
+
+        put_64bitLE(buf + 0x00, cpch->offset);
+        put_64bitLE(buf + 0x08, cpch->frame_header_offset);
+        put_32bitLE(buf + 0x10, cpch->samples_left_in_frame);
+        for (i = 0; i < 16; i++) {
+            put_16bitLE(buf + 0x14 + i*0x02, cpch->adpcm_coef[i]);
+        }
+        put_32bitLE(buf + 0x34, cpch->adpcm_history1_32);
+        put_32bitLE(buf + 0x38, cpch->adpcm_history2_32);
+        put_32bitLE(buf + 0x3c, cpch->adpcm_history3_32);
+        put_32bitLE(buf + 0x40, cpch->adpcm_history4_32);
+        put_32bitLE(buf + 0x44, cpch->adpcm_step_index);
+        put_32bitLE(buf + 0x48, cpch->adpcm_scale);
+        put_16bitLE(buf + 0x4c, cpch->adx_xor);
+        put_16bitLE(buf + 0x4e, 0);
+        buf += CHECKPOINT_CHANNEL_SIZE;
+    }
+
+    return CHECKPOINT_ENTRY_SIZE + CHECKPOINT_CHANNEL_SIZE * channels;
+}
+
+static size_t read_checkpoint(const uint8_t * cbuf, checkpoint * cp, int channels) {
+    uint8_t * buf = (uint8_t *)cbuf; /* get_Nbit don't take const */
+    int ch, i;
+
+    cp->current_sample = get_32bitLE(buf + 0x00);
+    cp->samples_into_block = get_32bitLE(buf + 0x04);
+    cp->current_block_offset = get_64bitLE(buf + 0x08);
+    cp->current_block_size = (uint32_t)get_32bitLE(buf + 0x10);
+    cp->current_block_samples = (uint32_t)get_32bitLE(buf + 0x14);
+    cp->next_block_offset = get_64bitLE(buf + 0x18);
+    buf += CHECKPOINT_ENTRY_SIZE;
+
+    for (ch = 0; ch < channels; ch++) {
+        checkpoint_channel * cpch = &cp->ch[ch];
+
+        cpch->offset = get_64bitLE(buf + 0x00);
+        cpch->frame_header_offset = get_64bitLE(buf + 0x08);
+        cpch->samples_left_in_frame = get_32bitLE(buf + 0x10);
+        for (i = 0; i < 16; i++) {
+            cpch->adpcm_coef[i] = get_16bitLE(buf + 0x14 + i*0x02);
+        }
+        cpch->adpcm_history1_32 = get_32bitLE(buf + 0x34);
+        cpch->adpcm_history2_32 = get_32bitLE(buf + 0x38);
+        cpch->adpcm_history3_32 = get_32bitLE(buf + 0x3c);
+        cpch->adpcm_history4_32 = get_32bitLE(buf + 0x40);
+        cpch->adpcm_step_index = get_32bitLE(buf + 0x44);
+        cpch->adpcm_scale = get_32bitLE(buf + 0x48);
+        cpch->adx_xor = (uint16_t)get_16bitLE(buf + 0x4c);
+        buf += CHECKPOINT_CHANNEL_SIZE;
+    }
+
+    return CHECKPOINT_ENTRY_SIZE + CHECKPOINT_CHANNEL_SIZE * channels;
+}
+
+static int is_offset_valid(off_t offset, STREAMFILE * streamFile) {
+    return offset >= 0 && (!streamFile || offset <= get_streamfile_size(streamFile));
+}
+
+/* loaded data may come from anywhere, so values that are used as positions must fit this stream */
+static int is_checkpoint_valid(const uint8_t * cbuf, VGMSTREAM * vgmstream) {
+    uint8_t * buf = (uint8_t *)cbuf;
+    int32_t current_sample = get_32bitLE(buf + 0x00);
+    int ch;
+
+    if (current_sample < 0 || current_sample >= vgmstream->num_samples || get_32bitLE(buf + 0x04) < 0)
+        return 0;
+    if (!is_offset_valid(get_64bitLE(buf + 0x08), vgmstream->ch[0].streamfile)
+            || !is_offset_valid(get_64bitLE(buf + 0x18), vgmstream->ch[0].streamfile))
+        return 0;
+    buf += CHECKPOINT_ENTRY_SIZE;
+
+    for (ch = 0; ch < vgmstream->channels; ch++) {
+        STREAMFILE * streamFile = vgmstream->ch[ch].streamfile;
+
+        if (!is_offset_valid(get_64bitLE(buf + 0x00), streamFile)
+                || !is_offset_valid(get_64bitLE(buf + 0x08), streamFile))
+            return 0;
+        buf += CHECKPOINT_CHANNEL_SIZE;
+    }
+
+    return 1;
+}
+
+size_t vgmstream_save_checkpoints(VGMSTREAM * vgmstream, uint8_t * buf, size_t buf_size) {
+    checkpoint_data * data;
+    size_t entry_size, total_size;
+    int i;
+
+    if (!vgmstream || !vgmstream->checkpoint_data)
+        return 0;
+    data = vgmstream->checkpoint_data;
+
+    entry_size = CHECKPOINT_ENTRY_SIZE + CHECKPOINT_CHANNEL_SIZE * data->channels;
+    total_size = CHECKPOINT_HEADER_SIZE + entry_size * (1 + data->count);
+    if (!buf)
+        return total_size;
+    if (buf_size < total_size)
+        return 0;
+
+    put_32bitBE(buf + 0x00, CHECKPOINT_FILE_ID);
+    put_32bitLE(buf + 0x04, CHECKPOINT_FILE_VERSION);
+    put_32bitLE(buf + 0x08, data->channels);
+    put_32bitLE(buf + 0x0c, vgmstream->num_samples);
+    put_32bitLE(buf + 0x10, vgmstream->sample_rate);
+    put_32bitLE(buf + 0x14, vgmstream->coding_type);
+    put_32bitLE(buf + 0x18, vgmstream->layout_type);
+    put_32bitLE(buf + 0x1c, data->interval);
+    put_32bitLE(buf + 0x20, data->count);
+    put_32bitLE(buf + 0x24, data->has_loop);
+    buf += CHECKPOINT_HEADER_SIZE;
+
+    buf += write_checkpoint(buf, &data->loop, data->channels);
+    for (i = 0; i < data->count; i++) {
+        buf += write_checkpoint(buf, &data->checkpoints[i], data->channels);
+    }
+
+    return total_size;
+}
+
+int vgmstream_load_checkpoints(VGMSTREAM * vgmstream, const uint8_t * cbuf, size_t buf_size) {
+    uint8_t * buf = (uint8_t *)cbuf;
+    checkpoint_data * data;
+    size_t entry_size;
+    int32_t interval, prev_sample = -1;
+    int i, count, has_loop;
+
+    if (!vgmstream || !buf || buf_size < CHECKPOINT_HEADER_SIZE)
+        return 0;
+
+    /* must match this stream */
+    if ((uint32_t)get_32bitBE(buf + 0x00) != CHECKPOINT_FILE_ID
+            || get_32bitLE(buf + 0x04) != CHECKPOINT_FILE_VERSION
+            || get_32bitLE(buf + 0x08) != vgmstream->channels
+            || get_32bitLE(buf + 0x0c) != vgmstream->num_samples
+            || get_32bitLE(buf + 0x10) != vgmstream->sample_rate
+            || get_32bitLE(buf + 0x14) != vgmstream->coding_type
+            || get_32bitLE(buf + 0x18) != vgmstream->layout_type)
+        return 0;
+
+    /* checkpoints are at least interval apart within the first playthrough, so there can't be more
+     * than num_samples / interval (fewer if the stream wasn't played to the end) */
+    interval = get_32bitLE(buf + 0x1c);
+    count = get_32bitLE(buf + 0x20);
+    has_loop = get_32bitLE(buf + 0x24);
+    if (interval <= 0 || count < 0 || count > vgmstream->num_samples / interval + 1 || (has_loop != 0 && has_loop != 1))
+        return 0;
+
+    entry_size = CHECKPOINT_ENTRY_SIZE + CHECKPOINT_CHANNEL_SIZE * vgmstream->channels;
+    if (buf_size < CHECKPOINT_HEADER_SIZE + entry_size * (1 + count))
+        return 0;
+
+    /* validate everything before changing the current checkpoints */
+    if (has_loop && !is_checkpoint_valid(buf + CHECKPOINT_HEADER_SIZE, vgmstream))
+        return 0;
+    for (i = 0; i < count; i++) {
+        const uint8_t * entry = buf + CHECKPOINT_HEADER_SIZE + entry_size * (1 + i);
+        int32_t current_sample = get_32bitLE((uint8_t *)entry + 0x00);
+
+        if (current_sample <= prev_sample || !is_checkpoint_valid(entry, vgmstream))
+            return 0;
+        prev_sample = current_sample;
+    }
+
+    if (!vgmstream->checkpoint_data && !vgmstream_enable_checkpoints(vgmstream, interval, count))
+        return 0;
+    data = vgmstream->checkpoint_data;
+    if (count > data->max_count)
+        return 0;
+
+    data->interval = interval;
+    data->has_loop = has_loop;
+    data->count = count;
+    buf += CHECKPOINT_HEADER_SIZE;
+
+    buf += read_checkpoint(buf, &data->loop, data->channels);
+    for (i = 0; i < count; i++) {
+        buf += read_checkpoint(buf, &data->checkpoints[i], data->channels);
+    }
+
+    return 1;
+}
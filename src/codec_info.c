@@ -0,0 +1,655 @@
+#include "vgmstream.h"
+#include "coding/coding.h"
+
+/* Per-codec info and handlers, looked up by coding_type (see get_codec_info).
+ * Adding a codec means writing its handlers and a row in codec_info_list, in coding_t order. */
+
+
+/* ******************************************** */
+/* DECODERS                                     */
+/* ******************************************** */
+
+/* Decode samples into the buffer. Assume that we have written samples_written into the
+ * buffer already, and we have samples_to_do consecutive samples ahead of us. */
+
+/* most decoders take one channel at a time with the same args, plus one (ex. ch) or the stream */
+#define DECODE_CHANNELS_ARG(name, decoder, arg) \
+    static void decode_##name(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) { \
+        int ch; \
+        for (ch = 0; ch < vgmstream->channels; ch++) { \
+            decoder(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch, \
+                    vgmstream->channels,vgmstream->samples_into_block,samples_to_do, arg); \
+        } \
+    }
+
+#define DECODE_CHANNELS(name, decoder) \
+    static void decode_##name(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) { \
+        int ch; \
+        for (ch = 0; ch < vgmstream->channels; ch++) { \
+            decoder(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch, \
+                    vgmstream->channels,vgmstream->samples_into_block,samples_to_do); \
+        } \
+    }
+
+#define DECODE_STREAM_CHANNELS(name, decoder) \
+    static void decode_##name(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) { \
+        int ch; \
+        for (ch = 0; ch < vgmstream->channels; ch++) { \
+            decoder(vgmstream,&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch, \
+                    vgmstream->channels,vgmstream->samples_into_block,samples_to_do, ch); \
+        } \
+    }
+
+DECODE_CHANNELS_ARG(CRI_ADX, decode_adx, vgmstream->interleave_block_size)
+DECODE_CHANNELS_ARG(CRI_ADX_exp, decode_adx_exp, vgmstream->interleave_block_size)
+DECODE_CHANNELS_ARG(CRI_ADX_fixed, decode_adx_fixed, vgmstream->interleave_block_size)
+DECODE_CHANNELS_ARG(CRI_ADX_enc, decode_adx_enc, vgmstream->interleave_block_size)
+DECODE_CHANNELS(NGC_DSP, decode_ngc_dsp)
+
+static void decode_NGC_DSP_subint(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
+    int ch;
+
+    for (ch = 0; ch < vgmstream->channels; ch++) {
+        decode_ngc_dsp_subint(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
+                vgmstream->channels,vgmstream->samples_into_block,samples_to_do,
+                ch, vgmstream->interleave_block_size);
+    }
+}
+
+DECODE_CHANNELS(PCM16LE, decode_pcm16le)
+DECODE_CHANNELS(PCM16BE, decode_pcm16be)
+DECODE_CHANNELS_ARG(PCM16_int, decode_pcm16_int, vgmstream->codec_endian)
+DECODE_CHANNELS(PCM8, decode_pcm8)
+DECODE_CHANNELS(PCM8_int, decode_pcm8_int)
+DECODE_CHANNELS(PCM8_U, decode_pcm8_unsigned)
+DECODE_CHANNELS(PCM8_U_int, decode_pcm8_unsigned_int)
+DECODE_CHANNELS(PCM8_SB, decode_pcm8_sb)
+DECODE_CHANNELS(ULAW, decode_ulaw)
+DECODE_CHANNELS(ULAW_int, decode_ulaw_int)
+DECODE_CHANNELS(ALAW, decode_alaw)
+DECODE_CHANNELS_ARG(PCMFLOAT, decode_pcmfloat, vgmstream->codec_endian)
+DECODE_CHANNELS(NDS_IMA, decode_nds_ima)
+DECODE_CHANNELS(DAT4_IMA, decode_dat4_ima)
+
+static void decode_XBOX_IMA(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
+    int ch;
+
+    for (ch = 0; ch < vgmstream->channels; ch++) {
+        int is_stereo = (vgmstream->channels > 1 && vgmstream->coding_type == coding_XBOX_IMA);
+        decode_xbox_ima(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
+                vgmstream->channels,vgmstream->samples_into_block,samples_to_do, ch,
+                is_stereo);
+    }
+}
+
+DECODE_CHANNELS_ARG(XBOX_IMA_mch, decode_xbox_ima_mch, ch)
+DECODE_STREAM_CHANNELS(MS_IMA, decode_ms_ima)
+DECODE_STREAM_CHANNELS(RAD_IMA, decode_rad_ima)
+DECODE_CHANNELS(RAD_IMA_mono, decode_rad_ima_mono)
+DECODE_CHANNELS_ARG(NGC_DTK, decode_ngc_dtk, ch)
+DECODE_CHANNELS(G721, decode_g721)
+DECODE_CHANNELS(NGC_AFC, decode_ngc_afc)
+DECODE_CHANNELS_ARG(PSX, decode_psx, 0)
+DECODE_CHANNELS_ARG(PSX_badflags, decode_psx, 1)
+DECODE_CHANNELS_ARG(PSX_cfg, decode_psx_configurable, vgmstream->interleave_block_size)
+DECODE_CHANNELS(HEVAG, decode_hevag)
+DECODE_CHANNELS_ARG(XA, decode_xa, ch)
+DECODE_CHANNELS_ARG(EA_XA, decode_ea_xa, ch)
+DECODE_CHANNELS_ARG(EA_XA_int, decode_ea_xa_int, ch)
+DECODE_CHANNELS_ARG(EA_XA_V2, decode_ea_xa_v2, ch)
+DECODE_CHANNELS_ARG(MAXIS_XA, decode_maxis_xa, ch)
+DECODE_CHANNELS_ARG(EA_XAS, decode_ea_xas, ch)
+DECODE_CHANNELS(SDX2, decode_sdx2)
+DECODE_CHANNELS(SDX2_int, decode_sdx2_int)
+DECODE_CHANNELS(CBD2, decode_cbd2)
+DECODE_CHANNELS(CBD2_int, decode_cbd2_int)
+DECODE_CHANNELS(DERF, decode_derf)
+
+static void decode_IMA(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
+    int ch;
+
+    for (ch = 0; ch < vgmstream->channels; ch++) {
+        int is_stereo = (vgmstream->channels > 1 && vgmstream->coding_type == coding_IMA)
+                || (vgmstream->channels > 1 && vgmstream->coding_type == coding_DVI_IMA);
+        int is_high_first = vgmstream->coding_type == coding_DVI_IMA || vgmstream->coding_type == coding_DVI_IMA_int;
+
+        decode_standard_ima(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
+                vgmstream->channels,vgmstream->samples_into_block,samples_to_do, ch,
+                is_stereo, is_high_first);
+    }
+}
+
+DECODE_CHANNELS(3DS_IMA, decode_3ds_ima)
+DECODE_CHANNELS(WV6_IMA, decode_wv6_ima)
+DECODE_CHANNELS(ALP_IMA, decode_alp_ima)
+DECODE_CHANNELS(FFTA2_IMA, decode_ffta2_ima)
+DECODE_CHANNELS(APPLE_IMA4, decode_apple_ima4)
+DECODE_CHANNELS_ARG(SNDS_IMA, decode_snds_ima, ch)
+DECODE_STREAM_CHANNELS(OTNS_IMA, decode_otns_ima)
+DECODE_STREAM_CHANNELS(FSB_IMA, decode_fsb_ima)
+DECODE_STREAM_CHANNELS(WWISE_IMA, decode_wwise_ima)
+DECODE_STREAM_CHANNELS(REF_IMA, decode_ref_ima)
+DECODE_CHANNELS(AWC_IMA, decode_awc_ima)
+DECODE_CHANNELS_ARG(UBI_IMA, decode_ubi_ima, ch)
+
+static void decode_H4M_IMA(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
+    int ch;
+
+    for (ch = 0; ch < vgmstream->channels; ch++) {
+        uint16_t frame_format = (uint16_t)((vgmstream->codec_config >> 8) & 0xFFFF);
+
+        decode_h4m_ima(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
+                vgmstream->channels,vgmstream->samples_into_block,samples_to_do, ch,
+                frame_format);
+    }
+}
+
+static void decode_WS(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
+    int ch;
+
+    for (ch = 0; ch < vgmstream->channels; ch++) {
+        decode_ws(vgmstream,ch,buffer+samples_written*vgmstream->channels+ch,
+                vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
+    }
+}
+
+static void decode_MSADPCM(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
+    if (vgmstream->channels == 2) {
+        decode_msadpcm_stereo(vgmstream,buffer+samples_written*vgmstream->channels,
+                vgmstream->samples_into_block,samples_to_do);
+    }
+    else if (vgmstream->channels == 1) {
+        decode_msadpcm_mono(vgmstream,buffer+samples_written*vgmstream->channels,
+                vgmstream->channels,vgmstream->samples_into_block,samples_to_do, 0);
+    }
+}
+
+static void decode_MSADPCM_ck(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
+    int ch;
+
+    for (ch = 0; ch < vgmstream->channels; ch++) {
+        decode_msadpcm_ck(vgmstream,buffer+samples_written*vgmstream->channels+ch,
+                vgmstream->channels,vgmstream->samples_into_block, samples_to_do, ch);
+    }
+}
+
+static void decode_AICA(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
+    int ch;
+
+    for (ch = 0; ch < vgmstream->channels; ch++) {
+        int is_stereo = (vgmstream->channels > 1 && vgmstream->coding_type == coding_AICA);
+
+        decode_aica(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
+                vgmstream->channels,vgmstream->samples_into_block,samples_to_do, ch,
+                is_stereo);
+    }
+}
+
+DECODE_CHANNELS_ARG(YAMAHA, decode_yamaha, ch)
+DECODE_CHANNELS(YAMAHA_NXAP, decode_yamaha_nxap)
+DECODE_CHANNELS(NDS_PROCYON, decode_nds_procyon)
+DECODE_CHANNELS(L5_555, decode_l5_555)
+
+static void free_L5_555(VGMSTREAM * vgmstream) {
+    int ch;
+
+    for (ch = 0; ch < vgmstream->channels; ch++) {
+        vgm_free(vgmstream->ch[ch].adpcm_coef_3by32);
+        vgmstream->ch[ch].adpcm_coef_3by32 = NULL;
+    }
+}
+
+DECODE_CHANNELS(SASSC, decode_sassc)
+DECODE_CHANNELS(LSF, decode_lsf)
+DECODE_CHANNELS_ARG(MTAF, decode_mtaf, ch)
+DECODE_CHANNELS_ARG(MTA2, decode_mta2, ch)
+DECODE_STREAM_CHANNELS(MC3, decode_mc3)
+DECODE_CHANNELS(FADPCM, decode_fadpcm)
+DECODE_CHANNELS(ASF, decode_asf)
+DECODE_CHANNELS_ARG(XMD, decode_xmd, vgmstream->interleave_block_size)
+
+/* ******************************************** */
+/* FRAME SIZES                                  */
+/* ******************************************** */
+
+/* for codecs whose frames depend on the stream's config (fixed ones are in the table) */
+
+static int samples_per_frame_CRI_ADX(VGMSTREAM * vgmstream) {
+    return (vgmstream->interleave_block_size - 2) * 2;
+}
+
+static int samples_per_frame_XA(VGMSTREAM * vgmstream) {
+    return 28*8 / vgmstream->channels; /* 8 subframes per frame, mono/stereo */
+}
+
+static int samples_per_frame_PSX_cfg(VGMSTREAM * vgmstream) {
+    return (vgmstream->interleave_block_size - 1) * 2; /* decodes 1 byte into 2 bytes */
+}
+
+static int samples_per_frame_MS_IMA(VGMSTREAM * vgmstream) {
+    return ((vgmstream->interleave_block_size - 0x04*vgmstream->channels) * 2 / vgmstream->channels) + 1;
+}
+
+static int samples_per_frame_NDS_IMA(VGMSTREAM * vgmstream) {
+    return (vgmstream->interleave_block_size - 0x04) * 2;
+}
+
+static int samples_per_frame_RAD_IMA(VGMSTREAM * vgmstream) {
+    return (vgmstream->interleave_block_size - 0x04*vgmstream->channels) * 2 / vgmstream->channels;
+}
+
+static int samples_per_frame_MSADPCM(VGMSTREAM * vgmstream) {
+    return (vgmstream->interleave_block_size - 0x07*vgmstream->channels)*2 / vgmstream->channels + 2;
+}
+
+static int samples_per_frame_MSADPCM_ck(VGMSTREAM * vgmstream) {
+    return (vgmstream->interleave_block_size - 0x07)*2 + 2;
+}
+
+static int samples_per_frame_WS(VGMSTREAM * vgmstream) {
+    /* only works if output sample size is 8 bit, which always is for WS ADPCM */
+    return vgmstream->ws_output_size;
+}
+
+static int samples_per_frame_YAMAHA(VGMSTREAM * vgmstream) {
+    return (0x40-0x04*vgmstream->channels) * 2 / vgmstream->channels;
+}
+
+static int samples_per_frame_XMD(VGMSTREAM * vgmstream) {
+    return (vgmstream->interleave_block_size - 0x06)*2 + 2;
+}
+
+#if defined(VGM_USE_MP4V2) && defined(VGM_USE_FDKAAC)
+static int samples_per_frame_MP4_AAC(VGMSTREAM * vgmstream) {
+    return ((mp4_aac_codec_data*)vgmstream->codec_data)->samples_per_frame;
+}
+
+#endif
+#ifdef VGM_USE_MAIATRAC3PLUS
+static int samples_per_frame_AT3plus(VGMSTREAM * vgmstream) {
+    return 2048 - ((maiatrac3plus_codec_data*)vgmstream->codec_data)->samples_discard;
+}
+
+#endif
+#ifdef VGM_USE_FFMPEG
+static int samples_per_frame_FFmpeg(VGMSTREAM * vgmstream) {
+    if (vgmstream->codec_data) {
+        ffmpeg_codec_data *data = (ffmpeg_codec_data*)vgmstream->codec_data;
+        return data->sampleBufferBlock; /* must know the full block size for edge loops */
+    }
+    else {
+        return 0;
+    }
+}
+
+#endif
+
+static int frame_size_block(VGMSTREAM * vgmstream) {
+    return vgmstream->interleave_block_size;
+}
+
+static int frame_size_NGC_DSP_subint(VGMSTREAM * vgmstream) {
+    return 0x08 * vgmstream->channels;
+}
+
+static int frame_size_MAXIS_XA(VGMSTREAM * vgmstream) {
+    return 0x0F*vgmstream->channels;
+}
+
+static int frame_size_EA_XAS(VGMSTREAM * vgmstream) {
+    return 0x4c*vgmstream->channels;
+}
+
+static int frame_size_XBOX_IMA_mch(VGMSTREAM * vgmstream) {
+    return 0x24 * vgmstream->channels;
+}
+
+static int frame_size_WS(VGMSTREAM * vgmstream) {
+    return vgmstream->current_block_size;
+}
+
+
+/* ******************************************** */
+/* CODECS WITH CODEC_DATA                       */
+/* ******************************************** */
+
+/* reset/loop/free handlers that only need codec_data */
+#define CODEC_DATA_HANDLER(name, handler) \
+    static void name(VGMSTREAM * vgmstream) { \
+        handler(vgmstream->codec_data); \
+    }
+
+static void decode_EA_MT(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
+    int ch;
+
+    for (ch = 0; ch < vgmstream->channels; ch++) {
+        decode_ea_mt(vgmstream, buffer+samples_written*vgmstream->channels+ch,
+                vgmstream->channels, samples_to_do, ch);
+    }
+}
+
+static void free_EA_MT(VGMSTREAM * vgmstream) {
+    free_ea_mt(vgmstream->codec_data, vgmstream->channels);
+}
+
+static void decode_CRI_HCA(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
+    decode_hca(vgmstream->codec_data, buffer+samples_written*vgmstream->channels,
+            samples_to_do);
+}
+
+static void decode_CRI_HCA_f32(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, float * buffer) {
+    decode_hca_f32(vgmstream->codec_data, buffer+samples_written*vgmstream->channels,
+            samples_to_do);
+}
+
+CODEC_DATA_HANDLER(reset_CRI_HCA, reset_hca)
+CODEC_DATA_HANDLER(loop_CRI_HCA, loop_hca)
+CODEC_DATA_HANDLER(free_CRI_HCA, free_hca)
+
+static void decode_ACM(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
+    decode_acm(vgmstream->codec_data, buffer+samples_written*vgmstream->channels,
+            samples_to_do, vgmstream->channels);
+}
+
+CODEC_DATA_HANDLER(reset_ACM, reset_acm)
+CODEC_DATA_HANDLER(free_ACM, free_acm)
+
+static void decode_NWA(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
+    decode_nwa(((nwa_codec_data*)vgmstream->codec_data)->nwa,
+            buffer+samples_written*vgmstream->channels, samples_to_do);
+}
+
+static void reset_NWA(VGMSTREAM * vgmstream) {
+    nwa_codec_data *data = vgmstream->codec_data;
+    if (data)
+        reset_nwa(data->nwa);
+}
+
+static void seek_NWA(VGMSTREAM * vgmstream, int32_t num_sample) {
+    nwa_codec_data *data = vgmstream->codec_data;
+    if (data)
+        seek_nwa(data->nwa, num_sample);
+}
+
+static void free_NWA(VGMSTREAM * vgmstream) {
+    nwa_codec_data *data = vgmstream->codec_data;
+    if (data) {
+        if (data->nwa)
+            close_nwa(data->nwa);
+        vgm_free(data);
+    }
+}
+
+#ifdef VGM_USE_VORBIS
+static void decode_OGG_VORBIS(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
+    decode_ogg_vorbis(vgmstream->codec_data, buffer+samples_written*vgmstream->channels,
+            samples_to_do,vgmstream->channels);
+}
+
+static void decode_OGG_VORBIS_f32(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, float * buffer) {
+    decode_ogg_vorbis_f32(vgmstream->codec_data, buffer+samples_written*vgmstream->channels,
+            samples_to_do,vgmstream->channels);
+}
+
+CODEC_DATA_HANDLER(free_OGG_VORBIS, free_ogg_vorbis)
+
+static void decode_VORBIS_custom(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
+    decode_vorbis_custom(vgmstream, buffer+samples_written*vgmstream->channels,
+            samples_to_do,vgmstream->channels);
+}
+
+static void decode_VORBIS_custom_f32(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, float * buffer) {
+    decode_vorbis_custom_f32(vgmstream, buffer+samples_written*vgmstream->channels,
+            samples_to_do,vgmstream->channels);
+}
+
+CODEC_DATA_HANDLER(free_VORBIS_custom, free_vorbis_custom)
+#endif
+
+#ifdef VGM_USE_MPEG
+static void decode_MPEG_custom(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
+    decode_mpeg(vgmstream,buffer+samples_written*vgmstream->channels,
+            samples_to_do,vgmstream->channels);
+}
+
+CODEC_DATA_HANDLER(free_MPEG_custom, free_mpeg)
+#endif
+
+#ifdef VGM_USE_G7221
+static void decode_G7221C(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
+    int ch;
+
+    for (ch = 0; ch < vgmstream->channels; ch++) {
+        decode_g7221(vgmstream, buffer+samples_written*vgmstream->channels+ch,
+                vgmstream->channels,samples_to_do, ch);
+    }
+}
+#endif
+
+#ifdef VGM_USE_G719
+static void decode_G719(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
+    int ch;
+
+    for (ch = 0; ch < vgmstream->channels; ch++) {
+        decode_g719(vgmstream, buffer+samples_written*vgmstream->channels+ch,
+            vgmstream->channels,samples_to_do, ch);
+    }
+}
+
+static void reset_G719(VGMSTREAM * vgmstream) {
+    reset_g719(vgmstream->codec_data, vgmstream->channels);
+}
+
+static void free_G719(VGMSTREAM * vgmstream) {
+    free_g719(vgmstream->codec_data, vgmstream->channels);
+}
+#endif
+
+#if defined(VGM_USE_MP4V2) && defined(VGM_USE_FDKAAC)
+static void decode_MP4_AAC(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
+    decode_mp4_aac(vgmstream->codec_data, buffer+samples_written*vgmstream->channels,
+            samples_to_do,vgmstream->channels);
+}
+
+CODEC_DATA_HANDLER(free_MP4_AAC, free_mp4_aac)
+#endif
+
+#ifdef VGM_USE_MAIATRAC3PLUS
+static void decode_AT3plus(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
+    int ch;
+
+    for (ch = 0; ch < vgmstream->channels; ch++) {
+        decode_at3plus(vgmstream, buffer+samples_written*vgmstream->channels+ch,
+            vgmstream->channels,samples_to_do, ch);
+    }
+}
+
+CODEC_DATA_HANDLER(free_AT3plus, free_at3plus)
+#endif
+
+#ifdef VGM_USE_ATRAC9
+static void decode_ATRAC9(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
+    decode_atrac9(vgmstream, buffer+samples_written*vgmstream->channels,
+            samples_to_do,vgmstream->channels);
+}
+
+CODEC_DATA_HANDLER(free_ATRAC9, free_atrac9)
+#endif
+
+#ifdef VGM_USE_CELT
+static void decode_CELT_FSB(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
+    decode_celt_fsb(vgmstream, buffer+samples_written*vgmstream->channels,
+            samples_to_do,vgmstream->channels);
+}
+
+CODEC_DATA_HANDLER(free_CELT_FSB, free_celt_fsb)
+#endif
+
+#ifdef VGM_USE_FFMPEG
+static void decode_FFmpeg(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
+    decode_ffmpeg(vgmstream,
+                  buffer+samples_written*vgmstream->channels,samples_to_do,vgmstream->channels);
+}
+
+static void decode_FFmpeg_f32(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, float * buffer) {
+    decode_ffmpeg_f32(vgmstream,
+                  buffer+samples_written*vgmstream->channels,samples_to_do,vgmstream->channels);
+}
+
+CODEC_DATA_HANDLER(free_FFmpeg, free_ffmpeg)
+#endif
+
+/* codecs that restart from the loop start's offsets/state rather than loop_sample */
+static void loop_from_start(VGMSTREAM * vgmstream) {
+    get_codec_info(vgmstream->coding_type)->seek(vgmstream, vgmstream->loop_start_sample);
+}
+
+
+/* ******************************************** */
+/* CODEC LIST                                   */
+/* ******************************************** */
+
+/* fields: type, flags, samples_per_frame, frame_size, decode, get_samples_per_frame, get_frame_size,
+ *   reset, seek, loop, free, decode_f32 (fixed sizes of 0 mean variable or unknown) */
+static const codec_info codec_info_list[] = {
+    {coding_PCM16LE, CODEC_STATELESS | CODEC_CHANNEL_STATE, 1, 0x02, decode_PCM16LE},
+    {coding_PCM16BE, CODEC_STATELESS | CODEC_CHANNEL_STATE, 1, 0x02, decode_PCM16BE},
+    {coding_PCM16_int, CODEC_STATELESS | CODEC_CHANNEL_STATE, 1, 0x02, decode_PCM16_int},
+    {coding_PCM8, CODEC_STATELESS | CODEC_CHANNEL_STATE, 1, 0x01, decode_PCM8},
+    {coding_PCM8_int, CODEC_STATELESS | CODEC_CHANNEL_STATE, 1, 0x01, decode_PCM8_int},
+    {coding_PCM8_U, CODEC_STATELESS | CODEC_CHANNEL_STATE, 1, 0x01, decode_PCM8_U},
+    {coding_PCM8_U_int, CODEC_STATELESS | CODEC_CHANNEL_STATE, 1, 0x01, decode_PCM8_U_int},
+    {coding_PCM8_SB, CODEC_STATELESS | CODEC_CHANNEL_STATE, 1, 0x01, decode_PCM8_SB},
+    {coding_ULAW, CODEC_STATELESS | CODEC_CHANNEL_STATE, 1, 0x01, decode_ULAW},
+    {coding_ULAW_int, CODEC_STATELESS | CODEC_CHANNEL_STATE, 1, 0x01, decode_ULAW_int},
+    {coding_ALAW, CODEC_STATELESS | CODEC_CHANNEL_STATE, 1, 0x01, decode_ALAW},
+    {coding_PCMFLOAT, CODEC_STATELESS | CODEC_CHANNEL_STATE, 1, 0x04, decode_PCMFLOAT},
+    {coding_CRI_ADX, CODEC_CHANNEL_STATE, 0, 0, decode_CRI_ADX, samples_per_frame_CRI_ADX, frame_size_block},
+    {coding_CRI_ADX_fixed, CODEC_CHANNEL_STATE, 0, 0, decode_CRI_ADX_fixed, samples_per_frame_CRI_ADX, frame_size_block},
+    {coding_CRI_ADX_exp, CODEC_CHANNEL_STATE, 0, 0, decode_CRI_ADX_exp, samples_per_frame_CRI_ADX, frame_size_block},
+    {coding_CRI_ADX_enc_8, CODEC_CHANNEL_STATE, 0, 0, decode_CRI_ADX_enc, samples_per_frame_CRI_ADX, frame_size_block},
+    {coding_CRI_ADX_enc_9, CODEC_CHANNEL_STATE, 0, 0, decode_CRI_ADX_enc, samples_per_frame_CRI_ADX, frame_size_block},
+    {coding_NGC_DSP, CODEC_CHANNEL_STATE, 14, 0x08, decode_NGC_DSP},
+    {coding_NGC_DSP_subint, CODEC_CHANNEL_STATE, 14, 0, decode_NGC_DSP_subint, NULL, frame_size_NGC_DSP_subint},
+    {coding_NGC_DTK, CODEC_CHANNEL_STATE, 28, 0x20, decode_NGC_DTK},
+    {coding_NGC_AFC, CODEC_CHANNEL_STATE, 16, 0x09, decode_NGC_AFC},
+    /* big g72x_state, not worth saving in checkpoints */
+    {coding_G721, CODEC_CHANNEL_EXT, 1, 0, decode_G721},
+    {coding_XA, CODEC_CHANNEL_STATE, 0, 0x80, decode_XA, samples_per_frame_XA},
+    {coding_PSX, CODEC_CHANNEL_STATE | CODEC_LOOP_HISTORY, 28, 0x10, decode_PSX},
+    {coding_PSX_badflags, CODEC_CHANNEL_STATE | CODEC_LOOP_HISTORY, 28, 0x10, decode_PSX_badflags},
+    {coding_PSX_cfg, CODEC_CHANNEL_STATE, 0, 0, decode_PSX_cfg, samples_per_frame_PSX_cfg, frame_size_block},
+    {coding_HEVAG, CODEC_CHANNEL_STATE, 28, 0x10, decode_HEVAG},
+    {coding_EA_XA, CODEC_CHANNEL_STATE, 28, 0x1E, decode_EA_XA},
+    {coding_EA_XA_int, CODEC_CHANNEL_STATE, 28, 0x0F, decode_EA_XA_int},
+    /* variable (ADPCM frames of 0x0f or PCM frames of 0x3d) */
+    {coding_EA_XA_V2, CODEC_CHANNEL_STATE, 28, 0, decode_EA_XA_V2},
+    {coding_MAXIS_XA, CODEC_CHANNEL_STATE, 28, 0, decode_MAXIS_XA, NULL, frame_size_MAXIS_XA},
+    {coding_EA_XAS, CODEC_CHANNEL_STATE, 128, 0, decode_EA_XAS, NULL, frame_size_EA_XAS},
+    {coding_IMA, CODEC_CHANNEL_STATE, 1, 0x01, decode_IMA},
+    {coding_IMA_int, CODEC_CHANNEL_STATE, 2, 0x01, decode_IMA},
+    {coding_DVI_IMA, CODEC_CHANNEL_STATE, 1, 0x01, decode_IMA},
+    {coding_DVI_IMA_int, CODEC_CHANNEL_STATE, 2, 0x01, decode_IMA},
+    {coding_3DS_IMA, CODEC_CHANNEL_STATE, 2, 0x01, decode_3DS_IMA},
+    /* todo: frame size 0x01? */
+    {coding_SNDS_IMA, CODEC_CHANNEL_STATE, 1, 0, decode_SNDS_IMA},
+    /* todo: frame size 0x01? */
+    {coding_OTNS_IMA, CODEC_CHANNEL_STATE, 1, 0, decode_OTNS_IMA},
+    {coding_WV6_IMA, CODEC_CHANNEL_STATE, 2, 0x01, decode_WV6_IMA},
+    {coding_ALP_IMA, CODEC_CHANNEL_STATE, 2, 0x01, decode_ALP_IMA},
+    {coding_FFTA2_IMA, CODEC_CHANNEL_STATE, 2, 0x01, decode_FFTA2_IMA},
+    {coding_MS_IMA, CODEC_CHANNEL_STATE, 0, 0, decode_MS_IMA, samples_per_frame_MS_IMA, frame_size_block},
+    /* todo: frame should be 0x48 when stereo, but blocked/interleave layout don't understand stereo codecs */
+    {coding_XBOX_IMA, CODEC_STATELESS | CODEC_CHANNEL_STATE, 64, 0x24, decode_XBOX_IMA},
+    {coding_XBOX_IMA_mch, CODEC_STATELESS | CODEC_CHANNEL_STATE, 64, 0, decode_XBOX_IMA_mch, NULL, frame_size_XBOX_IMA_mch},
+    {coding_XBOX_IMA_int, CODEC_STATELESS | CODEC_CHANNEL_STATE, 64, 0x24, decode_XBOX_IMA},
+    {coding_NDS_IMA, CODEC_CHANNEL_STATE, 0, 0, decode_NDS_IMA, samples_per_frame_NDS_IMA, frame_size_block},
+    {coding_DAT4_IMA, CODEC_CHANNEL_STATE, 0, 0, decode_DAT4_IMA, samples_per_frame_NDS_IMA, frame_size_block},
+    {coding_RAD_IMA, CODEC_CHANNEL_STATE, 0, 0, decode_RAD_IMA, samples_per_frame_RAD_IMA, frame_size_block},
+    {coding_RAD_IMA_mono, CODEC_CHANNEL_STATE, 32, 0x14, decode_RAD_IMA_mono},
+    {coding_APPLE_IMA4, CODEC_STATELESS | CODEC_CHANNEL_STATE, 64, 0x22, decode_APPLE_IMA4},
+    {coding_FSB_IMA, CODEC_CHANNEL_STATE, 64, 0, decode_FSB_IMA, NULL, frame_size_XBOX_IMA_mch},
+    {coding_WWISE_IMA, CODEC_CHANNEL_STATE, 64, 0x24, decode_WWISE_IMA},
+    {coding_REF_IMA, CODEC_CHANNEL_STATE, 0, 0, decode_REF_IMA, samples_per_frame_MS_IMA, frame_size_block},
+    {coding_AWC_IMA, CODEC_CHANNEL_STATE, (0x800 - 0x04) * 2, 0x800, decode_AWC_IMA},
+    /* variable (PCM then IMA) */
+    {coding_UBI_IMA, CODEC_CHANNEL_STATE, 1, 0, decode_UBI_IMA},
+    /* variable (block-controlled) */
+    {coding_H4M_IMA, CODEC_CHANNEL_STATE, 0, 0x00, decode_H4M_IMA},
+    {coding_MSADPCM, CODEC_STATELESS | CODEC_CHANNEL_STATE, 0, 0, decode_MSADPCM, samples_per_frame_MSADPCM, frame_size_block},
+    {coding_MSADPCM_ck, CODEC_STATELESS | CODEC_CHANNEL_STATE, 0, 0, decode_MSADPCM_ck, samples_per_frame_MSADPCM_ck, frame_size_block},
+    {coding_WS, CODEC_CHANNEL_STATE, 0, 0, decode_WS, samples_per_frame_WS, frame_size_WS},
+    {coding_AICA, CODEC_CHANNEL_STATE, 1, 0x01, decode_AICA},
+    {coding_AICA_int, CODEC_CHANNEL_STATE, 2, 0x01, decode_AICA},
+    {coding_YAMAHA, CODEC_CHANNEL_STATE, 0, 0x40, decode_YAMAHA, samples_per_frame_YAMAHA},
+    {coding_YAMAHA_NXAP, CODEC_CHANNEL_STATE, (0x40-0x04) * 2, 0x40, decode_YAMAHA_NXAP},
+    {coding_NDS_PROCYON, CODEC_CHANNEL_STATE, 30, 0x10, decode_NDS_PROCYON},
+    {coding_L5_555, CODEC_CHANNEL_STATE, 32, 0x12, decode_L5_555, NULL, NULL, NULL, NULL, NULL, free_L5_555},
+    {coding_LSF, CODEC_CHANNEL_STATE, 54, 0x1C, decode_LSF},
+    {coding_MTAF, CODEC_CHANNEL_STATE, 128*2, 0, decode_MTAF, NULL, frame_size_block},
+    {coding_MTA2, CODEC_CHANNEL_STATE, 128*2, 0x90, decode_MTA2},
+    {coding_MC3, CODEC_CHANNEL_STATE, 10, 0x04, decode_MC3},
+    /* (0x8c - 0xc) * 2 */
+    {coding_FADPCM, CODEC_CHANNEL_STATE, 256, 0x8c, decode_FADPCM},
+    /* (0x11 - 0x1) * 2 */
+    {coding_ASF, CODEC_CHANNEL_STATE, 32, 0x11, decode_ASF},
+    {coding_XMD, CODEC_CHANNEL_STATE, 0, 0, decode_XMD, samples_per_frame_XMD, frame_size_block},
+    {coding_SDX2, CODEC_CHANNEL_STATE, 1, 0x01, decode_SDX2},
+    {coding_SDX2_int, CODEC_CHANNEL_STATE, 1, 0x01, decode_SDX2_int},
+    {coding_CBD2, CODEC_CHANNEL_STATE, 1, 0x01, decode_CBD2},
+    {coding_CBD2_int, CODEC_CHANNEL_STATE, 0, 0, decode_CBD2_int},
+    {coding_SASSC, CODEC_CHANNEL_STATE, 1, 0x01, decode_SASSC},
+    {coding_DERF, CODEC_CHANNEL_STATE, 1, 0x01, decode_DERF},
+    {coding_ACM, 0, 1, 0, decode_ACM, NULL, NULL, reset_ACM, NULL, NULL, free_ACM},
+    {coding_NWA, CODEC_SEEKABLE, 1, 0x01, decode_NWA, NULL, NULL, reset_NWA, seek_NWA, NULL, free_NWA},
+    /* 432, but variable in looped files; frames of bit counts or PCM frames */
+    {coding_EA_MT, 0, 0, 0, decode_EA_MT, NULL, NULL, reset_ea_mt, seek_ea_mt, loop_from_start, free_EA_MT},
+    /* 1024 - delay/padding (which can be bigger than 1024) */
+    {coding_CRI_HCA, CODEC_FLOAT, 0, 0, decode_CRI_HCA, NULL, NULL, reset_CRI_HCA, NULL, loop_CRI_HCA, free_CRI_HCA, decode_CRI_HCA_f32},
+#ifdef VGM_USE_VORBIS
+    {coding_OGG_VORBIS, CODEC_SEEKABLE | CODEC_FLOAT, 1, 0, decode_OGG_VORBIS, NULL, NULL, reset_ogg_vorbis, seek_ogg_vorbis, NULL, free_OGG_VORBIS, decode_OGG_VORBIS_f32},
+    {coding_VORBIS_custom, CODEC_SEEKABLE | CODEC_FLOAT, 1, 0, decode_VORBIS_custom, NULL, NULL, reset_vorbis_custom, seek_vorbis_custom, loop_from_start, free_VORBIS_custom, decode_VORBIS_custom_f32},
+#endif
+#ifdef VGM_USE_MPEG
+    {coding_MPEG_custom, CODEC_SEEKABLE, 1, 0, decode_MPEG_custom, NULL, NULL, reset_mpeg, seek_mpeg, NULL, free_MPEG_custom},
+    {coding_MPEG_ealayer3, CODEC_SEEKABLE, 1, 0, decode_MPEG_custom, NULL, NULL, reset_mpeg, seek_mpeg, NULL, free_MPEG_custom},
+    {coding_MPEG_layer1, CODEC_SEEKABLE, 1, 0, decode_MPEG_custom, NULL, NULL, reset_mpeg, seek_mpeg, NULL, free_MPEG_custom},
+    {coding_MPEG_layer2, CODEC_SEEKABLE, 1, 0, decode_MPEG_custom, NULL, NULL, reset_mpeg, seek_mpeg, NULL, free_MPEG_custom},
+    {coding_MPEG_layer3, CODEC_SEEKABLE, 1, 0, decode_MPEG_custom, NULL, NULL, reset_mpeg, seek_mpeg, NULL, free_MPEG_custom},
+#endif
+#ifdef VGM_USE_G7221
+    /* Siren7: 16000/50 */
+    {coding_G7221C, 0, 32000/50, 0, decode_G7221C, NULL, frame_size_block, reset_g7221, NULL, NULL, free_g7221},
+#endif
+#ifdef VGM_USE_G719
+    {coding_G719, 0, 48000/50, 0, decode_G719, NULL, frame_size_block, reset_G719, NULL, NULL, free_G719},
+#endif
+#if defined(VGM_USE_MP4V2) && defined(VGM_USE_FDKAAC)
+    {coding_MP4_AAC, CODEC_SEEKABLE, 0, 0, decode_MP4_AAC, samples_per_frame_MP4_AAC, NULL, reset_mp4_aac, seek_mp4_aac, NULL, free_MP4_AAC},
+#endif
+#ifdef VGM_USE_MAIATRAC3PLUS
+    {coding_AT3plus, 0, 0, 0, decode_AT3plus, samples_per_frame_AT3plus, frame_size_block, reset_at3plus, seek_at3plus, NULL, free_AT3plus},
+#endif
+#ifdef VGM_USE_ATRAC9
+    /* varies with config data, usually 256 or 1024 samples and 0x100-200 bytes */
+    {coding_ATRAC9, CODEC_SEEKABLE, 0, 0, decode_ATRAC9, NULL, NULL, reset_atrac9, seek_atrac9, NULL, free_ATRAC9},
+#endif
+#ifdef VGM_USE_CELT
+    /* varies, usually 512? samples and 0x80-100 bytes */
+    {coding_CELT_FSB, CODEC_SEEKABLE, 0, 0, decode_CELT_FSB, NULL, NULL, reset_celt_fsb, seek_celt_fsb, NULL, free_CELT_FSB},
+#endif
+#ifdef VGM_USE_FFMPEG
+    {coding_FFmpeg, CODEC_SEEKABLE | CODEC_FLOAT, 0, 0, decode_FFmpeg, samples_per_frame_FFmpeg, frame_size_block, reset_ffmpeg, seek_ffmpeg, loop_from_start, free_FFmpeg, decode_FFmpeg_f32},
+#endif
+};
+
+static const codec_info codec_info_none = {0};
+
+/* Returns the info for a coding type (never NULL). The list has a row per coding_t, in order. */
+const codec_info * get_codec_info(coding_t type) {
+    const int count = sizeof(codec_info_list) / sizeof(codec_info_list[0]);
+
+    if (type < 0 || type >= count)
+        return &codec_info_none;
+    return &codec_info_list[type];
+}
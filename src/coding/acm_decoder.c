@@ -18,10 +18,10 @@ acm_codec_data *init_acm(STREAMFILE *streamFile, int force_channel_number) {
     char filename[PATH_LIMIT];
 
 
-    data = calloc(1,sizeof(acm_codec_data));
+    data = vgm_calloc(1,sizeof(acm_codec_data));
     if (!data) goto fail;
 
-    data->io_config = calloc(1,sizeof(acm_io_config));
+    data->io_config = vgm_calloc(1,sizeof(acm_io_config));
     if (!data->io_config) goto fail;
 
     streamFile->get_name(streamFile,filename,sizeof(filename));
@@ -92,8 +92,8 @@ void free_acm(acm_codec_data *data) {
 
     acm_close(data->handle);
     close_streamfile(data->streamfile);
-    free(data->io_config);
-    free(data);
+    vgm_free(data->io_config);
+    vgm_free(data);
 }
 
 /* ******************************* */
@@ -25,6 +25,8 @@
 #include <string.h>
 
 #include "acm_decoder_libacm.h" //"libacm.h"//vgmstream mod
+#include "../alloc.h" //vgmstream mod
+#include "../threads.h" //vgmstream mod
 
 #define ACM_BUFLEN	(64*1024)
 
@@ -177,8 +179,11 @@ static int tables_generated;
 static void generate_tables(void)
 {
 	int x1, x2, x3;
-	if (tables_generated)
+	vgm_lock_init(); //vgmstream mod
+	if (tables_generated) {
+		vgm_unlock_init(); //vgmstream mod
 		return;
+	}
 	for (x3 = 0; x3 < 3; x3++)
 		for (x2 = 0; x2 < 3; x2++)
 			for (x1 = 0; x1 < 3; x1++)
@@ -194,6 +199,7 @@ static void generate_tables(void)
 			mul_2x11[x1 + x2*11] = x1 + (x2 << 4);
 
 	tables_generated = 1;
+	vgm_unlock_init(); //vgmstream mod
 }
 
 /* IOW: (r * acm->subblock_len) + c */
@@ -777,7 +783,7 @@ int acm_open_decoder(ACMStream **res, void *arg, acm_io_callbacks io_cb, int for
 	int err = ACM_ERR_OTHER;
 	ACMStream *acm;
 	
-	acm = malloc(sizeof(*acm));
+	acm = vgm_malloc(sizeof(*acm));
 	if (!acm)
 		return err;
 	memset(acm, 0, sizeof(*acm));
@@ -792,7 +798,7 @@ int acm_open_decoder(ACMStream **res, void *arg, acm_io_callbacks io_cb, int for
 	}
 	
 	acm->buf_max = ACM_BUFLEN;
-	acm->buf = malloc(acm->buf_max);
+	acm->buf = vgm_malloc(acm->buf_max);
 	if (!acm->buf) 
 		goto err_out;
 
@@ -820,9 +826,9 @@ int acm_open_decoder(ACMStream **res, void *arg, acm_io_callbacks io_cb, int for
 	acm->block_len = acm->info.acm_rows * acm->info.acm_cols;
 
 	/* allocate */
-	acm->block = malloc(acm->block_len * sizeof(int));
-	acm->wrapbuf = malloc(acm->wrapbuf_len * sizeof(int));
-	acm->ampbuf = malloc(0x10000 * sizeof(int));
+	acm->block = vgm_malloc(acm->block_len * sizeof(int));
+	acm->wrapbuf = vgm_malloc(acm->wrapbuf_len * sizeof(int));
+	acm->ampbuf = vgm_malloc(0x10000 * sizeof(int));
 	acm->midbuf = acm->ampbuf + 0x8000;
 
 	memset(acm->wrapbuf, 0, acm->wrapbuf_len * sizeof(int));
@@ -900,13 +906,13 @@ void acm_close(ACMStream *acm)
 	if (acm->io.close_func)
 		acm->io.close_func(acm->io_arg);
 	if (acm->buf)
-		free(acm->buf);
+		vgm_free(acm->buf);
 	if (acm->block)
-		free(acm->block);
+		vgm_free(acm->block);
 	if (acm->wrapbuf)
-		free(acm->wrapbuf);
+		vgm_free(acm->wrapbuf);
 	if (acm->ampbuf)
-		free(acm->ampbuf);
-	free(acm);
+		vgm_free(acm->ampbuf);
+	vgm_free(acm);
 }
 
@@ -6,7 +6,7 @@
 
 maiatrac3plus_codec_data *init_at3plus() {
 
-    maiatrac3plus_codec_data *data = malloc(sizeof(maiatrac3plus_codec_data));
+    maiatrac3plus_codec_data *data = vgm_malloc(sizeof(maiatrac3plus_codec_data));
     data->buffer = 0;
     data->samples_discard = 0;
     data->handle = Atrac3plusDecoder_openContext();
@@ -74,7 +74,7 @@ void seek_at3plus(VGMSTREAM *vgmstream, int32_t num_sample) {
 void free_at3plus(maiatrac3plus_codec_data *data) {
     if (data) {
         if (data->handle) Atrac3plusDecoder_closeContext(data->handle);
-        free(data);
+        vgm_free(data);
     }
 }
 
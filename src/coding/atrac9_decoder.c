@@ -27,7 +27,7 @@ atrac9_codec_data *init_atrac9(atrac9_config *cfg) {
     uint8_t config_data[4];
     atrac9_codec_data *data = NULL;
 
-    data = calloc(1, sizeof(atrac9_codec_data));
+    data = vgm_calloc(1, sizeof(atrac9_codec_data));
     if (!data) goto fail;
 
     data->handle = Atrac9GetHandle();
@@ -49,8 +49,8 @@ atrac9_codec_data *init_atrac9(atrac9_config *cfg) {
 
     /* must hold at least one superframe and its samples */
     data->data_buffer_size = data->info.superframeSize;
-    data->data_buffer = calloc(sizeof(uint8_t), data->data_buffer_size);
-    data->sample_buffer = calloc(sizeof(sample), data->info.channels * data->info.frameSamples * data->info.framesInSuperframe);
+    data->data_buffer = vgm_calloc(sizeof(uint8_t), data->data_buffer_size);
+    data->sample_buffer = vgm_calloc(sizeof(sample), data->info.channels * data->info.frameSamples * data->info.framesInSuperframe);
 
     data->samples_to_discard = cfg->encoder_delay;
 
@@ -214,9 +214,9 @@ void free_atrac9(atrac9_codec_data *data) {
     if (!data) return;
 
     if (data->handle) Atrac9ReleaseHandle(data->handle);
-    free(data->data_buffer);
-    free(data->sample_buffer);
-    free(data);
+    vgm_free(data->data_buffer);
+    vgm_free(data->sample_buffer);
+    vgm_free(data);
 }
 
 
@@ -34,7 +34,7 @@ celt_codec_data *init_celt_fsb(int channels, celt_lib_t version) {
     celt_codec_data *data = NULL;
 
 
-    data = calloc(1, sizeof(celt_codec_data));
+    data = vgm_calloc(1, sizeof(celt_codec_data));
     if (!data) goto fail;
 
     data->channel_mode = channels; /* should be 1/2, or rejected by libcelt */
@@ -67,7 +67,7 @@ celt_codec_data *init_celt_fsb(int channels, celt_lib_t version) {
             goto fail;
     }
 
-    data->sample_buffer = calloc(sizeof(sample), data->channel_mode * FSB_CELT_SAMPLES_PER_FRAME);
+    data->sample_buffer = vgm_calloc(sizeof(sample), data->channel_mode * FSB_CELT_SAMPLES_PER_FRAME);
     if (!data->sample_buffer) goto fail;
     /*  there is ~128 samples of encoder delay, but FMOD DLLs don't discard it? */
 
@@ -225,7 +225,7 @@ void free_celt_fsb(celt_codec_data *data) {
             break;
     }
 
-    free(data->sample_buffer);
-    free(data);
+    vgm_free(data->sample_buffer);
+    vgm_free(data);
 }
 #endif
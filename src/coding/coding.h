@@ -75,6 +75,9 @@ void decode_ulaw(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing,
 void decode_ulaw_int(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do);
 void decode_alaw(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do);
 void decode_pcmfloat(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int big_endian);
+void decode_pcm16_frames(VGMSTREAMCHANNEL * stream, sample * outbuf, int channels, int32_t first_sample, int32_t samples_to_do, int big_endian);
+void decode_pcm8_frames(VGMSTREAMCHANNEL * stream, sample * outbuf, int channels, int32_t first_sample, int32_t samples_to_do, int is_unsigned);
+void decode_pcmfloat_frames(VGMSTREAMCHANNEL * stream, sample * outbuf, int channels, int32_t first_sample, int32_t samples_to_do, int big_endian);
 size_t pcm_bytes_to_samples(size_t bytes, int channels, int bits_per_sample);
 
 /* psx_decoder */
@@ -178,6 +181,7 @@ void free_ea_mt(ea_mt_codec_data *data, int channels);
 /* hca_decoder */
 hca_codec_data *init_hca(STREAMFILE *streamFile);
 void decode_hca(hca_codec_data * data, sample * outbuf, int32_t samples_to_do);
+void decode_hca_f32(hca_codec_data * data, float * outbuf, int32_t samples_to_do);
 void reset_hca(hca_codec_data * data);
 void loop_hca(hca_codec_data * data);
 void free_hca(hca_codec_data * data);
@@ -186,6 +190,7 @@ int test_hca_key(hca_codec_data * data, unsigned long long keycode);
 #ifdef VGM_USE_VORBIS
 /* ogg_vorbis_decoder */
 void decode_ogg_vorbis(ogg_vorbis_codec_data * data, sample * outbuf, int32_t samples_to_do, int channels);
+void decode_ogg_vorbis_f32(ogg_vorbis_codec_data * data, float * outbuf, int32_t samples_to_do, int channels);
 void reset_ogg_vorbis(VGMSTREAM *vgmstream);
 void seek_ogg_vorbis(VGMSTREAM *vgmstream, int32_t num_sample);
 void free_ogg_vorbis(ogg_vorbis_codec_data *data);
@@ -193,6 +198,7 @@ void free_ogg_vorbis(ogg_vorbis_codec_data *data);
 /* vorbis_custom_decoder */
 vorbis_custom_codec_data *init_vorbis_custom(STREAMFILE *streamfile, off_t start_offset, vorbis_custom_t type, vorbis_custom_config * config);
 void decode_vorbis_custom(VGMSTREAM * vgmstream, sample * outbuf, int32_t samples_to_do, int channels);
+void decode_vorbis_custom_f32(VGMSTREAM * vgmstream, float * outbuf, int32_t samples_to_do, int channels);
 void reset_vorbis_custom(VGMSTREAM *vgmstream);
 void seek_vorbis_custom(VGMSTREAM *vgmstream, int32_t num_sample);
 void free_vorbis_custom(vorbis_custom_codec_data *data);
@@ -271,6 +277,7 @@ ffmpeg_codec_data *init_ffmpeg_header_offset(STREAMFILE *streamFile, uint8_t * h
 ffmpeg_codec_data *init_ffmpeg_header_offset_subsong(STREAMFILE *streamFile, uint8_t * header, uint64_t header_size, uint64_t start, uint64_t size, int target_subsong);
 
 void decode_ffmpeg(VGMSTREAM *stream, sample * outbuf, int32_t samples_to_do, int channels);
+void decode_ffmpeg_f32(VGMSTREAM *stream, float * outbuf, int32_t samples_to_do, int channels);
 void reset_ffmpeg(VGMSTREAM *vgmstream);
 void seek_ffmpeg(VGMSTREAM *vgmstream, int32_t num_sample);
 void free_ffmpeg(ffmpeg_codec_data *data);
@@ -291,6 +298,17 @@ size_t ea_opus_get_encoder_delay(off_t offset, STREAMFILE *streamFile);
 #endif
 
 
+/* pcm_convert */
+#define PCM_CONVERT_TRUNCATE    0x00  /* (int)(f * 32768), saturated */
+#define PCM_CONVERT_ROUND       0x01  /* floor(f * 32767 + 0.5), clamped */
+#define PCM_CONVERT_RINT        0x02  /* lrint(f * 32768), clamped */
+void pcm_convert_float(sample * outbuf, const float * inbuf, int count, int mode);
+void pcm_convert_float_planar(sample * outbuf, float ** inbuf, int channels, int samples, int mode);
+void pcm_convert_s32(sample * outbuf, const int32_t * inbuf, int count);
+void pcm_convert_double(sample * outbuf, const double * inbuf, int count);
+void pcm_interleave_float_planar(float * outbuf, float ** inbuf, int channels, int samples);
+
+
 /* coding_utils */
 int ffmpeg_fmt_chunk_swap_endian(uint8_t * chunk, size_t chunk_size, uint16_t codec);
 int ffmpeg_make_riff_atrac3(uint8_t * buf, size_t buf_size, size_t sample_count, size_t data_size, int channels, int sample_rate, int block_align, int joint_stereo, int encoder_delay);
@@ -44,11 +44,11 @@ ea_mt_codec_data *init_ea_mt_loops(int channels, int pcm_blocks, int loop_sample
     ea_mt_codec_data *data = NULL;
     int i;
 
-    data = calloc(channels, sizeof(ea_mt_codec_data)); /* one decoder per channel */
+    data = vgm_calloc(channels, sizeof(ea_mt_codec_data)); /* one decoder per channel */
     if (!data) goto fail;
 
     for (i = 0; i < channels; i++) {
-        data[i].utk_context = calloc(1, sizeof(UTKContext));
+        data[i].utk_context = vgm_calloc(1, sizeof(UTKContext));
         if (!data[i].utk_context) goto fail;
         utk_init(data[i].utk_context);
 
@@ -187,9 +187,9 @@ void free_ea_mt(ea_mt_codec_data *data, int channels) {
         return;
 
     for (i = 0; i < channels; i++) {
-        free(data[i].utk_context);
+        vgm_free(data[i].utk_context);
     }
-    free(data);
+    vgm_free(data);
 }
 
 /* ********************** */
@@ -1,4 +1,5 @@
 #include "coding.h"
+#include "../threads.h"
 
 #ifdef VGM_USE_FFMPEG
 
@@ -7,7 +8,10 @@
 #define FFMPEG_DEFAULT_IO_BUFFER_SIZE 128 * 1024
 
 
-static volatile int g_ffmpeg_initialized = 0;
+static int g_ffmpeg_initialized = 0;
+
+static void add_seek_entry(ffmpeg_codec_data *data, AVPacket *packet);
+static void seek_ffmpeg_start(ffmpeg_codec_data *data, int32_t num_sample);
 
 
 /* ******************************************** */
@@ -16,16 +20,14 @@ static volatile int g_ffmpeg_initialized = 0;
 
 /* Global FFmpeg init */
 static void g_init_ffmpeg() {
-    if (g_ffmpeg_initialized == 1) {
-        while (g_ffmpeg_initialized < 2); /* active wait for lack of a better way */
-    }
-    else if (g_ffmpeg_initialized == 0) {
-        g_ffmpeg_initialized = 1;
+    vgm_lock_init();
+    if (!g_ffmpeg_initialized) {
         av_log_set_flags(AV_LOG_SKIP_REPEATED);
         av_log_set_level(AV_LOG_ERROR);
         //av_register_all(); /* not needed in newer versions */
-        g_ffmpeg_initialized = 2;
+        g_ffmpeg_initialized = 1;
     }
+    vgm_unlock_init();
 }
 
 /* converts codec's samples (can be in any format, ex. Ogg's float32) to PCM16 */
@@ -45,23 +47,50 @@ static void convert_audio_pcm16(sample *outbuf, const uint8_t *inbuf, int fullSa
             }
             break;
         }
+        case 32: {
+            if (!floatingPoint) {
+                pcm_convert_s32(outbuf, (const int32_t *)inbuf, fullSampleCount);
+            }
+            else {
+                pcm_convert_float(outbuf, (const float *)inbuf, fullSampleCount, PCM_CONVERT_TRUNCATE);
+            }
+            break;
+        }
+        case 64: {
+            if (floatingPoint) {
+                pcm_convert_double(outbuf, (const double *)inbuf, fullSampleCount);
+            }
+            break;
+        }
+    }
+}
+
+/* same as the above but for float output (no intermediate PCM16, so float decoders aren't clipped) */
+static void convert_audio_float(float *outbuf, const uint8_t *inbuf, int fullSampleCount, int bitsPerSample, int floatingPoint) {
+    int s;
+    switch (bitsPerSample) {
+        case 8: {
+            for (s = 0; s < fullSampleCount; s++) {
+                *outbuf++ = ((int)(*(inbuf++))-0x80) / 128.0f;
+            }
+            break;
+        }
+        case 16: {
+            int16_t *s16 = (int16_t *)inbuf;
+            for (s = 0; s < fullSampleCount; s++) {
+                *outbuf++ = *(s16++) / 32768.0f;
+            }
+            break;
+        }
         case 32: {
             if (!floatingPoint) {
                 int32_t *s32 = (int32_t *)inbuf;
                 for (s = 0; s < fullSampleCount; s++) {
-                    *outbuf++ = (*(s32++)) >> 16;
+                    *outbuf++ = (float)(*(s32++) / 2147483648.0);
                 }
             }
             else {
-                float *s32 = (float *)inbuf;
-                for (s = 0; s < fullSampleCount; s++) {
-                    float sample = *s32++;
-                    int s16 = (int)(sample * 32768.0f);
-                    if ((unsigned)(s16 + 0x8000) & 0xFFFF0000) {
-                        s16 = (s16 >> 31) ^ 0x7FFF;
-                    }
-                    *outbuf++ = s16;
-                }
+                memcpy(outbuf, inbuf, fullSampleCount * sizeof(float));
             }
             break;
         }
@@ -69,12 +98,7 @@ static void convert_audio_pcm16(sample *outbuf, const uint8_t *inbuf, int fullSa
             if (floatingPoint) {
                 double *s64 = (double *)inbuf;
                 for (s = 0; s < fullSampleCount; s++) {
-                    double sample = *s64++;
-                    int s16 = (int)(sample * 32768.0f);
-                    if ((unsigned)(s16 + 0x8000) & 0xFFFF0000) {
-                        s16 = (s16 >> 31) ^ 0x7FFF;
-                    }
-                    *outbuf++ = s16;
+                    *outbuf++ = (float)*(s64++);
                 }
             }
             break;
@@ -299,8 +323,9 @@ ffmpeg_codec_data * init_ffmpeg_header_offset_subsong(STREAMFILE *streamFile, ui
     /* basic setup */
     g_init_ffmpeg();
 
-    data = ( ffmpeg_codec_data * ) calloc(1, sizeof(ffmpeg_codec_data));
+    data = ( ffmpeg_codec_data * ) vgm_calloc(1, sizeof(ffmpeg_codec_data));
     if (!data) return NULL;
+    data->seekCheckPos = -1;
 
     streamFile->get_name( streamFile, filename, sizeof(filename) );
     data->streamfile = streamFile->open(streamFile, filename, STREAMFILE_DEFAULT_BUFFER_SIZE);
@@ -389,7 +414,7 @@ ffmpeg_codec_data * init_ffmpeg_header_offset_subsong(STREAMFILE *streamFile, ui
     if (!data->lastDecodedFrame) goto fail;
     av_frame_unref(data->lastDecodedFrame);
 
-    data->lastReadPacket = malloc(sizeof(AVPacket));
+    data->lastReadPacket = vgm_malloc(sizeof(AVPacket));
     if (!data->lastReadPacket) goto fail;
     av_new_packet(data->lastReadPacket, 0);
 
@@ -494,8 +519,8 @@ fail:
     return NULL;
 }
 
-/* decode samples of any kind of FFmpeg format */
-void decode_ffmpeg(VGMSTREAM *vgmstream, sample * outbuf, int32_t samples_to_do, int channels) {
+/* decode samples of any kind of FFmpeg format, into outbuf or outbuf_f (float) */
+static void decode_ffmpeg_internal(VGMSTREAM *vgmstream, sample * outbuf, float * outbuf_f, int32_t samples_to_do, int channels) {
     ffmpeg_codec_data *data = vgmstream->codec_data;
     int samplesReadNow;
     //todo use either channels / data->channels / codecCtx->channels
@@ -518,7 +543,10 @@ void decode_ffmpeg(VGMSTREAM *vgmstream, sample * outbuf, int32_t samples_to_do,
     /* ignore once file is done (but not at endOfStream as FFmpeg can still output samples until endOfAudio) */
     if (/*endOfStream ||*/ endOfAudio) {
         VGM_LOG("FFMPEG: decode after end of audio\n");
-        memset(outbuf, 0, samples_to_do * channels * sizeof(sample));
+        if (outbuf_f)
+            memset(outbuf_f, 0, samples_to_do * channels * sizeof(float));
+        else
+            memset(outbuf, 0, samples_to_do * channels * sizeof(sample));
         return;
     }
 
@@ -558,6 +586,19 @@ void decode_ffmpeg(VGMSTREAM *vgmstream, sample * outbuf, int32_t samples_to_do,
 
                 if (packet->stream_index != data->streamIndex)
                     continue; /* ignore non-selected streams */
+
+                if (errcode >= 0) {
+                    /* index seeks may land elsewhere in some demuxers, redo from the beginning */
+                    if (data->seekCheckPos >= 0 && packet->pos != data->seekCheckPos) {
+                        VGM_LOG("FFMPEG: index seek to 0x%"PRIx64" landed at 0x%"PRIx64"\n", data->seekCheckPos, (int64_t)packet->pos);
+                        seek_ffmpeg_start(data, data->seekTarget);
+                        bytesConsumedFromDecodedFrame = data->bytesConsumedFromDecodedFrame;
+                        continue;
+                    }
+                    data->seekCheckPos = -1;
+
+                    add_seek_entry(data, packet);
+                }
             }
 
             /* send compressed data to decoder in packet (NULL at EOF to "drain") */
@@ -597,6 +638,8 @@ void decode_ffmpeg(VGMSTREAM *vgmstream, sample * outbuf, int32_t samples_to_do,
                 }
             }
 
+            data->decodedSamples += frame->nb_samples;
+
             /* get sample data size of current frame */
             dataSize = av_samples_get_buffer_size(NULL, codecCtx->channels, frame->nb_samples, codecCtx->sample_fmt, 1);
             if (dataSize < 0)
@@ -653,14 +696,20 @@ void decode_ffmpeg(VGMSTREAM *vgmstream, sample * outbuf, int32_t samples_to_do,
 
 
 end:
-    /* convert native sample format into PCM16 outbuf */
+    /* convert native sample format into PCM16 (or float) outbuf */
     samplesReadNow = bytesRead / (bytesPerSample * channels);
-    convert_audio_pcm16(outbuf, data->sampleBuffer, samplesReadNow * channels, data->bitsPerSample, data->floatingPoint);
+    if (outbuf_f)
+        convert_audio_float(outbuf_f, data->sampleBuffer, samplesReadNow * channels, data->bitsPerSample, data->floatingPoint);
+    else
+        convert_audio_pcm16(outbuf, data->sampleBuffer, samplesReadNow * channels, data->bitsPerSample, data->floatingPoint);
 
     /* clean buffer when requested more samples than possible */
     if (endOfAudio && samplesReadNow < samples_to_do) {
         VGM_LOG("FFMPEG: decode after end of audio %i samples\n", (samples_to_do - samplesReadNow));
-        memset(outbuf + (samplesReadNow * channels), 0, (samples_to_do - samplesReadNow) * channels * sizeof(sample));
+        if (outbuf_f)
+            memset(outbuf_f + (samplesReadNow * channels), 0, (samples_to_do - samplesReadNow) * channels * sizeof(float));
+        else
+            memset(outbuf + (samplesReadNow * channels), 0, (samples_to_do - samplesReadNow) * channels * sizeof(sample));
     }
 
     /* copy state back */
@@ -670,15 +719,46 @@ end:
     data->bytesConsumedFromDecodedFrame = bytesConsumedFromDecodedFrame;
 }
 
+void decode_ffmpeg(VGMSTREAM *vgmstream, sample * outbuf, int32_t samples_to_do, int channels) {
+    decode_ffmpeg_internal(vgmstream, outbuf, NULL, samples_to_do, channels);
+}
+
+void decode_ffmpeg_f32(VGMSTREAM *vgmstream, float * outbuf, int32_t samples_to_do, int channels) {
+    decode_ffmpeg_internal(vgmstream, NULL, outbuf, samples_to_do, channels);
+}
+
 
 /* ******************************************** */
 /* UTILS                                        */
 /* ******************************************** */
 
-void reset_ffmpeg(VGMSTREAM *vgmstream) {
-    ffmpeg_codec_data *data = (ffmpeg_codec_data *) vgmstream->codec_data;
-    if (!data) return;
+/* Adds packets in the first pass to the index. Expects packets to output a frame as they are sent,
+ * as FFmpeg's audio decoders do (samples received before sending a packet belong to previous ones). */
+static void add_seek_entry(ffmpeg_codec_data *data, AVPacket *packet) {
+    ffmpeg_seek_entry *entry;
+
+    if (packet->pos < 0)
+        return;
+    if (data->seekIndexCount && packet->pos <= data->seekIndex[data->seekIndexCount - 1].pos)
+        return;
+
+    if (data->seekIndexCount == data->seekIndexMax) {
+        int new_max = data->seekIndexMax ? data->seekIndexMax * 2 : 256;
+        ffmpeg_seek_entry *new_index = vgm_realloc(data->seekIndex, new_max * sizeof(ffmpeg_seek_entry));
+        if (!new_index) return; /* keep what we have, seeking will discard more */
+        data->seekIndex = new_index;
+        data->seekIndexMax = new_max;
+    }
 
+    entry = &data->seekIndex[data->seekIndexCount];
+    entry->pos = packet->pos;
+    entry->ts = packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+    entry->sample = data->decodedSamples;
+    data->seekIndexCount++;
+}
+
+/* seeks to the beginning and discards until num_sample */
+static void seek_ffmpeg_start(ffmpeg_codec_data *data, int32_t num_sample) {
     if (data->formatCtx) {
         avformat_seek_file(data->formatCtx, data->streamIndex, 0, 0, 0, AVSEEK_FLAG_ANY);
     }
@@ -689,7 +769,9 @@ void reset_ffmpeg(VGMSTREAM *vgmstream) {
     data->bytesConsumedFromDecodedFrame = INT_MAX;
     data->endOfStream = 0;
     data->endOfAudio = 0;
-    data->samplesToDiscard = 0;
+    data->samplesToDiscard = num_sample;
+    data->decodedSamples = 0;
+    data->seekCheckPos = -1;
 
     /* consider skip samples (encoder delay), if manually set (otherwise let FFmpeg handle it) */
     if (data->skipSamplesSet) {
@@ -702,34 +784,90 @@ void reset_ffmpeg(VGMSTREAM *vgmstream) {
     }
 }
 
-void seek_ffmpeg(VGMSTREAM *vgmstream, int32_t num_sample) {
-    ffmpeg_codec_data *data = (ffmpeg_codec_data *) vgmstream->codec_data;
-    int64_t ts;
-    if (!data)
-        return;
+/* Seeks to a packet a bit before num_sample (to let MDCT overlap and codec pre-roll settle) and discards
+ * the rest. Returns 0 if the index can't be used. */
+static int seek_ffmpeg_index(ffmpeg_codec_data *data, int32_t num_sample) {
+    AVStream *stream;
+    const ffmpeg_seek_entry *entry;
+    int64_t target, preroll;
+    int lo, hi, index, ret;
 
-    /* Start from 0 and discard samples until loop_start (slower but not too noticeable).
-     * Due to various FFmpeg quirks seeking to a sample is erratic in many formats (would need extra steps). */
-    data->samplesToDiscard = num_sample;
-    ts = 0;
+    if (!data->formatCtx || !data->codecCtx || data->seekIndexCount == 0)
+        return 0;
+    /* XMA frames span packets and the decoder resyncs after flushing, so output count changes */
+    if (data->codecCtx->codec_id == AV_CODEC_ID_XMA1 || data->codecCtx->codec_id == AV_CODEC_ID_XMA2)
+        return 0;
+
+    stream = data->formatCtx->streams[data->streamIndex];
+    target = num_sample + (data->skipSamplesSet ? data->skipSamples : 0);
+    preroll = stream->codecpar->seek_preroll; /* ex. Opus */
+
+    /* last packet starting before target - preroll */
+    index = -1;
+    lo = 0;
+    hi = data->seekIndexCount - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (data->seekIndex[mid].sample <= target - preroll) {
+            index = mid;
+            lo = mid + 1;
+        }
+        else {
+            hi = mid - 1;
+        }
+    }
+
+    /* one more for overlap; the first packets are left to the normal path (skip_samples and such) */
+    index -= 1;
+    if (index < 1)
+        return 0;
+    entry = &data->seekIndex[index];
+
+    ret = -1;
+    if (!(data->formatCtx->iformat->flags & AVFMT_NO_BYTE_SEEK))
+        ret = av_seek_frame(data->formatCtx, data->streamIndex, entry->pos, AVSEEK_FLAG_BYTE);
+    if (ret < 0 && entry->ts != AV_NOPTS_VALUE)
+        ret = avformat_seek_file(data->formatCtx, data->streamIndex, entry->ts, entry->ts, entry->ts, AVSEEK_FLAG_ANY);
+    if (ret < 0)
+        return 0;
 
-    avformat_seek_file(data->formatCtx, data->streamIndex, ts, ts, ts, AVSEEK_FLAG_ANY);
     avcodec_flush_buffers(data->codecCtx);
 
     data->readNextPacket = 1;
     data->bytesConsumedFromDecodedFrame = INT_MAX;
     data->endOfStream = 0;
     data->endOfAudio = 0;
+    data->samplesToDiscard = (int)(target - entry->sample);
+    data->decodedSamples = entry->sample;
+    data->seekCheckPos = entry->pos;
+    data->seekTarget = num_sample;
 
-    /* consider skip samples (encoder delay), if manually set (otherwise let FFmpeg handle it) */
     if (data->skipSamplesSet) {
-        AVStream *stream = data->formatCtx->streams[data->streamIndex];
-        /* sometimes (ex. AAC) after seeking to the first packet skip_samples is restored, but we want our value */
         stream->skip_samples = 0;
         stream->start_skip_samples = 0;
-
-        data->samplesToDiscard += data->skipSamples;
     }
+
+    return 1;
+}
+
+void reset_ffmpeg(VGMSTREAM *vgmstream) {
+    ffmpeg_codec_data *data = (ffmpeg_codec_data *) vgmstream->codec_data;
+    if (!data) return;
+
+    seek_ffmpeg_start(data, 0);
+}
+
+void seek_ffmpeg(VGMSTREAM *vgmstream, int32_t num_sample) {
+    ffmpeg_codec_data *data = (ffmpeg_codec_data *) vgmstream->codec_data;
+    if (!data)
+        return;
+
+    /* Due to various FFmpeg quirks seeking to a sample is erratic in many formats (would need extra steps),
+     * so use our own packet index from a previous pass, or start from 0 and discard samples until the target. */
+    if (seek_ffmpeg_index(data, num_sample))
+        return;
+
+    seek_ffmpeg_start(data, num_sample);
 }
 
 void free_ffmpeg(ffmpeg_codec_data *data) {
@@ -738,7 +876,7 @@ void free_ffmpeg(ffmpeg_codec_data *data) {
 
     if (data->lastReadPacket) {
         av_packet_unref(data->lastReadPacket);
-        free(data->lastReadPacket);
+        vgm_free(data->lastReadPacket);
         data->lastReadPacket = NULL;
     }
     if (data->lastDecodedFrame) {
@@ -777,7 +915,8 @@ void free_ffmpeg(ffmpeg_codec_data *data) {
         close_streamfile(data->streamfile);
         data->streamfile = NULL;
     }
-    free(data);
+    vgm_free(data->seekIndex);
+    vgm_free(data);
 }
 
 
@@ -12,7 +12,7 @@ g719_codec_data *init_g719(int channel_count, int frame_size) {
     if (frame_size / sizeof(int16_t) > G719_MAX_CODES)
         goto fail;
 
-    data = calloc(channel_count, sizeof(g719_codec_data)); /* one decoder per channel */
+    data = vgm_calloc(channel_count, sizeof(g719_codec_data)); /* one decoder per channel */
     if (!data) goto fail;
 
     for (i = 0; i < channel_count; i++) {
@@ -28,7 +28,7 @@ fail:
             g719_free(data[i].handle);
         }
     }
-    free(data);
+    vgm_free(data);
 
     return NULL;
 }
@@ -69,7 +69,7 @@ void free_g719(g719_codec_data * data, int channels) {
     for (i = 0; i < channels; i++) {
         g719_free(data[i].handle);
     }
-    free(data);
+    vgm_free(data);
 }
 
 #endif
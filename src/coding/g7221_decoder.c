@@ -11,7 +11,7 @@ g7221_codec_data * init_g7221(int channel_count, int frame_size) {
     if (frame_size / sizeof(int16_t) > G7221_MAX_CODES)
         goto fail;
 
-    data = calloc(channel_count, sizeof(g7221_codec_data)); /* one decoder per channel */
+    data = vgm_calloc(channel_count, sizeof(g7221_codec_data)); /* one decoder per channel */
     if (!data) goto fail;
 
     for (i = 0; i < channel_count; i++) {
@@ -27,7 +27,7 @@ fail:
             g7221_free(data[i].handle);
         }
     }
-    free(data);
+    vgm_free(data);
 
     return NULL;
 }
@@ -69,7 +69,7 @@ void free_g7221(VGMSTREAM *vgmstream) {
     for (i = 0; i < vgmstream->channels; i++) {
         g7221_free(data[i].handle);
     }
-    free(data);
+    vgm_free(data);
 }
 
 #endif
@@ -19,11 +19,11 @@ hca_codec_data * init_hca(STREAMFILE *streamFile) {
         goto fail;
 
     /* init vgmstream context */
-    data = calloc(1, sizeof(hca_codec_data));
+    data = vgm_calloc(1, sizeof(hca_codec_data));
     if (!data) goto fail;
 
     /* init library handle */
-    data->handle = calloc(1, clHCA_sizeof());
+    data->handle = vgm_calloc(1, clHCA_sizeof());
     clHCA_clear(data->handle);
 
     status = clHCA_DecodeHeader(data->handle, header_buffer, header_size); /* parse header */
@@ -32,10 +32,10 @@ hca_codec_data * init_hca(STREAMFILE *streamFile) {
     status = clHCA_getInfo(data->handle, &data->info); /* extract header info */
     if (status < 0) goto fail;
 
-    data->data_buffer = malloc(data->info.blockSize);
+    data->data_buffer = vgm_malloc(data->info.blockSize);
     if (!data->data_buffer) goto fail;
 
-    data->sample_buffer = malloc(sizeof(signed short) * data->info.channelCount * data->info.samplesPerBlock);
+    data->sample_buffer = vgm_malloc(sizeof(signed short) * data->info.channelCount * data->info.samplesPerBlock);
     if (!data->sample_buffer) goto fail;
 
     /* load streamfile for reads */
@@ -53,8 +53,9 @@ fail:
     return NULL;
 }
 
-void decode_hca(hca_codec_data * data, sample * outbuf, int32_t samples_to_do) {
-	int samples_done = 0;
+/* outputs to outbuf or outbuf_f (float), converting only if the block was extracted in the other format */
+static void decode_hca_internal(hca_codec_data * data, sample * outbuf, float * outbuf_f, int32_t samples_to_do) {
+    int samples_done = 0;
     const unsigned int channels = data->info.channelCount;
     const unsigned int blockSize = data->info.blockSize;
 
@@ -71,13 +72,35 @@ void decode_hca(hca_codec_data * data, sample * outbuf, int32_t samples_to_do) {
                 data->samples_to_discard -= samples_to_get;
             }
             else {
+                int count, i;
+
                 /* get max samples and copy */
                 if (samples_to_get > samples_to_do - samples_done)
                     samples_to_get = samples_to_do - samples_done;
-
-                memcpy(outbuf + samples_done*channels,
-                       data->sample_buffer + data->samples_consumed*channels,
-                       samples_to_get*channels * sizeof(sample));
+                count = samples_to_get*channels;
+
+                if (outbuf_f && data->float_filled) {
+                    memcpy(outbuf_f + samples_done*channels,
+                           data->sample_buffer_f + data->samples_consumed*channels,
+                           count * sizeof(float));
+                }
+                else if (outbuf_f) {
+                    const signed short * src = data->sample_buffer + data->samples_consumed*channels;
+                    float * dst = outbuf_f + samples_done*channels;
+                    for (i = 0; i < count; i++) {
+                        dst[i] = src[i] / 32768.0f;
+                    }
+                }
+                else if (data->float_filled) {
+                    pcm_convert_float(outbuf + samples_done*channels,
+                           data->sample_buffer_f + data->samples_consumed*channels,
+                           count, PCM_CONVERT_TRUNCATE);
+                }
+                else {
+                    memcpy(outbuf + samples_done*channels,
+                           data->sample_buffer + data->samples_consumed*channels,
+                           count * sizeof(sample));
+                }
                 samples_done += samples_to_get;
             }
 
@@ -92,7 +115,10 @@ void decode_hca(hca_codec_data * data, sample * outbuf, int32_t samples_to_do) {
 
             /* EOF/error */
             if (data->current_block >= data->info.blockCount) {
-                memset(outbuf, 0, (samples_to_do - samples_done) * channels * sizeof(sample));
+                if (outbuf_f)
+                    memset(outbuf_f + samples_done*channels, 0, (samples_to_do - samples_done) * channels * sizeof(float));
+                else
+                    memset(outbuf + samples_done*channels, 0, (samples_to_do - samples_done) * channels * sizeof(sample));
                 break;
             }
 
@@ -111,7 +137,14 @@ void decode_hca(hca_codec_data * data, sample * outbuf, int32_t samples_to_do) {
             }
 
             /* extract samples */
-            clHCA_ReadSamples16(data->handle, data->sample_buffer);
+            if (outbuf_f && data->sample_buffer_f) {
+                clHCA_ReadSamplesFloat(data->handle, data->sample_buffer_f);
+                data->float_filled = 1;
+            }
+            else {
+                clHCA_ReadSamples16(data->handle, data->sample_buffer);
+                data->float_filled = 0;
+            }
 
             data->current_block++;
             data->samples_consumed = 0;
@@ -120,6 +153,19 @@ void decode_hca(hca_codec_data * data, sample * outbuf, int32_t samples_to_do) {
     }
 }
 
+void decode_hca(hca_codec_data * data, sample * outbuf, int32_t samples_to_do) {
+    decode_hca_internal(data, outbuf, NULL, samples_to_do);
+}
+
+void decode_hca_f32(hca_codec_data * data, float * outbuf, int32_t samples_to_do) {
+    if (!data->sample_buffer_f) {
+        /* if this fails blocks are converted from PCM16 instead */
+        data->sample_buffer_f = vgm_malloc(sizeof(float) * data->info.channelCount * data->info.samplesPerBlock);
+    }
+
+    decode_hca_internal(data, NULL, outbuf, samples_to_do);
+}
+
 void reset_hca(hca_codec_data * data) {
     if (!data) return;
 
@@ -143,10 +189,11 @@ void free_hca(hca_codec_data * data) {
 
     close_streamfile(data->streamfile);
     clHCA_done(data->handle);
-    free(data->handle);
-    free(data->data_buffer);
-    free(data->sample_buffer);
-    free(data);
+    vgm_free(data->handle);
+    vgm_free(data->data_buffer);
+    vgm_free(data->sample_buffer);
+    vgm_free(data->sample_buffer_f);
+    vgm_free(data);
 }
 
 
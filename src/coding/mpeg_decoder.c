@@ -1,6 +1,7 @@
 #include "coding.h"
 #include "../util.h"
 #include "../vgmstream.h"
+#include "../threads.h"
 
 #ifdef VGM_USE_MPEG
 #include <mpg123.h>
@@ -14,11 +15,13 @@
  */
 
 #define MPEG_DATA_BUFFER_SIZE 0x1000 /* at least one MPEG frame (max ~0x5A1 plus some more in case of free bitrate) */
+#define MPEG_SEEK_PREROLL_FRAMES 3 /* restart a bit early so bit reservoir, MDCT overlap and synth filter are set */
 
 static mpg123_handle * init_mpg123_handle();
 static void decode_mpeg_standard(VGMSTREAMCHANNEL *stream, mpeg_codec_data * data, sample * outbuf, int32_t samples_to_do, int channels);
 static void decode_mpeg_custom(VGMSTREAM * vgmstream, mpeg_codec_data * data, sample * outbuf, int32_t samples_to_do, int channels);
 static void decode_mpeg_custom_stream(VGMSTREAMCHANNEL *stream, mpeg_codec_data * data, int num_stream);
+static void add_seek_entry(mpeg_custom_stream *ms, off_t offset);
 
 
 /* Inits regular MPEG */
@@ -26,11 +29,11 @@ mpeg_codec_data *init_mpeg(STREAMFILE *streamfile, off_t start_offset, coding_t
     mpeg_codec_data *data = NULL;
 
     /* init codec */
-    data = calloc(1,sizeof(mpeg_codec_data));
+    data = vgm_calloc(1,sizeof(mpeg_codec_data));
     if (!data) goto fail;
 
     data->buffer_size = MPEG_DATA_BUFFER_SIZE;
-    data->buffer = calloc(sizeof(uint8_t), data->buffer_size);
+    data->buffer = vgm_calloc(sizeof(uint8_t), data->buffer_size);
     if (!data->buffer) goto fail;
 
     data->m = init_mpg123_handle();
@@ -122,7 +125,7 @@ mpeg_codec_data *init_mpeg_custom(STREAMFILE *streamFile, off_t start_offset, co
     int i, ok;
 
     /* init codec */
-    data = calloc(1,sizeof(mpeg_codec_data));
+    data = vgm_calloc(1,sizeof(mpeg_codec_data));
     if (!data) goto fail;
 
     /* keep around to decode */
@@ -153,20 +156,20 @@ mpeg_codec_data *init_mpeg_custom(STREAMFILE *streamFile, off_t start_offset, co
 
     /* init streams */
     data->streams_size = channels / data->channels_per_frame;
-    data->streams = calloc(data->streams_size, sizeof(mpeg_custom_stream*));
+    data->streams = vgm_calloc(data->streams_size, sizeof(mpeg_custom_stream*));
     for (i=0; i < data->streams_size; i++) {
-        data->streams[i] = calloc(1, sizeof(mpeg_custom_stream));
+        data->streams[i] = vgm_calloc(1, sizeof(mpeg_custom_stream));
         data->streams[i]->m = init_mpg123_handle(); /* decoder not shared as may need several frames to decode)*/
         if (!data->streams[i]->m) goto fail;
 
         /* size could be any value */
         data->streams[i]->output_buffer_size = sizeof(sample) * data->channels_per_frame * data->samples_per_frame;
-        data->streams[i]->output_buffer = calloc(data->streams[i]->output_buffer_size, sizeof(uint8_t));
+        data->streams[i]->output_buffer = vgm_calloc(data->streams[i]->output_buffer_size, sizeof(uint8_t));
         if (!data->streams[i]->output_buffer) goto fail;
 
         /* one per stream as sometimes mpg123 can't read the whole buffer in one pass */
         data->streams[i]->buffer_size = data->default_buffer_size;
-        data->streams[i]->buffer = calloc(sizeof(uint8_t), data->streams[i]->buffer_size);
+        data->streams[i]->buffer = vgm_calloc(sizeof(uint8_t), data->streams[i]->buffer_size);
         if (!data->streams[i]->buffer) goto fail;
     }
 
@@ -186,8 +189,11 @@ static mpg123_handle * init_mpg123_handle() {
     /* inits a new mpg123 handle */
     m = mpg123_new(NULL,&rc);
     if (rc == MPG123_NOT_INITIALIZED) {
-        /* inits the library if needed */
-        if (mpg123_init() != MPG123_OK)
+        /* inits the library if needed (not thread-safe) */
+        vgm_lock_init();
+        rc = mpg123_init();
+        vgm_unlock_init();
+        if (rc != MPG123_OK)
             goto fail;
         m = mpg123_new(NULL,&rc);
         if (rc != MPG123_OK) goto fail;
@@ -392,6 +398,8 @@ static void decode_mpeg_custom_stream(VGMSTREAMCHANNEL *stream, mpeg_codec_data
     /* read more raw data (could fill the sample buffer too in some cases, namely EALayer3) */
     if (!ms->buffer_full) {
         //;VGM_LOG("MPEG: reading more raw data\n");
+        add_seek_entry(ms, stream->offset);
+
         switch(data->type) {
             case MPEG_EAL31:
             case MPEG_EAL31b:
@@ -449,6 +457,7 @@ static void decode_mpeg_custom_stream(VGMSTREAMCHANNEL *stream, mpeg_codec_data
 
     /* if no decoding was done bytes_done will be zero */
     ms->samples_filled += samples_filled;
+    ms->samples_decoded += samples_filled;
 
     /* not enough raw data, set flag to request more next time
      * (but only with empty mpg123 buffer, EA blocks wait for all samples decoded before advancing blocks) */
@@ -484,15 +493,16 @@ void free_mpeg(mpeg_codec_data *data) {
         int i;
         for (i=0; i < data->streams_size; i++) {
             mpg123_delete(data->streams[i]->m);
-            free(data->streams[i]->buffer);
-            free(data->streams[i]->output_buffer);
-            free(data->streams[i]);
+            vgm_free(data->streams[i]->buffer);
+            vgm_free(data->streams[i]->output_buffer);
+            vgm_free(data->streams[i]->seek_entries);
+            vgm_free(data->streams[i]);
         }
-        free(data->streams);
+        vgm_free(data->streams);
     }
 
-    free(data->buffer);
-    free(data);
+    vgm_free(data->buffer);
+    vgm_free(data);
 
     /* The astute reader will note that a call to mpg123_exit is never
      * made. While is is evilly breaking our contract with mpg123, it
@@ -516,16 +526,102 @@ void reset_mpeg(VGMSTREAM *vgmstream) {
         int i;
         /* re-start from 0 */
         for (i=0; i < data->streams_size; i++) {
-            mpg123_feedseek(data->streams[i]->m,0,SEEK_SET,&input_offset);
+            mpg123_open_feed(data->streams[i]->m);
             data->streams[i]->samples_filled = 0;
             data->streams[i]->samples_used = 0;
             data->streams[i]->decode_to_discard = 0;
+            data->streams[i]->samples_decoded = 0;
         }
 
         data->samples_to_discard = data->skip_samples; /* initial delay */
     }
 }
 
+/* Adds frames in the first pass to the stream's seek table. mpg123 outputs a frame once fed,
+ * so decoded samples so far are the frame's start. Except the very first one, that waits for the
+ * next frame, so frames before anything is output are skipped (their start isn't known yet). */
+static void add_seek_entry(mpeg_custom_stream *ms, off_t offset) {
+    if (ms->seek_count && offset <= ms->seek_entries[ms->seek_count - 1].offset)
+        return;
+    if (ms->seek_count && ms->samples_decoded <= ms->seek_entries[ms->seek_count - 1].sample)
+        return;
+
+    if (ms->seek_count == ms->seek_max) {
+        int new_max = ms->seek_max ? ms->seek_max * 2 : 256;
+        mpeg_custom_seek_entry *new_entries = vgm_realloc(ms->seek_entries, new_max * sizeof(mpeg_custom_seek_entry));
+        if (!new_entries) return; /* keep what we have, seeking will discard more */
+        ms->seek_entries = new_entries;
+        ms->seek_max = new_max;
+    }
+
+    ms->seek_entries[ms->seek_count].offset = offset;
+    ms->seek_entries[ms->seek_count].sample = ms->samples_decoded;
+    ms->seek_count++;
+}
+
+/* Restarts each stream a few frames before num_sample using the seek tables, discarding the rest per stream.
+ * Only for modes where every parsed chunk starts with a frame and streams don't carry parser state
+ * (not-frame-aligned interleaves would make mpg123 resync and change sample counts). Returns 0 if not possible. */
+static int seek_mpeg_index(VGMSTREAM *vgmstream, int32_t num_sample) {
+    mpeg_codec_data *data = vgmstream->codec_data;
+    int32_t target = num_sample + data->skip_samples;
+    int i;
+
+    if (vgmstream->layout_type != layout_none || !vgmstream->loop_ch)
+        return 0;
+    switch(data->type) {
+        case MPEG_STANDARD:
+        case MPEG_AHX:
+        case MPEG_XVAG:
+        case MPEG_FSB:
+            break;
+        default:
+            return 0;
+    }
+
+    /* all streams must have a usable entry (they are decoded in lockstep, so usually they do) */
+    for (i = 0; i < data->streams_size; i++) {
+        mpeg_custom_stream *ms = data->streams[i];
+        if (ms->seek_count <= MPEG_SEEK_PREROLL_FRAMES || ms->seek_entries[MPEG_SEEK_PREROLL_FRAMES].sample > target)
+            return 0;
+    }
+
+    for (i = 0; i < data->streams_size; i++) {
+        mpeg_custom_stream *ms = data->streams[i];
+        const mpeg_custom_seek_entry *entry;
+        off_t input_offset;
+        int lo = 0, hi = ms->seek_count - 1, index = 0;
+
+        /* last frame starting before target */
+        while (lo <= hi) {
+            int mid = (lo + hi) / 2;
+            if (ms->seek_entries[mid].sample <= target) {
+                index = mid;
+                lo = mid + 1;
+            }
+            else {
+                hi = mid - 1;
+            }
+        }
+
+        index -= MPEG_SEEK_PREROLL_FRAMES;
+        entry = &ms->seek_entries[index];
+
+        mpg123_feedseek(ms->m,0,SEEK_SET,&input_offset);
+        ms->samples_filled = 0;
+        ms->samples_used = 0;
+        ms->buffer_full = 0;
+        ms->buffer_used = 0;
+        ms->decode_to_discard = target - entry->sample;
+        ms->samples_decoded = entry->sample;
+
+        vgmstream->loop_ch[i].offset = entry->offset;
+    }
+
+    data->samples_to_discard = 0;
+    return 1;
+}
+
 void seek_mpeg(VGMSTREAM *vgmstream, int32_t num_sample) {
     off_t input_offset;
     mpeg_codec_data *data = vgmstream->codec_data;
@@ -539,14 +635,18 @@ void seek_mpeg(VGMSTREAM *vgmstream, int32_t num_sample) {
         if (vgmstream->loop_ch)
             vgmstream->loop_ch[0].offset = vgmstream->loop_ch[0].channel_start_offset + input_offset;
     }
+    else if (seek_mpeg_index(vgmstream, num_sample)) {
+        ; /* streams restarted near num_sample */
+    }
     else {
         int i;
         /* re-start from 0 */
         for (i=0; i < data->streams_size; i++) {
-            mpg123_feedseek(data->streams[i]->m,0,SEEK_SET,&input_offset);
+            mpg123_open_feed(data->streams[i]->m);
             data->streams[i]->samples_filled = 0;
             data->streams[i]->samples_used = 0;
             data->streams[i]->decode_to_discard = 0;
+            data->streams[i]->samples_decoded = 0;
             data->streams[i]->buffer_full = 0;
             data->streams[i]->buffer_used = 0;
 
@@ -584,6 +684,7 @@ void flush_mpeg(mpeg_codec_data * data) {
             data->streams[i]->bytes_in_buffer = 0;
             data->streams[i]->buffer_full = 0;
             data->streams[i]->buffer_used = 0;
+            data->streams[i]->samples_decoded = 0;
         }
 
         data->samples_to_discard = data->skip_samples; /* initial delay */
@@ -12,8 +12,8 @@ void decode_ngc_dsp(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspaci
     int coef_index = (header >> 4) & 0xf;
     int32_t hist1 = stream->adpcm_history1_16;
     int32_t hist2 = stream->adpcm_history2_16;
-    int coef1 = stream->adpcm_coef[coef_index*2];
-    int coef2 = stream->adpcm_coef[coef_index*2+1];
+    int coef1 = coef_index < 8 ? stream->adpcm_coef[coef_index*2] : 0; /* only 8 pairs (bad frames may have more) */
+    int coef2 = coef_index < 8 ? stream->adpcm_coef[coef_index*2+1] : 0;
 
     first_sample = first_sample%14;
 
@@ -46,8 +46,8 @@ static void decode_ngc_dsp_subint_internal(VGMSTREAMCHANNEL * stream, sample * o
     int coef_index = (header >> 4) & 0xf;
     int32_t hist1 = stream->adpcm_history1_16;
     int32_t hist2 = stream->adpcm_history2_16;
-    int coef1 = stream->adpcm_coef[coef_index*2];
-    int coef2 = stream->adpcm_coef[coef_index*2+1];
+    int coef1 = coef_index < 8 ? stream->adpcm_coef[coef_index*2] : 0; /* only 8 pairs (bad frames may have more) */
+    int coef2 = coef_index < 8 ? stream->adpcm_coef[coef_index*2+1] : 0;
 
     first_sample = first_sample%14;
 
@@ -52,7 +52,7 @@ NWAData *
 open_nwa (STREAMFILE * streamFile, const char *filename)
 {
     int i;
-    NWAData * const nwa = malloc(sizeof(NWAData));
+    NWAData * const nwa = vgm_malloc(sizeof(NWAData));
     if (!nwa) goto fail;
 
     nwa->channels = read_16bitLE(0x00,streamFile);
@@ -87,7 +87,7 @@ open_nwa (STREAMFILE * streamFile, const char *filename)
     if (nwa->samplecount !=
             (nwa->blocks-1) * nwa->blocksize + nwa->restsize) goto fail;
 
-    nwa->offsets = malloc(sizeof(off_t)*nwa->blocks);
+    nwa->offsets = vgm_malloc(sizeof(off_t)*nwa->blocks);
     if (!nwa->offsets) goto fail;
 
     for (i = 0; i < nwa->blocks; i++)
@@ -100,9 +100,9 @@ open_nwa (STREAMFILE * streamFile, const char *filename)
     if (nwa->offsets[nwa->blocks-1] >= nwa->compdatasize) goto fail;
 
     if (nwa->restsize > nwa->blocksize) nwa->buffer =
-        malloc(sizeof(sample)*nwa->restsize);
+        vgm_malloc(sizeof(sample)*nwa->restsize);
     else nwa->buffer =
-        malloc(sizeof(sample)*nwa->blocksize);
+        vgm_malloc(sizeof(sample)*nwa->blocksize);
     if (nwa->buffer == NULL) goto fail;
 
     nwa->buffer_readpos = nwa->buffer;
@@ -131,15 +131,15 @@ close_nwa(NWAData * nwa)
     if (!nwa) return;
 
     if (nwa->offsets)
-        free (nwa->offsets);
+        vgm_free (nwa->offsets);
     nwa->offsets = NULL;
     if (nwa->buffer)
-        free (nwa->buffer);
+        vgm_free (nwa->buffer);
     nwa->buffer = NULL;
     if (nwa->file)
         close_streamfile (nwa->file);
     nwa->file = NULL;
-    free(nwa);
+    vgm_free(nwa);
 }
 
 void
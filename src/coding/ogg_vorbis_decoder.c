@@ -4,20 +4,38 @@
 #ifdef VGM_USE_VORBIS
 #include <vorbis/vorbisfile.h>
 
+/* ov_read's PCM16 conversion depends on how libvorbis was built (x87/SSE/generic vorbis_ftoi),
+ * so get floats and convert the same way as ov_read does with SSE (round-to-nearest) */
 void decode_ogg_vorbis(ogg_vorbis_codec_data * data, sample * outbuf, int32_t samples_to_do, int channels) {
     int samples_done = 0;
     OggVorbis_File *ogg_vorbis_file = &data->ogg_vorbis_file;
 
     do {
-        long rc = ov_read(ogg_vorbis_file, (char *)(outbuf + samples_done*channels),
-                (samples_to_do - samples_done)*sizeof(sample)*channels, 0,
-                sizeof(sample), 1, &data->bitstream);
+        float **pcm;
+        long rc = ov_read_float(ogg_vorbis_file, &pcm, samples_to_do - samples_done, &data->bitstream);
 
-        if (rc > 0) samples_done += rc/sizeof(sample)/channels;
+        if (rc > 0) {
+            pcm_convert_float_planar(outbuf + samples_done*channels, pcm, channels, rc, PCM_CONVERT_RINT);
+            samples_done += rc;
+        }
         else return;
     } while (samples_done < samples_to_do);
+}
+
+void decode_ogg_vorbis_f32(ogg_vorbis_codec_data * data, float * outbuf, int32_t samples_to_do, int channels) {
+    int samples_done = 0;
+    OggVorbis_File *ogg_vorbis_file = &data->ogg_vorbis_file;
 
-    swap_samples_le(outbuf, samples_to_do*channels);
+    do {
+        float **pcm;
+        long rc = ov_read_float(ogg_vorbis_file, &pcm, samples_to_do - samples_done, &data->bitstream);
+
+        if (rc > 0) {
+            pcm_interleave_float_planar(outbuf + samples_done*channels, pcm, channels, rc);
+            samples_done += rc;
+        }
+        else return;
+    } while (samples_done < samples_to_do);
 }
 
 
@@ -48,7 +66,7 @@ void free_ogg_vorbis(ogg_vorbis_codec_data *data) {
         ov_clear(ogg_vorbis_file);
 
         close_streamfile(data->ov_streamfile.streamfile);
-        free(data);
+        vgm_free(data);
     }
 }
 
@@ -0,0 +1,227 @@
+#include "coding.h"
+#include <math.h>
+
+/* SIMD paths are selected at compile time (SSE2 is always there in x86-64 and NEON in ARM64),
+ * and give the same results as the scalar code. */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PCM_CONVERT_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PCM_CONVERT_NEON 1
+#endif
+
+
+/**
+ * Float to PCM16 conversion shared by decoders that output float or 32-bit samples.
+ *
+ * Decoders used slightly different conversions over time, so all are kept to avoid changing output:
+ * - PCM_CONVERT_TRUNCATE: (int)(f * 32768), saturated (ex. FFmpeg's float output)
+ * - PCM_CONVERT_ROUND: floor(f * 32767 + 0.5), clamped (ex. libvorbis's decoder_example.c)
+ * - PCM_CONVERT_RINT: lrint(f * 32768), clamped (ex. vorbisfile's ov_read, round-to-nearest-even)
+ */
+
+static inline sample convert_sample(float f, int mode) {
+    int val;
+
+    switch(mode) {
+        case PCM_CONVERT_ROUND:
+            val = (int)floor(f * 32767.f + .5f);
+            if (val > 32767) val = 32767;
+            if (val < -32768) val = -32768;
+            break;
+
+        case PCM_CONVERT_RINT:
+            f = f * 32768.f;
+            if (f > 32767.f) f = 32767.f; /* clamp before as out of range lrintf is undefined */
+            if (f < -32768.f) f = -32768.f;
+            val = (int)lrintf(f);
+            break;
+
+        default:
+            val = (int)(f * 32768.0f);
+            if ((unsigned)(val + 0x8000) & 0xFFFF0000)
+                val = (val >> 31) ^ 0x7FFF;
+            break;
+    }
+
+    return val;
+}
+
+
+#if defined(PCM_CONVERT_SSE2)
+/* 4 floats to 4 int32 in -32768..32767 range (or beyond, for the saturating pack) */
+static inline __m128i convert_simd(__m128 v, int mode) {
+    switch(mode) {
+        case PCM_CONVERT_ROUND: {
+            /* floor() via truncation, fixed for negatives; pre-clamp so nothing overflows */
+            __m128 y = _mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(32767.f)), _mm_set1_ps(.5f));
+            __m128i t;
+            y = _mm_min_ps(_mm_max_ps(y, _mm_set1_ps(-32769.f)), _mm_set1_ps(32768.f)); /* NaN becomes min */
+            t = _mm_cvttps_epi32(y);
+            t = _mm_add_epi32(t, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(t), y))); /* -1 where t > y */
+            return t;
+        }
+        case PCM_CONVERT_RINT: {
+            /* uses the current rounding mode (nearest-even by default), same as lrintf */
+            __m128 y = _mm_mul_ps(v, _mm_set1_ps(32768.f));
+            y = _mm_min_ps(_mm_max_ps(y, _mm_set1_ps(-32768.f)), _mm_set1_ps(32767.f));
+            return _mm_cvtps_epi32(y);
+        }
+        default:
+            return _mm_cvttps_epi32(_mm_mul_ps(v, _mm_set1_ps(32768.0f))); /* overflow/NaN gives INT_MIN, like x86's scalar cast */
+    }
+}
+#elif defined(PCM_CONVERT_NEON)
+static inline int32x4_t convert_simd(float32x4_t v, int mode) {
+    switch(mode) {
+        case PCM_CONVERT_ROUND: {
+            float32x4_t y = vaddq_f32(vmulq_f32(v, vdupq_n_f32(32767.f)), vdupq_n_f32(.5f));
+            int32x4_t t;
+            y = vminq_f32(vmaxq_f32(y, vdupq_n_f32(-32769.f)), vdupq_n_f32(32768.f));
+            t = vcvtq_s32_f32(y);
+            t = vaddq_s32(t, vreinterpretq_s32_u32(vcgtq_f32(vcvtq_f32_s32(t), y))); /* -1 where t > y */
+            return t;
+        }
+        case PCM_CONVERT_RINT: {
+            /* ARMv7 has no round-to-nearest convert, so add/subtract 1.5*2^23 to round (nearest-even) */
+            float32x4_t y = vmulq_f32(v, vdupq_n_f32(32768.f));
+            y = vminq_f32(vmaxq_f32(y, vdupq_n_f32(-32768.f)), vdupq_n_f32(32767.f));
+            y = vsubq_f32(vaddq_f32(y, vdupq_n_f32(12582912.f)), vdupq_n_f32(12582912.f));
+            return vcvtq_s32_f32(y);
+        }
+        default:
+            return vcvtq_s32_f32(vmulq_f32(v, vdupq_n_f32(32768.0f))); /* saturates, like ARM's scalar cast */
+    }
+}
+#endif
+
+
+/* Converts interleaved float samples (count = samples * channels). */
+void pcm_convert_float(sample * outbuf, const float * inbuf, int count, int mode) {
+    int i = 0;
+
+#if defined(PCM_CONVERT_SSE2)
+    for (; i + 8 <= count; i += 8) {
+        __m128i s1 = convert_simd(_mm_loadu_ps(inbuf + i + 0), mode);
+        __m128i s2 = convert_simd(_mm_loadu_ps(inbuf + i + 4), mode);
+        _mm_storeu_si128((__m128i*)(outbuf + i), _mm_packs_epi32(s1, s2));
+    }
+#elif defined(PCM_CONVERT_NEON)
+    for (; i + 8 <= count; i += 8) {
+        int16x4_t s1 = vqmovn_s32(convert_simd(vld1q_f32(inbuf + i + 0), mode));
+        int16x4_t s2 = vqmovn_s32(convert_simd(vld1q_f32(inbuf + i + 4), mode));
+        vst1q_s16(outbuf + i, vcombine_s16(s1, s2));
+    }
+#endif
+
+    for (; i < count; i++) {
+        outbuf[i] = convert_sample(inbuf[i], mode);
+    }
+}
+
+/* Converts planar float samples (inbuf[channel][sample]) to interleaved. */
+void pcm_convert_float_planar(sample * outbuf, float ** inbuf, int channels, int samples, int mode) {
+    int ch, s = 0;
+
+#if defined(PCM_CONVERT_SSE2)
+    if (channels == 2) {
+        for (; s + 4 <= samples; s += 4) {
+            __m128i l = convert_simd(_mm_loadu_ps(inbuf[0] + s), mode);
+            __m128i r = convert_simd(_mm_loadu_ps(inbuf[1] + s), mode);
+            _mm_storeu_si128((__m128i*)(outbuf + s*2), _mm_unpacklo_epi16(_mm_packs_epi32(l, l), _mm_packs_epi32(r, r)));
+        }
+    }
+    else {
+        for (; s + 8 <= samples; s += 8) {
+            for (ch = 0; ch < channels; ch++) {
+                int16_t tmp[8];
+                int i;
+                __m128i s1 = convert_simd(_mm_loadu_ps(inbuf[ch] + s + 0), mode);
+                __m128i s2 = convert_simd(_mm_loadu_ps(inbuf[ch] + s + 4), mode);
+                _mm_storeu_si128((__m128i*)tmp, _mm_packs_epi32(s1, s2));
+                for (i = 0; i < 8; i++) {
+                    outbuf[(s + i)*channels + ch] = tmp[i];
+                }
+            }
+        }
+    }
+#elif defined(PCM_CONVERT_NEON)
+    if (channels == 2) {
+        for (; s + 4 <= samples; s += 4) {
+            int16x4x2_t lr;
+            lr.val[0] = vqmovn_s32(convert_simd(vld1q_f32(inbuf[0] + s), mode));
+            lr.val[1] = vqmovn_s32(convert_simd(vld1q_f32(inbuf[1] + s), mode));
+            vst2_s16(outbuf + s*2, lr);
+        }
+    }
+    else {
+        for (; s + 4 <= samples; s += 4) {
+            for (ch = 0; ch < channels; ch++) {
+                int16_t tmp[4];
+                int i;
+                vst1_s16(tmp, vqmovn_s32(convert_simd(vld1q_f32(inbuf[ch] + s), mode)));
+                for (i = 0; i < 4; i++) {
+                    outbuf[(s + i)*channels + ch] = tmp[i];
+                }
+            }
+        }
+    }
+#endif
+
+    for (; s < samples; s++) {
+        for (ch = 0; ch < channels; ch++) {
+            outbuf[s*channels + ch] = convert_sample(inbuf[ch][s], mode);
+        }
+    }
+}
+
+/* Converts interleaved signed 32-bit samples (count = samples * channels), keeping the upper 16 bits. */
+void pcm_convert_s32(sample * outbuf, const int32_t * inbuf, int count) {
+    int i = 0;
+
+#if defined(PCM_CONVERT_SSE2)
+    for (; i + 8 <= count; i += 8) {
+        __m128i s1 = _mm_srai_epi32(_mm_loadu_si128((const __m128i*)(inbuf + i + 0)), 16);
+        __m128i s2 = _mm_srai_epi32(_mm_loadu_si128((const __m128i*)(inbuf + i + 4)), 16);
+        _mm_storeu_si128((__m128i*)(outbuf + i), _mm_packs_epi32(s1, s2));
+    }
+#elif defined(PCM_CONVERT_NEON)
+    for (; i + 4 <= count; i += 4) {
+        vst1_s16(outbuf + i, vshrn_n_s32(vld1q_s32(inbuf + i), 16));
+    }
+#endif
+
+    for (; i < count; i++) {
+        outbuf[i] = inbuf[i] >> 16;
+    }
+}
+
+/* Converts interleaved double samples (count = samples * channels), like PCM_CONVERT_TRUNCATE
+ * but multiplying in double (ex. FFmpeg's double output). */
+void pcm_convert_double(sample * outbuf, const double * inbuf, int count) {
+    int i;
+
+    for (i = 0; i < count; i++) {
+        int val = (int)(inbuf[i] * 32768.0f);
+        if ((unsigned)(val + 0x8000) & 0xFFFF0000)
+            val = (val >> 31) ^ 0x7FFF;
+        outbuf[i] = val;
+    }
+}
+
+/* Interleaves planar float samples (inbuf[channel][sample]), for float output. */
+void pcm_interleave_float_planar(float * outbuf, float ** inbuf, int channels, int samples) {
+    int ch, s;
+
+    if (channels == 1) {
+        memcpy(outbuf, inbuf[0], samples * sizeof(float));
+        return;
+    }
+
+    for (s = 0; s < samples; s++) {
+        for (ch = 0; ch < channels; ch++) {
+            outbuf[s*channels + ch] = inbuf[ch][s];
+        }
+    }
+}
@@ -1,81 +1,244 @@
 #include "coding.h"
 #include "../util.h"
 #include <math.h>
+#include <string.h>
 
-void decode_pcm16le(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
-    int i;
-    int32_t sample_count;
+#define PCM_READ_BUFFER_SIZE 0x1000 /* bytes read at once, must be a multiple of 4 */
 
-    for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        outbuf[sample_count]=read_16bitLE(stream->offset+i*2,stream->streamfile);
-    }
+/* SIMD paths for the common contiguous cases, selected at compile time like in pcm_convert.c */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PCM_DECODER_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PCM_DECODER_NEON 1
+#endif
+
+/* Reading one sample at a time through the streamfile is slow, so data for a run of samples is read at once.
+ * Samples past EOF are set to 0xFF, which converts like the per-sample read_Nbit functions' -1 on failure. */
+static void read_pcm_bulk(uint8_t * buf, off_t offset, size_t bytes, STREAMFILE * streamFile, int sample_size) {
+    size_t bytes_read = read_streamfile(buf, offset, bytes, streamFile);
+    bytes_read -= bytes_read % sample_size; /* partial samples count as failed reads too */
+    if (bytes_read < bytes)
+        memset(buf + bytes_read, 0xFF, bytes - bytes_read);
 }
 
-void decode_pcm16be(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
-    int i;
-    int32_t sample_count;
+static inline int is_host_big_endian(void) {
+    static const uint16_t value = 0x0100;
+    return *(const uint8_t*)&value;
+}
 
-    for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        outbuf[sample_count]=read_16bitBE(stream->offset+i*2,stream->streamfile);
+/* Byteswaps contiguous 16-bit samples (data with the opposite endianness of the host), returns samples done
+ * (the rest is left to the scalar code). */
+static int swap_pcm16_simd(sample * outbuf, const uint8_t * buf, int samples) {
+    int i = 0;
+#if defined(PCM_DECODER_SSE2)
+    for (; i + 8 <= samples; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(buf + i*2));
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        _mm_storeu_si128((__m128i*)(outbuf + i), v);
     }
+#elif defined(PCM_DECODER_NEON)
+    for (; i + 8 <= samples; i += 8) {
+        uint8x16_t v = vrev16q_u8(vld1q_u8(buf + i*2));
+        vst1q_s16(outbuf + i, vreinterpretq_s16_u8(v));
+    }
+#endif
+    return i;
 }
 
-void decode_pcm16_int(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int big_endian) {
-    int i, sample_count;
-    int16_t (*read_16bit)(off_t,STREAMFILE*) = big_endian ? read_16bitBE : read_16bitLE;
-
-    for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        outbuf[sample_count]=read_16bit(stream->offset+i*2*channelspacing,stream->streamfile);
+/* Expands contiguous signed (or unsigned, by flipping the sign bit first) 8-bit samples to 16-bit,
+ * returns samples done. */
+static int expand_pcm8_simd(sample * outbuf, const uint8_t * buf, int samples, int is_unsigned) {
+    int i = 0;
+#if defined(PCM_DECODER_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i flip = _mm_set1_epi8(is_unsigned ? (char)0x80 : 0);
+    for (; i + 16 <= samples; i += 16) {
+        __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(buf + i)), flip);
+        _mm_storeu_si128((__m128i*)(outbuf + i + 0), _mm_unpacklo_epi8(zero, v)); /* byte to high byte = x*0x100 */
+        _mm_storeu_si128((__m128i*)(outbuf + i + 8), _mm_unpackhi_epi8(zero, v));
     }
+#elif defined(PCM_DECODER_NEON)
+    const uint8x16_t flip = vdupq_n_u8(is_unsigned ? 0x80 : 0);
+    for (; i + 16 <= samples; i += 16) {
+        uint8x16_t v = veorq_u8(vld1q_u8(buf + i), flip);
+        vst1q_s16(outbuf + i + 0, vreinterpretq_s16_u16(vshll_n_u8(vget_low_u8(v), 8)));
+        vst1q_s16(outbuf + i + 8, vreinterpretq_s16_u16(vshll_n_u8(vget_high_u8(v), 8)));
+    }
+#endif
+    return i;
 }
 
-void decode_pcm8(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
-    int i;
-    int32_t sample_count;
+/* Reads 16-bit samples separated by in_spacing bytes (2 for mono/interleaved blocks, 2*channels
+ * for sample interleave) and writes them every out_spacing samples. Contiguous data with the same
+ * endianness as the host is read directly into the output buffer. */
+static void decode_pcm16_bulk(STREAMFILE * streamFile, off_t offset, int in_spacing, sample * outbuf, int out_spacing, int32_t samples_to_do, int big_endian) {
+    uint8_t buf[PCM_READ_BUFFER_SIZE];
+    int samples_per_read = sizeof(buf) / in_spacing;
+    int i, sample_count = 0;
+
+    if (in_spacing == 2 && out_spacing == 1 && big_endian == is_host_big_endian()) {
+        read_pcm_bulk((uint8_t*)outbuf, offset, samples_to_do*2, streamFile, 2);
+        return;
+    }
 
-    for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        outbuf[sample_count]=read_8bit(stream->offset+i,stream->streamfile)*0x100;
+    while (samples_to_do > 0) {
+        int samples = samples_to_do > samples_per_read ? samples_per_read : samples_to_do;
+
+        read_pcm_bulk(buf, offset, samples*in_spacing, streamFile, 2);
+
+        i = 0;
+        if (in_spacing == 2 && out_spacing == 1) {
+            i = swap_pcm16_simd(outbuf + sample_count, buf, samples);
+            sample_count += i;
+        }
+
+        /* separate loops so compilers can vectorize the byteswap/deinterleave */
+        if (big_endian) {
+            for (; i < samples; i++, sample_count += out_spacing) {
+                outbuf[sample_count] = get_16bitBE(buf + i*in_spacing);
+            }
+        }
+        else {
+            for (; i < samples; i++, sample_count += out_spacing) {
+                outbuf[sample_count] = get_16bitLE(buf + i*in_spacing);
+            }
+        }
+
+        offset += samples*in_spacing;
+        samples_to_do -= samples;
     }
 }
 
-void decode_pcm8_int(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
-    int i;
-    int32_t sample_count;
-
-    for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        outbuf[sample_count]=read_8bit(stream->offset+i*channelspacing,stream->streamfile)*0x100;
+typedef enum { PCM8_SIGNED, PCM8_UNSIGNED, PCM8_SIGNBIT, PCM8_ULAW, PCM8_ALAW } pcm8_type_t;
+static int expand_ulaw(uint8_t ulawbyte);
+static int expand_alaw(uint8_t alawbyte);
+
+/* same as the above for 8-bit samples, with the conversion depending on type */
+static void decode_pcm8_bulk(STREAMFILE * streamFile, off_t offset, int in_spacing, sample * outbuf, int out_spacing, int32_t samples_to_do, pcm8_type_t type) {
+    uint8_t buf[PCM_READ_BUFFER_SIZE];
+    int samples_per_read = sizeof(buf) / in_spacing;
+    int i, sample_count = 0;
+
+    while (samples_to_do > 0) {
+        int samples = samples_to_do > samples_per_read ? samples_per_read : samples_to_do;
+
+        read_pcm_bulk(buf, offset, samples*in_spacing, streamFile, 1);
+
+        i = 0;
+        if (in_spacing == 1 && out_spacing == 1 && (type == PCM8_SIGNED || type == PCM8_UNSIGNED)) {
+            i = expand_pcm8_simd(outbuf + sample_count, buf, samples, type == PCM8_UNSIGNED);
+            sample_count += i;
+        }
+
+        switch(type) {
+            case PCM8_SIGNED:
+                for (; i < samples; i++, sample_count += out_spacing) {
+                    outbuf[sample_count] = (int8_t)buf[i*in_spacing]*0x100;
+                }
+                break;
+            case PCM8_UNSIGNED:
+                for (; i < samples; i++, sample_count += out_spacing) {
+                    outbuf[sample_count] = buf[i*in_spacing]*0x100 - 0x8000;
+                }
+                break;
+            case PCM8_SIGNBIT:
+                for (i = 0; i < samples; i++, sample_count += out_spacing) {
+                    int16_t v = buf[i*in_spacing];
+                    if (v&0x80) v = 0-(v&0x7f);
+                    outbuf[sample_count] = v*0x100;
+                }
+                break;
+            case PCM8_ULAW:
+                for (i = 0; i < samples; i++, sample_count += out_spacing) {
+                    outbuf[sample_count] = expand_ulaw(buf[i*in_spacing]);
+                }
+                break;
+            case PCM8_ALAW:
+                for (i = 0; i < samples; i++, sample_count += out_spacing) {
+                    outbuf[sample_count] = expand_alaw(buf[i*in_spacing]);
+                }
+                break;
+        }
+
+        offset += samples*in_spacing;
+        samples_to_do -= samples;
     }
 }
 
-void decode_pcm8_unsigned(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
-    int i;
-    int32_t sample_count;
+/* same as the above for 32-bit float samples */
+static void decode_pcmfloat_bulk(STREAMFILE * streamFile, off_t offset, int in_spacing, sample * outbuf, int out_spacing, int32_t samples_to_do, int big_endian) {
+    uint8_t buf[PCM_READ_BUFFER_SIZE];
+    int samples_per_read = sizeof(buf) / in_spacing;
+    int i, sample_count = 0;
+
+    while (samples_to_do > 0) {
+        int samples = samples_to_do > samples_per_read ? samples_per_read : samples_to_do;
+
+        read_pcm_bulk(buf, offset, samples*in_spacing, streamFile, 4);
 
-    for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        int16_t v = (uint8_t)read_8bit(stream->offset+i,stream->streamfile);
-        outbuf[sample_count] = v*0x100 - 0x8000;
+        for (i = 0; i < samples; i++, sample_count += out_spacing) {
+            uint32_t sample_int = big_endian ? get_32bitBE(buf + i*in_spacing) : get_32bitLE(buf + i*in_spacing);
+            float* sample_float;
+            int sample_pcm;
+
+            sample_float = (float*)&sample_int;
+            sample_pcm = (int)floor((*sample_float) * 32767.f + .5f);
+
+            outbuf[sample_count] = clamp16(sample_pcm);
+        }
+
+        offset += samples*in_spacing;
+        samples_to_do -= samples;
     }
 }
 
-void decode_pcm8_unsigned_int(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
-    int i;
-    int32_t sample_count;
 
-    for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        int16_t v = (uint8_t)read_8bit(stream->offset+i*channelspacing,stream->streamfile);
-        outbuf[sample_count] = v*0x100 - 0x8000;
-    }
+void decode_pcm16le(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
+    decode_pcm16_bulk(stream->streamfile, stream->offset + first_sample*2, 2, outbuf, channelspacing, samples_to_do, 0);
+}
+
+void decode_pcm16be(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
+    decode_pcm16_bulk(stream->streamfile, stream->offset + first_sample*2, 2, outbuf, channelspacing, samples_to_do, 1);
+}
+
+void decode_pcm16_int(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int big_endian) {
+    decode_pcm16_bulk(stream->streamfile, stream->offset + first_sample*2*channelspacing, 2*channelspacing, outbuf, channelspacing, samples_to_do, big_endian);
+}
+
+void decode_pcm8(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
+    decode_pcm8_bulk(stream->streamfile, stream->offset + first_sample, 1, outbuf, channelspacing, samples_to_do, PCM8_SIGNED);
+}
+
+void decode_pcm8_int(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
+    decode_pcm8_bulk(stream->streamfile, stream->offset + first_sample*channelspacing, channelspacing, outbuf, channelspacing, samples_to_do, PCM8_SIGNED);
+}
+
+void decode_pcm8_unsigned(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
+    decode_pcm8_bulk(stream->streamfile, stream->offset + first_sample, 1, outbuf, channelspacing, samples_to_do, PCM8_UNSIGNED);
+}
+
+void decode_pcm8_unsigned_int(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
+    decode_pcm8_bulk(stream->streamfile, stream->offset + first_sample*channelspacing, channelspacing, outbuf, channelspacing, samples_to_do, PCM8_UNSIGNED);
 }
 
 void decode_pcm8_sb(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
-    int i;
-    int32_t sample_count;
+    decode_pcm8_bulk(stream->streamfile, stream->offset + first_sample, 1, outbuf, channelspacing, samples_to_do, PCM8_SIGNBIT);
+}
 
-    for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        int16_t v = (uint8_t)read_8bit(stream->offset+i,stream->streamfile);
-        if (v&0x80) v = 0-(v&0x7f);
-        outbuf[sample_count] = v*0x100;
-    }
+/* Decodes PCM stored in frames of one sample per channel (standard .wav-like interleave) for all
+ * channels at once, from the first channel's offset. Output is contiguous, so it may be a plain read. */
+void decode_pcm16_frames(VGMSTREAMCHANNEL * stream, sample * outbuf, int channels, int32_t first_sample, int32_t samples_to_do, int big_endian) {
+    decode_pcm16_bulk(stream->streamfile, stream->offset + first_sample*2*channels, 2, outbuf, 1, samples_to_do*channels, big_endian);
+}
+
+void decode_pcm8_frames(VGMSTREAMCHANNEL * stream, sample * outbuf, int channels, int32_t first_sample, int32_t samples_to_do, int is_unsigned) {
+    decode_pcm8_bulk(stream->streamfile, stream->offset + first_sample*channels, 1, outbuf, 1, samples_to_do*channels, is_unsigned ? PCM8_UNSIGNED : PCM8_SIGNED);
+}
+
+void decode_pcmfloat_frames(VGMSTREAMCHANNEL * stream, sample * outbuf, int channels, int32_t first_sample, int32_t samples_to_do, int big_endian) {
+    decode_pcmfloat_bulk(stream->streamfile, stream->offset + first_sample*4*channels, 4, outbuf, 1, samples_to_do*channels, big_endian);
 }
 
 static int expand_ulaw(uint8_t ulawbyte) {
@@ -104,22 +267,11 @@ static int expand_ulaw(uint8_t ulawbyte) {
 
 /* decodes u-law (ITU G.711 non-linear PCM), from g711.c */
 void decode_ulaw(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
-    int i, sample_count;
-
-    for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        uint8_t ulawbyte = read_8bit(stream->offset+i,stream->streamfile);
-        outbuf[sample_count] = expand_ulaw(ulawbyte);
-    }
+    decode_pcm8_bulk(stream->streamfile, stream->offset + first_sample, 1, outbuf, channelspacing, samples_to_do, PCM8_ULAW);
 }
 
-
 void decode_ulaw_int(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
-    int i, sample_count;
-
-    for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        uint8_t ulawbyte = read_8bit(stream->offset+i*channelspacing,stream->streamfile);
-        outbuf[sample_count] = expand_ulaw(ulawbyte);
-    }
+    decode_pcm8_bulk(stream->streamfile, stream->offset + first_sample*channelspacing, channelspacing, outbuf, channelspacing, samples_to_do, PCM8_ULAW);
 }
 
 static int expand_alaw(uint8_t alawbyte) {
@@ -150,28 +302,11 @@ static int expand_alaw(uint8_t alawbyte) {
 
 /* decodes a-law (ITU G.711 non-linear PCM), from g711.c */
 void decode_alaw(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
-    int i, sample_count;
-
-    for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        uint8_t alawbyte = read_8bit(stream->offset+i,stream->streamfile);
-        outbuf[sample_count] = expand_alaw(alawbyte);;
-    }
+    decode_pcm8_bulk(stream->streamfile, stream->offset + first_sample, 1, outbuf, channelspacing, samples_to_do, PCM8_ALAW);
 }
 
 void decode_pcmfloat(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int big_endian) {
-    int i, sample_count;
-    int32_t (*read_32bit)(off_t,STREAMFILE*) = big_endian ? read_32bitBE : read_32bitLE;
-
-    for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        uint32_t sample_int = read_32bit(stream->offset+i*4,stream->streamfile);
-        float* sample_float;
-        int sample_pcm;
-
-        sample_float = (float*)&sample_int;
-        sample_pcm = (int)floor((*sample_float) * 32767.f + .5f);
-
-        outbuf[sample_count] = clamp16(sample_pcm);
-    }
+    decode_pcmfloat_bulk(stream->streamfile, stream->offset + first_sample*4, 4, outbuf, channelspacing, samples_to_do, big_endian);
 }
 
 size_t pcm_bytes_to_samples(size_t bytes, int channels, int bits_per_sample) {
@@ -1,226 +1,381 @@
-#include <math.h>
-#include "coding.h"
-#include "vorbis_custom_decoder.h"
-
-#ifdef VGM_USE_VORBIS
-#include <vorbis/codec.h>
-
-#define VORBIS_DEFAULT_BUFFER_SIZE 0x8000 /* should be at least the size of the setup header, ~0x2000 */
-
-static void pcm_convert_float_to_16(vorbis_custom_codec_data * data, sample * outbuf, int samples_to_do, float ** pcm);
-
-/**
- * Inits a vorbis stream of some custom variety.
- *
- * Normally Vorbis packets are stored in .ogg, which is divided into OggS pages/packets, and the first packets contain necessary
- * Vorbis setup. For custom vorbis the OggS layer is replaced/optimized, the setup can be modified or stored elsewhere
- * (i.e.- in the .exe) and raw Vorbis packets may be modified as well, presumably to shave off some kb and/or obfuscate.
- * We'll manually read/modify the data and decode it with libvorbis calls.
- *
- * Reference: https://www.xiph.org/vorbis/doc/libvorbis/overview.html
- */
-vorbis_custom_codec_data * init_vorbis_custom(STREAMFILE *streamFile, off_t start_offset, vorbis_custom_t type, vorbis_custom_config * config) {
-    vorbis_custom_codec_data * data = NULL;
-    int ok;
-
-    /* init stuff */
-    data = calloc(1,sizeof(vorbis_custom_codec_data));
-    if (!data) goto fail;
-
-    data->buffer_size = VORBIS_DEFAULT_BUFFER_SIZE;
-    data->buffer = calloc(sizeof(uint8_t), data->buffer_size);
-    if (!data->buffer) goto fail;
-
-    /* keep around to decode too */
-    data->type = type;
-    memcpy(&data->config, config, sizeof(vorbis_custom_config));
-
-
-    /* init vorbis stream state, using 3 fake Ogg setup packets (info, comments, setup/codebooks)
-     * libvorbis expects parsed Ogg pages, but we'll fake them with our raw data instead */
-    vorbis_info_init(&data->vi);
-    vorbis_comment_init(&data->vc);
-
-    data->op.packet = data->buffer;
-    data->op.b_o_s = 1; /* fake headers start */
-
-    /* init header */
-    switch(data->type) {
-        case VORBIS_FSB:    ok = vorbis_custom_setup_init_fsb(streamFile, start_offset, data); break;
-        case VORBIS_WWISE:  ok = vorbis_custom_setup_init_wwise(streamFile, start_offset, data); break;
-        case VORBIS_OGL:    ok = vorbis_custom_setup_init_ogl(streamFile, start_offset, data); break;
-        case VORBIS_SK:     ok = vorbis_custom_setup_init_sk(streamFile, start_offset, data); break;
-        case VORBIS_VID1:   ok = vorbis_custom_setup_init_vid1(streamFile, start_offset, data); break;
-        default: goto fail;
-    }
-    if(!ok) goto fail;
-
-    data->op.b_o_s = 0; /* end of fake headers */
-
-    /* init vorbis global and block state */
-    if (vorbis_synthesis_init(&data->vd,&data->vi) != 0) goto fail;
-    if (vorbis_block_init(&data->vd,&data->vb) != 0) goto fail;
-
-
-    /* write output */
-    config->data_start_offset = data->config.data_start_offset;
-
-
-    return data;
-
-fail:
-    VGM_LOG("VORBIS: init fail at around 0x%"PRIx64"\n", (off64_t)start_offset);
-    free_vorbis_custom(data);
-    return NULL;
-}
-
-/* Decodes Vorbis packets into a libvorbis sample buffer, and copies them to outbuf */
-void decode_vorbis_custom(VGMSTREAM * vgmstream, sample * outbuf, int32_t samples_to_do, int channels) {
-    VGMSTREAMCHANNEL *stream = &vgmstream->ch[0];
-    vorbis_custom_codec_data * data = vgmstream->codec_data;
-    size_t stream_size =  get_streamfile_size(stream->streamfile);
-    //data->op.packet = data->buffer;/* implicit from init */
-    int samples_done = 0;
-
-    while (samples_done < samples_to_do) {
-
-        /* extra EOF check for edge cases */
-        if (stream->offset >= stream_size) {
-            memset(outbuf + samples_done * channels, 0, (samples_to_do - samples_done) * sizeof(sample) * channels);
-            break;
-        }
-
-
-        if (data->samples_full) {  /* read more samples */
-            int samples_to_get;
-            float **pcm;
-
-            /* get PCM samples from libvorbis buffers */
-            samples_to_get = vorbis_synthesis_pcmout(&data->vd, &pcm);
-            if (!samples_to_get) {
-                data->samples_full = 0; /* request more if empty*/
-                continue;
-            }
-
-            if (data->samples_to_discard) {
-                /* discard samples for looping */
-                if (samples_to_get > data->samples_to_discard)
-                    samples_to_get = data->samples_to_discard;
-                data->samples_to_discard -= samples_to_get;
-            }
-            else {
-                /* get max samples and convert from Vorbis float pcm to 16bit pcm */
-                if (samples_to_get > samples_to_do - samples_done)
-                    samples_to_get = samples_to_do - samples_done;
-                pcm_convert_float_to_16(data, outbuf + samples_done * channels, samples_to_get, pcm);
-                samples_done += samples_to_get;
-            }
-
-            /* mark consumed samples from the buffer
-             * (non-consumed samples are returned in next vorbis_synthesis_pcmout calls) */
-            vorbis_synthesis_read(&data->vd, samples_to_get);
-        }
-        else { /* read more data */
-            int ok, rc;
-
-            /* not actually needed, but feels nicer */
-            data->op.granulepos += samples_to_do; /* can be changed next if desired */
-            data->op.packetno++;
-
-            /* read/transform data into the ogg_packet buffer and advance offsets */
-            switch(data->type) {
-                case VORBIS_FSB:    ok = vorbis_custom_parse_packet_fsb(stream, data); break;
-                case VORBIS_WWISE:  ok = vorbis_custom_parse_packet_wwise(stream, data); break;
-                case VORBIS_OGL:    ok = vorbis_custom_parse_packet_ogl(stream, data); break;
-                case VORBIS_SK:     ok = vorbis_custom_parse_packet_sk(stream, data); break;
-                case VORBIS_VID1:   ok = vorbis_custom_parse_packet_vid1(stream, data); break;
-                default: goto decode_fail;
-            }
-            if(!ok) {
-                goto decode_fail;
-            }
-
-
-            /* parse the fake ogg packet into a logical vorbis block */
-            rc = vorbis_synthesis(&data->vb,&data->op);
-            if (rc == OV_ENOTAUDIO) {
-                VGM_LOG("Vorbis: not an audio packet (size=0x%x) @ %"PRIx64"\n",(size_t)data->op.bytes,(off64_t)stream->offset);
-                //VGM_LOGB(data->op.packet, (size_t)data->op.bytes,0);
-                continue; /* rarely happens, seems ok? */
-            } else if (rc != 0) goto decode_fail;
-
-            /* finally decode the logical block into samples */
-            rc = vorbis_synthesis_blockin(&data->vd,&data->vb);
-            if (rc != 0) goto decode_fail; /* ? */
-
-
-            data->samples_full = 1;
-        }
-    }
-
-    return;
-
-decode_fail:
-    /* on error just put some 0 samples */
-    VGM_LOG("VORBIS: decode fail at %"PRIx64", missing %i samples\n", (off64_t)stream->offset, (samples_to_do - samples_done));
-    memset(outbuf + samples_done * channels, 0, (samples_to_do - samples_done) * channels * sizeof(sample));
-}
-
-/* converts from internal Vorbis format to standard PCM (mostly from Xiph's decoder_example.c) */
-static void pcm_convert_float_to_16(vorbis_custom_codec_data * data, sample * outbuf, int samples_to_do, float ** pcm) {
-    int i,j;
-
-    /* convert float PCM (multichannel float array, with pcm[0]=ch0, pcm[1]=ch1, pcm[2]=ch0, etc)
-     * to 16 bit signed PCM ints (host order) and interleave + fix clipping */
-    for (i = 0; i < data->vi.channels; i++) {
-        sample *ptr = outbuf + i;
-        float *mono = pcm[i];
-        for (j = 0; j < samples_to_do; j++) {
-            int val = (int)floor(mono[j] * 32767.f + .5f);
-            if (val > 32767) val = 32767;
-            if (val < -32768) val = -32768;
-
-            *ptr = val;
-            ptr += data->vi.channels;
-        }
-    }
-}
-
-/* ********************************************** */
-
-void free_vorbis_custom(vorbis_custom_codec_data * data) {
-    if (!data)
-        return;
-
-    /* internal decoder cleanp */
-    vorbis_info_clear(&data->vi);
-    vorbis_comment_clear(&data->vc);
-    vorbis_dsp_clear(&data->vd);
-
-    free(data->buffer);
-    free(data);
-}
-
-void reset_vorbis_custom(VGMSTREAM *vgmstream) {
-    vorbis_custom_codec_data *data = vgmstream->codec_data;
-    if (!data) return;
-
-    /* Seeking is provided by the Ogg layer, so with custom vorbis we'd need seek tables instead.
-     * To avoid having to parse different formats we'll just discard until the expected sample */
-    vorbis_synthesis_restart(&data->vd);
-    data->samples_to_discard = 0;
-}
-
-void seek_vorbis_custom(VGMSTREAM *vgmstream, int32_t num_sample) {
-    vorbis_custom_codec_data *data = vgmstream->codec_data;
-    if (!data) return;
-
-    /* Seeking is provided by the Ogg layer, so with custom vorbis we'd need seek tables instead.
-     * To avoid having to parse different formats we'll just discard until the expected sample */
-    vorbis_synthesis_restart(&data->vd);
-    data->samples_to_discard = num_sample;
-    if (vgmstream->loop_ch)
-        vgmstream->loop_ch[0].offset = vgmstream->loop_ch[0].channel_start_offset;
-}
-
-#endif
+#include <math.h>
+#include "coding.h"
+#include "vorbis_custom_decoder.h"
+
+#ifdef VGM_USE_VORBIS
+#include <vorbis/codec.h>
+
+#define VORBIS_DEFAULT_BUFFER_SIZE 0x8000 /* should be at least the size of the setup header, ~0x2000 */
+#define VORBIS_SEEK_INTERVAL 0x1000 /* min samples between seek table entries */
+
+static int parse_packet(VGMSTREAMCHANNEL *stream, vorbis_custom_codec_data *data);
+static void get_packet_state(VGMSTREAMCHANNEL *stream, vorbis_custom_codec_data *data, vorbis_custom_seek_entry *entry);
+static void set_packet_state(vorbis_custom_codec_data *data, const vorbis_custom_seek_entry *entry);
+static void add_seek_entry(vorbis_custom_codec_data *data, const vorbis_custom_seek_entry *entry, int32_t sample);
+
+/**
+ * Inits a vorbis stream of some custom variety.
+ *
+ * Normally Vorbis packets are stored in .ogg, which is divided into OggS pages/packets, and the first packets contain necessary
+ * Vorbis setup. For custom vorbis the OggS layer is replaced/optimized, the setup can be modified or stored elsewhere
+ * (i.e.- in the .exe) and raw Vorbis packets may be modified as well, presumably to shave off some kb and/or obfuscate.
+ * We'll manually read/modify the data and decode it with libvorbis calls.
+ *
+ * Reference: https://www.xiph.org/vorbis/doc/libvorbis/overview.html
+ */
+vorbis_custom_codec_data * init_vorbis_custom(STREAMFILE *streamFile, off_t start_offset, vorbis_custom_t type, vorbis_custom_config * config) {
+    vorbis_custom_codec_data * data = NULL;
+    int ok;
+
+    /* init stuff */
+    data = vgm_calloc(1,sizeof(vorbis_custom_codec_data));
+    if (!data) goto fail;
+
+    data->buffer_size = VORBIS_DEFAULT_BUFFER_SIZE;
+    data->buffer = vgm_calloc(sizeof(uint8_t), data->buffer_size);
+    if (!data->buffer) goto fail;
+
+    /* keep around to decode too */
+    data->type = type;
+    memcpy(&data->config, config, sizeof(vorbis_custom_config));
+
+
+    /* init vorbis stream state, using 3 fake Ogg setup packets (info, comments, setup/codebooks)
+     * libvorbis expects parsed Ogg pages, but we'll fake them with our raw data instead */
+    vorbis_info_init(&data->vi);
+    vorbis_comment_init(&data->vc);
+
+    data->op.packet = data->buffer;
+    data->op.b_o_s = 1; /* fake headers start */
+
+    /* init header */
+    switch(data->type) {
+        case VORBIS_FSB:    ok = vorbis_custom_setup_init_fsb(streamFile, start_offset, data); break;
+        case VORBIS_WWISE:  ok = vorbis_custom_setup_init_wwise(streamFile, start_offset, data); break;
+        case VORBIS_OGL:    ok = vorbis_custom_setup_init_ogl(streamFile, start_offset, data); break;
+        case VORBIS_SK:     ok = vorbis_custom_setup_init_sk(streamFile, start_offset, data); break;
+        case VORBIS_VID1:   ok = vorbis_custom_setup_init_vid1(streamFile, start_offset, data); break;
+        default: goto fail;
+    }
+    if(!ok) goto fail;
+
+    data->op.b_o_s = 0; /* end of fake headers */
+
+    /* init vorbis global and block state */
+    if (vorbis_synthesis_init(&data->vd,&data->vi) != 0) goto fail;
+    if (vorbis_block_init(&data->vd,&data->vb) != 0) goto fail;
+
+    /* parsers may have set up some initial state, restored when seeking to the beginning */
+    get_packet_state(NULL, data, &data->seek_start);
+
+    /* write output */
+    config->data_start_offset = data->config.data_start_offset;
+
+
+    return data;
+
+fail:
+    VGM_LOG("VORBIS: init fail at around 0x%"PRIx64"\n", (off64_t)start_offset);
+    free_vorbis_custom(data);
+    return NULL;
+}
+
+/* Decodes Vorbis packets into a libvorbis sample buffer, and copies them to outbuf (or outbuf_f as float) */
+static void decode_vorbis_custom_internal(VGMSTREAM * vgmstream, sample * outbuf, float * outbuf_f, int32_t samples_to_do, int channels) {
+    VGMSTREAMCHANNEL *stream = &vgmstream->ch[0];
+    vorbis_custom_codec_data * data = vgmstream->codec_data;
+    size_t stream_size =  get_streamfile_size(stream->streamfile);
+    //data->op.packet = data->buffer;/* implicit from init */
+    int samples_done = 0;
+
+    while (samples_done < samples_to_do) {
+
+        /* extra EOF check for edge cases */
+        if (stream->offset >= stream_size) {
+            if (outbuf_f)
+                memset(outbuf_f + samples_done * channels, 0, (samples_to_do - samples_done) * sizeof(float) * channels);
+            else
+                memset(outbuf + samples_done * channels, 0, (samples_to_do - samples_done) * sizeof(sample) * channels);
+            break;
+        }
+
+
+        if (data->samples_full) {  /* read more samples */
+            int samples_to_get;
+            float **pcm;
+
+            /* get PCM samples from libvorbis buffers */
+            samples_to_get = vorbis_synthesis_pcmout(&data->vd, &pcm);
+            if (!samples_to_get) {
+                data->samples_full = 0; /* request more if empty*/
+                continue;
+            }
+
+            if (data->samples_to_discard) {
+                /* discard samples for looping */
+                if (samples_to_get > data->samples_to_discard)
+                    samples_to_get = data->samples_to_discard;
+                data->samples_to_discard -= samples_to_get;
+                data->current_sample += samples_to_get;
+            }
+            else {
+                /* get max samples and convert from Vorbis float pcm to 16bit pcm (or just interleave) */
+                if (samples_to_get > samples_to_do - samples_done)
+                    samples_to_get = samples_to_do - samples_done;
+                if (outbuf_f)
+                    pcm_interleave_float_planar(outbuf_f + samples_done * channels, pcm, data->vi.channels, samples_to_get);
+                else
+                    pcm_convert_float_planar(outbuf + samples_done * channels, pcm, data->vi.channels, samples_to_get, PCM_CONVERT_ROUND);
+                samples_done += samples_to_get;
+                data->current_sample += samples_to_get;
+            }
+
+            /* mark consumed samples from the buffer
+             * (non-consumed samples are returned in next vorbis_synthesis_pcmout calls) */
+            vorbis_synthesis_read(&data->vd, samples_to_get);
+        }
+        else { /* read more data */
+            int ok, rc;
+            vorbis_custom_seek_entry packet;
+
+            /* not actually needed, but feels nicer */
+            data->op.granulepos += samples_to_do; /* can be changed next if desired */
+            data->op.packetno++;
+
+            /* restarting at the previous packet primes libvorbis, so output resumes here */
+            get_packet_state(stream, data, &packet);
+            if (data->seek_prev_set)
+                add_seek_entry(data, &data->seek_prev, data->current_sample);
+            data->seek_prev = packet;
+            data->seek_prev_set = 1;
+
+            /* read/transform data into the ogg_packet buffer and advance offsets */
+            ok = parse_packet(stream, data);
+            if(!ok) {
+                goto decode_fail;
+            }
+
+
+            /* parse the fake ogg packet into a logical vorbis block */
+            rc = vorbis_synthesis(&data->vb,&data->op);
+            if (rc == OV_ENOTAUDIO) {
+                VGM_LOG("Vorbis: not an audio packet (size=0x%x) @ %"PRIx64"\n",(size_t)data->op.bytes,(off64_t)stream->offset);
+                //VGM_LOGB(data->op.packet, (size_t)data->op.bytes,0);
+                data->seek_prev_set = 0; /* won't prime the decoder */
+                continue; /* rarely happens, seems ok? */
+            } else if (rc != 0) goto decode_fail;
+
+            /* finally decode the logical block into samples */
+            rc = vorbis_synthesis_blockin(&data->vd,&data->vb);
+            if (rc != 0) goto decode_fail; /* ? */
+
+
+            data->samples_full = 1;
+        }
+    }
+
+    return;
+
+decode_fail:
+    /* on error just put some 0 samples */
+    VGM_LOG("VORBIS: decode fail at %"PRIx64", missing %i samples\n", (off64_t)stream->offset, (samples_to_do - samples_done));
+    if (outbuf_f)
+        memset(outbuf_f + samples_done * channels, 0, (samples_to_do - samples_done) * channels * sizeof(float));
+    else
+        memset(outbuf + samples_done * channels, 0, (samples_to_do - samples_done) * channels * sizeof(sample));
+}
+
+void decode_vorbis_custom(VGMSTREAM * vgmstream, sample * outbuf, int32_t samples_to_do, int channels) {
+    decode_vorbis_custom_internal(vgmstream, outbuf, NULL, samples_to_do, channels);
+}
+
+void decode_vorbis_custom_f32(VGMSTREAM * vgmstream, float * outbuf, int32_t samples_to_do, int channels) {
+    decode_vorbis_custom_internal(vgmstream, NULL, outbuf, samples_to_do, channels);
+}
+
+static int parse_packet(VGMSTREAMCHANNEL *stream, vorbis_custom_codec_data *data) {
+    switch(data->type) {
+        case VORBIS_FSB:    return vorbis_custom_parse_packet_fsb(stream, data);
+        case VORBIS_WWISE:  return vorbis_custom_parse_packet_wwise(stream, data);
+        case VORBIS_OGL:    return vorbis_custom_parse_packet_ogl(stream, data);
+        case VORBIS_SK:     return vorbis_custom_parse_packet_sk(stream, data);
+        case VORBIS_VID1:   return vorbis_custom_parse_packet_vid1(stream, data);
+        default: return 0;
+    }
+}
+
+/* ********************************************** */
+
+void free_vorbis_custom(vorbis_custom_codec_data * data) {
+    if (!data)
+        return;
+
+    /* internal decoder cleanp */
+    vorbis_info_clear(&data->vi);
+    vorbis_comment_clear(&data->vc);
+    vorbis_dsp_clear(&data->vd);
+
+    vgm_free(data->seek_entries);
+    vgm_free(data->buffer);
+    vgm_free(data);
+}
+
+/* ********************************************** */
+
+/* Seeking is provided by the Ogg layer, so with custom vorbis we need our own seek table. Each entry saves
+ * a packet's offset and parser state, plus the sample where output resumes when decoding restarts there:
+ * the first packet after a restart only primes libvorbis (0 samples), and since MDCT blocks only overlap
+ * with the previous one, output from the next packet on is the same as decoding linearly. */
+
+static void get_packet_state(VGMSTREAMCHANNEL *stream, vorbis_custom_codec_data *data, vorbis_custom_seek_entry *entry) {
+    entry->offset = stream ? stream->offset : 0;
+    entry->sample = 0;
+    entry->prev_blockflag = data->prev_blockflag;
+    entry->current_packet = data->current_packet;
+    entry->block_offset = data->block_offset;
+    entry->block_size = data->block_size;
+}
+
+static void set_packet_state(vorbis_custom_codec_data *data, const vorbis_custom_seek_entry *entry) {
+    data->prev_blockflag = entry->prev_blockflag;
+    data->current_packet = entry->current_packet;
+    data->block_offset = entry->block_offset;
+    data->block_size = entry->block_size;
+}
+
+static void add_seek_entry(vorbis_custom_codec_data *data, const vorbis_custom_seek_entry *entry, int32_t sample) {
+    vorbis_custom_seek_entry *last = data->seek_count ? &data->seek_entries[data->seek_count - 1] : NULL;
+
+    /* only the first pass adds entries (loops/seeks decode again older packets) */
+    if (last && (sample < last->sample + VORBIS_SEEK_INTERVAL || entry->offset <= last->offset))
+        return;
+
+    if (data->seek_count == data->seek_max) {
+        int new_max = data->seek_max ? data->seek_max * 2 : 256;
+        vorbis_custom_seek_entry *new_entries = vgm_realloc(data->seek_entries, new_max * sizeof(vorbis_custom_seek_entry));
+        if (!new_entries) return; /* keep what we have, seeking will discard more */
+        data->seek_entries = new_entries;
+        data->seek_max = new_max;
+    }
+
+    data->seek_entries[data->seek_count] = *entry;
+    data->seek_entries[data->seek_count].sample = sample;
+    data->seek_count++;
+}
+
+/* Fills the seek table up to num_sample by parsing packets and adding their block sizes, without decoding.
+ * Output per audio packet is (prev_blocksize/4 + blocksize/4) after the first, same as vorbis_synthesis_blockin. */
+static void scan_seek_table(VGMSTREAM *vgmstream, int32_t num_sample) {
+    vorbis_custom_codec_data *data = vgmstream->codec_data;
+    VGMSTREAMCHANNEL stream = vgmstream->ch[0]; /* copy, decoding may resume from the current offset */
+    size_t stream_size = get_streamfile_size(stream.streamfile);
+    vorbis_custom_seek_entry packet, prev;
+    int prev_set = 0;
+    long prev_blocksize = 0;
+    int32_t sample;
+
+    if (data->seek_count) {
+        const vorbis_custom_seek_entry *last = &data->seek_entries[data->seek_count - 1];
+        stream.offset = last->offset;
+        set_packet_state(data, last);
+        sample = last->sample;
+    }
+    else {
+        stream.offset = stream.channel_start_offset;
+        set_packet_state(data, &data->seek_start);
+        sample = 0;
+    }
+
+    while (sample <= num_sample) {
+        long blocksize;
+
+        if (stream.offset >= stream_size) {
+            data->seek_scanned = 1;
+            break;
+        }
+
+        get_packet_state(&stream, data, &packet);
+        if (prev_set)
+            add_seek_entry(data, &prev, sample);
+
+        if (!parse_packet(&stream, data)) {
+            data->seek_scanned = 1;
+            break;
+        }
+
+        blocksize = vorbis_packet_blocksize(&data->vi, &data->op);
+        if (blocksize <= 0) { /* not audio, ignored by libvorbis */
+            prev_set = 0;
+            continue;
+        }
+
+        if (prev_blocksize)
+            sample += prev_blocksize / 4 + blocksize / 4;
+        prev_blocksize = blocksize;
+        prev = packet;
+        prev_set = 1;
+    }
+
+    /* buffers and parser state are reset by the caller */
+}
+
+/* finds the last entry at or before num_sample */
+static const vorbis_custom_seek_entry * find_seek_entry(vorbis_custom_codec_data *data, int32_t num_sample) {
+    int lo = 0, hi = data->seek_count - 1;
+    const vorbis_custom_seek_entry *entry = NULL;
+
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (data->seek_entries[mid].sample <= num_sample) {
+            entry = &data->seek_entries[mid];
+            lo = mid + 1;
+        }
+        else {
+            hi = mid - 1;
+        }
+    }
+
+    return entry;
+}
+
+void reset_vorbis_custom(VGMSTREAM *vgmstream) {
+    vorbis_custom_codec_data *data = vgmstream->codec_data;
+    if (!data) return;
+
+    vorbis_synthesis_restart(&data->vd);
+    data->samples_to_discard = 0;
+    data->current_sample = 0;
+    data->seek_prev_set = 0;
+    set_packet_state(data, &data->seek_start);
+}
+
+void seek_vorbis_custom(VGMSTREAM *vgmstream, int32_t num_sample) {
+    vorbis_custom_codec_data *data = vgmstream->codec_data;
+    const vorbis_custom_seek_entry *entry;
+    if (!data) return;
+
+    if (!data->seek_scanned && (data->seek_count == 0 || data->seek_entries[data->seek_count - 1].sample < num_sample))
+        scan_seek_table(vgmstream, num_sample);
+
+    /* restart at the closest packet and discard until the expected sample */
+    vorbis_synthesis_restart(&data->vd);
+    data->seek_prev_set = 0;
+
+    entry = find_seek_entry(data, num_sample);
+    if (entry) {
+        set_packet_state(data, entry);
+        data->samples_to_discard = num_sample - entry->sample;
+        data->current_sample = entry->sample;
+        if (vgmstream->loop_ch)
+            vgmstream->loop_ch[0].offset = entry->offset;
+    }
+    else {
+        set_packet_state(data, &data->seek_start);
+        data->samples_to_discard = num_sample;
+        data->current_sample = 0;
+        if (vgmstream->loop_ch)
+            vgmstream->loop_ch[0].offset = vgmstream->loop_ch[0].channel_start_offset;
+    }
+}
+
+#endif
@@ -1,25 +1,19 @@
 #include "layout.h"
 #include "../vgmstream.h"
 
+static int get_block_samples(VGMSTREAM * vgmstream);
+static void update_block_index(VGMSTREAM * vgmstream, size_t prev_full_block_size);
+
 
 /* Decodes samples for blocked streams.
  * Data is divided into headered blocks with a bunch of data. The layout calls external helper functions
  * when a block is decoded, and those must parse the new block and move offsets accordingly. */
 void render_vgmstream_blocked(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
     int samples_written = 0;
-    int frame_size, samples_per_frame, samples_this_block;
+    int samples_per_frame, samples_this_block;
 
-    frame_size = get_vgmstream_frame_size(vgmstream);
     samples_per_frame = get_vgmstream_samples_per_frame(vgmstream);
-    samples_this_block = 0;
-
-    if (vgmstream->current_block_samples) {
-        samples_this_block = vgmstream->current_block_samples;
-    } else if (frame_size == 0) { /* assume 4 bit */ //TODO: get_vgmstream_frame_size() really should return bits... */
-        samples_this_block = vgmstream->current_block_size * 2 * samples_per_frame;
-    } else {
-        samples_this_block = vgmstream->current_block_size / frame_size * samples_per_frame;
-    }
+    samples_this_block = get_block_samples(vgmstream);
 
 
     while (samples_written < sample_count) {
@@ -28,13 +22,8 @@ void render_vgmstream_blocked(sample * buffer, int32_t sample_count, VGMSTREAM *
 
         if (vgmstream->loop_flag && vgmstream_do_loop(vgmstream)) {
             /* handle looping, readjust back to loop start values */
-            if (vgmstream->current_block_samples) {
-                samples_this_block = vgmstream->current_block_samples;
-            } else if (frame_size == 0) { /* assume 4 bit */ //TODO: get_vgmstream_frame_size() really should return bits... */
-                samples_this_block = vgmstream->current_block_size * 2 * samples_per_frame;
-            } else {
-                samples_this_block = vgmstream->current_block_size / frame_size * samples_per_frame;
-            }
+            samples_per_frame = get_vgmstream_samples_per_frame(vgmstream);
+            samples_this_block = get_block_samples(vgmstream);
             continue;
         }
 
@@ -69,20 +58,18 @@ void render_vgmstream_blocked(sample * buffer, int32_t sample_count, VGMSTREAM *
         /* move to next block when all samples are consumed */
         if (vgmstream->samples_into_block == samples_this_block
                 /*&& vgmstream->current_sample < vgmstream->num_samples*/) { /* don't go past last block */ //todo
+            size_t prev_full_block_size = vgmstream->full_block_size;
+
             block_update(vgmstream->next_block_offset,vgmstream);
 
             /* update since these may change each block */
-            frame_size = get_vgmstream_frame_size(vgmstream);
             samples_per_frame = get_vgmstream_samples_per_frame(vgmstream);
-            if (vgmstream->current_block_samples) {
-                samples_this_block = vgmstream->current_block_samples;
-            } else if (frame_size == 0) { /* assume 4 bit */ //TODO: get_vgmstream_frame_size() really should return bits... */
-                samples_this_block = vgmstream->current_block_size * 2 * samples_per_frame;
-            } else {
-                samples_this_block = vgmstream->current_block_size / frame_size * samples_per_frame;
-            }
+            samples_this_block = get_block_samples(vgmstream);
 
             vgmstream->samples_into_block = 0;
+
+            if (vgmstream->block_index_data)
+                update_block_index(vgmstream, prev_full_block_size);
         }
 
     }
@@ -209,3 +196,276 @@ void block_update(off_t block_offset, VGMSTREAM * vgmstream) {
             break;
     }
 }
+
+/* samples in the current block, from the values set by block_update */
+static int get_block_samples(VGMSTREAM * vgmstream) {
+    int frame_size = get_vgmstream_frame_size(vgmstream);
+    int samples_per_frame = get_vgmstream_samples_per_frame(vgmstream);
+
+    if (vgmstream->current_block_samples) {
+        return vgmstream->current_block_samples;
+    } else if (frame_size == 0) { /* assume 4 bit */ //TODO: get_vgmstream_frame_size() really should return bits... */
+        return vgmstream->current_block_size * 2 * samples_per_frame;
+    } else {
+        return vgmstream->current_block_size / frame_size * samples_per_frame;
+    }
+}
+
+
+/* BLOCK INDEX: offsets of each block and their first sample, so seeking can jump to a block instead
+ * of walking every header from the start. Only useful when the codec's state is fully set at block
+ * (or frame) start, as otherwise history from the previous block would be needed. */
+
+#define BLOCK_INDEX_INITIAL_COUNT 256
+
+typedef struct {
+    off_t offset;
+    int32_t sample;
+    size_t full_block_size; /* before block_update, as some layouts use it to find the next block */
+} block_index_entry;
+
+struct block_index_data {
+    int count;
+    int max_count;
+    int complete; /* all blocks are known */
+    block_index_entry * entries;
+};
+
+/* Layouts handled by render_vgmstream_blocked/block_update. */
+int is_blocked_layout(layout_t layout_type) {
+    return layout_type >= layout_blocked_ast && layout_type <= layout_blocked_xa_aiff;
+}
+
+/* Blocked streams where decoding can start at any block without previous state. */
+int block_index_supported(VGMSTREAM * vgmstream) {
+    if (!is_blocked_layout(vgmstream->layout_type))
+        return 0;
+    if (vgmstream->codec_data || vgmstream->layout_data)
+        return 0;
+
+    switch(vgmstream->coding_type) {
+        /* stateless */
+        case coding_PCM16LE:
+        case coding_PCM16BE:
+        case coding_PCM16_int:
+        case coding_PCM8:
+        case coding_PCM8_int:
+        case coding_PCM8_U:
+        case coding_PCM8_U_int:
+        case coding_PCM8_SB:
+        case coding_ULAW:
+        case coding_ULAW_int:
+        case coding_ALAW:
+        case coding_PCMFLOAT:
+        /* state in frame headers */
+        case coding_MSADPCM:
+        case coding_MSADPCM_ck:
+        case coding_XBOX_IMA:
+        case coding_XBOX_IMA_int:
+        case coding_XBOX_IMA_mch:
+        case coding_APPLE_IMA4:
+            return 1;
+
+        /* state in block headers */
+        case coding_NGC_DSP:
+            return vgmstream->layout_type == layout_blocked_thp;
+        case coding_IMA_int:
+            return vgmstream->layout_type == layout_blocked_hwas;
+        case coding_DVI_IMA:
+            return vgmstream->layout_type == layout_blocked_ea_schl ||
+                    (vgmstream->layout_type == layout_blocked_ea_1snh && vgmstream->codec_config == 1);
+
+        default:
+            return 0;
+    }
+}
+
+static int add_block_index(block_index_data * data, off_t offset, int32_t sample, size_t full_block_size) {
+
+    /* only new blocks (empty blocks share their sample with the next one, the first is enough) */
+    if (data->count > 0 && data->entries[data->count-1].sample >= sample)
+        return 1;
+
+    if (data->count == data->max_count) {
+        block_index_entry * entries;
+        int max_count = data->max_count * 2;
+
+        entries = vgm_realloc(data->entries, max_count * sizeof(block_index_entry));
+        if (!entries) return 0;
+
+        data->entries = entries;
+        data->max_count = max_count;
+    }
+
+    data->entries[data->count].offset = offset;
+    data->entries[data->count].sample = sample;
+    data->entries[data->count].full_block_size = full_block_size;
+    data->count++;
+    return 1;
+}
+
+/* called by the layout after moving to a new block (first playthrough only, as loops go back) */
+static void update_block_index(VGMSTREAM * vgmstream, size_t prev_full_block_size) {
+    block_index_data * data = vgmstream->block_index_data;
+
+    if (data->complete)
+        return;
+    if (vgmstream->current_sample >= vgmstream->num_samples)
+        return;
+
+    add_block_index(data, vgmstream->current_block_offset, vgmstream->current_sample, prev_full_block_size);
+}
+
+static block_index_data * init_block_index(void) {
+    block_index_data * data = vgm_calloc(1, sizeof(block_index_data));
+    if (!data) goto fail;
+
+    data->max_count = BLOCK_INDEX_INITIAL_COUNT;
+    data->entries = vgm_malloc(data->max_count * sizeof(block_index_entry));
+    if (!data->entries) goto fail;
+
+    return data;
+fail:
+    free_block_index(data);
+    return NULL;
+}
+
+void free_block_index(block_index_data * data) {
+    if (!data)
+        return;
+    vgm_free(data->entries);
+    vgm_free(data);
+}
+
+/* Moves to the start of the last known block before seek_sample, returning the sample it ended up in
+ * (-1 if none). Caller must decode the rest, which also indexes new blocks on the way. */
+int32_t seek_layout_blocked(VGMSTREAM * vgmstream, int32_t seek_sample) {
+    block_index_data * data = vgmstream->block_index_data;
+    block_index_entry * entry;
+    int lo, hi;
+
+    if (!data || data->count == 0)
+        return -1;
+
+    /* find last entry <= seek_sample */
+    lo = 0;
+    hi = data->count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (data->entries[mid].sample <= seek_sample)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    entry = &data->entries[lo];
+    if (entry->sample > seek_sample)
+        return -1;
+
+    if (lo == 0) {
+        /* first block was set up by the meta (values before that aren't known) */
+        VGMSTREAM * start_vgmstream = vgmstream->start_vgmstream;
+
+        vgmstream->current_block_offset = start_vgmstream->current_block_offset;
+        vgmstream->current_block_size = start_vgmstream->current_block_size;
+        vgmstream->current_block_samples = start_vgmstream->current_block_samples;
+        vgmstream->next_block_offset = start_vgmstream->next_block_offset;
+        vgmstream->full_block_size = start_vgmstream->full_block_size;
+        copy_vgmstream_channels(vgmstream, vgmstream->ch, vgmstream->start_ch);
+    }
+    else {
+        vgmstream->full_block_size = entry->full_block_size;
+        block_update(entry->offset, vgmstream);
+    }
+
+    vgmstream->current_sample = entry->sample;
+    vgmstream->samples_into_block = 0;
+    return entry->sample;
+}
+
+
+int vgmstream_enable_block_index(VGMSTREAM * vgmstream) {
+    VGMSTREAM * start_vgmstream;
+    block_index_data * data;
+    vgm_alloc_scope * previous;
+
+    if (!vgmstream || !block_index_supported(vgmstream))
+        return 0;
+    if (vgmstream->block_index_data)
+        return 1;
+
+    previous = vgm_alloc_scope_enter(vgmstream->alloc_scope); /* entries may grow later, but stay in the scope */
+    data = init_block_index();
+    vgm_alloc_scope_leave(previous);
+    if (!data) return 0;
+
+    /* first block, as set up by the meta */
+    start_vgmstream = vgmstream->start_vgmstream;
+    data->entries[0].offset = start_vgmstream->current_block_offset;
+    data->entries[0].sample = 0;
+    data->entries[0].full_block_size = 0; /* not used */
+    data->count = 1;
+
+    vgmstream->block_index_data = data;
+    start_vgmstream->block_index_data = data; /* so resets keep it */
+    return 1;
+}
+
+int vgmstream_build_block_index(VGMSTREAM * vgmstream) {
+    block_index_data * data;
+    VGMSTREAM * backup = NULL;
+    VGMSTREAMCHANNEL * backup_ch = NULL;
+    size_t channels_size;
+    int32_t current_sample;
+
+    if (!vgmstream_enable_block_index(vgmstream))
+        return 0;
+    data = vgmstream->block_index_data;
+    if (data->complete)
+        return 1;
+
+    /* block_update changes channels and block values, restored when done */
+    channels_size = sizeof(VGMSTREAMCHANNEL) * vgmstream->channels;
+    backup = vgm_malloc(sizeof(VGMSTREAM));
+    backup_ch = vgm_malloc(channels_size);
+    if (!backup || !backup_ch) goto fail;
+    memcpy(backup, vgmstream, sizeof(VGMSTREAM));
+    memcpy(backup_ch, vgmstream->ch, channels_size);
+
+    /* read headers only, from the last known block */
+    current_sample = seek_layout_blocked(vgmstream, vgmstream->num_samples);
+    while (current_sample >= 0 && current_sample < vgmstream->num_samples) {
+        off_t current_offset = vgmstream->current_block_offset;
+        size_t prev_full_block_size = vgmstream->full_block_size;
+        int block_samples = get_block_samples(vgmstream);
+
+        if (block_samples < 0 || vgmstream->current_block_offset < 0 || vgmstream->current_block_offset == 0xFFFFFFFF)
+            break; /* EOF or bad block */
+
+        current_sample += block_samples;
+        if (current_sample >= vgmstream->num_samples)
+            break;
+
+        block_update(vgmstream->next_block_offset, vgmstream);
+        if (vgmstream->current_block_offset <= current_offset)
+            break; /* shouldn't happen */
+
+        if (!add_block_index(data, vgmstream->current_block_offset, current_sample, prev_full_block_size))
+            goto fail;
+    }
+
+    data->complete = 1;
+
+    memcpy(vgmstream->ch, backup_ch, channels_size);
+    memcpy(vgmstream, backup, sizeof(VGMSTREAM));
+    vgm_free(backup);
+    vgm_free(backup_ch);
+    return 1;
+fail:
+    if (backup && backup_ch) {
+        memcpy(vgmstream->ch, backup_ch, channels_size);
+        memcpy(vgmstream, backup, sizeof(VGMSTREAM));
+    }
+    vgm_free(backup);
+    vgm_free(backup_ch);
+    return 0;
+}
@@ -2,9 +2,20 @@
 #include "../vgmstream.h"
 
 
+/* Writes samples_to_do samples to buffer's samples_written position (s16 or float). */
+typedef void (*flat_writer_t)(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, void * buffer);
+
+static void write_s16(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, void * buffer) {
+    decode_vgmstream(vgmstream, samples_written, samples_to_do, buffer);
+}
+
+static void write_f32(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, void * buffer) {
+    decode_vgmstream_f32(vgmstream, samples_written, samples_to_do, buffer);
+}
+
 /* Decodes samples for flat streams.
  * Data forms a single stream, and the decoder may internally skip chunks and move offsets as needed. */
-void render_vgmstream_flat(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
+static void render_flat(void * buffer, size_t sample_size, flat_writer_t write, int32_t sample_count, VGMSTREAM * vgmstream) {
     int samples_written = 0;
     int samples_per_frame, samples_this_block;
 
@@ -26,14 +37,45 @@ void render_vgmstream_flat(sample * buffer, int32_t sample_count, VGMSTREAM * vg
         
         if (samples_to_do == 0) {
             VGM_LOG("layout_flat: wrong samples_to_do found\n");
-            memset(buffer + samples_written*vgmstream->channels, 0, (sample_count - samples_written) * vgmstream->channels * sizeof(sample));
+            memset((uint8_t*)buffer + samples_written*vgmstream->channels*sample_size, 0, (sample_count - samples_written) * vgmstream->channels * sample_size);
             break;
         }
 
-        decode_vgmstream(vgmstream, samples_written, samples_to_do, buffer);
+        write(vgmstream, samples_written, samples_to_do, buffer);
 
         samples_written += samples_to_do;
         vgmstream->current_sample += samples_to_do;
         vgmstream->samples_into_block += samples_to_do;
     }
 }
+
+void render_vgmstream_flat(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
+    render_flat(buffer, sizeof(sample), write_s16, sample_count, vgmstream);
+}
+
+/* Same as the above but with float output, for decoders that support it. */
+void render_vgmstream_flat_f32(float * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
+    render_flat(buffer, sizeof(float), write_f32, sample_count, vgmstream);
+}
+
+/* Moves to the start of the frame that contains seek_sample, returning the sample it ended up in.
+ * Only valid for decoders that find frames from samples_into_block and don't keep state between
+ * frames (stateless codecs or frames with full headers), the caller must decode the rest. */
+int32_t seek_layout_flat(VGMSTREAM * vgmstream, int32_t seek_sample) {
+    int32_t frame_sample;
+    int samples_per_frame, ch;
+
+    samples_per_frame = get_vgmstream_samples_per_frame(vgmstream);
+    if (samples_per_frame <= 0)
+        samples_per_frame = 1;
+
+    frame_sample = seek_sample - seek_sample % samples_per_frame;
+
+    for (ch = 0; ch < vgmstream->channels; ch++) {
+        vgmstream->ch[ch].offset = vgmstream->start_ch[ch].offset;
+    }
+
+    vgmstream->current_sample = frame_sample;
+    vgmstream->samples_into_block = frame_sample;
+    return frame_sample;
+}
@@ -1,5 +1,83 @@
 #include "layout.h"
 #include "../vgmstream.h"
+#include "../coding/coding.h"
+
+
+/* PCM with an interleave of one sample (standard .wav) is rendered as one big block of frames,
+ * decoding all channels at once, since otherwise the layout would loop and decode per sample. */
+static int is_interleave_frames(VGMSTREAM * vgmstream, int frame_size, int samples_per_frame) {
+    int ch;
+
+    switch(vgmstream->coding_type) {
+        case coding_PCM16LE:
+        case coding_PCM16BE:
+        case coding_PCM8:
+        case coding_PCM8_U:
+        case coding_PCMFLOAT:
+            break;
+        default:
+            return 0;
+    }
+
+    if (vgmstream->channels <= 1 || samples_per_frame != 1 || vgmstream->interleave_block_size != frame_size)
+        return 0;
+    if (vgmstream->interleave_last_block_size && vgmstream->interleave_last_block_size != frame_size)
+        return 0;
+
+    /* channels must be next to each other */
+    for (ch = 1; ch < vgmstream->channels; ch++) {
+        if (vgmstream->ch[ch].streamfile != vgmstream->ch[0].streamfile ||
+                vgmstream->ch[ch].offset != vgmstream->ch[0].offset + frame_size*ch)
+            return 0;
+    }
+
+    return 1;
+}
+
+static void render_vgmstream_interleave_frames(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream, int frame_size) {
+    int samples_written = 0;
+    sample * outbuf;
+    int ch;
+
+    while (samples_written < sample_count) {
+        int samples_to_do;
+
+        if (vgmstream->loop_flag && vgmstream_do_loop(vgmstream)) {
+            continue;
+        }
+
+        /* the whole buffer is a single "block" (stops at loop points, or samples_into_block is always 0) */
+        samples_to_do = vgmstream_samples_to_do(sample_count - samples_written, 1, vgmstream);
+
+        outbuf = buffer + samples_written*vgmstream->channels;
+        switch(vgmstream->coding_type) {
+            case coding_PCM16LE:
+                decode_pcm16_frames(&vgmstream->ch[0], outbuf, vgmstream->channels, 0, samples_to_do, 0);
+                break;
+            case coding_PCM16BE:
+                decode_pcm16_frames(&vgmstream->ch[0], outbuf, vgmstream->channels, 0, samples_to_do, 1);
+                break;
+            case coding_PCM8:
+                decode_pcm8_frames(&vgmstream->ch[0], outbuf, vgmstream->channels, 0, samples_to_do, 0);
+                break;
+            case coding_PCM8_U:
+                decode_pcm8_frames(&vgmstream->ch[0], outbuf, vgmstream->channels, 0, samples_to_do, 1);
+                break;
+            case coding_PCMFLOAT:
+                decode_pcmfloat_frames(&vgmstream->ch[0], outbuf, vgmstream->channels, 0, samples_to_do, vgmstream->codec_endian);
+                break;
+            default:
+                break;
+        }
+
+        samples_written += samples_to_do;
+        vgmstream->current_sample += samples_to_do;
+
+        for (ch = 0; ch < vgmstream->channels; ch++) {
+            vgmstream->ch[ch].offset += samples_to_do * frame_size * vgmstream->channels;
+        }
+    }
+}
 
 
 /* Decodes samples for interleaved streams.
@@ -23,6 +101,11 @@ void render_vgmstream_interleave(sample * buffer, int32_t sample_count, VGMSTREA
         samples_this_block = vgmstream->interleave_last_block_size / frame_size * samples_per_frame;
     }
 
+    if (vgmstream->samples_into_block == 0 && is_interleave_frames(vgmstream, frame_size, samples_per_frame)) {
+        render_vgmstream_interleave_frames(buffer, sample_count, vgmstream, frame_size);
+        return;
+    }
+
     /* mono interleaved stream with no layout set, just behave like flat layout */
     if (samples_this_block == 0 && vgmstream->channels == 1)
         samples_this_block = vgmstream->num_samples;
@@ -91,3 +174,63 @@ void render_vgmstream_interleave(sample * buffer, int32_t sample_count, VGMSTREA
 
     }
 }
+
+/* Moves to the start of the frame that contains seek_sample, returning the sample it ended up in.
+ * Offsets are calculated the same way the render loop above would move them, so it's only valid
+ * for decoders that don't move offsets nor keep state between frames (stateless codecs or frames
+ * with full headers), the caller must decode the rest. */
+int32_t seek_layout_interleave(VGMSTREAM * vgmstream, int32_t seek_sample) {
+    int32_t block_sample, samples_into_block;
+    int frame_size, samples_per_frame, samples_this_block, full_blocks, ch;
+    int has_interleave_last = vgmstream->interleave_last_block_size && vgmstream->channels > 1;
+
+    frame_size = get_vgmstream_frame_size(vgmstream);
+    samples_per_frame = get_vgmstream_samples_per_frame(vgmstream);
+    if (frame_size <= 0 || samples_per_frame <= 0)
+        return -1;
+    samples_this_block = vgmstream->interleave_block_size / frame_size * samples_per_frame;
+
+    /* mono interleaved stream with no layout set, just behave like flat layout */
+    if (samples_this_block == 0 && vgmstream->channels == 1)
+        samples_this_block = vgmstream->num_samples;
+    if (samples_this_block <= 0)
+        return -1;
+
+    /* the render switches to the last interleave once a full block doesn't fit anymore */
+    full_blocks = vgmstream->num_samples / samples_this_block;
+
+    if (has_interleave_last && seek_sample >= (int32_t)full_blocks * samples_this_block) {
+        samples_into_block = seek_sample - full_blocks * samples_this_block;
+        block_sample = full_blocks * samples_this_block;
+
+        samples_per_frame = get_vgmstream_samples_per_shortframe(vgmstream);
+        if (samples_per_frame <= 0)
+            return -1;
+
+        for (ch = 0; ch < vgmstream->channels; ch++) {
+            off_t skip = 0;
+            if (full_blocks > 0) {
+                skip = vgmstream->interleave_block_size*vgmstream->channels*(full_blocks-1) +
+                        vgmstream->interleave_block_size*(vgmstream->channels-ch) +
+                        vgmstream->interleave_last_block_size*ch;
+            }
+            vgmstream->ch[ch].offset = vgmstream->start_ch[ch].offset + skip;
+        }
+    }
+    else {
+        int32_t block = seek_sample / samples_this_block;
+        samples_into_block = seek_sample % samples_this_block;
+        block_sample = block * samples_this_block;
+
+        for (ch = 0; ch < vgmstream->channels; ch++) {
+            off_t skip = (off_t)vgmstream->interleave_block_size*vgmstream->channels*block;
+            vgmstream->ch[ch].offset = vgmstream->start_ch[ch].offset + skip;
+        }
+    }
+
+    samples_into_block -= samples_into_block % samples_per_frame;
+
+    vgmstream->current_sample = block_sample + samples_into_block;
+    vgmstream->samples_into_block = samples_into_block;
+    return vgmstream->current_sample;
+}
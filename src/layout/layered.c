@@ -1,45 +1,163 @@
 #include "layout.h"
 #include "../vgmstream.h"
 
+/* SIMD path for the common two layer case, selected at compile time like in pcm_convert.c */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LAYERED_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define LAYERED_NEON 1
+#endif
+
 
 /* NOTE: if loop settings change the layered vgmstreams must be notified (preferably using vgmstream_force_loop) */
 #define LAYER_BUF_SIZE 512
+#define LAYER_MAX_BUF_SIZE 0x10000
 #define LAYER_MAX_CHANNELS 6 /* at least 2, but let's be generous */
 
+typedef struct {
+    vgm_task task;
+    VGMSTREAM *layer;
+    sample *buffer;
+    int32_t samples_to_do;
+} layer_task;
+
+static void render_layer(void *arg) {
+    layer_task *lt = arg;
+
+    /* each layer will handle its own looping internally */
+    render_vgmstream(lt->buffer, lt->samples_to_do, lt->layer);
+}
+
+/* copies a layer's samples into their channels of the main buffer, a frame at a time */
+static void interleave_layer(sample * outbuf, int out_channels, const sample * inbuf, int layer_channels, int32_t samples) {
+    int32_t s;
+    int ch;
+
+    switch (layer_channels) {
+        case 1:
+            for (s = 0; s < samples; s++) {
+                outbuf[s*out_channels] = inbuf[s];
+            }
+            break;
+        case 2:
+            for (s = 0; s < samples; s++) {
+                outbuf[s*out_channels + 0] = inbuf[s*2 + 0];
+                outbuf[s*out_channels + 1] = inbuf[s*2 + 1];
+            }
+            break;
+        default:
+            for (s = 0; s < samples; s++) {
+                for (ch = 0; ch < layer_channels; ch++) {
+                    outbuf[s*out_channels + ch] = inbuf[s*layer_channels + ch];
+                }
+            }
+            break;
+    }
+}
+
+/* interleaves two layers with the same channels (1 or 2) at once, the most common layered case
+ * (ex. mono L+R or stereo front+rear). Returns samples done, the caller does the rest. */
+static int32_t interleave_layer_pair(sample * outbuf, const sample * inbuf1, const sample * inbuf2, int layer_channels, int32_t samples) {
+    int32_t s = 0;
+
+#if defined(LAYERED_SSE2)
+    if (layer_channels == 1) {
+        for (; s + 8 <= samples; s += 8) {
+            __m128i l1 = _mm_loadu_si128((const __m128i*)(inbuf1 + s));
+            __m128i l2 = _mm_loadu_si128((const __m128i*)(inbuf2 + s));
+            _mm_storeu_si128((__m128i*)(outbuf + s*2 + 0), _mm_unpacklo_epi16(l1, l2));
+            _mm_storeu_si128((__m128i*)(outbuf + s*2 + 8), _mm_unpackhi_epi16(l1, l2));
+        }
+    }
+    else if (layer_channels == 2) {
+        /* a stereo sample is a 32-bit pair */
+        for (; s + 4 <= samples; s += 4) {
+            __m128i l1 = _mm_loadu_si128((const __m128i*)(inbuf1 + s*2));
+            __m128i l2 = _mm_loadu_si128((const __m128i*)(inbuf2 + s*2));
+            _mm_storeu_si128((__m128i*)(outbuf + s*4 + 0), _mm_unpacklo_epi32(l1, l2));
+            _mm_storeu_si128((__m128i*)(outbuf + s*4 + 8), _mm_unpackhi_epi32(l1, l2));
+        }
+    }
+#elif defined(LAYERED_NEON)
+    if (layer_channels == 1) {
+        for (; s + 8 <= samples; s += 8) {
+            int16x8x2_t v;
+            v.val[0] = vld1q_s16(inbuf1 + s);
+            v.val[1] = vld1q_s16(inbuf2 + s);
+            vst2q_s16(outbuf + s*2, v);
+        }
+    }
+    else if (layer_channels == 2) {
+        for (; s + 4 <= samples; s += 4) {
+            int32x4x2_t v;
+            v.val[0] = vreinterpretq_s32_s16(vld1q_s16(inbuf1 + s*2));
+            v.val[1] = vreinterpretq_s32_s16(vld1q_s16(inbuf2 + s*2));
+            vst2q_s32((int32_t*)(outbuf + s*4), v);
+        }
+    }
+#endif
+
+    return s;
+}
+
 /* Decodes samples for layered streams.
  * Similar to interleave layout, but decodec samples are mixed from complete vgmstreams, each
  * with custom codecs and different number of channels, creating a single super-vgmstream.
- * Usually combined with custom streamfiles to handle data interleaved in weird ways. */
+ * Usually combined with custom streamfiles to handle data interleaved in weird ways.
+ * Layers are independent, so they may be rendered in parallel into their own buffers. */
 void render_vgmstream_layered(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
     int samples_written = 0;
     layered_layout_data *data = vgmstream->layout_data;
-    sample interleave_buf[LAYER_BUF_SIZE*LAYER_MAX_CHANNELS];
+    layer_task *tasks = data->tasks;
 
 
     while (samples_written < sample_count) {
-        int samples_to_do = LAYER_BUF_SIZE;
+        int samples_to_do = data->buffer_samples;
         int layer, ch = 0;
+        sample *layer_buf = data->buffer;
 
         if (samples_to_do > sample_count - samples_written)
             samples_to_do = sample_count - samples_written;
 
+        /* render all layers (first one in this thread, as it needs to wait anyway) */
         for (layer = 0; layer < data->layer_count; layer++) {
-            int s, layer_ch;
-            int layer_channels = data->layers[layer]->channels;
+            tasks[layer].layer = data->layers[layer];
+            tasks[layer].buffer = layer_buf;
+            tasks[layer].samples_to_do = samples_to_do;
+            layer_buf += data->buffer_samples * data->layers[layer]->channels;
 
-            /* each layer will handle its own looping internally */
+            if (layer > 0 && data->pool)
+                vgm_task_submit(data->pool, &tasks[layer].task, render_layer, &tasks[layer]);
+        }
 
-            render_vgmstream(interleave_buf, samples_to_do, data->layers[layer]);
+        render_layer(&tasks[0]);
+        for (layer = 1; layer < data->layer_count; layer++) {
+            if (data->pool)
+                vgm_task_wait(data->pool, &tasks[layer].task);
+            else
+                render_layer(&tasks[layer]);
+        }
 
-            /* mix layer samples to main samples */
-            for (layer_ch = 0; layer_ch < layer_channels; layer_ch++) {
-                for (s = 0; s < samples_to_do; s++) {
-                    size_t layer_sample = s*layer_channels + layer_ch;
-                    size_t buffer_sample = (samples_written+s)*vgmstream->channels + ch;
+        /* mix layer samples to main samples */
+        if (data->layer_count == 1) {
+            memcpy(buffer + samples_written*vgmstream->channels, tasks[0].buffer, samples_to_do * vgmstream->channels * sizeof(sample));
+        }
+        else {
+            int32_t samples_done = 0;
 
-                    buffer[buffer_sample] = interleave_buf[layer_sample];
-                }
-                ch++;
+            if (data->layer_count == 2 && data->layers[0]->channels == data->layers[1]->channels) {
+                samples_done = interleave_layer_pair(buffer + samples_written*vgmstream->channels,
+                        tasks[0].buffer, tasks[1].buffer, data->layers[0]->channels, samples_to_do);
+            }
+
+            for (layer = 0; layer < data->layer_count; layer++) {
+                int layer_channels = data->layers[layer]->channels;
+
+                interleave_layer(buffer + (samples_written + samples_done)*vgmstream->channels + ch, vgmstream->channels,
+                        tasks[layer].buffer + samples_done*layer_channels, layer_channels, samples_to_do - samples_done);
+                ch += layer_channels;
             }
         }
 
@@ -49,6 +167,37 @@ void render_vgmstream_layered(sample * buffer, int32_t sample_count, VGMSTREAM *
     }
 }
 
+/* Sets samples rendered per layer at once (0=default) and if layers render in parallel.
+ * Buffers are reallocated, so it shouldn't be called while rendering. */
+int config_layout_layered(layered_layout_data* data, int use_threads, int buffer_samples) {
+    int i, channels = 0;
+    sample *buffer;
+
+    if (buffer_samples <= 0)
+        buffer_samples = LAYER_BUF_SIZE;
+    if (buffer_samples > LAYER_MAX_BUF_SIZE)
+        buffer_samples = LAYER_MAX_BUF_SIZE;
+
+    for (i = 0; i < data->layer_count; i++) {
+        channels += data->layers[i]->channels;
+    }
+
+    buffer = vgm_realloc(data->buffer, buffer_samples * channels * sizeof(sample));
+    if (!buffer) return 0;
+    data->buffer = buffer;
+    data->buffer_samples = buffer_samples;
+
+    if (use_threads && !data->pool && data->layer_count > 1) {
+        data->pool = vgm_pool_acquire(); /* may be NULL */
+    }
+    else if (!use_threads && data->pool) {
+        vgm_pool_release(data->pool);
+        data->pool = NULL;
+    }
+
+    return 1;
+}
+
 
 layered_layout_data* init_layout_layered(int layer_count) {
     layered_layout_data *data = NULL;
@@ -56,14 +205,17 @@ layered_layout_data* init_layout_layered(int layer_count) {
     if (layer_count <= 0 || layer_count > 255)
         goto fail;
 
-    data = calloc(1, sizeof(layered_layout_data));
+    data = vgm_calloc(1, sizeof(layered_layout_data));
     if (!data) goto fail;
 
     data->layer_count = layer_count;
 
-    data->layers = calloc(layer_count, sizeof(VGMSTREAM*));
+    data->layers = vgm_calloc(layer_count, sizeof(VGMSTREAM*));
     if (!data->layers) goto fail;
 
+    data->tasks = vgm_calloc(layer_count, sizeof(layer_task));
+    if (!data->tasks) goto fail;
+
     return data;
 fail:
     free_layout_layered(data);
@@ -103,6 +255,9 @@ int setup_layout_layered(layered_layout_data* data) {
         memcpy(data->layers[i]->start_vgmstream,data->layers[i],sizeof(VGMSTREAM));
     }
 
+    if (!config_layout_layered(data, 0, LAYER_BUF_SIZE))
+        goto fail;
+
     return 1;
 fail:
     return 0; /* caller is expected to free */
@@ -118,9 +273,12 @@ void free_layout_layered(layered_layout_data *data) {
         for (i = 0; i < data->layer_count; i++) {
             close_vgmstream(data->layers[i]);
         }
-        free(data->layers);
+        vgm_free(data->layers);
     }
-    free(data);
+    vgm_pool_release(data->pool);
+    vgm_free(data->buffer);
+    vgm_free(data->tasks);
+    vgm_free(data);
 }
 
 void reset_layout_layered(layered_layout_data *data) {
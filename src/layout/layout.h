@@ -7,6 +7,10 @@
 /* blocked layouts */
 void render_vgmstream_blocked(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
 void block_update(off_t block_offset, VGMSTREAM * vgmstream);
+int is_blocked_layout(layout_t layout_type);
+int block_index_supported(VGMSTREAM * vgmstream);
+int32_t seek_layout_blocked(VGMSTREAM * vgmstream, int32_t seek_sample);
+void free_block_index(block_index_data * data);
 
 void block_update_ast(off_t block_ofset, VGMSTREAM * vgmstream);
 void block_update_mxch(off_t block_ofset, VGMSTREAM * vgmstream);
@@ -49,8 +53,11 @@ void block_update_xa_aiff(off_t block_offset, VGMSTREAM * vgmstream);
 
 /* other layouts */
 void render_vgmstream_interleave(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
+int32_t seek_layout_interleave(VGMSTREAM * vgmstream, int32_t seek_sample);
 
 void render_vgmstream_flat(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
+void render_vgmstream_flat_f32(float * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
+int32_t seek_layout_flat(VGMSTREAM * vgmstream, int32_t seek_sample);
 
 void render_vgmstream_aix(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
 
@@ -59,10 +66,13 @@ segmented_layout_data* init_layout_segmented(int segment_count);
 int setup_layout_segmented(segmented_layout_data* data);
 void free_layout_segmented(segmented_layout_data *data);
 void reset_layout_segmented(segmented_layout_data *data);
+int config_layout_segmented(segmented_layout_data* data, int prefetch_samples);
+void seek_layout_segmented(VGMSTREAM * vgmstream, int32_t seek_sample);
 
 void render_vgmstream_layered(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
 layered_layout_data* init_layout_layered(int layer_count);
 int setup_layout_layered(layered_layout_data* data);
+int config_layout_layered(layered_layout_data* data, int use_threads, int buffer_samples);
 void free_layout_layered(layered_layout_data *data);
 void reset_layout_layered(layered_layout_data *data);
 
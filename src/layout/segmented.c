@@ -2,12 +2,160 @@
 #include "../vgmstream.h"
 
 
+#define SEGMENT_MAX_PREFETCH 0x10000
+
+#define PREFETCH_NONE     0     /* nothing prepared */
+#define PREFETCH_PENDING  1     /* segment queued to be prepared */
+#define PREFETCH_READY    2     /* segment prepared, waiting for the segment change */
+#define PREFETCH_PLAYING  3     /* current segment, prepared samples are being played */
+
+typedef struct {
+    vgm_task task;
+    int state;
+    int segment;
+    int32_t skip;               /* samples into the segment where it starts playing */
+    VGMSTREAM *vgmstream;
+    sample *buffer;
+    int32_t samples;            /* prepared samples */
+    int32_t pos;                /* prepared samples already played */
+    uint32_t prepare_us;
+} segment_prefetch;
+
+static void prepare_segment(void *arg) {
+    segment_prefetch *pf = arg;
+    uint32_t start = vgm_clock_us();
+
+    if (pf->skip > 0)
+        vgmstream_seek(pf->vgmstream, pf->skip);
+    else
+        reset_vgmstream(pf->vgmstream);
+    render_vgmstream(pf->buffer, pf->samples, pf->vgmstream);
+
+    pf->prepare_us = vgm_clock_us() - start;
+}
+
+/* find segment where sample falls (binary search in the segment start table), plus samples into it */
+static int find_segment(segmented_layout_data *data, int32_t sample, int32_t *p_samples_skip) {
+    int lo = 0, hi = data->segment_count - 1;
+
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (data->sample_offsets[mid] <= sample)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    /* past the end stays at the end of the last segment */
+    if (sample > data->sample_offsets[data->segment_count])
+        sample = data->sample_offsets[data->segment_count];
+    if (sample < 0)
+        sample = 0;
+
+    *p_samples_skip = sample - data->sample_offsets[lo];
+    return lo;
+}
+
+/* queues the segment played after the current one, unless it's the same */
+static void start_prefetch(VGMSTREAM * vgmstream, segmented_layout_data *data) {
+    segment_prefetch *pf = data->prefetch;
+    int next = data->current_segment + 1;
+
+    int32_t skip = 0;
+
+    if (next >= data->segment_count) {
+        if (!vgmstream->loop_flag)
+            return;
+        next = find_segment(data, vgmstream->loop_start_sample, &skip);
+    }
+    if (next == data->current_segment)
+        return;
+
+    pf->state = PREFETCH_PENDING;
+    pf->segment = next;
+    pf->skip = skip;
+    pf->vgmstream = data->segments[next];
+    pf->samples = data->prefetch_samples;
+    if (pf->samples > pf->vgmstream->num_samples - skip)
+        pf->samples = pf->vgmstream->num_samples - skip;
+    pf->pos = 0;
+    vgm_task_submit(data->pool, &pf->task, prepare_segment, pf);
+}
+
+/* waits for the queued segment (if any) to be prepared */
+static void finish_prefetch(segmented_layout_data *data) {
+    segment_prefetch *pf = data->prefetch;
+
+    if (!pf || pf->state != PREFETCH_PENDING)
+        return;
+
+    if (!vgm_task_done(data->pool, &pf->task))
+        data->stats.waited++;
+    vgm_task_wait(data->pool, &pf->task);
+
+    pf->state = PREFETCH_READY;
+    data->stats.prepared++;
+    data->stats.prepare_us_last = pf->prepare_us;
+    if (data->stats.prepare_us_max < pf->prepare_us)
+        data->stats.prepare_us_max = pf->prepare_us;
+    data->stats.prepare_us_total += pf->prepare_us;
+}
+
+/* moves to a segment (skip samples into it), using the prepared one if possible */
+static void change_segment(segmented_layout_data *data, int segment, int32_t skip) {
+    segment_prefetch *pf = data->prefetch;
+
+    data->current_segment = segment;
+
+    if (pf) {
+        finish_prefetch(data);
+        if (pf->state == PREFETCH_READY && pf->segment == segment && pf->skip == skip) {
+            pf->state = PREFETCH_PLAYING;
+            data->stats.ready++;
+            return;
+        }
+        pf->state = PREFETCH_NONE;
+        data->stats.missed++;
+    }
+
+    /* only the new segment needs to be reset, others are reset when changing to them */
+    if (skip > 0)
+        vgmstream_seek(data->segments[segment], skip);
+    else
+        reset_vgmstream(data->segments[segment]);
+}
+
+static void render_segment(sample * buffer, int32_t sample_count, segmented_layout_data *data) {
+    segment_prefetch *pf = data->prefetch;
+    VGMSTREAM *segment = data->segments[data->current_segment];
+
+    /* prepared samples first, segment continues after them */
+    if (pf && pf->state == PREFETCH_PLAYING) {
+        int32_t samples = pf->samples - pf->pos;
+        if (samples > sample_count)
+            samples = sample_count;
+
+        memcpy(buffer, pf->buffer + pf->pos * segment->channels, samples * segment->channels * sizeof(sample));
+        pf->pos += samples;
+        if (pf->pos == pf->samples)
+            pf->state = PREFETCH_NONE;
+
+        buffer += samples * segment->channels;
+        sample_count -= samples;
+    }
+
+    if (sample_count > 0)
+        render_vgmstream(buffer, sample_count, segment);
+}
+
 /* Decodes samples for segmented streams.
  * Chains together sequential vgmstreams, for data divided into separate sections or files
- * (like one part for intro and other for loop segments, which may even use different codecs). */
+ * (like one part for intro and other for loop segments, which may even use different codecs).
+ * The next segment may be prepared in the background, so segment changes only copy samples. */
 void render_vgmstream_segmented(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
     int samples_written = 0;
     segmented_layout_data *data = vgmstream->layout_data;
+    segment_prefetch *pf = data->prefetch;
 
 
     while (samples_written < sample_count) {
@@ -16,46 +164,31 @@ void render_vgmstream_segmented(sample * buffer, int32_t sample_count, VGMSTREAM
 
 
         if (vgmstream->loop_flag && vgmstream_do_loop(vgmstream)) {
-            /* handle looping, finding loop segment */
-            int loop_segment = 0, samples = 0, loop_samples_skip = 0;
-            while (samples < vgmstream->num_samples) {
-                int32_t segment_samples = data->segments[loop_segment]->num_samples;
-                if (vgmstream->loop_start_sample >= samples && vgmstream->loop_start_sample < samples + segment_samples) {
-                    loop_samples_skip = vgmstream->loop_start_sample - samples;
-                    break; /* loop_start falls within loop_segment's samples */
-                }
-                samples += segment_samples;
-                loop_segment++;
-            }
-            if (loop_segment == data->segment_count) {
-                VGM_LOG("segmented_layout: can't find loop segment\n");
-                loop_segment = 0;
-            }
-            if (loop_samples_skip > 0) {
-                VGM_LOG("segmented_layout: loop starts after %i samples\n", loop_samples_skip);
-                //todo skip/fix, but probably won't happen
-            }
+            /* handle looping, finding loop segment (loop may start in the middle of it) */
+            int32_t loop_samples_skip;
+            int loop_segment = find_segment(data, vgmstream->loop_start_sample, &loop_samples_skip);
 
-            data->current_segment = loop_segment;
-            reset_vgmstream(data->segments[data->current_segment]);
-            vgmstream->samples_into_block = 0;
+            change_segment(data, loop_segment, loop_samples_skip);
+            vgmstream->samples_into_block = loop_samples_skip;
             continue;
         }
 
+        if (pf && pf->state == PREFETCH_NONE)
+            start_prefetch(vgmstream, data);
+
         samples_to_do = vgmstream_samples_to_do(samples_this_block, sample_count, vgmstream);
         if (samples_to_do > sample_count - samples_written)
             samples_to_do = sample_count - samples_written;
 
         /* detect segment change and restart */
         if (samples_to_do == 0) {
-            data->current_segment++;
-            reset_vgmstream(data->segments[data->current_segment]);
+            change_segment(data, data->current_segment + 1, 0);
             vgmstream->samples_into_block = 0;
             continue;
         }
 
-        render_vgmstream(&buffer[samples_written*data->segments[data->current_segment]->channels],
-                samples_to_do,data->segments[data->current_segment]);
+        render_segment(&buffer[samples_written*data->segments[data->current_segment]->channels],
+                samples_to_do, data);
 
         samples_written += samples_to_do;
         vgmstream->current_sample += samples_to_do;
@@ -63,6 +196,17 @@ void render_vgmstream_segmented(sample * buffer, int32_t sample_count, VGMSTREAM
     }
 }
 
+/* Moves to seek_sample (in the current playthrough), resetting and seeking only the segment it falls in. */
+void seek_layout_segmented(VGMSTREAM * vgmstream, int32_t seek_sample) {
+    segmented_layout_data *data = vgmstream->layout_data;
+    int32_t samples_skip;
+    int segment = find_segment(data, seek_sample, &samples_skip);
+
+    change_segment(data, segment, samples_skip);
+    vgmstream->current_sample = seek_sample;
+    vgmstream->samples_into_block = samples_skip;
+}
+
 
 segmented_layout_data* init_layout_segmented(int segment_count) {
     segmented_layout_data *data = NULL;
@@ -70,13 +214,13 @@ segmented_layout_data* init_layout_segmented(int segment_count) {
     if (segment_count <= 0 || segment_count > 255)
         goto fail;
 
-    data = calloc(1, sizeof(segmented_layout_data));
+    data = vgm_calloc(1, sizeof(segmented_layout_data));
     if (!data) goto fail;
 
     data->segment_count = segment_count;
     data->current_segment = 0;
 
-    data->segments = calloc(segment_count, sizeof(VGMSTREAM*));
+    data->segments = vgm_calloc(segment_count, sizeof(VGMSTREAM*));
     if (!data->segments) goto fail;
 
     return data;
@@ -88,6 +232,11 @@ fail:
 int setup_layout_segmented(segmented_layout_data* data) {
     int i;
 
+    /* start sample of each segment, plus total at the end */
+    data->sample_offsets = vgm_calloc(data->segment_count + 1, sizeof(int32_t));
+    if (!data->sample_offsets)
+        goto fail;
+
     /* setup each VGMSTREAM (roughly equivalent to vgmstream.c's init_vgmstream_internal stuff) */
     for (i = 0; i < data->segment_count; i++) {
         if (!data->segments[i])
@@ -119,6 +268,8 @@ int setup_layout_segmented(segmented_layout_data* data) {
         /* save start things so we can restart for seeking/looping */
         memcpy(data->segments[i]->start_ch,data->segments[i]->ch,sizeof(VGMSTREAMCHANNEL)*data->segments[i]->channels);
         memcpy(data->segments[i]->start_vgmstream,data->segments[i],sizeof(VGMSTREAM));
+
+        data->sample_offsets[i + 1] = data->sample_offsets[i] + data->segments[i]->num_samples;
     }
 
 
@@ -133,23 +284,82 @@ void free_layout_segmented(segmented_layout_data *data) {
     if (!data)
         return;
 
+    config_layout_segmented(data, 0); /* stop prefetch before segments are gone */
+
     if (data->segments) {
         for (i = 0; i < data->segment_count; i++) {
             close_vgmstream(data->segments[i]);
         }
-        free(data->segments);
+        vgm_free(data->segments);
     }
-    free(data);
+    vgm_free(data->sample_offsets);
+    vgm_free(data);
 }
 
 void reset_layout_segmented(segmented_layout_data *data) {
-    int i;
-
     if (!data)
         return;
 
+    /* prepared segment is discarded */
+    if (data->prefetch) {
+        finish_prefetch(data);
+        ((segment_prefetch*)data->prefetch)->state = PREFETCH_NONE;
+    }
+
+    /* only the current segment needs to be reset, others are reset when changing to them */
     data->current_segment = 0;
+    reset_vgmstream(data->segments[0]);
+}
+
+/* Sets samples prepared ahead for the next segment (0=disable). Buffers are reallocated,
+ * so it shouldn't be called while rendering (prepared samples are discarded). */
+int config_layout_segmented(segmented_layout_data* data, int prefetch_samples) {
+    segment_prefetch *pf;
+    sample *buffer;
+    int i, channels = 0;
+
+    if (prefetch_samples < 0)
+        prefetch_samples = 0;
+    if (prefetch_samples > SEGMENT_MAX_PREFETCH)
+        prefetch_samples = SEGMENT_MAX_PREFETCH;
+
+    pf = data->prefetch;
+    if (pf) {
+        finish_prefetch(data);
+        pf->state = PREFETCH_NONE;
+    }
+
+    if (prefetch_samples == 0 || data->segment_count <= 1) {
+        if (pf) {
+            vgm_free(pf->buffer);
+            vgm_free(pf);
+            data->prefetch = NULL;
+        }
+        vgm_pool_release(data->pool);
+        data->pool = NULL;
+        data->prefetch_samples = 0;
+        return prefetch_samples == 0;
+    }
+
+    if (!pf) {
+        pf = vgm_calloc(1, sizeof(segment_prefetch));
+        if (!pf) return 0;
+        data->prefetch = pf;
+    }
+
+    /* any segment may be prepared (segments should have the same channels, but just in case) */
     for (i = 0; i < data->segment_count; i++) {
-        reset_vgmstream(data->segments[i]);
+        if (channels < data->segments[i]->channels)
+            channels = data->segments[i]->channels;
     }
+
+    buffer = vgm_realloc(pf->buffer, prefetch_samples * channels * sizeof(sample));
+    if (!buffer) return 0;
+    pf->buffer = buffer;
+    data->prefetch_samples = prefetch_samples;
+
+    if (!data->pool)
+        data->pool = vgm_pool_acquire(); /* may be NULL (prepared in this thread) */
+
+    return 1;
 }
@@ -0,0 +1,173 @@
+#include <stdlib.h>
+#include <string.h>
+#include "vgmstream.h"
+
+/* Loop cache: the loop is saved while it's played for the second time (first time after looping),
+ * and then copied rather than decoded. The first pass isn't used as decoders may output slightly
+ * different samples when decoding into the loop start vs restoring it (ex. lossy codecs' priming),
+ * while all later loops start from the same restored state.
+ *
+ * When copying, the decoder waits at the loop end (with current_sample = loop_end_sample) and
+ * loop_count is updated as if it was looping, so stopping at any loop end (like when the loop target
+ * is reached) continues from the right state. */
+
+#define LOOP_CACHE_DEFAULT_BYTES    (32*1024*1024) /* ~3 minutes of 44100hz stereo */
+#define LOOP_CACHE_SYNC_SAMPLES     0x400
+
+struct loop_cache_data {
+    sample * buffer;            /* loop samples (interleaved, allocated on first use) */
+    int32_t loop_samples;
+    int channels;
+    int32_t recorded;           /* samples saved (done if loop_samples) */
+    int32_t position;           /* samples copied of the current loop (0 = decoding) */
+};
+
+
+static int loop_cache_supported(VGMSTREAM * vgmstream) {
+    const codec_info * info = get_codec_info(vgmstream->coding_type);
+
+    if (!vgmstream->loop_flag || vgmstream->loop_end_sample <= vgmstream->loop_start_sample)
+        return 0;
+
+    /* layers loop by themselves */
+    if (vgmstream->layout_type == layout_layered)
+        return 0;
+
+    /* each loop starts with the previous loop's history, so they may differ (see vgmstream_do_loop) */
+    if (vgmstream->meta_type == meta_DSP_STD ||
+        vgmstream->meta_type == meta_DSP_RS03 ||
+        vgmstream->meta_type == meta_DSP_CSTR ||
+        (info->flags & CODEC_LOOP_HISTORY))
+        return 0;
+
+    return 1;
+}
+
+int vgmstream_enable_loop_cache(VGMSTREAM * vgmstream, size_t max_bytes) {
+    loop_cache_data * data;
+    int32_t loop_samples;
+
+    if (!vgmstream || !loop_cache_supported(vgmstream))
+        return 0;
+    if (vgmstream->loop_cache_data)
+        return 1;
+
+    if (max_bytes == 0)
+        max_bytes = LOOP_CACHE_DEFAULT_BYTES;
+    loop_samples = vgmstream->loop_end_sample - vgmstream->loop_start_sample;
+    if ((size_t)loop_samples > max_bytes / (vgmstream->channels * sizeof(sample)))
+        return 0;
+
+    data = vgm_calloc(1, sizeof(loop_cache_data));
+    if (!data) return 0;
+
+    data->loop_samples = loop_samples;
+    data->channels = vgmstream->channels;
+
+    vgmstream->loop_cache_data = data;
+    ((VGMSTREAM*)vgmstream->start_vgmstream)->loop_cache_data = data; /* so resets keep it */
+    return 1;
+}
+
+void reset_loop_cache(loop_cache_data * data) {
+    data->position = 0;
+}
+
+void free_loop_cache(loop_cache_data * data) {
+    if (!data) return;
+    vgm_free(data->buffer);
+    vgm_free(data);
+}
+
+/* at a loop end with another loop to play (as vgmstream_do_loop would do next) */
+static int is_loop_pending(VGMSTREAM * vgmstream) {
+    return vgmstream->loop_flag
+            && vgmstream->current_sample == vgmstream->loop_end_sample
+            && !(vgmstream->loop_target && vgmstream->loop_target == vgmstream->loop_count + 1);
+}
+
+static void record_loop(loop_cache_data * data, const sample * buffer, int32_t start, int32_t samples) {
+    if (data->recorded != start || data->recorded == data->loop_samples)
+        return; /* not contiguous (seeked into the loop) */
+
+    if (!data->buffer) {
+        data->buffer = vgm_malloc(data->loop_samples * data->channels * sizeof(sample));
+        if (!data->buffer) return;
+    }
+
+    memcpy(data->buffer + start * data->channels, buffer, samples * data->channels * sizeof(sample));
+    data->recorded += samples;
+}
+
+void render_loop_cache(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
+    loop_cache_data * data = vgmstream->loop_cache_data;
+    int32_t samples_done = 0;
+
+    while (samples_done < sample_count) {
+        sample * dst = buffer + samples_done * data->channels;
+        int32_t samples_to_do = sample_count - samples_done;
+        int32_t current_sample;
+        int loop_count;
+
+        /* copy loops after the saved one */
+        if (data->position == 0 && data->recorded == data->loop_samples
+                && vgmstream->loop_count >= 1 && is_loop_pending(vgmstream)) {
+            vgmstream->loop_count++;
+            if (samples_to_do > data->loop_samples)
+                samples_to_do = data->loop_samples;
+            memcpy(dst, data->buffer, samples_to_do * data->channels * sizeof(sample));
+            data->position = samples_to_do;
+        }
+        else if (data->position > 0) {
+            if (samples_to_do > data->loop_samples - data->position)
+                samples_to_do = data->loop_samples - data->position;
+            memcpy(dst, data->buffer + data->position * data->channels, samples_to_do * data->channels * sizeof(sample));
+            data->position += samples_to_do;
+        }
+        else {
+            /* decode up to the loop end, so loops happen between calls */
+            current_sample = vgmstream->current_sample;
+            loop_count = vgmstream->loop_count;
+            if (is_loop_pending(vgmstream)) {
+                current_sample = vgmstream->loop_start_sample;
+                loop_count++;
+            }
+            if (vgmstream->loop_flag && current_sample < vgmstream->loop_end_sample
+                    && samples_to_do > vgmstream->loop_end_sample - current_sample)
+                samples_to_do = vgmstream->loop_end_sample - current_sample;
+
+            render_vgmstream_layout(dst, samples_to_do, vgmstream);
+
+            if (loop_count == 1 && current_sample >= vgmstream->loop_start_sample)
+                record_loop(data, dst, current_sample - vgmstream->loop_start_sample, samples_to_do);
+        }
+
+        if (data->position == data->loop_samples)
+            data->position = 0; /* loop done, decoder is still waiting at the loop end */
+
+        samples_done += samples_to_do;
+    }
+}
+
+/* Decodes the part of the current loop that was copied, so the decoder is where the copy was. */
+void sync_loop_cache(VGMSTREAM * vgmstream) {
+    loop_cache_data * data = vgmstream->loop_cache_data;
+    sample temp[LOOP_CACHE_SYNC_SAMPLES];
+    int32_t samples_per_pass = LOOP_CACHE_SYNC_SAMPLES / data->channels;
+    int32_t samples_left = data->position;
+
+    if (data->position == 0)
+        return;
+
+    data->position = 0;
+    vgmstream->loop_count--; /* counted again when looping now */
+
+    while (samples_left > 0) {
+        int32_t samples_to_do = samples_left;
+        if (samples_to_do > samples_per_pass)
+            samples_to_do = samples_per_pass;
+
+        render_vgmstream_layout(temp, samples_to_do, vgmstream);
+        samples_left -= samples_to_do;
+    }
+}
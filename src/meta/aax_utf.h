@@ -117,13 +117,13 @@ static struct utf_query_result analyze_utf(STREAMFILE *infile, const long offset
 
     /* allocate for string table */
     string_table_size = table_info.data_offset-table_info.string_table_offset;
-    string_table = malloc(string_table_size+1);
+    string_table = vgm_malloc(string_table_size+1);
     if (!string_table) goto cleanup_error;
     table_info.string_table = string_table;
     memset(string_table, 0, string_table_size+1);
 
     /* load schema */
-    schema = malloc(sizeof(struct utf_column_info) * table_info.columns);
+    schema = vgm_malloc(sizeof(struct utf_column_info) * table_info.columns);
     if (!schema) goto cleanup_error;
 
     {
@@ -366,13 +366,13 @@ cleanup_error:
 
     if (string_table)
     {
-        free(string_table);
+        vgm_free(string_table);
         string_table = NULL;
     }
 
     if (schema)
     {
-        free(schema);
+        vgm_free(schema);
         schema = NULL;
     }
 
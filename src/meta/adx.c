@@ -313,14 +313,14 @@ static int find_adx_key(STREAMFILE *streamFile, uint8_t type, uint16_t *xor_star
 
         /* allocate storage for scales */
         scales_to_do = (bruteframe_count > MAX_TEST_FRAMES ? MAX_TEST_FRAMES : bruteframe_count);
-        scales = malloc(scales_to_do*sizeof(uint16_t));
+        scales = vgm_malloc(scales_to_do*sizeof(uint16_t));
         if (!scales) goto find_key_cleanup;
 
         /* prescales are those scales before the first frame we test
          * against, we use these to compute the actual start */
         if (bruteframe > 0) {
             /* allocate memory for the prescales */
-            prescales = malloc(bruteframe*sizeof(uint16_t));
+            prescales = vgm_malloc(bruteframe*sizeof(uint16_t));
             if (!prescales) goto find_key_cleanup;
 
             /* read the prescales */
@@ -422,7 +422,7 @@ static int find_adx_key(STREAMFILE *streamFile, uint8_t type, uint16_t *xor_star
     }
 
 find_key_cleanup:
-    free(scales);
-    free(prescales);
+    vgm_free(scales);
+    vgm_free(prescales);
     return rc;
 }
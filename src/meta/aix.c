@@ -39,9 +39,9 @@ VGMSTREAM * init_vgmstream_aix(STREAMFILE *streamFile) {
     layer_list_offset = segment_list_offset + segment_count*segment_list_entry_size + 0x10;
     if (layer_list_offset >= data_offset) goto fail;
 
-    segment_samples = calloc(segment_count,sizeof(int32_t));
+    segment_samples = vgm_calloc(segment_count,sizeof(int32_t));
     if (!segment_samples) goto fail;
-    segment_offset = calloc(segment_count,sizeof(off_t));
+    segment_offset = vgm_calloc(segment_count,sizeof(off_t));
     if (!segment_offset) goto fail;
 
     /* parse segments table */
@@ -105,15 +105,15 @@ VGMSTREAM * init_vgmstream_aix(STREAMFILE *streamFile) {
 
     /* init layout */
     {
-        data = malloc(sizeof(aix_codec_data));
+        data = vgm_malloc(sizeof(aix_codec_data));
         if (!data) goto fail;
 
         data->segment_count = segment_count;
         data->stream_count = layer_count;
-        data->adxs = calloc(segment_count * layer_count, sizeof(VGMSTREAM*));
+        data->adxs = vgm_calloc(segment_count * layer_count, sizeof(VGMSTREAM*));
         if (!data->adxs) goto fail;
 
-        data->sample_counts = calloc(segment_count,sizeof(int32_t));
+        data->sample_counts = vgm_calloc(segment_count,sizeof(int32_t));
         if (!data->sample_counts) goto fail;
 
         memcpy(data->sample_counts,segment_samples,segment_count*sizeof(int32_t));
@@ -171,16 +171,16 @@ VGMSTREAM * init_vgmstream_aix(STREAMFILE *streamFile) {
     data->current_segment = 0;
 
     vgmstream->codec_data = data;
-    free(segment_offset);
-    free(segment_samples);
+    vgm_free(segment_offset);
+    vgm_free(segment_samples);
 
     return vgmstream;
 
 fail:
     close_streamfile(streamFileAIX);
     close_vgmstream(vgmstream);
-    free(segment_samples);
-    free(segment_offset);
+    vgm_free(segment_samples);
+    vgm_free(segment_offset);
 
     /* free aix layout */
     if (data) {
@@ -189,12 +189,12 @@ fail:
             for (i = 0; i < data->segment_count*data->stream_count; i++) {
                 close_vgmstream(data->adxs[i]);
             }
-            free(data->adxs);
+            vgm_free(data->adxs);
         }
         if (data->sample_counts) {
-            free(data->sample_counts);
+            vgm_free(data->sample_counts);
         }
-        free(data);
+        vgm_free(data);
     }
     return NULL;
 }
@@ -107,7 +107,7 @@ static size_t read_aix(AIXSTREAMFILE *streamfile,uint8_t *dest,off_t offset,size
 }
 
 static void close_aix(AIXSTREAMFILE *streamfile) {
-    free(streamfile);
+    vgm_free(streamfile);
     return;
 }
 
@@ -129,7 +129,7 @@ static STREAMFILE *open_aix_impl(AIXSTREAMFILE *streamfile,const char * const fi
     if (strcmp(filename,"ARBITRARY.ADX"))
         return  NULL;
 
-    newfile = malloc(sizeof(AIXSTREAMFILE));
+    newfile = vgm_malloc(sizeof(AIXSTREAMFILE));
     if (!newfile)
         return NULL;
     memcpy(newfile,streamfile,sizeof(AIXSTREAMFILE));
@@ -137,7 +137,7 @@ static STREAMFILE *open_aix_impl(AIXSTREAMFILE *streamfile,const char * const fi
 }
 
 /*static*/ STREAMFILE *open_aix_with_STREAMFILE(STREAMFILE *file, off_t start_offset, int stream_id) {
-    AIXSTREAMFILE *streamfile = malloc(sizeof(AIXSTREAMFILE));
+    AIXSTREAMFILE *streamfile = vgm_malloc(sizeof(AIXSTREAMFILE));
 
     if (!streamfile)
         return NULL;
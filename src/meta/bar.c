@@ -66,12 +66,12 @@ VGMSTREAM * init_vgmstream_bar(STREAMFILE *streamFile) {
     }
 
     // discard our decrypt wrapper, without closing the original streamfile
-    free(streamFileBAR);
+    vgm_free(streamFileBAR);
 
     return vgmstream;
 fail:
     if (streamFileBAR)
-        free(streamFileBAR);
+        vgm_free(streamFileBAR);
     if (vgmstream) close_vgmstream(vgmstream);
     return NULL;
 }
@@ -54,13 +54,13 @@ STREAMFILE *open_bar(BARSTREAMFILE *streamFile, const char * const filename, siz
 
 static void close_bar(BARSTREAMFILE *streamFile) {
     streamFile->real_file->close(streamFile->real_file);
-    free(streamFile);
+    vgm_free(streamFile);
     return;
 }
 
 
 /*static*/ STREAMFILE *wrap_bar_STREAMFILE(STREAMFILE *file) {
-    BARSTREAMFILE *streamfile = malloc(sizeof(BARSTREAMFILE));
+    BARSTREAMFILE *streamfile = vgm_malloc(sizeof(BARSTREAMFILE));
 
     if (!streamfile)
         return NULL;
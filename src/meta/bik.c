@@ -96,7 +96,7 @@ static int bink_get_info(STREAMFILE *streamFile, int target_subsong, int * out_t
 
 
     /* read frame offsets in a buffer, to avoid fseeking to the table back and forth */
-    offsets = malloc(sizeof(uint32_t) * num_frames);
+    offsets = vgm_malloc(sizeof(uint32_t) * num_frames);
     if (!offsets) goto fail;
 
     for (i=0; i < num_frames; i++) {
@@ -129,7 +129,7 @@ static int bink_get_info(STREAMFILE *streamFile, int target_subsong, int * out_t
         }
     }
 
-    free(offsets);
+    vgm_free(offsets);
 
 
     if (out_total_subsongs) *out_total_subsongs = total_subsongs;
@@ -142,6 +142,6 @@ static int bink_get_info(STREAMFILE *streamFile, int target_subsong, int * out_t
     return 1;
 
 fail:
-    free(offsets);
+    vgm_free(offsets);
     return 0;
 }
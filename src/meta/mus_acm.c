@@ -226,11 +226,11 @@ static char** parse_mus(STREAMFILE *streamFile, int *out_file_count, int *out_lo
     if (*end_ptr != '\0') goto fail;
 
     /* set names */
-    names = calloc(file_count,sizeof(char*)); /* array of strings (size NAME_LENGTH) */
+    names = vgm_calloc(file_count,sizeof(char*)); /* array of strings (size NAME_LENGTH) */
     if (!names) goto fail;
 
     for (i = 0; i < file_count; i++) {
-        names[i] = calloc(1,sizeof(char)*NAME_LENGTH);
+        names[i] = vgm_calloc(1,sizeof(char)*NAME_LENGTH);
         if (!names[i]) goto fail;
     }
 
@@ -375,7 +375,7 @@ static void clean_mus(char** mus_filenames, int file_count) {
     if (!mus_filenames) return;
 
     for (i = 0; i < file_count; i++) {
-        free(mus_filenames[i]);
+        vgm_free(mus_filenames[i]);
     }
-    free(mus_filenames);
+    vgm_free(mus_filenames);
 }
@@ -284,7 +284,7 @@ static nwa_codec_data *open_nwa_vgmstream(STREAMFILE *streamFile) {
 
     streamFile->get_name(streamFile,filename,sizeof(filename));
 
-    data = malloc(sizeof(nwa_codec_data));
+    data = vgm_malloc(sizeof(nwa_codec_data));
     if (!data) goto fail;
 
     data->nwa = open_nwa(streamFile,filename);
@@ -302,6 +302,6 @@ static void free_nwa_vgmstream(nwa_codec_data *data) {
         if (data->nwa) {
             close_nwa(data->nwa);
         }
-        free(data);
+        vgm_free(data);
     }
 }
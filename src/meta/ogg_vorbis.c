@@ -492,7 +492,7 @@ VGMSTREAM * init_vgmstream_ogg_vorbis_callbacks(STREAMFILE *streamFile, ov_callb
     {
         char filename[PATH_LIMIT];
 
-        data = calloc(1,sizeof(ogg_vorbis_codec_data));
+        data = vgm_calloc(1,sizeof(ogg_vorbis_codec_data));
         if (!data) goto fail;
 
         streamFile->get_name(streamFile,filename,sizeof(filename));
@@ -643,7 +643,7 @@ fail:
             ov_clear(&data->ogg_vorbis_file);//same as ovf
         if (data->ov_streamfile.streamfile)
             close_streamfile(data->ov_streamfile.streamfile);
-        free(data);
+        vgm_free(data);
     }
     if (vgmstream) {
         vgmstream->codec_data = NULL;
@@ -37,10 +37,10 @@ static void parse_adtl(off_t adtl_offset, off_t adtl_length, STREAMFILE  *stream
 
         switch(chunk_type) {
             case 0x6c61626c: { /* "labl" */
-                unsigned char *labelcontent = malloc(chunk_size-0x04);
+                unsigned char *labelcontent = vgm_malloc(chunk_size-0x04);
                 if (!labelcontent) return;
                 if (read_streamfile(labelcontent,current_chunk+0x0c, chunk_size-0x04,streamFile) != chunk_size-0x04) {
-                    free(labelcontent);
+                    vgm_free(labelcontent);
                     return;
                 }
 
@@ -57,7 +57,7 @@ static void parse_adtl(off_t adtl_offset, off_t adtl_length, STREAMFILE  *stream
                         break;
                 }
 
-                free(labelcontent);
+                vgm_free(labelcontent);
                 break;
             }
             default:
@@ -485,6 +485,7 @@ VGMSTREAM * init_vgmstream_riff(STREAMFILE *streamFile) {
     if (!vgmstream) goto fail;
 
     vgmstream->sample_rate = fmt.sample_rate;
+    vgmstream->coding_type = fmt.coding_type; /* early, so codec allocations are freed on fail */
 
     /* init, samples */
     switch (fmt.coding_type) {
@@ -513,6 +514,9 @@ VGMSTREAM * init_vgmstream_riff(STREAMFILE *streamFile) {
                     goto fail;
 
                 for (ch = 0; ch < fmt.channel_count; ch++) {
+                    vgmstream->ch[ch].adpcm_coef_3by32 = vgm_calloc(0x60, sizeof(int32_t));
+                    if (!vgmstream->ch[ch].adpcm_coef_3by32) goto fail;
+
                     for (i = 0; i < filter_count * filter_order; i++) {
                         int coef = read_32bitLE(mwv_pflt_offset+0x10+i*0x04, streamFile);
                         vgmstream->ch[ch].adpcm_coef_3by32[i] = coef;
@@ -609,8 +613,7 @@ VGMSTREAM * init_vgmstream_riff(STREAMFILE *streamFile) {
             goto fail;
     }
 
-    /* coding, layout, interleave */
-    vgmstream->coding_type = fmt.coding_type;
+    /* layout, interleave */
     switch (fmt.coding_type) {
         case coding_MSADPCM:
         case coding_MS_IMA:
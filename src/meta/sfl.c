@@ -146,10 +146,10 @@ static void parse_adtl(off_t adtl_offset, off_t adtl_length, STREAMFILE  *stream
 
         switch(chunk_type) {
             case 0x6c61626c: { /* "labl" */
-                unsigned char *labelcontent = malloc(chunk_size-0x04);
+                unsigned char *labelcontent = vgm_malloc(chunk_size-0x04);
                 if (!labelcontent) return;
                 if (read_streamfile(labelcontent,current_chunk+0x0c, chunk_size-0x04,streamFile) != chunk_size-0x04) {
-                    free(labelcontent);
+                    vgm_free(labelcontent);
                     return;
                 }
 
@@ -172,7 +172,7 @@ static void parse_adtl(off_t adtl_offset, off_t adtl_length, STREAMFILE  *stream
                         break;
                 }
 
-                free(labelcontent);
+                vgm_free(labelcontent);
                 break;
             }
             default:
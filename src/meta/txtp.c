@@ -387,7 +387,7 @@ static int add_filename(txtp_header * txtp, char *filename) {
             txtp_entry *temp_entry;
 
             txtp->entry_max += 5;
-            temp_entry = realloc(txtp->entry, sizeof(txtp_entry) * txtp->entry_max);
+            temp_entry = vgm_realloc(txtp->entry, sizeof(txtp_entry) * txtp->entry_max);
             if (!temp_entry) goto fail;
             txtp->entry = temp_entry;
         }
@@ -467,7 +467,7 @@ static txtp_header* parse_txtp(STREAMFILE* streamFile) {
     off_t file_size = get_streamfile_size(streamFile);
 
 
-    txtp = calloc(1,sizeof(txtp_header));
+    txtp = vgm_calloc(1,sizeof(txtp_header));
     if (!txtp) goto fail;
 
 
@@ -536,6 +536,6 @@ static void clean_txtp(txtp_header* txtp) {
     if (!txtp)
         return;
 
-    free(txtp->entry);
-    free(txtp);
+    vgm_free(txtp->entry);
+    vgm_free(txtp);
 }
@@ -764,10 +764,10 @@ static int get_xsb_name(char * buf, size_t maxsize, int target_subsong, xwb_head
 
 
     /* init stuff */
-    xsb.xsb_sounds = calloc(xsb.xsb_sounds_count, sizeof(xsb_sound));
+    xsb.xsb_sounds = vgm_calloc(xsb.xsb_sounds_count, sizeof(xsb_sound));
     if (!xsb.xsb_sounds) goto fail;
 
-    xsb.xsb_wavebanks = calloc(xsb.xsb_wavebanks_count, sizeof(xsb_wavebank));
+    xsb.xsb_wavebanks = vgm_calloc(xsb.xsb_wavebanks_count, sizeof(xsb_wavebank));
     if (!xsb.xsb_wavebanks) goto fail;
 
     /* The following is a bizarre soup of flags, tables, offsets to offsets and stuff, just to get the actual name.
@@ -960,8 +960,8 @@ static int get_xsb_name(char * buf, size_t maxsize, int target_subsong, xwb_head
     //return; /* no return, let free */
 
 fail:
-    free(xsb.xsb_sounds);
-    free(xsb.xsb_wavebanks);
+    vgm_free(xsb.xsb_sounds);
+    vgm_free(xsb.xsb_wavebanks);
     close_streamfile(streamFile);
 
     return (name_offset);
@@ -0,0 +1,247 @@
+#include <stdlib.h>
+#include <string.h>
+#include "vgmstream.h"
+
+/* Play config: the final length (loops plus fade, or the stream end) and fade out are applied when
+ * rendering, so players just render until vgmstream_get_play_samples.
+ *
+ * The fade is a linear gain ramp from 1.0 to 0.0 over the last fade samples, same as players used to
+ * do, but in fixed point: gain starts at samples_left * step and goes down by step each sample. */
+
+#define FADE_SHIFT  47                              /* gain precision, so sample * gain fits in 64 bits */
+#define FADE_ONE    ((int64_t)1 << FADE_SHIFT)
+
+struct play_config_data {
+    int32_t play_samples;       /* final length */
+    int32_t fade_samples;       /* last samples of the length that fade out (0 = no fade) */
+    int64_t fade_step;          /* gain change per sample */
+    int play_forever;           /* no end or fade (loops endlessly) */
+    int32_t position;           /* samples rendered (in the play timeline) */
+};
+
+
+static play_config_data * get_play_config_data(VGMSTREAM * vgmstream) {
+    play_config_data * data = vgmstream->play_config_data;
+
+    if (data)
+        return data;
+
+    data = vgm_calloc(1, sizeof(play_config_data));
+    if (!data) return NULL;
+
+    vgmstream->play_config_data = data;
+    ((VGMSTREAM*)vgmstream->start_vgmstream)->play_config_data = data; /* so resets keep it */
+    return data;
+}
+
+int vgmstream_set_play_config(VGMSTREAM * vgmstream, const vgmstream_play_config * config) {
+    play_config_data * data;
+    vgmstream_play_config cfg;
+
+    if (!vgmstream || !config)
+        return 0;
+    data = get_play_config_data(vgmstream);
+    if (!data) return 0;
+
+    cfg = *config;
+
+    /* honor suggested config, if any (defined order matters)
+     * note that ignore_fade and play_forever should take priority */
+    if (vgmstream->config_loop_count) {
+        cfg.loop_count = vgmstream->config_loop_count;
+    }
+    if (vgmstream->config_fade_delay) {
+        cfg.fade_delay = vgmstream->config_fade_delay;
+    }
+    if (vgmstream->config_fade_time) {
+        cfg.fade_time = vgmstream->config_fade_time;
+    }
+    if (vgmstream->config_force_loop) {
+        cfg.really_force_loop = 1;
+    }
+    if (vgmstream->config_ignore_loop) {
+        cfg.ignore_loop = 1;
+    }
+    if (vgmstream->config_ignore_fade) {
+        cfg.ignore_fade = 1;
+    }
+
+    /* remove non-compatible options */
+    if (cfg.play_forever) {
+        cfg.ignore_fade = 0;
+        cfg.ignore_loop = 0;
+    }
+    if (cfg.fade_time < 0)
+        cfg.fade_time = 0;
+
+    /* change vgmstream's loop stuff (ignore loop goes last) */
+    if (cfg.force_loop && !vgmstream->loop_flag) {
+        vgmstream_force_loop(vgmstream, 1, 0,vgmstream->num_samples);
+    }
+    if (cfg.really_force_loop) {
+        vgmstream_force_loop(vgmstream, 1, 0,vgmstream->num_samples);
+    }
+    if (cfg.ignore_loop) {
+        vgmstream_force_loop(vgmstream, 0, 0,0);
+    }
+
+    /* loop N times, but also play stream end instead of fading out */
+    if (cfg.loop_count > 0 && cfg.ignore_fade) {
+        vgmstream_set_loop_target(vgmstream, (int)cfg.loop_count);
+        cfg.fade_time = 0;
+    }
+    else {
+        vgmstream_set_loop_target(vgmstream, 0);
+    }
+
+    data->play_samples = get_vgmstream_play_samples(cfg.loop_count, cfg.fade_time, cfg.fade_delay, vgmstream);
+    data->fade_samples = 0;
+    data->fade_step = 0;
+    if (vgmstream->loop_flag && cfg.fade_time > 0) {
+        data->fade_samples = (int32_t)(cfg.fade_time * vgmstream->sample_rate);
+        if (data->fade_samples > 0)
+            data->fade_step = (FADE_ONE + data->fade_samples / 2) / data->fade_samples;
+    }
+    data->play_forever = cfg.play_forever && vgmstream->loop_flag;
+    data->position = 0;
+
+    return 1;
+}
+
+int32_t vgmstream_get_play_samples(VGMSTREAM * vgmstream) {
+    play_config_data * data;
+
+    if (!vgmstream) return 0;
+    data = vgmstream->play_config_data;
+    if (!data)
+        return vgmstream->num_samples;
+    return data->play_samples;
+}
+
+int32_t vgmstream_get_play_position(VGMSTREAM * vgmstream) {
+    play_config_data * data;
+
+    if (!vgmstream) return 0;
+    data = vgmstream->play_config_data;
+    if (!data)
+        return vgmstream->current_sample;
+    return data->position;
+}
+
+void vgmstream_set_play_forever(VGMSTREAM * vgmstream, int play_forever) {
+    play_config_data * data;
+
+    if (!vgmstream) return;
+    data = vgmstream->play_config_data;
+    if (!data) return;
+
+    play_forever = play_forever && vgmstream->loop_flag;
+
+    /* if already past where the fade starts, fade from here instead of ending (or jumping into the fade) */
+    if (data->play_forever && !play_forever && data->position > data->play_samples - data->fade_samples)
+        data->play_samples = data->position + data->fade_samples;
+
+    data->play_forever = play_forever;
+}
+
+
+void reset_play_config(play_config_data * data) {
+    data->position = 0;
+}
+
+void free_play_config(play_config_data * data) {
+    vgm_free(data);
+}
+
+int32_t clamp_play_config_seek(play_config_data * data, int32_t seek_sample) {
+    if (!data->play_forever && seek_sample > data->play_samples)
+        seek_sample = data->play_samples;
+    return seek_sample;
+}
+
+void seek_play_config(play_config_data * data, int32_t seek_sample) {
+    data->position = seek_sample;
+}
+
+
+/* first sample of buffer that fades (or count if none) */
+static int32_t get_fade_start(play_config_data * data, int32_t position, int32_t count) {
+    int32_t fade_start;
+
+    if (data->fade_samples <= 0 || data->play_forever)
+        return count;
+
+    /* gain is samples_left / fade_samples, so under 1.0 once less than fade_samples are left */
+    fade_start = data->play_samples - data->fade_samples + 1 - position;
+    if (fade_start < 0)
+        fade_start = 0;
+    if (fade_start > count)
+        fade_start = count;
+    return fade_start;
+}
+
+static void apply_fade(play_config_data * data, sample * buffer, int channels, int32_t position, int32_t count) {
+    int32_t s = get_fade_start(data, position, count);
+    int64_t gain = (int64_t)(data->play_samples - (position + s)) * data->fade_step;
+    sample * buf = buffer + s * channels;
+    int ch;
+
+    for (; s < count; s++) {
+        for (ch = 0; ch < channels; ch++) {
+            int64_t val = (int64_t)buf[ch] * gain;
+            if (val < 0)
+                val += FADE_ONE - 1; /* truncate towards zero, like casting a float */
+            buf[ch] = (sample)(val >> FADE_SHIFT);
+        }
+        buf += channels;
+        gain -= data->fade_step;
+    }
+}
+
+static void apply_fade_f32(play_config_data * data, float * buffer, int channels, int32_t position, int32_t count) {
+    int32_t s = get_fade_start(data, position, count);
+    int64_t gain = (int64_t)(data->play_samples - (position + s)) * data->fade_step;
+    float * buf = buffer + s * channels;
+    int ch;
+
+    for (; s < count; s++) {
+        float gain_f = (float)((double)gain / FADE_ONE);
+        for (ch = 0; ch < channels; ch++) {
+            buf[ch] = buf[ch] * gain_f;
+        }
+        buf += channels;
+        gain -= data->fade_step;
+    }
+}
+
+/* Renders up to the play length (silence after it), applying the fade. Uses buffer or buffer_f if float. */
+void render_play_config(sample * buffer, float * buffer_f, int32_t sample_count, VGMSTREAM * vgmstream) {
+    play_config_data * data = vgmstream->play_config_data;
+    int channels = vgmstream->channels;
+    int32_t samples_to_do = sample_count;
+
+    if (!data->play_forever) {
+        samples_to_do = data->play_samples - data->position;
+        if (samples_to_do < 0)
+            samples_to_do = 0;
+        if (samples_to_do > sample_count)
+            samples_to_do = sample_count;
+    }
+
+    if (buffer_f) {
+        render_vgmstream_f32_main(buffer_f, samples_to_do, vgmstream);
+        apply_fade_f32(data, buffer_f, channels, data->position, samples_to_do);
+        memset(buffer_f + samples_to_do * channels, 0, (sample_count - samples_to_do) * channels * sizeof(float));
+    }
+    else {
+        render_vgmstream_main(buffer, samples_to_do, vgmstream);
+        apply_fade(data, buffer, channels, data->position, samples_to_do);
+        memset(buffer + samples_to_do * channels, 0, (sample_count - samples_to_do) * channels * sizeof(sample));
+    }
+
+    /* keeps counting past the length while looping forever (stops at the max, many hours later) */
+    if (data->position > INT32_MAX - samples_to_do)
+        data->position = INT32_MAX;
+    else
+        data->position += samples_to_do;
+}
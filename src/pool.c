@@ -0,0 +1,351 @@
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "vgmstream.h"
+#include "layout/layout.h"
+#include "threads.h"
+
+/* Pool of closed streams, so files opened often don't need to be parsed again. Streams from the pool
+ * keep an entry while open (so close knows their key), and become idle when closed. Settings done
+ * after opening are undone when closing, so the next opener gets the stream as parsed.
+ *
+ * Players may open files from several threads (ex. playlist info vs playback), so entries are locked
+ * (streams themselves are used by one thread at a time, and only the pool is shared). The pool's own
+ * memory is allocated outside any stream's scope.
+ *
+ * Changed files are noticed by size and modification time (if the name can be stat'd). */
+
+#define POOL_DEFAULT_COUNT  16
+
+typedef struct {
+    VGMSTREAM * vgmstream;
+    char * filename;
+    int stream_index;
+    size_t file_size;
+    time_t file_time;
+    size_t bytes;               /* memory used by the stream when closed */
+    uint32_t last_used;         /* for LRU eviction */
+    int idle;
+
+    /* settings when opened */
+    int loop_flag;
+    int32_t loop_start_sample;
+    int32_t loop_end_sample;
+    int loop_target;
+    size_t alloc_limit;
+} pool_entry;
+
+struct vgmstream_pool {
+    vgm_mutex * lock;
+    pool_entry * entries;
+    int entry_count;
+    int entry_max;
+
+    int max_count;
+    size_t max_bytes;
+    uint32_t tick;
+    int released;               /* freed by the user, waiting for open streams */
+
+    vgmstream_pool_stats stats;
+};
+
+
+vgmstream_pool * vgmstream_pool_init(int max_count, size_t max_bytes) {
+    vgmstream_pool * pool;
+    vgm_alloc_scope * previous = vgm_alloc_scope_enter(NULL);
+
+    pool = vgm_calloc(1, sizeof(vgmstream_pool));
+    vgm_alloc_scope_leave(previous);
+    if (!pool) return NULL;
+
+    pool->lock = vgm_mutex_new();
+    if (!pool->lock) {
+        vgm_free(pool);
+        return NULL;
+    }
+
+    pool->max_count = max_count > 0 ? max_count : POOL_DEFAULT_COUNT;
+    pool->max_bytes = max_bytes;
+    return pool;
+}
+
+static void remove_entry(vgmstream_pool * pool, int index) {
+    pool_entry * entry = &pool->entries[index];
+
+    if (entry->idle) {
+        pool->stats.idle_count--;
+        pool->stats.idle_bytes -= entry->bytes;
+    }
+    vgm_free(entry->filename);
+
+    pool->entry_count--;
+    if (index != pool->entry_count)
+        *entry = pool->entries[pool->entry_count];
+}
+
+static void close_entry(vgmstream_pool * pool, int index) {
+    VGMSTREAM * vgmstream = pool->entries[index].vgmstream;
+
+    remove_entry(pool, index);
+
+    vgmstream->pool = NULL;
+    close_vgmstream(vgmstream);
+}
+
+static void free_pool(vgmstream_pool * pool) {
+    vgm_mutex_free(pool->lock);
+    vgm_free(pool->entries);
+    vgm_free(pool);
+}
+
+void vgmstream_pool_free(vgmstream_pool * pool) {
+    int i;
+    if (!pool) return;
+
+    vgm_mutex_lock(pool->lock);
+    for (i = pool->entry_count - 1; i >= 0; i--) {
+        if (pool->entries[i].idle)
+            close_entry(pool, i);
+    }
+
+    if (pool->entry_count == 0) {
+        vgm_mutex_unlock(pool->lock);
+        free_pool(pool);
+        return;
+    }
+    pool->released = 1; /* last open stream frees it */
+    vgm_mutex_unlock(pool->lock);
+}
+
+/* closes least recently used idle streams until under the limits */
+static void evict_entries(vgmstream_pool * pool) {
+    while (pool->stats.idle_count > pool->max_count
+            || (pool->max_bytes && pool->stats.idle_bytes > pool->max_bytes)) {
+        int i, oldest = -1;
+
+        for (i = 0; i < pool->entry_count; i++) {
+            if (!pool->entries[i].idle)
+                continue;
+            if (oldest < 0 || (int32_t)(pool->entries[i].last_used - pool->entries[oldest].last_used) < 0)
+                oldest = i;
+        }
+        if (oldest < 0)
+            break;
+
+        close_entry(pool, oldest);
+        pool->stats.evictions++;
+    }
+}
+
+static int find_entry(vgmstream_pool * pool, VGMSTREAM * vgmstream) {
+    int i;
+    for (i = 0; i < pool->entry_count; i++) {
+        if (pool->entries[i].vgmstream == vgmstream)
+            return i;
+    }
+    return -1;
+}
+
+/* layers render in this thread and segments aren't prepared ahead (as set up when opened) */
+static void reset_layout_config(VGMSTREAM * vgmstream) {
+    int i;
+
+    if (vgmstream->layout_type == layout_layered) {
+        layered_layout_data *data = vgmstream->layout_data;
+        config_layout_layered(data, 0, 0);
+        for (i = 0; i < data->layer_count; i++) {
+            reset_layout_config(data->layers[i]);
+        }
+    }
+    else if (vgmstream->layout_type == layout_segmented) {
+        segmented_layout_data *data = vgmstream->layout_data;
+        config_layout_segmented(data, 0);
+        memset(&data->stats, 0, sizeof(data->stats));
+        for (i = 0; i < data->segment_count; i++) {
+            reset_layout_config(data->segments[i]);
+        }
+    }
+}
+
+/* undoes what was set after opening (kept in the start state so far, as resets must keep them) */
+static void restore_settings(VGMSTREAM * vgmstream, const pool_entry * entry) {
+    VGMSTREAM * start_vgmstream = vgmstream->start_vgmstream;
+    vgm_alloc_scope * previous = vgm_alloc_scope_enter(vgmstream->alloc_scope);
+
+    if (start_vgmstream->loop_flag != entry->loop_flag
+            || start_vgmstream->loop_start_sample != entry->loop_start_sample
+            || start_vgmstream->loop_end_sample != entry->loop_end_sample) {
+        vgmstream_force_loop(vgmstream, entry->loop_flag, entry->loop_start_sample, entry->loop_end_sample);
+    }
+    vgmstream_set_loop_target(vgmstream, entry->loop_target);
+
+    free_play_config(start_vgmstream->play_config_data);
+    free_loop_cache(start_vgmstream->loop_cache_data);
+    free_checkpoints(start_vgmstream->checkpoint_data);
+    free_block_index(start_vgmstream->block_index_data);
+    start_vgmstream->play_config_data = vgmstream->play_config_data = NULL;
+    start_vgmstream->loop_cache_data = vgmstream->loop_cache_data = NULL;
+    start_vgmstream->checkpoint_data = vgmstream->checkpoint_data = NULL;
+    start_vgmstream->block_index_data = vgmstream->block_index_data = NULL;
+
+    reset_layout_config(vgmstream);
+
+    vgm_alloc_scope_set_limit(vgmstream->alloc_scope, entry->alloc_limit);
+    vgm_alloc_scope_leave(previous);
+}
+
+int recycle_vgmstream(VGMSTREAM * vgmstream) {
+    vgmstream_pool * pool = vgmstream->pool;
+    pool_entry * entry;
+    vgmstream_alloc_stats alloc_stats;
+    int index;
+
+    vgm_mutex_lock(pool->lock);
+    index = find_entry(pool, vgmstream);
+    if (index < 0 || pool->released) {
+        int free_unused;
+
+        if (index >= 0)
+            remove_entry(pool, index);
+        vgmstream->pool = NULL;
+        free_unused = pool->released && pool->entry_count == 0;
+        vgm_mutex_unlock(pool->lock);
+        if (free_unused)
+            free_pool(pool);
+        return 0;
+    }
+
+    entry = &pool->entries[index];
+    restore_settings(vgmstream, entry);
+    vgmstream_get_alloc_stats(vgmstream, &alloc_stats);
+    entry->bytes = alloc_stats.current_bytes;
+    entry->last_used = pool->tick++;
+    entry->idle = 1;
+    pool->stats.idle_count++;
+    pool->stats.idle_bytes += entry->bytes;
+
+    evict_entries(pool);
+    vgm_mutex_unlock(pool->lock);
+    return 1;
+}
+
+/* 0 if unknown (names of custom STREAMFILEs may not be paths) */
+static time_t get_file_time(const char * filename) {
+    struct stat st;
+    if (stat(filename, &st) != 0)
+        return 0;
+    return st.st_mtime;
+}
+
+/* lock must be held, and no scope entered */
+static int add_entry(vgmstream_pool * pool, VGMSTREAM * vgmstream, const char * filename, size_t file_size, time_t file_time, int stream_index) {
+    pool_entry * entry;
+    vgmstream_alloc_stats alloc_stats;
+    size_t filename_size = strlen(filename) + 1;
+
+    if (pool->entry_count == pool->entry_max) {
+        int entry_max = pool->entry_max ? pool->entry_max * 2 : pool->max_count;
+        pool_entry * entries = vgm_realloc(pool->entries, entry_max * sizeof(pool_entry));
+        if (!entries) return 0;
+
+        pool->entries = entries;
+        pool->entry_max = entry_max;
+    }
+
+    entry = &pool->entries[pool->entry_count];
+    memset(entry, 0, sizeof(pool_entry));
+    entry->filename = vgm_malloc(filename_size);
+    if (!entry->filename) return 0;
+    memcpy(entry->filename, filename, filename_size);
+
+    entry->vgmstream = vgmstream;
+    entry->stream_index = stream_index;
+    entry->file_size = file_size;
+    entry->file_time = file_time;
+    entry->loop_flag = vgmstream->loop_flag;
+    entry->loop_start_sample = vgmstream->loop_start_sample;
+    entry->loop_end_sample = vgmstream->loop_end_sample;
+    entry->loop_target = vgmstream->loop_target;
+    vgmstream_get_alloc_stats(vgmstream, &alloc_stats);
+    entry->alloc_limit = alloc_stats.max_bytes;
+    pool->entry_count++;
+
+    vgmstream->pool = pool;
+    ((VGMSTREAM*)vgmstream->start_vgmstream)->pool = pool; /* so resets keep it */
+    return 1;
+}
+
+VGMSTREAM * init_vgmstream_from_pool(vgmstream_pool * pool, STREAMFILE *streamFile) {
+    char filename[PATH_LIMIT];
+    size_t file_size;
+    time_t file_time;
+    VGMSTREAM * vgmstream;
+    vgm_alloc_scope * previous;
+    int i;
+
+    if (!pool)
+        return init_vgmstream_from_STREAMFILE(streamFile);
+    if (!streamFile)
+        return NULL;
+
+    streamFile->get_name(streamFile, filename, sizeof(filename));
+    file_size = streamFile->get_size(streamFile);
+    file_time = get_file_time(filename);
+
+    vgm_mutex_lock(pool->lock);
+    for (i = 0; i < pool->entry_count; i++) {
+        pool_entry * entry = &pool->entries[i];
+
+        if (!entry->idle || entry->stream_index != streamFile->stream_index || strcmp(entry->filename, filename) != 0)
+            continue;
+
+        /* file changed since */
+        if (entry->file_size != file_size || entry->file_time != file_time) {
+            close_entry(pool, i);
+            i--;
+            continue;
+        }
+
+        entry->idle = 0;
+        pool->stats.idle_count--;
+        pool->stats.idle_bytes -= entry->bytes;
+        pool->stats.hits++;
+        vgmstream = entry->vgmstream;
+        vgm_mutex_unlock(pool->lock);
+
+        reset_vgmstream(vgmstream); /* only the caller has it now */
+        return vgmstream;
+    }
+    pool->stats.misses++;
+    vgm_mutex_unlock(pool->lock);
+
+    /* parsed unlocked, so other files can be opened meanwhile */
+    vgmstream = init_vgmstream_from_STREAMFILE(streamFile);
+    if (!vgmstream) return NULL;
+
+    previous = vgm_alloc_scope_enter(NULL);
+    vgm_mutex_lock(pool->lock);
+    if (!pool->released)
+        add_entry(pool, vgmstream, filename, file_size, file_time, streamFile->stream_index); /* if it fails it's just not pooled */
+    vgm_mutex_unlock(pool->lock);
+    vgm_alloc_scope_leave(previous);
+    return vgmstream;
+}
+
+void vgmstream_pool_flush(vgmstream_pool * pool, const char * filename) {
+    int i;
+    if (!pool) return;
+
+    vgm_mutex_lock(pool->lock);
+    for (i = pool->entry_count - 1; i >= 0; i--) {
+        if (pool->entries[i].idle && (!filename || strcmp(pool->entries[i].filename, filename) == 0))
+            close_entry(pool, i);
+    }
+    vgm_mutex_unlock(pool->lock);
+}
+
+void vgmstream_get_pool_stats(vgmstream_pool * pool, vgmstream_pool_stats * stats) {
+    if (!pool || !stats) return;
+    vgm_mutex_lock(pool->lock);
+    *stats = pool->stats;
+    vgm_mutex_unlock(pool->lock);
+}
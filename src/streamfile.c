@@ -4,13 +4,23 @@
 #include "streamfile.h"
 #include "util.h"
 #include "vgmstream.h"
+#include "threads.h"
 
 
+/* dup'd FILEs share the file position with the original, so seek+read must be done at once in case
+ * they are read from other threads. Only those get a lock (shared by the original and its dups).
+ * Uses malloc as the original may outlive the (format probe) alloc scope that dup'd it. */
+typedef struct {
+    vgm_mutex * lock;
+    int refs;               /* guarded by lock */
+} stdio_shared_t;
+
 /* a STREAMFILE that operates via standard IO using a buffer */
 typedef struct {
     STREAMFILE sf;          /* callbacks */
 
     FILE * infile;          /* actual FILE */
+    stdio_shared_t * shared; /* set once the FILE is dup'd */
     char name[PATH_LIMIT];  /* FILE filename */
     off_t offset;           /* last read offset (info) */
     off_t buffer_offset;    /* current buffer data start */
@@ -58,7 +68,11 @@ static size_t read_stdio(STDIOSTREAMFILE *streamfile,uint8_t * dest, off_t offse
         }
 
         /* position to new offset */
+        if (streamfile->shared)
+            vgm_mutex_lock(streamfile->shared->lock);
         if (fseeko(streamfile->infile,offset,SEEK_SET)) {
+            if (streamfile->shared)
+                vgm_mutex_unlock(streamfile->shared->lock);
             break; /* this shouldn't happen in our code */
         }
 
@@ -73,6 +87,8 @@ static size_t read_stdio(STDIOSTREAMFILE *streamfile,uint8_t * dest, off_t offse
         /* fill the buffer (offset now is beyond buffer_offset) */
         streamfile->buffer_offset = offset;
         streamfile->validsize = fread(streamfile->buffer,sizeof(uint8_t),streamfile->buffersize,streamfile->infile);
+        if (streamfile->shared)
+            vgm_mutex_unlock(streamfile->shared->lock);
 
         /* decide how much must be read this time */
         if (length > streamfile->buffersize)
@@ -110,10 +126,46 @@ static void get_name_stdio(STDIOSTREAMFILE *streamfile,char *buffer,size_t lengt
     buffer[length-1]='\0';
 }
 static void close_stdio(STDIOSTREAMFILE * streamfile) {
+    if (streamfile->shared) {
+        stdio_shared_t * shared = streamfile->shared;
+        int refs;
+
+        vgm_mutex_lock(shared->lock);
+        refs = --shared->refs;
+        vgm_mutex_unlock(shared->lock);
+        if (refs == 0) {
+            vgm_mutex_free(shared->lock);
+            free(shared);
+        }
+    }
     fclose(streamfile->infile);
-    free(streamfile->buffer);
-    free(streamfile);
+    vgm_free(streamfile->buffer);
+    vgm_free(streamfile);
+}
+
+#if !defined (__ANDROID__)
+/* Sets the lock the FILE and its dups will share. Returns 0 on failure (then the file must be
+ * opened again rather than dup'd). */
+static int share_stdio(STDIOSTREAMFILE * streamfile) {
+    stdio_shared_t * shared;
+
+    if (streamfile->shared)
+        return 1;
+
+    shared = calloc(1, sizeof(stdio_shared_t));
+    if (!shared) return 0;
+
+    shared->lock = vgm_mutex_new();
+    if (!shared->lock) {
+        free(shared);
+        return 0;
+    }
+
+    shared->refs = 1;
+    streamfile->shared = shared;
+    return 1;
 }
+#endif
 
 static STREAMFILE *open_stdio(STDIOSTREAMFILE *streamFile,const char * const filename,size_t buffersize) {
     int newfd;
@@ -124,11 +176,19 @@ static STREAMFILE *open_stdio(STDIOSTREAMFILE *streamFile,const char * const fil
         return NULL;
 #if !defined (__ANDROID__)
     // if same name, duplicate the file pointer we already have open
-    if (!strcmp(streamFile->name,filename)) {
+    if (!strcmp(streamFile->name,filename) && share_stdio(streamFile)) {
         if (((newfd = dup(fileno(streamFile->infile))) >= 0) &&
             (newfile = fdopen( newfd, "rb" ))) 
         {
+            /* opening seeks to get the size, so it's done with the lock too */
+            vgm_mutex_lock(streamFile->shared->lock);
             newstreamFile = open_stdio_streamfile_buffer_by_file(newfile,filename,buffersize);
+            if (newstreamFile) {
+                ((STDIOSTREAMFILE *)newstreamFile)->shared = streamFile->shared;
+                streamFile->shared->refs++;
+            }
+            vgm_mutex_unlock(streamFile->shared->lock);
+
             if (newstreamFile) { 
                 return newstreamFile;
             }
@@ -145,10 +205,10 @@ static STREAMFILE * open_stdio_streamfile_buffer_by_file(FILE *infile,const char
     uint8_t * buffer = NULL;
     STDIOSTREAMFILE * streamfile = NULL;
 
-    buffer = calloc(buffersize,1);
+    buffer = vgm_calloc(buffersize,1);
     if (!buffer) goto fail;
 
-    streamfile = calloc(1,sizeof(STDIOSTREAMFILE));
+    streamfile = vgm_calloc(1,sizeof(STDIOSTREAMFILE));
     if (!streamfile) goto fail;
 
     streamfile->sf.read = (void*)read_stdio;
@@ -180,8 +240,8 @@ static STREAMFILE * open_stdio_streamfile_buffer_by_file(FILE *infile,const char
     return &streamfile->sf;
 
 fail:
-    free(buffer);
-    free(streamfile);
+    vgm_free(buffer);
+    vgm_free(streamfile);
     return NULL;
 }
 
@@ -302,8 +362,8 @@ static STREAMFILE *buffer_open(BUFFER_STREAMFILE *streamfile, const char * const
 }
 static void buffer_close(BUFFER_STREAMFILE *streamfile) {
     streamfile->inner_sf->close(streamfile->inner_sf);
-    free(streamfile->buffer);
-    free(streamfile);
+    vgm_free(streamfile->buffer);
+    vgm_free(streamfile);
 }
 
 STREAMFILE *open_buffer_streamfile(STREAMFILE *streamfile, size_t buffer_size) {
@@ -311,14 +371,14 @@ STREAMFILE *open_buffer_streamfile(STREAMFILE *streamfile, size_t buffer_size) {
 
     if (!streamfile) goto fail;
 
-    this_sf = calloc(1,sizeof(BUFFER_STREAMFILE));
+    this_sf = vgm_calloc(1,sizeof(BUFFER_STREAMFILE));
     if (!this_sf) goto fail;
 
     this_sf->buffersize = buffer_size;
     if (this_sf->buffersize == 0)
         this_sf->buffersize = STREAMFILE_DEFAULT_BUFFER_SIZE;
 
-    this_sf->buffer = calloc(this_sf->buffersize,1);
+    this_sf->buffer = vgm_calloc(this_sf->buffersize,1);
     if (!this_sf->buffer) goto fail;
 
     /* set callbacks and internals */
@@ -337,8 +397,8 @@ STREAMFILE *open_buffer_streamfile(STREAMFILE *streamfile, size_t buffer_size) {
     return &this_sf->sf;
 
 fail:
-    if (this_sf) free(this_sf->buffer);
-    free(this_sf);
+    if (this_sf) vgm_free(this_sf->buffer);
+    vgm_free(this_sf);
     return NULL;
 }
 
@@ -371,7 +431,7 @@ static void wrap_open(WRAP_STREAMFILE *streamfile, const char * const filename,
 }
 static void wrap_close(WRAP_STREAMFILE *streamfile) {
     //streamfile->inner_sf->close(streamfile->inner_sf); /* don't close */
-    free(streamfile);
+    vgm_free(streamfile);
 }
 
 STREAMFILE *open_wrap_streamfile(STREAMFILE *streamfile) {
@@ -379,7 +439,7 @@ STREAMFILE *open_wrap_streamfile(STREAMFILE *streamfile) {
 
     if (!streamfile) return NULL;
 
-    this_sf = calloc(1,sizeof(WRAP_STREAMFILE));
+    this_sf = vgm_calloc(1,sizeof(WRAP_STREAMFILE));
     if (!this_sf) return NULL;
 
     /* set callbacks and internals */
@@ -436,7 +496,7 @@ static STREAMFILE *clamp_open(CLAMP_STREAMFILE *streamfile, const char * const f
 }
 static void clamp_close(CLAMP_STREAMFILE *streamfile) {
     streamfile->inner_sf->close(streamfile->inner_sf);
-    free(streamfile);
+    vgm_free(streamfile);
 }
 
 STREAMFILE *open_clamp_streamfile(STREAMFILE *streamfile, off_t start, size_t size) {
@@ -445,7 +505,7 @@ STREAMFILE *open_clamp_streamfile(STREAMFILE *streamfile, off_t start, size_t si
     if (!streamfile || !size) return NULL;
     if (start + size > get_streamfile_size(streamfile)) return NULL;
 
-    this_sf = calloc(1,sizeof(CLAMP_STREAMFILE));
+    this_sf = vgm_calloc(1,sizeof(CLAMP_STREAMFILE));
     if (!this_sf) return NULL;
 
     /* set callbacks and internals */
@@ -500,8 +560,8 @@ static STREAMFILE *io_open(IO_STREAMFILE *streamfile, const char * const filenam
 }
 static void io_close(IO_STREAMFILE *streamfile) {
     streamfile->inner_sf->close(streamfile->inner_sf);
-    free(streamfile->data);
-    free(streamfile);
+    vgm_free(streamfile->data);
+    vgm_free(streamfile);
 }
 
 STREAMFILE *open_io_streamfile(STREAMFILE *streamfile, void* data, size_t data_size, void* read_callback, void* size_callback) {
@@ -510,7 +570,7 @@ STREAMFILE *open_io_streamfile(STREAMFILE *streamfile, void* data, size_t data_s
     if (!streamfile) return NULL;
     if ((data && !data_size) || (!data && data_size)) return NULL;
 
-    this_sf = calloc(1,sizeof(IO_STREAMFILE));
+    this_sf = vgm_calloc(1,sizeof(IO_STREAMFILE));
     if (!this_sf) return NULL;
 
     /* set callbacks and internals */
@@ -524,9 +584,9 @@ STREAMFILE *open_io_streamfile(STREAMFILE *streamfile, void* data, size_t data_s
 
     this_sf->inner_sf = streamfile;
     if (data) {
-        this_sf->data = malloc(data_size);
+        this_sf->data = vgm_malloc(data_size);
         if (!this_sf->data)  {
-            free(this_sf);
+            vgm_free(this_sf);
             return NULL;
         }
         memcpy(this_sf->data, data, data_size);
@@ -576,7 +636,7 @@ static STREAMFILE *fakename_open(FAKENAME_STREAMFILE *streamfile, const char * c
 }
 static void fakename_close(FAKENAME_STREAMFILE *streamfile) {
     streamfile->inner_sf->close(streamfile->inner_sf);
-    free(streamfile);
+    vgm_free(streamfile);
 }
 
 STREAMFILE *open_fakename_streamfile(STREAMFILE *streamfile, const char * fakename, const char* fakeext) {
@@ -584,7 +644,7 @@ STREAMFILE *open_fakename_streamfile(STREAMFILE *streamfile, const char * fakena
 
     if (!streamfile || (!fakename && !fakeext)) return NULL;
 
-    this_sf = calloc(1,sizeof(FAKENAME_STREAMFILE));
+    this_sf = vgm_calloc(1,sizeof(FAKENAME_STREAMFILE));
     if (!this_sf) return NULL;
 
     /* set callbacks and internals */
@@ -682,7 +742,7 @@ static STREAMFILE *multifile_open(MULTIFILE_STREAMFILE *streamfile, const char *
 
     /* detect re-opening the file */
     if (strcmp(filename, original_filename) == 0) { /* same multifile */
-        new_inner_sfs = calloc(streamfile->inner_sfs_size, sizeof(STREAMFILE*));
+        new_inner_sfs = vgm_calloc(streamfile->inner_sfs_size, sizeof(STREAMFILE*));
         if (!new_inner_sfs) goto fail;
 
         for (i = 0; i < streamfile->inner_sfs_size; i++) {
@@ -705,7 +765,7 @@ fail:
         for (i = 0; i < streamfile->inner_sfs_size; i++)
             close_streamfile(new_inner_sfs[i]);
     }
-    free(new_inner_sfs);
+    vgm_free(new_inner_sfs);
     return NULL;
 }
 static void multifile_close(MULTIFILE_STREAMFILE *streamfile) {
@@ -715,9 +775,9 @@ static void multifile_close(MULTIFILE_STREAMFILE *streamfile) {
             close_streamfile(streamfile->inner_sfs[i]);
         }
     }
-    free(streamfile->inner_sfs);
-    free(streamfile->sizes);
-    free(streamfile);
+    vgm_free(streamfile->inner_sfs);
+    vgm_free(streamfile->sizes);
+    vgm_free(streamfile);
 }
 
 STREAMFILE *open_multifile_streamfile(STREAMFILE **streamfiles, size_t streamfiles_size) {
@@ -729,7 +789,7 @@ STREAMFILE *open_multifile_streamfile(STREAMFILE **streamfiles, size_t streamfil
         if (!streamfiles[i]) return NULL;
     }
 
-    this_sf = calloc(1,sizeof(MULTIFILE_STREAMFILE));
+    this_sf = vgm_calloc(1,sizeof(MULTIFILE_STREAMFILE));
     if (!this_sf) goto fail;
 
     /* set callbacks and internals */
@@ -742,9 +802,9 @@ STREAMFILE *open_multifile_streamfile(STREAMFILE **streamfiles, size_t streamfil
     this_sf->sf.stream_index = streamfiles[0]->stream_index;
 
     this_sf->inner_sfs_size = streamfiles_size;
-    this_sf->inner_sfs = calloc(streamfiles_size, sizeof(STREAMFILE*));
+    this_sf->inner_sfs = vgm_calloc(streamfiles_size, sizeof(STREAMFILE*));
     if (!this_sf->inner_sfs) goto fail;
-    this_sf->sizes = calloc(streamfiles_size, sizeof(size_t));
+    this_sf->sizes = vgm_calloc(streamfiles_size, sizeof(size_t));
     if (!this_sf->sizes) goto fail;
 
     for (i = 0; i < this_sf->inner_sfs_size; i++) {
@@ -757,10 +817,10 @@ STREAMFILE *open_multifile_streamfile(STREAMFILE **streamfiles, size_t streamfil
 
 fail:
     if (this_sf) {
-        free(this_sf->inner_sfs);
-        free(this_sf->sizes);
+        vgm_free(this_sf->inner_sfs);
+        vgm_free(this_sf->sizes);
     }
-    free(this_sf);
+    vgm_free(this_sf);
     return NULL;
 }
 
@@ -15,6 +15,7 @@
 #include <sys/types.h>
 #include "streamtypes.h"
 #include "util.h"
+#include "alloc.h"
 
 
 /* MSVC fixes (though mingw uses MSVCRT but not MSC_VER, maybe use AND?) */
@@ -0,0 +1,442 @@
+#include <stdlib.h>
+#include "threads.h"
+
+/* Shared worker pool: a few threads pulling tasks from a queue. Callers that wait on a task that
+ * wasn't picked up yet run it themselves, so a busy (or small) pool never blocks progress. */
+
+#define POOL_MAX_WORKERS  15
+
+#define TASK_QUEUED   1
+#define TASK_RUNNING  2
+#define TASK_DONE     3
+
+
+#ifdef _WIN32
+#include <windows.h>
+#if defined(VGM_USE_THREADS) && _WIN32_WINNT < 0x0600
+#undef VGM_USE_THREADS /* needs Vista's condition variables */
+#endif
+#endif
+
+
+/* Locks are always real, even without VGM_USE_THREADS: players open and decode files from several
+ * threads of their own (ex. playlist info while playing), so shared state must be guarded anyway. */
+
+#ifdef _WIN32
+#if _WIN32_WINNT >= 0x0600
+
+typedef SRWLOCK vgm_mutex_t;
+#define VGM_MUTEX_INITIALIZER SRWLOCK_INIT
+
+static void mutex_init(vgm_mutex_t * m)    { InitializeSRWLock(m); }
+static void mutex_free(vgm_mutex_t * m)    { (void)m; }
+static void mutex_lock(vgm_mutex_t * m)    { AcquireSRWLockExclusive(m); }
+static void mutex_unlock(vgm_mutex_t * m)  { ReleaseSRWLockExclusive(m); }
+#else
+
+/* no static init for critical sections before Vista, so a spinlock (locks are held briefly) */
+typedef volatile LONG vgm_mutex_t;
+#define VGM_MUTEX_INITIALIZER 0
+
+static void mutex_init(vgm_mutex_t * m)    { *m = 0; }
+static void mutex_free(vgm_mutex_t * m)    { (void)m; }
+static void mutex_lock(vgm_mutex_t * m)    { while (InterlockedCompareExchange(m, 1, 0) != 0) Sleep(0); }
+static void mutex_unlock(vgm_mutex_t * m)  { InterlockedExchange(m, 0); }
+#endif
+#else
+#include <pthread.h>
+
+typedef pthread_mutex_t vgm_mutex_t;
+#define VGM_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+
+static void mutex_init(vgm_mutex_t * m)    { pthread_mutex_init(m, NULL); }
+static void mutex_free(vgm_mutex_t * m)    { pthread_mutex_destroy(m); }
+static void mutex_lock(vgm_mutex_t * m)    { pthread_mutex_lock(m); }
+static void mutex_unlock(vgm_mutex_t * m)  { pthread_mutex_unlock(m); }
+#endif
+
+static vgm_mutex_t g_alloc_lock = VGM_MUTEX_INITIALIZER;
+static vgm_mutex_t g_init_lock = VGM_MUTEX_INITIALIZER;
+
+
+#ifdef VGM_USE_THREADS
+
+#ifdef _WIN32
+
+typedef CONDITION_VARIABLE vgm_cond_t;
+typedef HANDLE vgm_thread_t;
+
+static void cond_init(vgm_cond_t * c)      { InitializeConditionVariable(c); }
+static void cond_free(vgm_cond_t * c)      { (void)c; }
+static void cond_wait(vgm_cond_t * c, vgm_mutex_t * m) { SleepConditionVariableSRW(c, m, INFINITE, 0); }
+static void cond_signal(vgm_cond_t * c)    { WakeConditionVariable(c); }
+static void cond_broadcast(vgm_cond_t * c) { WakeAllConditionVariable(c); }
+
+static int get_cpu_count(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+}
+#else
+#include <unistd.h>
+
+typedef pthread_cond_t vgm_cond_t;
+typedef pthread_t vgm_thread_t;
+
+static void cond_init(vgm_cond_t * c)      { pthread_cond_init(c, NULL); }
+static void cond_free(vgm_cond_t * c)      { pthread_cond_destroy(c); }
+static void cond_wait(vgm_cond_t * c, vgm_mutex_t * m) { pthread_cond_wait(c, m); }
+static void cond_signal(vgm_cond_t * c)    { pthread_cond_signal(c); }
+static void cond_broadcast(vgm_cond_t * c) { pthread_cond_broadcast(c); }
+
+static int get_cpu_count(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+    return (int)sysconf(_SC_NPROCESSORS_ONLN);
+#else
+    return 1;
+#endif
+}
+#endif
+
+
+struct vgm_pool {
+    vgm_cond_t work_cond;       /* signaled when tasks are queued (or on stop) */
+    vgm_cond_t done_cond;       /* signaled when tasks are done */
+    vgm_task * queue_head;
+    vgm_task * queue_tail;
+    int stop;
+
+    int worker_count;
+    vgm_thread_t workers[POOL_MAX_WORKERS];
+};
+
+/* all pool state is guarded by a single lock, as tasks are few and big (decoding whole buffers) */
+static vgm_mutex_t g_pool_lock = VGM_MUTEX_INITIALIZER;
+static vgm_pool * g_pool = NULL;
+static int g_pool_refs = 0;
+
+
+static void run_task(vgm_pool * pool, vgm_task * task) {
+    task->job(task->arg);
+
+    mutex_lock(&g_pool_lock);
+    task->state = TASK_DONE;
+    cond_broadcast(&pool->done_cond);
+    mutex_unlock(&g_pool_lock);
+}
+
+/* removes the task from the queue (lock must be held) */
+static int unqueue_task(vgm_pool * pool, vgm_task * task) {
+    vgm_task * prev = NULL;
+    vgm_task * cur = pool->queue_head;
+
+    while (cur) {
+        if (cur == task) {
+            if (prev)
+                prev->next = cur->next;
+            else
+                pool->queue_head = cur->next;
+            if (pool->queue_tail == cur)
+                pool->queue_tail = prev;
+            cur->next = NULL;
+            return 1;
+        }
+        prev = cur;
+        cur = cur->next;
+    }
+    return 0;
+}
+
+static void worker_loop(vgm_pool * pool) {
+    while (1) {
+        vgm_task * task;
+
+        mutex_lock(&g_pool_lock);
+        while (!pool->queue_head && !pool->stop) {
+            cond_wait(&pool->work_cond, &g_pool_lock);
+        }
+        if (!pool->queue_head) { /* stop */
+            mutex_unlock(&g_pool_lock);
+            break;
+        }
+        task = pool->queue_head;
+        unqueue_task(pool, task);
+        task->state = TASK_RUNNING;
+        mutex_unlock(&g_pool_lock);
+
+        run_task(pool, task);
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI worker_thread(LPVOID arg) {
+    worker_loop(arg);
+    return 0;
+}
+static int thread_start(vgm_thread_t * thread, vgm_pool * pool) {
+    *thread = CreateThread(NULL, 0, worker_thread, pool, 0, NULL);
+    return *thread != NULL;
+}
+static void thread_join(vgm_thread_t thread) {
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+#else
+static void * worker_thread(void * arg) {
+    worker_loop(arg);
+    return NULL;
+}
+static int thread_start(vgm_thread_t * thread, vgm_pool * pool) {
+    return pthread_create(thread, NULL, worker_thread, pool) == 0;
+}
+static void thread_join(vgm_thread_t thread) {
+    pthread_join(thread, NULL);
+}
+#endif
+
+
+static void free_pool(vgm_pool * pool) {
+    int i;
+
+    mutex_lock(&g_pool_lock);
+    pool->stop = 1;
+    cond_broadcast(&pool->work_cond);
+    mutex_unlock(&g_pool_lock);
+
+    for (i = 0; i < pool->worker_count; i++) {
+        thread_join(pool->workers[i]);
+    }
+
+    cond_free(&pool->work_cond);
+    cond_free(&pool->done_cond);
+    free(pool);
+}
+
+static vgm_pool * init_pool(void) {
+    vgm_pool * pool;
+    int i, workers;
+
+    workers = get_cpu_count() - 1; /* callers also run tasks */
+    if (workers < 1)
+        return NULL; /* not worth it */
+    if (workers > POOL_MAX_WORKERS)
+        workers = POOL_MAX_WORKERS;
+
+    pool = calloc(1, sizeof(vgm_pool));
+    if (!pool) return NULL;
+
+    cond_init(&pool->work_cond);
+    cond_init(&pool->done_cond);
+
+    for (i = 0; i < workers; i++) {
+        if (!thread_start(&pool->workers[i], pool))
+            break;
+        pool->worker_count++;
+    }
+
+    if (pool->worker_count == 0) {
+        free_pool(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+
+vgm_pool * vgm_pool_acquire(void) {
+    vgm_pool * pool, * new_pool;
+
+    mutex_lock(&g_pool_lock);
+    if (g_pool) {
+        g_pool_refs++;
+        pool = g_pool;
+        mutex_unlock(&g_pool_lock);
+        return pool;
+    }
+    mutex_unlock(&g_pool_lock); /* init_pool/free_pool take the lock */
+
+    new_pool = init_pool();
+    if (!new_pool) return NULL;
+
+    mutex_lock(&g_pool_lock);
+    if (!g_pool) {
+        g_pool = new_pool;
+        new_pool = NULL;
+    }
+    g_pool_refs++;
+    pool = g_pool;
+    mutex_unlock(&g_pool_lock);
+
+    if (new_pool) /* another thread made one first */
+        free_pool(new_pool);
+    return pool;
+}
+
+void vgm_pool_release(vgm_pool * pool) {
+    if (!pool) return;
+
+    mutex_lock(&g_pool_lock);
+    g_pool_refs--;
+    if (g_pool_refs > 0 || g_pool != pool) {
+        mutex_unlock(&g_pool_lock);
+        return;
+    }
+    g_pool = NULL;
+    mutex_unlock(&g_pool_lock);
+
+    free_pool(pool);
+}
+
+int vgm_pool_threads(vgm_pool * pool) {
+    if (!pool) return 1;
+    return pool->worker_count + 1;
+}
+
+void vgm_task_submit(vgm_pool * pool, vgm_task * task, vgm_job_t job, void * arg) {
+    task->job = job;
+    task->arg = arg;
+    task->next = NULL;
+
+    if (!pool) {
+        task->job(task->arg);
+        task->state = TASK_DONE;
+        return;
+    }
+
+    mutex_lock(&g_pool_lock);
+    task->state = TASK_QUEUED;
+    if (pool->queue_tail)
+        pool->queue_tail->next = task;
+    else
+        pool->queue_head = task;
+    pool->queue_tail = task;
+    cond_signal(&pool->work_cond);
+    mutex_unlock(&g_pool_lock);
+}
+
+int vgm_task_done(vgm_pool * pool, vgm_task * task) {
+    int done;
+    if (!pool) return 1;
+
+    mutex_lock(&g_pool_lock);
+    done = (task->state == TASK_DONE);
+    mutex_unlock(&g_pool_lock);
+    return done;
+}
+
+void vgm_task_wait(vgm_pool * pool, vgm_task * task) {
+    if (!pool) return;
+
+    mutex_lock(&g_pool_lock);
+    if (task->state == TASK_QUEUED && unqueue_task(pool, task)) {
+        task->state = TASK_RUNNING;
+        mutex_unlock(&g_pool_lock);
+
+        run_task(pool, task);
+        return;
+    }
+
+    while (task->state != TASK_DONE) {
+        cond_wait(&pool->done_cond, &g_pool_lock);
+    }
+    mutex_unlock(&g_pool_lock);
+}
+
+#else
+
+vgm_pool * vgm_pool_acquire(void) {
+    return NULL;
+}
+
+void vgm_pool_release(vgm_pool * pool) {
+}
+
+int vgm_pool_threads(vgm_pool * pool) {
+    return 1;
+}
+
+void vgm_task_submit(vgm_pool * pool, vgm_task * task, vgm_job_t job, void * arg) {
+    task->job = job;
+    task->arg = arg;
+    task->next = NULL;
+    task->job(task->arg);
+    task->state = TASK_DONE;
+}
+
+int vgm_task_done(vgm_pool * pool, vgm_task * task) {
+    return 1;
+}
+
+void vgm_task_wait(vgm_pool * pool, vgm_task * task) {
+}
+
+#endif /* VGM_USE_THREADS */
+
+
+struct vgm_mutex {
+    vgm_mutex_t m;
+};
+
+vgm_mutex * vgm_mutex_new(void) {
+    vgm_mutex * mutex = calloc(1, sizeof(vgm_mutex));
+    if (!mutex) return NULL;
+
+    mutex_init(&mutex->m);
+    return mutex;
+}
+
+void vgm_mutex_free(vgm_mutex * mutex) {
+    if (!mutex) return;
+    mutex_free(&mutex->m);
+    free(mutex);
+}
+
+void vgm_mutex_lock(vgm_mutex * mutex) {
+    if (mutex) mutex_lock(&mutex->m);
+}
+
+void vgm_mutex_unlock(vgm_mutex * mutex) {
+    if (mutex) mutex_unlock(&mutex->m);
+}
+
+void vgm_lock_alloc(void) {
+    mutex_lock(&g_alloc_lock);
+}
+
+void vgm_unlock_alloc(void) {
+    mutex_unlock(&g_alloc_lock);
+}
+
+void vgm_lock_init(void) {
+    mutex_lock(&g_init_lock);
+}
+
+void vgm_unlock_init(void) {
+    mutex_unlock(&g_init_lock);
+}
+
+
+#ifdef _WIN32
+
+uint64_t vgm_clock_us64(void) {
+    LARGE_INTEGER freq, count;
+    if (!QueryPerformanceFrequency(&freq) || !QueryPerformanceCounter(&count))
+        return (uint64_t)GetTickCount() * 1000u;
+    return (uint64_t)(count.QuadPart / freq.QuadPart * 1000000 + (count.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart);
+}
+#else
+#include <time.h>
+
+uint64_t vgm_clock_us64(void) {
+#ifdef CLOCK_MONOTONIC
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+        return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)(ts.tv_nsec / 1000);
+#endif
+    return (uint64_t)((double)clock() * 1000000.0 / CLOCKS_PER_SEC);
+}
+#endif
+
+uint32_t vgm_clock_us(void) {
+    return (uint32_t)vgm_clock_us64();
+}
@@ -0,0 +1,66 @@
+/*
+ * threads.h - shared worker pool, for decoding independent streams in parallel
+ */
+#ifndef _THREADS_H
+#define _THREADS_H
+
+#include "streamtypes.h"
+
+/* Threads are only available when compiled with VGM_USE_THREADS (pthreads or Win32). Otherwise
+ * vgm_pool_acquire returns NULL and tasks run in the calling thread, so callers don't need to care.
+ * Locks below are real in all builds, as players may call the library from their own threads. */
+
+typedef struct vgm_pool vgm_pool;
+
+typedef void (*vgm_job_t)(void * arg);
+
+/* task owned by the caller (must live until waited) */
+typedef struct vgm_task {
+    vgm_job_t job;
+    void * arg;
+    volatile int state;
+    struct vgm_task * next;
+} vgm_task;
+
+
+/* Gets a reference to the process-wide pool (created on first use, with one worker per extra CPU).
+ * Returns NULL if threads aren't available. */
+vgm_pool * vgm_pool_acquire(void);
+
+/* Releases a reference (the last one stops the workers). */
+void vgm_pool_release(vgm_pool * pool);
+
+/* Number of threads that may run tasks at once (workers plus the caller), 1 if pool is NULL. */
+int vgm_pool_threads(vgm_pool * pool);
+
+/* Queues job(arg) in the pool (or runs it now if pool is NULL). */
+void vgm_task_submit(vgm_pool * pool, vgm_task * task, vgm_job_t job, void * arg);
+
+/* Returns 1 if the task is done (so waiting won't block). */
+int vgm_task_done(vgm_pool * pool, vgm_task * task);
+
+/* Waits until the task is done. Tasks that no worker has started yet run in the calling thread. */
+void vgm_task_wait(vgm_pool * pool, vgm_task * task);
+
+/* Lock for a few objects that share something (ex. dup'd FILEs share the file position, or a stream pool).
+ * vgm_mutex_new returns NULL on failure. */
+typedef struct vgm_mutex vgm_mutex;
+vgm_mutex * vgm_mutex_new(void);
+void vgm_mutex_free(vgm_mutex * mutex);
+void vgm_mutex_lock(vgm_mutex * mutex);
+void vgm_mutex_unlock(vgm_mutex * mutex);
+
+/* Serializes the global allocation counters (scopes have their own lock, see alloc.c) */
+void vgm_lock_alloc(void);
+void vgm_unlock_alloc(void);
+
+/* Serializes one-time global setup and shared caches (codec libraries, tables), so streams can be opened in parallel */
+void vgm_lock_init(void);
+void vgm_unlock_init(void);
+
+/* Monotonic clock in microseconds, for measuring intervals. The 32-bit one wraps around every ~71 minutes
+ * (fine for short intervals, ex. differences in a decode loop). */
+uint64_t vgm_clock_us64(void);
+uint32_t vgm_clock_us(void);
+
+#endif /* _THREADS_H */
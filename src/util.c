@@ -107,6 +107,15 @@ void swap_samples_le(sample *buf, int count) {
     }
 }
 
+void swap_samples_le_f32(float *buf, int count) {
+    int i;
+    for (i=0;i<count;i++) {
+        uint32_t v;
+        memcpy(&v, &buf[i], sizeof(uint32_t));
+        put_32bitLE((uint8_t*)&buf[i], (int32_t)v);
+    }
+}
+
 /* length is maximum length of dst. dst will always be null-terminated if
  * length > 0 */
 void concatn(int length, char * dst, const char * src) {
@@ -72,6 +72,7 @@ static inline int clamp16(int32_t val) {
 const char * filename_extension(const char * filename);
 
 void swap_samples_le(sample *buf, int count);
+void swap_samples_le_f32(float *buf, int count);
 
 void concatn(int length, char * dst, const char * src);
 
@@ -3,6 +3,7 @@
 #endif
 
 #include <stdio.h>
+#include <stddef.h>
 #include <string.h>
 #include <math.h>
 #include "vgmstream.h"
@@ -11,6 +12,13 @@
 #include "coding/coding.h"
 
 static void try_dual_file_stereo(VGMSTREAM * opened_vgmstream, STREAMFILE *streamFile, VGMSTREAM* (*init_vgmstream_function)(STREAMFILE*));
+static void apply_channel_settings(VGMSTREAM * vgmstream, sample * buffer, float * buffer_f, int32_t sample_count);
+
+/* up to ~16 aren't too rare for multilayered files, more is probably a bug */
+#define VGMSTREAM_MAX_CHANNELS  64
+
+/* PCM16 buffer for streams rendered to float by conversion (enough for max channels) */
+#define VGMSTREAM_F32_TEMP_SAMPLES  0x1000
 
 
 /* List of functions that will recognize files */
@@ -457,25 +465,40 @@ VGMSTREAM * (*init_vgmstream_functions[])(STREAMFILE *streamFile) = {
 };
 
 
-/* internal version with all parameters */
-static VGMSTREAM * init_vgmstream_internal(STREAMFILE *streamFile) {
-    int i, fcns_size;
+/* internal version with all parameters (format: only try that init function, see format_index) */
+static VGMSTREAM * init_vgmstream_internal(STREAMFILE *streamFile, int format) {
+    int i, first = 0, fcns_size;
+    vgm_alloc_scope * scope = vgm_alloc_scope_current();
+    vgm_alloc_mark mark;
     
     if (!streamFile)
         return NULL;
 
     fcns_size = (sizeof(init_vgmstream_functions)/sizeof(init_vgmstream_functions[0]));
+    if (format > 0 && format <= fcns_size) {
+        first = format - 1;
+        fcns_size = format;
+    }
+
     /* try a series of formats, see which works */
-    for (i=0; i < fcns_size; i++) {
+    for (i=first; i < fcns_size; i++) {
+        VGMSTREAM * vgmstream;
+
+        /* memory of failed probes is dropped at once (see vgm_alloc_arena_begin) */
+        vgm_alloc_arena_mark(scope, &mark);
+
         /* call init function and see if valid VGMSTREAM was returned */
-        VGMSTREAM * vgmstream = (init_vgmstream_functions[i])(streamFile);
-        if (!vgmstream)
+        vgmstream = (init_vgmstream_functions[i])(streamFile);
+        if (!vgmstream) {
+            vgm_alloc_arena_rollback(scope, &mark);
             continue;
+        }
 
         /* fail if there is nothing to play (without this check vgmstream can generate empty files) */
         if (vgmstream->num_samples <= 0) {
             VGM_LOG("VGMSTREAM: wrong num_samples (ns=%i / 0x%08x)\n", vgmstream->num_samples, vgmstream->num_samples);
             close_vgmstream(vgmstream);
+            vgm_alloc_arena_rollback(scope, &mark);
             continue;
         }
 
@@ -483,6 +506,7 @@ static VGMSTREAM * init_vgmstream_internal(STREAMFILE *streamFile) {
         if (vgmstream->sample_rate < 300 || vgmstream->sample_rate > 96000) {
             VGM_LOG("VGMSTREAM: wrong sample rate (sr=%i)\n", vgmstream->sample_rate);
             close_vgmstream(vgmstream);
+            vgm_alloc_arena_rollback(scope, &mark);
             continue;
         }
             
@@ -516,6 +540,7 @@ static VGMSTREAM * init_vgmstream_internal(STREAMFILE *streamFile) {
         if (vgmstream->num_streams < 0 || vgmstream->num_streams > 65535) {
             VGM_LOG("VGMSTREAM: wrong num_streams (ns=%i)\n", vgmstream->num_streams);
             close_vgmstream(vgmstream);
+            vgm_alloc_arena_rollback(scope, &mark);
             continue;
         }
 
@@ -525,6 +550,9 @@ static VGMSTREAM * init_vgmstream_internal(STREAMFILE *streamFile) {
         if (!vgmstream->stream_index)
             vgmstream->stream_index = streamFile->stream_index;
 
+        /* so other subsongs can skip detection (see init_vgmstream_subsong) */
+        vgmstream->format_index = i + 1;
+
         /* save start things so we can restart for seeking */
         memcpy(vgmstream->start_ch,vgmstream->ch,sizeof(VGMSTREAMCHANNEL)*vgmstream->channels);
         memcpy(vgmstream->start_vgmstream,vgmstream,sizeof(VGMSTREAM));
@@ -548,122 +576,327 @@ VGMSTREAM * init_vgmstream(const char * const filename) {
 }
 
 VGMSTREAM * init_vgmstream_from_STREAMFILE(STREAMFILE *streamFile) {
-    return init_vgmstream_internal(streamFile);
+    return init_vgmstream_from_STREAMFILE_alloc(streamFile, NULL, 0);
+}
+
+static VGMSTREAM * init_vgmstream_scope(STREAMFILE *streamFile, const vgmstream_allocator * allocator, size_t max_bytes, int format) {
+    VGMSTREAM * vgmstream;
+    vgm_alloc_scope * scope, * previous;
+
+    /* opened from a meta (ex. .txtp/subfiles): goes in the caller's scope */
+    if (vgm_alloc_scope_current())
+        return init_vgmstream_internal(streamFile, format);
+
+    scope = vgm_alloc_scope_new(allocator, max_bytes);
+    if (!scope) return NULL;
+
+    previous = vgm_alloc_scope_enter(scope);
+    vgm_alloc_arena_begin(scope);
+    vgmstream = init_vgmstream_internal(streamFile, format);
+    vgm_alloc_arena_end(scope);
+    vgm_alloc_scope_leave(previous);
+
+    vgm_alloc_scope_unref(scope); /* kept by the VGMSTREAM, if any */
+    return vgmstream;
+}
+
+VGMSTREAM * init_vgmstream_from_STREAMFILE_alloc(STREAMFILE *streamFile, const vgmstream_allocator * allocator, size_t max_bytes) {
+    return init_vgmstream_scope(streamFile, allocator, max_bytes, 0);
+}
+
+VGMSTREAM * init_vgmstream_subsong(VGMSTREAM * vgmstream, STREAMFILE *streamFile, int subsong) {
+    if (!vgmstream || !streamFile)
+        return NULL;
+
+    /* the format's parser still reads the header to find the subsong, but the file isn't tested
+     * against all others (most of the time spent opening banks with many subsongs) */
+    streamFile->stream_index = subsong;
+    return init_vgmstream_scope(streamFile, NULL, 0, vgmstream->format_index);
+}
+
+void vgmstream_set_allocator(const vgmstream_allocator * allocator) {
+    vgm_alloc_set_default(allocator);
+}
+
+int vgmstream_get_alloc_stats(VGMSTREAM * vgmstream, vgmstream_alloc_stats * stats) {
+    if (!stats) return 0;
+    vgm_alloc_scope_stats(vgmstream ? vgmstream->alloc_scope : NULL, stats);
+    return 1;
+}
+
+void vgmstream_set_alloc_limit(VGMSTREAM * vgmstream, size_t max_bytes) {
+    vgm_alloc_scope_set_limit(vgmstream ? vgmstream->alloc_scope : NULL, max_bytes);
 }
 
 /* Reset a VGMSTREAM to its state at the start of playback
  * (when a plugin needs to seek back to zero, for instance).
  * Note that this does not reset the constituent STREAMFILES. */
 void reset_vgmstream(VGMSTREAM * vgmstream) {
+    const codec_info * info = get_codec_info(vgmstream->coding_type);
+
     /* copy the vgmstream back into itself */
     memcpy(vgmstream,vgmstream->start_vgmstream,sizeof(VGMSTREAM));
 
     /* copy the initial channels */
-    memcpy(vgmstream->ch,vgmstream->start_ch,sizeof(VGMSTREAMCHANNEL)*vgmstream->channels);
+    copy_vgmstream_channels(vgmstream, vgmstream->ch, vgmstream->start_ch);
+
+    if (vgmstream->loop_cache_data)
+        reset_loop_cache(vgmstream->loop_cache_data);
+    if (vgmstream->play_config_data)
+        reset_play_config(vgmstream->play_config_data);
 
     /* loop_ch is not zeroed here because there is a possibility of the
      * init_vgmstream_* function doing something tricky and precomputing it.
      * Otherwise hit_loop will be 0 and it will be copied over anyway when we
      * really hit the loop start. */
 
-#ifdef VGM_USE_VORBIS
-    if (vgmstream->coding_type==coding_OGG_VORBIS) {
-        reset_ogg_vorbis(vgmstream);
+    if (info->reset) {
+        info->reset(vgmstream);
     }
 
-    if (vgmstream->coding_type==coding_VORBIS_custom) {
-        reset_vorbis_custom(vgmstream);
-    }
-#endif
 
-    if (vgmstream->coding_type==coding_CRI_HCA) {
-        reset_hca(vgmstream->codec_data);
-    }
+    if (vgmstream->layout_type==layout_aix) {
+        aix_codec_data *data = vgmstream->codec_data;
+        int i;
 
-    if (vgmstream->coding_type==coding_EA_MT) {
-        reset_ea_mt(vgmstream);
+        data->current_segment = 0;
+        for (i=0;i<data->segment_count*data->stream_count;i++) {
+            reset_vgmstream(data->adxs[i]);
+        }
     }
 
-#if defined(VGM_USE_MP4V2) && defined(VGM_USE_FDKAAC)
-    if (vgmstream->coding_type==coding_MP4_AAC) {
-        reset_mp4_aac(vgmstream);
+    if (vgmstream->layout_type==layout_segmented) {
+        reset_layout_segmented(vgmstream->layout_data);
     }
-#endif
 
-#ifdef VGM_USE_MPEG
-    if (vgmstream->coding_type==coding_MPEG_custom ||
-        vgmstream->coding_type==coding_MPEG_ealayer3 ||
-        vgmstream->coding_type==coding_MPEG_layer1 ||
-        vgmstream->coding_type==coding_MPEG_layer2 ||
-        vgmstream->coding_type==coding_MPEG_layer3) {
-        reset_mpeg(vgmstream);
+    if (vgmstream->layout_type==layout_layered) {
+        reset_layout_layered(vgmstream->layout_data);
     }
-#endif
+}
 
-#ifdef VGM_USE_G7221
-    if (vgmstream->coding_type==coding_G7221C) {
-        reset_g7221(vgmstream);
-    }
-#endif
+/* Codecs whose decoders find any frame from samples_into_block and offsets (which the layout can
+ * calculate, or find in the block index), and either don't keep state between samples or reload it
+ * from each frame's header. */
+static int is_seekable_layout(VGMSTREAM * vgmstream) {
+    if (vgmstream->block_index_data)
+        return 1; /* only set if supported */
+    if (vgmstream->layout_type != layout_none && vgmstream->layout_type != layout_interleave)
+        return 0;
+    if (vgmstream->codec_data)
+        return 0;
 
-#ifdef VGM_USE_G719
-    if (vgmstream->coding_type==coding_G719) {
-        reset_g719(vgmstream->codec_data, vgmstream->channels);
-    }
-#endif
+    return (get_codec_info(vgmstream->coding_type)->flags & CODEC_STATELESS) != 0;
+}
 
-#ifdef VGM_USE_MAIATRAC3PLUS
-    if (vgmstream->coding_type==coding_AT3plus) {
-        reset_at3plus(vgmstream);
-    }
-#endif
+/* Codecs that can move to any sample directly, without decoding previous samples. */
+static int is_seekable_direct(VGMSTREAM * vgmstream) {
+    if (is_seekable_layout(vgmstream))
+        return 1;
+    if (vgmstream->layout_type == layout_segmented)
+        return 1; /* segments are full vgmstreams that seek on their own */
+    if (vgmstream->layout_type != layout_none)
+        return 0;
 
-#ifdef VGM_USE_ATRAC9
-    if (vgmstream->coding_type==coding_ATRAC9) {
-        reset_atrac9(vgmstream);
+    /* codecs with their own seeking */
+    if (get_codec_info(vgmstream->coding_type)->flags & CODEC_SEEKABLE)
+        return vgmstream->codec_data != NULL;
+    return 0;
+}
+
+/* optional check to stop seeks that must decode a lot (see vgmstream_seek_abortable) */
+typedef struct {
+    int (*callback)(void * arg);
+    void * arg;
+} seek_abort_t;
+
+static int seek_discard(VGMSTREAM * vgmstream, int32_t seek_sample, seek_abort_t * abort);
+
+/* Moves to seek_sample (in the current playthrough), for streams where is_seekable_direct is true.
+ * Returns 0 if aborted. */
+static int seek_direct(VGMSTREAM * vgmstream, int32_t seek_sample, seek_abort_t * abort) {
+    VGMSTREAMCHANNEL * saved_ch;
+
+    if (vgmstream->layout_type == layout_segmented) {
+        seek_layout_segmented(vgmstream, seek_sample);
+        return 1;
     }
-#endif
 
-#ifdef VGM_USE_CELT
-    if (vgmstream->coding_type==coding_CELT_FSB) {
-        reset_celt_fsb(vgmstream);
+    /* offsets are calculated from the layout, then the rest of the frame is decoded */
+    if (is_seekable_layout(vgmstream)) {
+        int32_t frame_sample;
+
+        if (vgmstream->block_index_data)
+            frame_sample = seek_layout_blocked(vgmstream, seek_sample);
+        else if (vgmstream->layout_type == layout_interleave)
+            frame_sample = seek_layout_interleave(vgmstream, seek_sample);
+        else
+            frame_sample = seek_layout_flat(vgmstream, seek_sample);
+
+        /* shouldn't happen, but layout seeks fail before changing anything, so decoding from the
+         * current position keeps the loop state set up on the way (resetting would lose it) */
+        if (frame_sample < 0) {
+            VGM_LOG("VGMSTREAM: can't seek layout\n");
+        }
+
+        return seek_discard(vgmstream, seek_sample, abort);
     }
-#endif
 
-#ifdef VGM_USE_FFMPEG
-    if (vgmstream->coding_type==coding_FFmpeg) {
-        reset_ffmpeg(vgmstream);
+    /* codec seeks are meant for looping, and set offsets in loop_ch that are restored into ch after.
+     * Do the same, but keep a local copy of the loop start state to put back (or give a temp
+     * loop_ch to non-looped streams). */
+    saved_ch = vgm_malloc(sizeof(VGMSTREAMCHANNEL) * vgmstream->channels);
+    if (!saved_ch)
+        return seek_discard(vgmstream, seek_sample, abort);
+
+    if (vgmstream->loop_ch) {
+        copy_vgmstream_channels(vgmstream, saved_ch, vgmstream->loop_ch);
+        copy_vgmstream_channels(vgmstream, vgmstream->loop_ch, vgmstream->ch);
+
+        get_codec_info(vgmstream->coding_type)->seek(vgmstream, seek_sample);
+
+        copy_vgmstream_channels(vgmstream, vgmstream->ch, vgmstream->loop_ch);
+        copy_vgmstream_channels(vgmstream, vgmstream->loop_ch, saved_ch);
     }
-#endif
+    else {
+        copy_vgmstream_channels(vgmstream, saved_ch, vgmstream->ch);
+        vgmstream->loop_ch = saved_ch;
 
-    if (vgmstream->coding_type==coding_ACM) {
-        reset_acm(vgmstream->codec_data);
+        get_codec_info(vgmstream->coding_type)->seek(vgmstream, seek_sample);
+
+        vgmstream->loop_ch = NULL;
+        copy_vgmstream_channels(vgmstream, vgmstream->ch, saved_ch);
     }
 
-    if (vgmstream->coding_type == coding_NWA) {
-        nwa_codec_data *data = vgmstream->codec_data;
-        if (data)
-            reset_nwa(data->nwa);
+    vgm_free(saved_ch);
+
+    vgmstream->current_sample = seek_sample;
+    vgmstream->samples_into_block = seek_sample;
+    return 1;
+}
+
+/* Decodes and discards samples until seek_sample (in the current playthrough). Returns 0 if aborted. */
+static int seek_discard(VGMSTREAM * vgmstream, int32_t seek_sample, seek_abort_t * abort) {
+    sample * discard_buf;
+    int32_t max_samples = 0x1000;
+
+    discard_buf = vgm_malloc(max_samples * vgmstream->channels * sizeof(sample));
+    if (!discard_buf) return 1;
+
+    while (vgmstream->current_sample < seek_sample) {
+        int32_t samples_to_do = seek_sample - vgmstream->current_sample;
+        if (samples_to_do > max_samples)
+            samples_to_do = max_samples;
+
+        if (abort && abort->callback(abort->arg)) {
+            vgm_free(discard_buf);
+            return 0;
+        }
+
+        render_vgmstream_main(discard_buf, samples_to_do, vgmstream);
     }
 
+    vgm_free(discard_buf);
+    return 1;
+}
 
-    if (vgmstream->layout_type==layout_aix) {
-        aix_codec_data *data = vgmstream->codec_data;
-        int i;
+/* Seek to a sample position, as if seek_sample samples were played from the start (loops included).
+ * Returns 0 if aborted. */
+static int seek_stream(VGMSTREAM * vgmstream, int32_t seek_sample, seek_abort_t * abort) {
+    int32_t stream_sample, loop_samples;
+    int loop_count = 0, loop_done = 0, done = 1;
+    vgm_alloc_scope * previous;
 
-        data->current_segment = 0;
-        for (i=0;i<data->segment_count*data->stream_count;i++) {
-            reset_vgmstream(data->adxs[i]);
+    /* layers are full vgmstreams that handle their own looping */
+    if (vgmstream->layout_type == layout_layered) {
+        layered_layout_data *data = vgmstream->layout_data;
+        int i;
+        for (i = 0; i < data->layer_count; i++) {
+            if (!seek_stream(data->layers[i], seek_sample, abort))
+                return 0;
         }
+        vgmstream->current_sample = data->layers[0]->current_sample;
+        vgmstream->loop_count = data->layers[0]->loop_count;
+        return 1;
     }
 
-    if (vgmstream->layout_type==layout_segmented) {
-        reset_layout_segmented(vgmstream->layout_data);
+    previous = vgm_alloc_scope_enter(vgmstream->alloc_scope);
+
+    /* loop config may have changed while playing (loop target reached) */
+    reset_vgmstream(vgmstream);
+
+    /* find the position in the stream and loops done to get there */
+    stream_sample = seek_sample;
+    loop_samples = vgmstream->loop_end_sample - vgmstream->loop_start_sample;
+    if (vgmstream->loop_flag && loop_samples > 0 && seek_sample >= vgmstream->loop_end_sample) {
+        loop_count = (seek_sample - vgmstream->loop_start_sample) / loop_samples;
+        stream_sample = vgmstream->loop_start_sample + (seek_sample - vgmstream->loop_start_sample) % loop_samples;
+
+        /* after N loops play the stream end (see vgmstream_do_loop) */
+        if (vgmstream->loop_target && loop_count >= vgmstream->loop_target) {
+            loop_count = vgmstream->loop_target;
+            stream_sample = seek_sample - (loop_count - 1) * loop_samples;
+            loop_done = 1;
+        }
     }
+    /* past the end decoders just read (garbage) data, so only codecs that must be told to seek are clamped */
+    if (stream_sample > vgmstream->num_samples && vgmstream->codec_data)
+        stream_sample = vgmstream->num_samples;
 
-    if (vgmstream->layout_type==layout_layered) {
-        reset_layout_layered(vgmstream->layout_data);
+    /* start from the closest saved state, if possible */
+    if (vgmstream->checkpoint_data && !is_seekable_direct(vgmstream))
+        vgmstream_restore_checkpoint(vgmstream, stream_sample);
+
+    if (loop_done)
+        vgmstream->loop_flag = 0;
+
+    if (vgmstream->current_sample < stream_sample) {
+        if (is_seekable_direct(vgmstream)) {
+            /* loop start state must be saved on the way, as normally done when decoding */
+            if (vgmstream->loop_flag && !vgmstream->hit_loop && stream_sample > vgmstream->loop_start_sample) {
+                done = seek_direct(vgmstream, vgmstream->loop_start_sample, abort);
+                if (done)
+                    vgmstream_do_loop(vgmstream);
+            }
+            if (done)
+                done = seek_direct(vgmstream, stream_sample, abort);
+        }
+        else {
+            done = seek_discard(vgmstream, stream_sample, abort);
+        }
     }
+
+    if (done)
+        vgmstream->loop_count = loop_count;
+
+    vgm_alloc_scope_leave(previous);
+    return done;
+}
+
+void vgmstream_seek(VGMSTREAM * vgmstream, int32_t seek_sample) {
+    vgmstream_seek_abortable(vgmstream, seek_sample, NULL, NULL);
+}
+
+int vgmstream_seek_abortable(VGMSTREAM * vgmstream, int32_t seek_sample, int (*abort_callback)(void * arg), void * arg) {
+    seek_abort_t abort;
+
+    if (!vgmstream)
+        return 1;
+    if (seek_sample < 0)
+        seek_sample = 0;
+
+    abort.callback = abort_callback;
+    abort.arg = arg;
+
+    /* no need to decode past the end */
+    if (vgmstream->play_config_data)
+        seek_sample = clamp_play_config_seek(vgmstream->play_config_data, seek_sample);
+
+    if (!seek_stream(vgmstream, seek_sample, abort_callback ? &abort : NULL))
+        return 0;
+
+    if (vgmstream->play_config_data)
+        seek_play_config(vgmstream->play_config_data, seek_sample);
+    return 1;
 }
 
 /* Allocate memory and setup a VGMSTREAM */
@@ -674,13 +907,12 @@ VGMSTREAM * allocate_vgmstream(int channel_count, int looped) {
     VGMSTREAMCHANNEL * start_channels;
     VGMSTREAMCHANNEL * loop_channels;
 
-    /* up to ~16 aren't too rare for multilayered files, more is probably a bug */
-    if (channel_count <= 0 || channel_count > 64) {
+    if (channel_count <= 0 || channel_count > VGMSTREAM_MAX_CHANNELS) {
         VGM_LOG("VGMSTREAM: error allocating %i channels\n", channel_count);
         return NULL;
     }
 
-    vgmstream = calloc(1,sizeof(VGMSTREAM));
+    vgmstream = vgm_calloc(1,sizeof(VGMSTREAM));
     if (!vgmstream) return NULL;
     
     vgmstream->ch = NULL;
@@ -689,39 +921,39 @@ VGMSTREAM * allocate_vgmstream(int channel_count, int looped) {
     vgmstream->start_vgmstream = NULL;
     vgmstream->codec_data = NULL;
 
-    start_vgmstream = calloc(1,sizeof(VGMSTREAM));
+    start_vgmstream = vgm_calloc(1,sizeof(VGMSTREAM));
     if (!start_vgmstream) {
-        free(vgmstream);
+        vgm_free(vgmstream);
         return NULL;
     }
     vgmstream->start_vgmstream = start_vgmstream;
     start_vgmstream->start_vgmstream = start_vgmstream;
 
-    channels = calloc(channel_count,sizeof(VGMSTREAMCHANNEL));
+    channels = vgm_calloc(channel_count,sizeof(VGMSTREAMCHANNEL));
     if (!channels) {
-        free(vgmstream);
-        free(start_vgmstream);
+        vgm_free(vgmstream);
+        vgm_free(start_vgmstream);
         return NULL;
     }
     vgmstream->ch = channels;
     vgmstream->channels = channel_count;
 
-    start_channels = calloc(channel_count,sizeof(VGMSTREAMCHANNEL));
+    start_channels = vgm_calloc(channel_count,sizeof(VGMSTREAMCHANNEL));
     if (!start_channels) {
-        free(vgmstream);
-        free(start_vgmstream);
-        free(channels);
+        vgm_free(vgmstream);
+        vgm_free(start_vgmstream);
+        vgm_free(channels);
         return NULL;
     }
     vgmstream->start_ch = start_channels;
 
     if (looped) {
-        loop_channels = calloc(channel_count,sizeof(VGMSTREAMCHANNEL));
+        loop_channels = vgm_calloc(channel_count,sizeof(VGMSTREAMCHANNEL));
         if (!loop_channels) {
-            free(vgmstream);
-            free(start_vgmstream);
-            free(channels);
-            free(start_channels);
+            vgm_free(vgmstream);
+            vgm_free(start_vgmstream);
+            vgm_free(channels);
+            vgm_free(start_channels);
             return NULL;
         }
         vgmstream->loop_ch = loop_channels;
@@ -729,110 +961,32 @@ VGMSTREAM * allocate_vgmstream(int channel_count, int looped) {
 
     vgmstream->loop_flag = looped;
 
+    /* allocations done by the meta/codec go to the same scope */
+    vgmstream->alloc_scope = vgm_alloc_scope_current();
+    vgm_alloc_scope_ref(vgmstream->alloc_scope);
+    start_vgmstream->alloc_scope = vgmstream->alloc_scope;
+
     return vgmstream;
 }
 
 void close_vgmstream(VGMSTREAM * vgmstream) {
+    const codec_info * info;
+    vgm_alloc_scope * scope;
+
     if (!vgmstream)
         return;
 
-#ifdef VGM_USE_VORBIS
-    if (vgmstream->coding_type==coding_OGG_VORBIS) {
-        free_ogg_vorbis(vgmstream->codec_data);
-        vgmstream->codec_data = NULL;
-    }
-
-    if (vgmstream->coding_type==coding_VORBIS_custom) {
-        free_vorbis_custom(vgmstream->codec_data);
-        vgmstream->codec_data = NULL;
-    }
-#endif
-
-    if (vgmstream->coding_type==coding_CRI_HCA) {
-        free_hca(vgmstream->codec_data);
-        vgmstream->codec_data = NULL;
-    }
-
-    if (vgmstream->coding_type==coding_EA_MT) {
-        free_ea_mt(vgmstream->codec_data, vgmstream->channels);
-        vgmstream->codec_data = NULL;
-    }
-
-#ifdef VGM_USE_FFMPEG
-    if (vgmstream->coding_type==coding_FFmpeg) {
-        free_ffmpeg(vgmstream->codec_data);
-        vgmstream->codec_data = NULL;
-    }
-#endif
-
-#if defined(VGM_USE_MP4V2) && defined(VGM_USE_FDKAAC)
-    if (vgmstream->coding_type==coding_MP4_AAC) {
-        free_mp4_aac(vgmstream->codec_data);
-        vgmstream->codec_data = NULL;
-    }
-#endif
-
-#ifdef VGM_USE_MPEG
-    if (vgmstream->coding_type==coding_MPEG_custom ||
-        vgmstream->coding_type==coding_MPEG_ealayer3 ||
-        vgmstream->coding_type==coding_MPEG_layer1 ||
-        vgmstream->coding_type==coding_MPEG_layer2 ||
-        vgmstream->coding_type==coding_MPEG_layer3) {
-        free_mpeg(vgmstream->codec_data);
-        vgmstream->codec_data = NULL;
-    }
-#endif
-
-#ifdef VGM_USE_G7221
-    if (vgmstream->coding_type == coding_G7221C) {
-        free_g7221(vgmstream);
-        vgmstream->codec_data = NULL;
-    }
-#endif
-
-#ifdef VGM_USE_G719
-    if (vgmstream->coding_type == coding_G719) {
-        free_g719(vgmstream->codec_data, vgmstream->channels);
-        vgmstream->codec_data = NULL;
-    }
-#endif
-
-#ifdef VGM_USE_MAIATRAC3PLUS
-    if (vgmstream->coding_type == coding_AT3plus) {
-        free_at3plus(vgmstream->codec_data);
-        vgmstream->codec_data = NULL;
-    }
-#endif
-
-#ifdef VGM_USE_ATRAC9
-    if (vgmstream->coding_type == coding_ATRAC9) {
-        free_atrac9(vgmstream->codec_data);
-        vgmstream->codec_data = NULL;
-    }
-#endif
+    if (vgmstream->pool && recycle_vgmstream(vgmstream))
+        return;
 
-#ifdef VGM_USE_CELT
-    if (vgmstream->coding_type == coding_CELT_FSB) {
-        free_celt_fsb(vgmstream->codec_data);
-        vgmstream->codec_data = NULL;
-    }
-#endif
+    scope = vgmstream->alloc_scope;
 
-    if (vgmstream->coding_type==coding_ACM) {
-        free_acm(vgmstream->codec_data);
+    info = get_codec_info(vgmstream->coding_type);
+    if (info->free) {
+        info->free(vgmstream);
         vgmstream->codec_data = NULL;
     }
 
-    if (vgmstream->coding_type == coding_NWA) {
-        if (vgmstream->codec_data) {
-            nwa_codec_data *data = (nwa_codec_data *) vgmstream->codec_data;
-            if (data->nwa)
-                close_nwa(data->nwa);
-            free(data);
-            vgmstream->codec_data = NULL;
-        }
-    }
-
 
     if (vgmstream->layout_type==layout_aix) {
         aix_codec_data *data = (aix_codec_data *) vgmstream->codec_data;
@@ -845,13 +999,13 @@ void close_vgmstream(VGMSTREAM * vgmstream) {
                      * there is only one open file in vgmstream->ch[0].streamfile */
                     close_vgmstream(data->adxs[i]);
                 }
-                free(data->adxs);
+                vgm_free(data->adxs);
             }
             if (data->sample_counts) {
-                free(data->sample_counts);
+                vgm_free(data->sample_counts);
             }
 
-            free(data);
+            vgm_free(data);
         }
         vgmstream->codec_data = NULL;
     }
@@ -888,13 +1042,20 @@ void close_vgmstream(VGMSTREAM * vgmstream) {
         }
     }
 
-    if (vgmstream->loop_ch) free(vgmstream->loop_ch);
-    if (vgmstream->start_ch) free(vgmstream->start_ch);
-    if (vgmstream->ch) free(vgmstream->ch);
+    free_checkpoints(vgmstream->checkpoint_data);
+    free_block_index(vgmstream->block_index_data);
+    free_loop_cache(vgmstream->loop_cache_data);
+    free_play_config(vgmstream->play_config_data);
+
+    if (vgmstream->loop_ch) vgm_free(vgmstream->loop_ch);
+    if (vgmstream->start_ch) vgm_free(vgmstream->start_ch);
+    if (vgmstream->ch) vgm_free(vgmstream->ch);
     /* the start_vgmstream is considered just data */
-    if (vgmstream->start_vgmstream) free(vgmstream->start_vgmstream);
+    if (vgmstream->start_vgmstream) vgm_free(vgmstream->start_vgmstream);
+
+    vgm_free(vgmstream);
 
-    free(vgmstream);
+    vgm_alloc_scope_unref(scope); /* freed with the last allocation */
 }
 
 /* calculate samples based on player's config */
@@ -925,12 +1086,12 @@ void vgmstream_force_loop(VGMSTREAM* vgmstream, int loop_flag, int loop_start_sa
 
     /* this requires a bit more messing with the VGMSTREAM than I'm comfortable with... */
     if (loop_flag && !vgmstream->loop_flag && !vgmstream->loop_ch) {
-        vgmstream->loop_ch = calloc(vgmstream->channels,sizeof(VGMSTREAMCHANNEL));
+        vgmstream->loop_ch = vgm_calloc(vgmstream->channels,sizeof(VGMSTREAMCHANNEL));
         /* loop_ch will be populated when decoded samples reach loop start */
     }
     else if (!loop_flag && vgmstream->loop_flag) {
         /* not important though */
-        free(vgmstream->loop_ch);
+        vgm_free(vgmstream->loop_ch);
         vgmstream->loop_ch = NULL;
     }
 
@@ -943,6 +1104,22 @@ void vgmstream_force_loop(VGMSTREAM* vgmstream, int loop_flag, int loop_start_sa
         vgmstream->loop_end_sample = 0;
     }
 
+    /* cached loop (if any) no longer applies */
+    if (vgmstream->loop_cache_data) {
+        free_loop_cache(vgmstream->loop_cache_data);
+        vgmstream->loop_cache_data = NULL;
+    }
+
+    /* keep changes in the start state too, as otherwise resets (seeks) would undo them */
+    if (vgmstream->start_vgmstream) {
+        VGMSTREAM *start_vgmstream = vgmstream->start_vgmstream;
+        start_vgmstream->loop_ch = vgmstream->loop_ch;
+        start_vgmstream->loop_cache_data = NULL;
+        start_vgmstream->loop_flag = vgmstream->loop_flag;
+        start_vgmstream->loop_start_sample = vgmstream->loop_start_sample;
+        start_vgmstream->loop_end_sample = vgmstream->loop_end_sample;
+    }
+
     /* propagate changes to layouts that need them */
     if (vgmstream->layout_type == layout_layered) {
         int i;
@@ -951,13 +1128,15 @@ void vgmstream_force_loop(VGMSTREAM* vgmstream, int loop_flag, int loop_start_sa
             vgmstream_force_loop(data->layers[i], loop_flag, loop_start_sample, loop_end_sample);
         }
     }
-    /* segmented layout only works (ATM) with exact/header loop, full loop or no loop */
+    /* segmented layout finds and seeks the loop segment itself */
 }
 
 void vgmstream_set_loop_target(VGMSTREAM* vgmstream, int loop_target) {
     if (!vgmstream) return;
 
     vgmstream->loop_target = loop_target; /* loop count must be rounded (int) as otherwise target is meaningless */
+    if (vgmstream->start_vgmstream)
+        ((VGMSTREAM*)vgmstream->start_vgmstream)->loop_target = loop_target;
 
     /* propagate changes to layouts that need them */
     if (vgmstream->layout_type == layout_layered) {
@@ -969,9 +1148,93 @@ void vgmstream_set_loop_target(VGMSTREAM* vgmstream, int loop_target) {
     }
 }
 
+int vgmstream_enable_layer_threads(VGMSTREAM* vgmstream, int buffer_samples) {
+    int i, done = 0;
+    if (!vgmstream) return 0;
+
+    if (vgmstream->layout_type == layout_layered) {
+        layered_layout_data *data = vgmstream->layout_data;
+        vgm_alloc_scope * previous = vgm_alloc_scope_enter(vgmstream->alloc_scope);
+        if (config_layout_layered(data, 1, buffer_samples))
+            done = 1;
+        vgm_alloc_scope_leave(previous);
+        for (i = 0; i < data->layer_count; i++) {
+            done |= vgmstream_enable_layer_threads(data->layers[i], buffer_samples);
+        }
+    }
+    else if (vgmstream->layout_type == layout_segmented) {
+        segmented_layout_data *data = vgmstream->layout_data;
+        for (i = 0; i < data->segment_count; i++) {
+            done |= vgmstream_enable_layer_threads(data->segments[i], buffer_samples);
+        }
+    }
+
+    return done;
+}
+
+int vgmstream_enable_segment_prefetch(VGMSTREAM* vgmstream, int prefetch_samples) {
+    int i, done = 0;
+    if (!vgmstream) return 0;
+
+    if (vgmstream->layout_type == layout_segmented) {
+        segmented_layout_data *data = vgmstream->layout_data;
+        vgm_alloc_scope * previous = vgm_alloc_scope_enter(vgmstream->alloc_scope);
+        if (config_layout_segmented(data, prefetch_samples))
+            done = 1;
+        vgm_alloc_scope_leave(previous);
+        for (i = 0; i < data->segment_count; i++) {
+            done |= vgmstream_enable_segment_prefetch(data->segments[i], prefetch_samples);
+        }
+    }
+    else if (vgmstream->layout_type == layout_layered) {
+        layered_layout_data *data = vgmstream->layout_data;
+        for (i = 0; i < data->layer_count; i++) {
+            done |= vgmstream_enable_segment_prefetch(data->layers[i], prefetch_samples);
+        }
+    }
+
+    return done;
+}
+
+int vgmstream_get_segment_stats(VGMSTREAM* vgmstream, segmented_prefetch_stats* stats) {
+    segmented_layout_data *data;
+
+    memset(stats, 0, sizeof(segmented_prefetch_stats));
+    if (!vgmstream || vgmstream->layout_type != layout_segmented)
+        return 0;
+
+    data = vgmstream->layout_data;
+    *stats = data->stats;
+    return 1;
+}
+
 
 /* Decode data into sample buffer */
 void render_vgmstream(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
+    if (vgmstream->play_config_data) {
+        render_play_config(buffer, NULL, sample_count, vgmstream);
+        return;
+    }
+
+    render_vgmstream_main(buffer, sample_count, vgmstream);
+}
+
+void render_vgmstream_main(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
+    /* decoders may (re)allocate, and layers may render in worker threads */
+    vgm_alloc_scope * previous = vgm_alloc_scope_enter(vgmstream->alloc_scope);
+
+    if (vgmstream->loop_cache_data)
+        render_loop_cache(buffer, sample_count, vgmstream);
+    else
+        render_vgmstream_layout(buffer, sample_count, vgmstream);
+
+    apply_channel_settings(vgmstream, buffer, NULL, sample_count);
+
+    vgm_alloc_scope_leave(previous);
+}
+
+/* Decodes with the stream's layout, without channel settings. */
+void render_vgmstream_layout(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
     switch (vgmstream->layout_type) {
         case layout_interleave:
             render_vgmstream_interleave(buffer,sample_count,vgmstream);
@@ -1032,382 +1295,162 @@ void render_vgmstream(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstre
             break;
     }
 
+    if (vgmstream->checkpoint_data)
+        update_checkpoints(vgmstream);
+}
 
-    /* swap channels if set, to create custom channel mappings */
-    if (vgmstream->channel_mappings_on) {
-        int ch_from,ch_to,s;
-        sample temp;
-        for (s = 0; s < sample_count; s++) {
-            for (ch_from = 0; ch_from < vgmstream->channels; ch_from++) {
-                if (ch_from > 32)
-                    continue;
+/* Decode data into a float sample buffer (nominally -1.0..1.0, not clipped). Float decoders output
+ * directly, others are rendered as usual and converted. */
+void render_vgmstream_f32(float * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
+    if (vgmstream->play_config_data) {
+        render_play_config(NULL, buffer, sample_count, vgmstream);
+        return;
+    }
+
+    render_vgmstream_f32_main(buffer, sample_count, vgmstream);
+}
+
+void render_vgmstream_f32_main(float * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
+    vgm_alloc_scope * previous;
 
-                ch_to = vgmstream->channel_mappings[ch_from];
-                if (ch_to < 1 || ch_to > 32 || ch_to > vgmstream->channels-1 || ch_from == ch_to)
-                    continue;
+    if (!decode_vgmstream_f32_supported(vgmstream)) {
+        sample temp[VGMSTREAM_F32_TEMP_SAMPLES];
+        int samples_per_pass = VGMSTREAM_F32_TEMP_SAMPLES / vgmstream->channels;
+        int32_t samples_done = 0;
 
-                temp = buffer[s*vgmstream->channels + ch_from];
-                buffer[s*vgmstream->channels + ch_from] = buffer[s*vgmstream->channels + ch_to];
-                buffer[s*vgmstream->channels + ch_to] = temp;
+        while (samples_done < sample_count) {
+            int i, samples_to_do = samples_per_pass;
+            float * dst = buffer + samples_done * vgmstream->channels;
+            if (samples_to_do > sample_count - samples_done)
+                samples_to_do = sample_count - samples_done;
+
+            render_vgmstream_main(temp, samples_to_do, vgmstream);
+
+            for (i = 0; i < samples_to_do * vgmstream->channels; i++) {
+                dst[i] = temp[i] / 32768.0f;
             }
+            samples_done += samples_to_do;
         }
+        return;
     }
 
-    /* channel bitmask to silence non-set channels (up to 32)
-     * can be used for 'crossfading subsongs' or layered channels, where a set of channels make a song section */
-    if (vgmstream->channel_mask) {
-        int ch,s;
-        for (s = 0; s < sample_count; s++) {
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                if ((vgmstream->channel_mask >> ch) & 1)
-                    continue;
-                buffer[s*vgmstream->channels + ch] = 0;
-            }
+    previous = vgm_alloc_scope_enter(vgmstream->alloc_scope);
+
+    /* loops are decoded (in float) rather than copied from the PCM16 cache */
+    if (vgmstream->loop_cache_data)
+        sync_loop_cache(vgmstream);
+
+    render_vgmstream_flat_f32(buffer, sample_count, vgmstream);
+
+    if (vgmstream->checkpoint_data)
+        update_checkpoints(vgmstream);
+
+    apply_channel_settings(vgmstream, NULL, buffer, sample_count);
+
+    vgm_alloc_scope_leave(previous);
+}
+
+/* Applies TXTP channel config to rendered samples (in buffer, or buffer_f if float).
+ * Mappings (a list of swaps) and mask are first compiled into the source channel of each output
+ * channel, so samples are moved once in a single pass. */
+static void apply_channel_settings(VGMSTREAM * vgmstream, sample * buffer, float * buffer_f, int32_t sample_count) {
+    int channel_map[VGMSTREAM_MAX_CHANNELS]; /* source channel, or -1 to silence */
+    int channels = vgmstream->channels;
+    int ch, s, remapped = 0;
+
+    if (!vgmstream->channel_mappings_on && !vgmstream->channel_mask)
+        return;
+
+    for (ch = 0; ch < channels; ch++) {
+        channel_map[ch] = ch;
+    }
+
+    /* swap channels if set, to create custom channel mappings (in order, so swaps may chain) */
+    if (vgmstream->channel_mappings_on) {
+        int ch_from, ch_to, temp;
+        for (ch_from = 0; ch_from < channels && ch_from < 32; ch_from++) {
+            ch_to = vgmstream->channel_mappings[ch_from];
+            if (ch_to < 1 || ch_to > 32 || ch_to > channels-1 || ch_from == ch_to)
+                continue;
+
+            temp = channel_map[ch_from];
+            channel_map[ch_from] = channel_map[ch_to];
+            channel_map[ch_to] = temp;
+        }
+
+        for (ch = 0; ch < channels; ch++) {
+            if (channel_map[ch] != ch)
+                remapped = 1;
         }
     }
-}
 
-/* Get the number of samples of a single frame (smallest self-contained sample group, 1/N channels) */
-int get_vgmstream_samples_per_frame(VGMSTREAM * vgmstream) {
-    switch (vgmstream->coding_type) {
-        case coding_CRI_ADX:
-        case coding_CRI_ADX_fixed:
-        case coding_CRI_ADX_exp:
-        case coding_CRI_ADX_enc_8:
-        case coding_CRI_ADX_enc_9:
-            return (vgmstream->interleave_block_size - 2) * 2;
-
-        case coding_NGC_DSP:
-        case coding_NGC_DSP_subint:
-            return 14;
-        case coding_NGC_AFC:
-            return 16;
-        case coding_NGC_DTK:
-            return 28;
-        case coding_G721:
-            return 1;
-
-        case coding_PCM16LE:
-        case coding_PCM16BE:
-        case coding_PCM16_int:
-        case coding_PCM8:
-        case coding_PCM8_int:
-        case coding_PCM8_U:
-        case coding_PCM8_U_int:
-        case coding_PCM8_SB:
-        case coding_ULAW:
-        case coding_ULAW_int:
-        case coding_ALAW:
-        case coding_PCMFLOAT:
-            return 1;
-#ifdef VGM_USE_VORBIS
-        case coding_OGG_VORBIS:
-        case coding_VORBIS_custom:
-#endif
-#ifdef VGM_USE_MPEG
-        case coding_MPEG_custom:
-        case coding_MPEG_ealayer3:
-        case coding_MPEG_layer1:
-        case coding_MPEG_layer2:
-        case coding_MPEG_layer3:
-#endif
-        case coding_SDX2:
-        case coding_SDX2_int:
-        case coding_CBD2:
-        case coding_ACM:
-        case coding_DERF:
-        case coding_NWA:
-        case coding_SASSC:
-            return 1;
-
-        case coding_IMA:
-        case coding_DVI_IMA:
-        case coding_SNDS_IMA:
-        case coding_OTNS_IMA:
-        case coding_UBI_IMA:
-            return 1;
-        case coding_IMA_int:
-        case coding_DVI_IMA_int:
-        case coding_3DS_IMA:
-        case coding_WV6_IMA:
-        case coding_ALP_IMA:
-        case coding_FFTA2_IMA:
-            return 2;
-        case coding_XBOX_IMA:
-        case coding_XBOX_IMA_mch:
-        case coding_XBOX_IMA_int:
-        case coding_FSB_IMA:
-        case coding_WWISE_IMA:
-            return 64;
-        case coding_APPLE_IMA4:
-            return 64;
-        case coding_MS_IMA:
-        case coding_REF_IMA:
-            return ((vgmstream->interleave_block_size - 0x04*vgmstream->channels) * 2 / vgmstream->channels) + 1;
-        case coding_RAD_IMA:
-            return (vgmstream->interleave_block_size - 0x04*vgmstream->channels) * 2 / vgmstream->channels;
-        case coding_NDS_IMA:
-        case coding_DAT4_IMA:
-            return (vgmstream->interleave_block_size - 0x04) * 2;
-        case coding_AWC_IMA:
-            return (0x800 - 0x04) * 2;
-        case coding_RAD_IMA_mono:
-            return 32;
-        case coding_H4M_IMA:
-            return 0; /* variable (block-controlled) */
-
-        case coding_XA:
-            return 28*8 / vgmstream->channels; /* 8 subframes per frame, mono/stereo */
-        case coding_PSX:
-        case coding_PSX_badflags:
-        case coding_HEVAG:
-            return 28;
-        case coding_PSX_cfg:
-            return (vgmstream->interleave_block_size - 1) * 2; /* decodes 1 byte into 2 bytes */
-
-        case coding_EA_XA:
-        case coding_EA_XA_int:
-        case coding_EA_XA_V2:
-        case coding_MAXIS_XA:
-            return 28;
-        case coding_EA_XAS:
-            return 128;
-
-        case coding_MSADPCM:
-            return (vgmstream->interleave_block_size - 0x07*vgmstream->channels)*2 / vgmstream->channels + 2;
-        case coding_MSADPCM_ck:
-            return (vgmstream->interleave_block_size - 0x07)*2 + 2;
-        case coding_WS: /* only works if output sample size is 8 bit, which always is for WS ADPCM */
-            return vgmstream->ws_output_size;
-        case coding_AICA:
-            return 1;
-        case coding_AICA_int:
-            return 2;
-        case coding_YAMAHA:
-            return (0x40-0x04*vgmstream->channels) * 2 / vgmstream->channels;
-        case coding_YAMAHA_NXAP:
-            return (0x40-0x04) * 2;
-        case coding_NDS_PROCYON:
-            return 30;
-        case coding_L5_555:
-            return 32;
-        case coding_LSF:
-            return 54;
-
-#ifdef VGM_USE_G7221
-        case coding_G7221C:
-            return 32000/50; /* Siren7: 16000/50 */
-#endif
-#ifdef VGM_USE_G719
-        case coding_G719:
-            return 48000/50;
-#endif
-#ifdef VGM_USE_FFMPEG
-        case coding_FFmpeg:
-            if (vgmstream->codec_data) {
-                ffmpeg_codec_data *data = (ffmpeg_codec_data*)vgmstream->codec_data;
-                return data->sampleBufferBlock; /* must know the full block size for edge loops */
+    /* channel bitmask to silence non-set channels (up to 32)
+     * can be used for 'crossfading subsongs' or layered channels, where a set of channels make a song section */
+    if (vgmstream->channel_mask) {
+        for (ch = 0; ch < channels && ch < 32; ch++) {
+            if (!((vgmstream->channel_mask >> ch) & 1))
+                channel_map[ch] = -1;
+        }
+    }
+
+    if (!remapped) {
+        /* only silence, per channel so the compiler can unroll */
+        for (ch = 0; ch < channels; ch++) {
+            if (channel_map[ch] >= 0)
+                continue;
+            if (buffer_f) {
+                for (s = 0; s < sample_count; s++) {
+                    buffer_f[s*channels + ch] = 0;
+                }
             }
             else {
-                return 0;
+                for (s = 0; s < sample_count; s++) {
+                    buffer[s*channels + ch] = 0;
+                }
             }
-            break;
-#endif
-        case coding_MTAF:
-            return 128*2;
-        case coding_MTA2:
-            return 128*2;
-        case coding_MC3:
-            return 10;
-        case coding_FADPCM:
-            return 256; /* (0x8c - 0xc) * 2 */
-        case coding_ASF:
-            return 32;  /* (0x11 - 0x1) * 2 */
-        case coding_XMD:
-            return (vgmstream->interleave_block_size - 0x06)*2 + 2;
-        case coding_EA_MT:
-            return 0; /* 432, but variable in looped files */
-        case coding_CRI_HCA:
-            return 0; /* 1024 - delay/padding (which can be bigger than 1024) */
-#if defined(VGM_USE_MP4V2) && defined(VGM_USE_FDKAAC)
-        case coding_MP4_AAC:
-            return ((mp4_aac_codec_data*)vgmstream->codec_data)->samples_per_frame;
-#endif
-#ifdef VGM_USE_MAIATRAC3PLUS
-        case coding_AT3plus:
-            return 2048 - ((maiatrac3plus_codec_data*)vgmstream->codec_data)->samples_discard;
-#endif
-#ifdef VGM_USE_ATRAC9
-        case coding_ATRAC9:
-            return 0; /* varies with config data, usually 256 or 1024 */
-#endif
-#ifdef VGM_USE_CELT
-        case coding_CELT_FSB:
-            return 0; /* 512? */
-#endif
-        default:
-            return 0;
+        }
+        return;
+    }
+
+    /* gather each frame from a copy */
+    if (buffer_f) {
+        float frame[VGMSTREAM_MAX_CHANNELS];
+        for (s = 0; s < sample_count; s++) {
+            float * dst = buffer_f + s*channels;
+            memcpy(frame, dst, channels * sizeof(float));
+            for (ch = 0; ch < channels; ch++) {
+                dst[ch] = channel_map[ch] < 0 ? 0 : frame[channel_map[ch]];
+            }
+        }
+    }
+    else {
+        sample frame[VGMSTREAM_MAX_CHANNELS];
+        for (s = 0; s < sample_count; s++) {
+            sample * dst = buffer + s*channels;
+            memcpy(frame, dst, channels * sizeof(sample));
+            for (ch = 0; ch < channels; ch++) {
+                dst[ch] = channel_map[ch] < 0 ? 0 : frame[channel_map[ch]];
+            }
+        }
     }
 }
 
+/* Get the number of samples of a single frame (smallest self-contained sample group, 1/N channels) */
+int get_vgmstream_samples_per_frame(VGMSTREAM * vgmstream) {
+    const codec_info * info = get_codec_info(vgmstream->coding_type);
+
+    if (info->get_samples_per_frame)
+        return info->get_samples_per_frame(vgmstream);
+    return info->samples_per_frame;
+}
+
 /* Get the number of bytes of a single frame (smallest self-contained byte group, 1/N channels) */
 int get_vgmstream_frame_size(VGMSTREAM * vgmstream) {
-    switch (vgmstream->coding_type) {
-        case coding_CRI_ADX:
-        case coding_CRI_ADX_fixed:
-        case coding_CRI_ADX_exp:
-        case coding_CRI_ADX_enc_8:
-        case coding_CRI_ADX_enc_9:
-            return vgmstream->interleave_block_size;
-
-        case coding_NGC_DSP:
-            return 0x08;
-        case coding_NGC_DSP_subint:
-            return 0x08 * vgmstream->channels;
-        case coding_NGC_AFC:
-            return 0x09;
-        case coding_NGC_DTK:
-            return 0x20;
-        case coding_G721:
-            return 0;
+    const codec_info * info = get_codec_info(vgmstream->coding_type);
 
-        case coding_PCM16LE:
-        case coding_PCM16BE:
-        case coding_PCM16_int:
-            return 0x02;
-        case coding_PCM8:
-        case coding_PCM8_int:
-        case coding_PCM8_U:
-        case coding_PCM8_U_int:
-        case coding_PCM8_SB:
-        case coding_ULAW:
-        case coding_ULAW_int:
-        case coding_ALAW:
-            return 0x01;
-        case coding_PCMFLOAT:
-            return 0x04;
-
-        case coding_SDX2:
-        case coding_SDX2_int:
-        case coding_CBD2:
-        case coding_DERF:
-        case coding_NWA:
-        case coding_SASSC:
-            return 0x01;
-
-        case coding_IMA:
-        case coding_IMA_int:
-        case coding_DVI_IMA:
-        case coding_DVI_IMA_int:
-        case coding_3DS_IMA:
-        case coding_WV6_IMA:
-        case coding_ALP_IMA:
-        case coding_FFTA2_IMA:
-            return 0x01;
-        case coding_MS_IMA:
-        case coding_RAD_IMA:
-        case coding_NDS_IMA:
-        case coding_DAT4_IMA:
-        case coding_REF_IMA:
-            return vgmstream->interleave_block_size;
-        case coding_AWC_IMA:
-            return 0x800;
-        case coding_RAD_IMA_mono:
-            return 0x14;
-        case coding_SNDS_IMA:
-        case coding_OTNS_IMA:
-            return 0; //todo: 0x01?
-        case coding_UBI_IMA: /* variable (PCM then IMA) */
-            return 0;
-        case coding_XBOX_IMA:
-            //todo should be  0x48 when stereo, but blocked/interleave layout don't understand stereo codecs
-            return 0x24; //vgmstream->channels==1 ? 0x24 : 0x48;
-        case coding_XBOX_IMA_int:
-        case coding_WWISE_IMA:
-            return 0x24;
-        case coding_XBOX_IMA_mch:
-        case coding_FSB_IMA:
-            return 0x24 * vgmstream->channels;
-        case coding_APPLE_IMA4:
-            return 0x22;
-        case coding_H4M_IMA:
-            return 0x00; /* variable (block-controlled) */
-
-        case coding_XA:
-            return 0x80;
-        case coding_PSX:
-        case coding_PSX_badflags:
-        case coding_HEVAG:
-            return 0x10;
-        case coding_PSX_cfg:
-            return vgmstream->interleave_block_size;
-
-        case coding_EA_XA:
-            return 0x1E;
-        case coding_EA_XA_int:
-            return 0x0F;
-        case coding_MAXIS_XA:
-            return 0x0F*vgmstream->channels;
-        case coding_EA_XA_V2:
-            return 0; /* variable (ADPCM frames of 0x0f or PCM frames of 0x3d) */
-        case coding_EA_XAS:
-            return 0x4c*vgmstream->channels;
-
-        case coding_MSADPCM:
-        case coding_MSADPCM_ck:
-            return vgmstream->interleave_block_size;
-        case coding_WS:
-            return vgmstream->current_block_size;
-        case coding_AICA:
-        case coding_AICA_int:
-            return 0x01;
-        case coding_YAMAHA:
-        case coding_YAMAHA_NXAP:
-            return 0x40;
-        case coding_NDS_PROCYON:
-            return 0x10;
-        case coding_L5_555:
-            return 0x12;
-        case coding_LSF:
-            return 0x1C;
-
-#ifdef VGM_USE_G7221
-        case coding_G7221C:
-#endif
-#ifdef VGM_USE_G719
-        case coding_G719:
-#endif
-#ifdef VGM_USE_MAIATRAC3PLUS
-        case coding_AT3plus:
-#endif
-#ifdef VGM_USE_FFMPEG
-        case coding_FFmpeg:
-#endif
-        case coding_MTAF:
-            return vgmstream->interleave_block_size;
-        case coding_MTA2:
-            return 0x90;
-        case coding_MC3:
-            return 0x04;
-        case coding_FADPCM:
-            return 0x8c;
-        case coding_ASF:
-            return 0x11;
-        case coding_XMD:
-            return vgmstream->interleave_block_size;
-        case coding_EA_MT:
-            return 0; /* variable (frames of bit counts or PCM frames) */
-#ifdef VGM_USE_ATRAC9
-        case coding_ATRAC9:
-            return 0; /* varies with config data, usually 0x100-200 */
-#endif
-#ifdef VGM_USE_CELT
-        case coding_CELT_FSB:
-            return 0; /* varies, usually 0x80-100 */
-#endif
-        default: /* Vorbis, MPEG, ACM, etc */
-            return 0;
-    }
+    if (info->get_frame_size)
+        return info->get_frame_size(vgmstream);
+    return info->frame_size;
 }
 
 /* In NDS IMA the frame size is the block size, so the last one is short */
@@ -1431,579 +1474,44 @@ int get_vgmstream_shortframe_size(VGMSTREAM * vgmstream) {
 /* Decode samples into the buffer. Assume that we have written samples_written into the
  * buffer already, and we have samples_to_do consecutive samples ahead of us. */
 void decode_vgmstream(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
-    int ch;
-
-    switch (vgmstream->coding_type) {
-        case coding_CRI_ADX:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_adx(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do,
-                        vgmstream->interleave_block_size);
-            }
-
-            break;
-        case coding_CRI_ADX_exp:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_adx_exp(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do,
-                        vgmstream->interleave_block_size);
-            }
-
-            break;
-        case coding_CRI_ADX_fixed:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_adx_fixed(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do,
-                        vgmstream->interleave_block_size);
-            }
-
-            break;
-        case coding_CRI_ADX_enc_8:
-        case coding_CRI_ADX_enc_9:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_adx_enc(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do,
-                        vgmstream->interleave_block_size);
-            }
-
-            break;
-        case coding_NGC_DSP:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_ngc_dsp(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_NGC_DSP_subint:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_ngc_dsp_subint(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do,
-                        ch, vgmstream->interleave_block_size);
-            }
-            break;
-
-        case coding_PCM16LE:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_pcm16le(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_PCM16BE:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_pcm16be(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_PCM16_int:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_pcm16_int(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do,
-                        vgmstream->codec_endian);
-            }
-            break;
-        case coding_PCM8:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_pcm8(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_PCM8_int:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_pcm8_int(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_PCM8_U:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_pcm8_unsigned(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_PCM8_U_int:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_pcm8_unsigned_int(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_PCM8_SB:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_pcm8_sb(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-
-        case coding_ULAW:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_ulaw(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_ULAW_int:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_ulaw_int(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_ALAW:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_alaw(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_PCMFLOAT:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_pcmfloat(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do,
-                        vgmstream->codec_endian);
-            }
-            break;
+    const codec_info * info = get_codec_info(vgmstream->coding_type);
 
-        case coding_NDS_IMA:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_nds_ima(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_DAT4_IMA:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_dat4_ima(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_XBOX_IMA:
-        case coding_XBOX_IMA_int:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                int is_stereo = (vgmstream->channels > 1 && vgmstream->coding_type == coding_XBOX_IMA);
-                decode_xbox_ima(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do, ch,
-                        is_stereo);
-            }
-            break;
-        case coding_XBOX_IMA_mch:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_xbox_ima_mch(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do, ch);
-            }
-            break;
-        case coding_MS_IMA:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_ms_ima(vgmstream,&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do, ch);
-            }
-            break;
-        case coding_RAD_IMA:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_rad_ima(vgmstream,&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do, ch);
-            }
-            break;
-        case coding_RAD_IMA_mono:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_rad_ima_mono(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_NGC_DTK:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_ngc_dtk(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do, ch);
-            }
-            break;
-        case coding_G721:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_g721(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_NGC_AFC:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_ngc_afc(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_PSX:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_psx(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do, 0);
-            }
-            break;
-        case coding_PSX_badflags:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_psx(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do, 1);
-            }
-            break;
-        case coding_PSX_cfg:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_psx_configurable(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do, vgmstream->interleave_block_size);
-            }
-            break;
-        case coding_HEVAG:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_hevag(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_XA:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_xa(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do, ch);
-            }
-            break;
-        case coding_EA_XA:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_ea_xa(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do, ch);
-            }
-            break;
-        case coding_EA_XA_int:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_ea_xa_int(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do, ch);
-            }
-            break;
-        case coding_EA_XA_V2:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_ea_xa_v2(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do, ch);
-            }
-            break;
-        case coding_MAXIS_XA:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_maxis_xa(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do, ch);
-            }
-            break;
-        case coding_EA_XAS:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_ea_xas(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do, ch);
-            }
-            break;
-#ifdef VGM_USE_VORBIS
-        case coding_OGG_VORBIS:
-            decode_ogg_vorbis(vgmstream->codec_data, buffer+samples_written*vgmstream->channels,
-                    samples_to_do,vgmstream->channels);
-            break;
+    if (info->decode)
+        info->decode(vgmstream, samples_written, samples_to_do, buffer);
+}
 
-        case coding_VORBIS_custom:
-            decode_vorbis_custom(vgmstream, buffer+samples_written*vgmstream->channels,
-                    samples_to_do,vgmstream->channels);
-            break;
-#endif
-        case coding_CRI_HCA:
-            decode_hca(vgmstream->codec_data, buffer+samples_written*vgmstream->channels,
-                    samples_to_do);
-            break;
-#ifdef VGM_USE_FFMPEG
-        case coding_FFmpeg:
-            decode_ffmpeg(vgmstream,
-                          buffer+samples_written*vgmstream->channels,samples_to_do,vgmstream->channels);
-            break;
-#endif
-#if defined(VGM_USE_MP4V2) && defined(VGM_USE_FDKAAC)
-        case coding_MP4_AAC:
-            decode_mp4_aac(vgmstream->codec_data, buffer+samples_written*vgmstream->channels,
-                    samples_to_do,vgmstream->channels);
-            break;
-#endif
-        case coding_SDX2:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_sdx2(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_SDX2_int:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_sdx2_int(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_CBD2:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_cbd2(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_CBD2_int:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_cbd2_int(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_DERF:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_derf(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
+/* Returns if the stream can be decoded to float directly (decoders that work in float internally) */
+int decode_vgmstream_f32_supported(VGMSTREAM * vgmstream) {
+    if (vgmstream->layout_type != layout_none)
+        return 0;
 
-        case coding_IMA:
-        case coding_IMA_int:
-        case coding_DVI_IMA:
-        case coding_DVI_IMA_int:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                int is_stereo = (vgmstream->channels > 1 && vgmstream->coding_type == coding_IMA)
-                        || (vgmstream->channels > 1 && vgmstream->coding_type == coding_DVI_IMA);
-                int is_high_first = vgmstream->coding_type == coding_DVI_IMA || vgmstream->coding_type == coding_DVI_IMA_int;
-
-                decode_standard_ima(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do, ch,
-                        is_stereo, is_high_first);
-            }
-            break;
-        case coding_3DS_IMA:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_3ds_ima(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_WV6_IMA:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_wv6_ima(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_ALP_IMA:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_alp_ima(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_FFTA2_IMA:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_ffta2_ima(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
+    return (get_codec_info(vgmstream->coding_type)->flags & CODEC_FLOAT) != 0;
+}
 
-        case coding_APPLE_IMA4:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_apple_ima4(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_SNDS_IMA:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_snds_ima(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do, ch);
-            }
-            break;
-        case coding_OTNS_IMA:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_otns_ima(vgmstream, &vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do, ch);
-            }
-            break;
-        case coding_FSB_IMA:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_fsb_ima(vgmstream, &vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do, ch);
-            }
-            break;
-        case coding_WWISE_IMA:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_wwise_ima(vgmstream,&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do, ch);
-            }
-            break;
-        case coding_REF_IMA:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_ref_ima(vgmstream,&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do, ch);
-            }
-            break;
-        case coding_AWC_IMA:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_awc_ima(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_UBI_IMA:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_ubi_ima(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do, ch);
-            }
-            break;
-        case coding_H4M_IMA:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                uint16_t frame_format = (uint16_t)((vgmstream->codec_config >> 8) & 0xFFFF);
+/* Same as decode_vgmstream but into a float buffer, for decode_vgmstream_f32_supported codecs */
+void decode_vgmstream_f32(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, float * buffer) {
+    const codec_info * info = get_codec_info(vgmstream->coding_type);
 
-                decode_h4m_ima(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do, ch,
-                        frame_format);
-            }
-            break;
+    if (info->decode_f32)
+        info->decode_f32(vgmstream, samples_written, samples_to_do, buffer);
+    else
+        memset(buffer+samples_written*vgmstream->channels, 0, samples_to_do * vgmstream->channels * sizeof(float));
+}
 
-        case coding_WS:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_ws(vgmstream,ch,buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
+/* Copies channel state (ex. ch into loop_ch), only the parts of VGMSTREAMCHANNEL the codec uses. */
+void copy_vgmstream_channels(VGMSTREAM * vgmstream, VGMSTREAMCHANNEL * dst, const VGMSTREAMCHANNEL * src) {
+    size_t channel_size;
+    int ch;
 
-#ifdef VGM_USE_MPEG
-        case coding_MPEG_custom:
-        case coding_MPEG_ealayer3:
-        case coding_MPEG_layer1:
-        case coding_MPEG_layer2:
-        case coding_MPEG_layer3:
-            decode_mpeg(vgmstream,buffer+samples_written*vgmstream->channels,
-                    samples_to_do,vgmstream->channels);
-            break;
-#endif
-#ifdef VGM_USE_G7221
-        case coding_G7221C:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_g7221(vgmstream, buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,samples_to_do, ch);
-            }
-            break;
-#endif
-#ifdef VGM_USE_G719
-        case coding_G719:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_g719(vgmstream, buffer+samples_written*vgmstream->channels+ch,
-                    vgmstream->channels,samples_to_do, ch);
-            }
-            break;
-#endif
-#ifdef VGM_USE_MAIATRAC3PLUS
-        case coding_AT3plus:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_at3plus(vgmstream, buffer+samples_written*vgmstream->channels+ch,
-                    vgmstream->channels,samples_to_do, ch);
-            }
-            break;
-#endif
-#ifdef VGM_USE_ATRAC9
-        case coding_ATRAC9:
-            decode_atrac9(vgmstream, buffer+samples_written*vgmstream->channels,
-                    samples_to_do,vgmstream->channels);
-            break;
-#endif
-#ifdef VGM_USE_CELT
-        case coding_CELT_FSB:
-            decode_celt_fsb(vgmstream, buffer+samples_written*vgmstream->channels,
-                    samples_to_do,vgmstream->channels);
-            break;
-#endif
-        case coding_ACM:
-            decode_acm(vgmstream->codec_data, buffer+samples_written*vgmstream->channels,
-                    samples_to_do, vgmstream->channels);
-            break;
-        case coding_NWA:
-            decode_nwa(((nwa_codec_data*)vgmstream->codec_data)->nwa,
-                    buffer+samples_written*vgmstream->channels, samples_to_do);
-            break;
-        case coding_MSADPCM:
-            if (vgmstream->channels == 2) {
-                decode_msadpcm_stereo(vgmstream,buffer+samples_written*vgmstream->channels,
-                        vgmstream->samples_into_block,samples_to_do);
-            }
-            else if (vgmstream->channels == 1) {
-                decode_msadpcm_mono(vgmstream,buffer+samples_written*vgmstream->channels,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do, 0);
-            }
-            break;
-        case coding_MSADPCM_ck:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_msadpcm_ck(vgmstream,buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block, samples_to_do, ch);
-            }
-            break;
-        case coding_AICA:
-        case coding_AICA_int:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                int is_stereo = (vgmstream->channels > 1 && vgmstream->coding_type == coding_AICA);
-
-                decode_aica(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do, ch,
-                        is_stereo);
-            }
-            break;
-        case coding_YAMAHA:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_yamaha(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do, ch);
-            }
-            break;
-        case coding_YAMAHA_NXAP:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_yamaha_nxap(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_NDS_PROCYON:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_nds_procyon(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_L5_555:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_l5_555(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_SASSC:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_sassc(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
+    if (get_codec_info(vgmstream->coding_type)->flags & CODEC_CHANNEL_EXT) {
+        memcpy(dst, src, sizeof(VGMSTREAMCHANNEL) * vgmstream->channels);
+        return;
+    }
 
-            break;
-        case coding_LSF:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_lsf(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_MTAF:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_mtaf(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels, vgmstream->samples_into_block, samples_to_do, ch);
-            }
-            break;
-        case coding_MTA2:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_mta2(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels, vgmstream->samples_into_block, samples_to_do, ch);
-            }
-            break;
-        case coding_MC3:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_mc3(vgmstream, &vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels, vgmstream->samples_into_block, samples_to_do, ch);
-            }
-            break;
-        case coding_FADPCM:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_fadpcm(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_ASF:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_asf(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
-            }
-            break;
-        case coding_XMD:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_xmd(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels,vgmstream->samples_into_block,samples_to_do,
-                        vgmstream->interleave_block_size);
-            }
-            break;
-        case coding_EA_MT:
-            for (ch = 0; ch < vgmstream->channels; ch++) {
-                decode_ea_mt(vgmstream, buffer+samples_written*vgmstream->channels+ch,
-                        vgmstream->channels, samples_to_do, ch);
-            }
-            break;
-        default:
-            break;
+    /* the extended part is at the end */
+    channel_size = offsetof(VGMSTREAMCHANNEL, g72x_state);
+    for (ch = 0; ch < vgmstream->channels; ch++) {
+        memcpy(&dst[ch], &src[ch], channel_size);
     }
 }
 
@@ -2041,6 +1549,7 @@ int vgmstream_samples_to_do(int samples_this_block, int samples_per_frame, VGMST
 
 /* Detect loop start and save values, or detect loop end and restore (loop back). Returns 1 if loop was done. */
 int vgmstream_do_loop(VGMSTREAM * vgmstream) {
+    const codec_info * info = get_codec_info(vgmstream->coding_type);
     /*if (!vgmstream->loop_flag) return 0;*/
 
     /* is this the loop end? = new loop, continue from loop_start_sample */
@@ -2059,8 +1568,7 @@ int vgmstream_do_loop(VGMSTREAM * vgmstream) {
         if (vgmstream->meta_type == meta_DSP_STD ||
             vgmstream->meta_type == meta_DSP_RS03 ||
             vgmstream->meta_type == meta_DSP_CSTR ||
-            vgmstream->coding_type == coding_PSX ||
-            vgmstream->coding_type == coding_PSX_badflags) {
+            (info->flags & CODEC_LOOP_HISTORY)) {
             int i;
             for (i=0;i<vgmstream->channels;i++) {
                 vgmstream->loop_ch[i].adpcm_history1_16 = vgmstream->ch[i].adpcm_history1_16;
@@ -2072,73 +1580,15 @@ int vgmstream_do_loop(VGMSTREAM * vgmstream) {
 
 
         /* prepare certain codecs' internal state for looping */
-
-        if (vgmstream->coding_type==coding_CRI_HCA) {
-            loop_hca(vgmstream->codec_data);
-        }
-
-        if (vgmstream->coding_type==coding_EA_MT) {
-            seek_ea_mt(vgmstream, vgmstream->loop_start_sample);
-        }
-
-#ifdef VGM_USE_VORBIS
-        if (vgmstream->coding_type==coding_OGG_VORBIS) {
-            seek_ogg_vorbis(vgmstream, vgmstream->loop_sample);
-        }
-
-        if (vgmstream->coding_type==coding_VORBIS_custom) {
-            seek_vorbis_custom(vgmstream, vgmstream->loop_start_sample);
-        }
-#endif
-
-#ifdef VGM_USE_FFMPEG
-        if (vgmstream->coding_type==coding_FFmpeg) {
-            seek_ffmpeg(vgmstream, vgmstream->loop_start_sample);
+        if (info->loop) {
+            info->loop(vgmstream);
         }
-#endif
-
-#if defined(VGM_USE_MP4V2) && defined(VGM_USE_FDKAAC)
-        if (vgmstream->coding_type==coding_MP4_AAC) {
-            seek_mp4_aac(vgmstream, vgmstream->loop_sample);
-        }
-#endif
-
-#ifdef VGM_USE_MAIATRAC3PLUS
-        if (vgmstream->coding_type==coding_AT3plus) {
-            seek_at3plus(vgmstream, vgmstream->loop_sample);
-        }
-#endif
-
-#ifdef VGM_USE_ATRAC9
-        if (vgmstream->coding_type==coding_ATRAC9) {
-            seek_atrac9(vgmstream, vgmstream->loop_sample);
-        }
-#endif
-
-#ifdef VGM_USE_CELT
-        if (vgmstream->coding_type==coding_CELT_FSB) {
-            seek_celt_fsb(vgmstream, vgmstream->loop_sample);
-        }
-#endif
-
-#ifdef VGM_USE_MPEG
-        if (vgmstream->coding_type==coding_MPEG_custom ||
-            vgmstream->coding_type==coding_MPEG_ealayer3 ||
-            vgmstream->coding_type==coding_MPEG_layer1 ||
-            vgmstream->coding_type==coding_MPEG_layer2 ||
-            vgmstream->coding_type==coding_MPEG_layer3) {
-            seek_mpeg(vgmstream, vgmstream->loop_sample);
-        }
-#endif
-
-        if (vgmstream->coding_type == coding_NWA) {
-            nwa_codec_data *data = vgmstream->codec_data;
-            if (data)
-                seek_nwa(data->nwa, vgmstream->loop_sample);
+        else if (info->seek) {
+            info->seek(vgmstream, vgmstream->loop_sample);
         }
 
         /* restore! */
-        memcpy(vgmstream->ch,vgmstream->loop_ch,sizeof(VGMSTREAMCHANNEL)*vgmstream->channels);
+        copy_vgmstream_channels(vgmstream, vgmstream->ch, vgmstream->loop_ch);
         vgmstream->current_sample = vgmstream->loop_sample;
         vgmstream->samples_into_block = vgmstream->loop_samples_into_block;
         vgmstream->current_block_size = vgmstream->loop_block_size;
@@ -2153,7 +1603,7 @@ int vgmstream_do_loop(VGMSTREAM * vgmstream) {
     /* is this the loop start? */
     if (!vgmstream->hit_loop && vgmstream->current_sample==vgmstream->loop_start_sample) {
         /* save! */
-        memcpy(vgmstream->loop_ch,vgmstream->ch,sizeof(VGMSTREAMCHANNEL)*vgmstream->channels);
+        copy_vgmstream_channels(vgmstream, vgmstream->loop_ch, vgmstream->ch);
 
         vgmstream->loop_sample = vgmstream->current_sample;
         vgmstream->loop_samples_into_block = vgmstream->samples_into_block;
@@ -2440,39 +1890,39 @@ static void try_dual_file_stereo(VGMSTREAM * opened_vgmstream, STREAMFILE *strea
         VGMSTREAMCHANNEL * new_start_chans = NULL;
 
         /* build the channels */
-        new_chans = calloc(2,sizeof(VGMSTREAMCHANNEL));
+        new_chans = vgm_calloc(2,sizeof(VGMSTREAMCHANNEL));
         if (!new_chans) goto fail;
 
         memcpy(&new_chans[dfs_pair],&opened_vgmstream->ch[0],sizeof(VGMSTREAMCHANNEL));
         memcpy(&new_chans[dfs_pair^1],&new_vgmstream->ch[0],sizeof(VGMSTREAMCHANNEL));
 
         /* loop and start will be initialized later, we just need to allocate them here */
-        new_start_chans = calloc(2,sizeof(VGMSTREAMCHANNEL));
+        new_start_chans = vgm_calloc(2,sizeof(VGMSTREAMCHANNEL));
         if (!new_start_chans) {
-            free(new_chans);
+            vgm_free(new_chans);
             goto fail;
         }
 
         if (opened_vgmstream->loop_ch) {
-            new_loop_chans = calloc(2,sizeof(VGMSTREAMCHANNEL));
+            new_loop_chans = vgm_calloc(2,sizeof(VGMSTREAMCHANNEL));
             if (!new_loop_chans) {
-                free(new_chans);
-                free(new_start_chans);
+                vgm_free(new_chans);
+                vgm_free(new_start_chans);
                 goto fail;
             }
         }
 
         /* remove the existing structures */
         /* not using close_vgmstream as that would close the file */
-        free(opened_vgmstream->ch);
-        free(new_vgmstream->ch);
+        vgm_free(opened_vgmstream->ch);
+        vgm_free(new_vgmstream->ch);
 
-        free(opened_vgmstream->start_ch);
-        free(new_vgmstream->start_ch);
+        vgm_free(opened_vgmstream->start_ch);
+        vgm_free(new_vgmstream->start_ch);
 
         if (opened_vgmstream->loop_ch) {
-            free(opened_vgmstream->loop_ch);
-            free(new_vgmstream->loop_ch);
+            vgm_free(opened_vgmstream->loop_ch);
+            vgm_free(new_vgmstream->loop_ch);
         }
 
         /* fill in the new structures */
@@ -2484,7 +1934,8 @@ static void try_dual_file_stereo(VGMSTREAM * opened_vgmstream, STREAMFILE *strea
         opened_vgmstream->channels = 2;
 
         /* discard the second VGMSTREAM */
-        free(new_vgmstream);
+        vgm_alloc_scope_unref(new_vgmstream->alloc_scope);
+        vgm_free(new_vgmstream);
     }
 
 fail:
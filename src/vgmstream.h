@@ -9,6 +9,7 @@ enum { PATH_LIMIT = 32768 };
 enum { STREAM_NAME_SIZE = 255 }; /* reasonable max */
 
 #include "streamfile.h"
+#include "threads.h"
 
 /* Due mostly to licensing issues, Vorbis, MPEG, G.722.1, etc decoding is done by external libraries.
  * Libs are disabled by default, defined on compile-time for builds that support it */
@@ -717,7 +718,7 @@ typedef struct {
 
     /* adpcm */
     int16_t adpcm_coef[16]; /* for formats with decode coefficients built in */
-    int32_t adpcm_coef_3by32[0x60];     /* for Level-5 0x555 */
+    int32_t * adpcm_coef_3by32; /* for Level-5 0x555 (0x60 coefs, allocated by the meta and freed on close) */
     union {
         int16_t adpcm_history1_16;  /* previous sample */
         int32_t adpcm_history1_32;
@@ -735,23 +736,26 @@ typedef struct {
         int32_t adpcm_history4_32;
     };
 
-    double adpcm_history1_double;
-    double adpcm_history2_double;
-
     int adpcm_step_index;       /* for IMA */
     int adpcm_scale;            /* for MS ADPCM */
 
-    /* state for G.721 decoder, sort of big but we might as well keep it around */
-    struct g72x_state g72x_state;
-
     /* ADX encryption */
     int adx_channels;
     uint16_t adx_xor;
     uint16_t adx_mult;
     uint16_t adx_add;
 
+    /* Extended state, only copied between ch/start_ch/loop_ch for codecs with CODEC_CHANNEL_EXT
+     * (fields above are the part all codecs use, see copy_vgmstream_channels) */
+
+    /* state for G.721 decoder, sort of big so it's not copied around otherwise */
+    struct g72x_state g72x_state;
+
 } VGMSTREAMCHANNEL;
 
+/* idle streams kept for reopening (see init_vgmstream_from_pool) */
+typedef struct vgmstream_pool vgmstream_pool;
+
 /* main vgmstream info */
 typedef struct {
     /* basics */
@@ -834,6 +838,15 @@ typedef struct {
     void * codec_data;
     /* Same, for special layouts. layout_data + codec_data may exist at the same time. */
     void * layout_data;
+
+    void * checkpoint_data;         /* seek checkpoints (optional, shared with start_vgmstream) */
+    void * block_index_data;        /* blocked layout index (optional, shared with start_vgmstream) */
+    void * loop_cache_data;         /* decoded loop (optional, shared with start_vgmstream) */
+    void * play_config_data;        /* final length and fade (optional, shared with start_vgmstream) */
+
+    vgm_alloc_scope * alloc_scope;  /* memory accounting (shared with start_vgmstream, segments and layers) */
+    vgmstream_pool * pool;          /* returned there on close, if opened from a pool */
+    int format_index;               /* init function that opened the stream + 1 (0 = unknown) */
 } VGMSTREAM;
 
 #ifdef VGM_USE_VORBIS
@@ -894,6 +907,18 @@ typedef struct {
 
 } vorbis_custom_config;
 
+/* custom Vorbis packet position, to restart decoding mid-stream */
+typedef struct {
+    off_t offset;               /* packet start */
+    int32_t sample;             /* first sample output when decoding restarts at this packet (from the next packet) */
+
+    /* parser state before reading the packet */
+    uint8_t prev_blockflag;
+    int current_packet;
+    off_t block_offset;
+    size_t block_size;
+} vorbis_custom_seek_entry;
+
 /* custom Vorbis without Ogg layer */
 typedef struct {
     vorbis_info vi;             /* stream settings */
@@ -923,6 +948,16 @@ typedef struct {
 
     int prev_block_samples;     /* count for optimization */
 
+    /* seek table, filled while decoding or scanning packets */
+    vorbis_custom_seek_entry * seek_entries;
+    int seek_count;
+    int seek_max;
+    int seek_scanned;                   /* flag, all packets are in the table */
+    int32_t current_sample;             /* position of the next sample returned by libvorbis */
+    vorbis_custom_seek_entry seek_prev; /* state before reading the previous packet */
+    int seek_prev_set;                  /* flag, seek_prev is usable */
+    vorbis_custom_seek_entry seek_start; /* parser state at stream start */
+
 } vorbis_custom_codec_data;
 #endif
 
@@ -961,6 +996,12 @@ typedef struct {
     uint16_t cri_key3;
 } mpeg_custom_config;
 
+/* custom MPEG frame position, to restart decoding mid-stream */
+typedef struct {
+    off_t offset;           /* frame start */
+    int32_t sample;         /* samples decoded in this stream before the frame */
+} mpeg_custom_seek_entry;
+
 /* represents a single MPEG stream */
 typedef struct {
     /* per stream as sometimes mpg123 must be fed in passes if data is big enough (ex. EALayer3 multichannel) */
@@ -980,6 +1021,11 @@ typedef struct {
     size_t current_size_target; /* max data, until something happens */
     size_t decode_to_discard;  /* discard from this stream only (for EALayer3 or AWC) */
 
+    size_t samples_decoded; /* total decoded (discards included), to fill the seek table */
+    mpeg_custom_seek_entry *seek_entries; /* frame index, filled while decoding */
+    int seek_count;
+    int seek_max;
+
 } mpeg_custom_stream;
 
 typedef struct {
@@ -1052,6 +1098,18 @@ typedef enum { CELT_0_06_1,CELT_0_11_0} celt_lib_t;
 typedef struct celt_codec_data celt_codec_data;
 #endif
 
+/* seek checkpoints */
+typedef struct checkpoint_data checkpoint_data;
+
+/* decoded loop cache */
+typedef struct loop_cache_data loop_cache_data;
+
+/* final length and fade */
+typedef struct play_config_data play_config_data;
+
+/* blocked layout index */
+typedef struct block_index_data block_index_data;
+
 /* libacm interface */
 typedef struct {
     STREAMFILE *streamfile;
@@ -1073,17 +1131,63 @@ typedef struct {
     VGMSTREAM **adxs;
 } aix_codec_data;
 
+/* stream pool counters (see init_vgmstream_from_pool) */
+typedef struct {
+    int hits;                   /* opens that got an idle stream back */
+    int misses;                 /* opens that had to parse the file */
+    int evictions;              /* idle streams closed to stay under the limits */
+    int idle_count;             /* idle streams in the pool now */
+    size_t idle_bytes;          /* memory used by them */
+} vgmstream_pool_stats;
+
+/* play config (see vgmstream_set_play_config) */
+typedef struct {
+    double loop_count;          /* loops before fading out (or before playing the stream end if ignore_fade) */
+    double fade_time;           /* fade out seconds after the loops */
+    double fade_delay;          /* seconds to keep looping before fading */
+    int ignore_loop;            /* play the stream once, ignoring loop points */
+    int force_loop;             /* loop the whole stream if it doesn't loop */
+    int really_force_loop;      /* loop the whole stream even if it loops */
+    int ignore_fade;            /* after N loops play the stream end instead of fading */
+    int play_forever;           /* loop endlessly (no length or fade) */
+} vgmstream_play_config;
+
+/* segmented look-ahead counters (see vgmstream_enable_segment_prefetch) */
+typedef struct {
+    int prepared;               /* segments prepared ahead */
+    int ready;                  /* segment changes that only needed to copy prepared samples */
+    int waited;                 /* segment changes that had to wait for the preparation to finish */
+    int missed;                 /* segment changes with nothing prepared (reset and decoded in place) */
+    uint32_t prepare_us_last;   /* preparation time in microseconds (reset + first decode) */
+    uint32_t prepare_us_max;
+    uint32_t prepare_us_total;
+} segmented_prefetch_stats;
+
 /* for files made of "vertical" segments, one per section of a song (using a complete sub-VGMSTREAM) */
 typedef struct {
     int segment_count;
     VGMSTREAM **segments;
     int current_segment;
+    int32_t *sample_offsets;    /* start sample of each segment (segment_count + 1, last is the total) */
+
+    /* look-ahead preparation of the next segment (see vgmstream_enable_segment_prefetch) */
+    int prefetch_samples;
+    vgm_pool *pool;
+    void *prefetch;
+    segmented_prefetch_stats stats;
 } segmented_layout_data;
 
 /* for files made of "horizontal" layers, one per group of channels (using a complete sub-VGMSTREAM) */
 typedef struct {
     int layer_count;
     VGMSTREAM **layers;
+
+    /* render buffers, one per layer back to back (buffer_samples * layer channels each) */
+    int buffer_samples;
+    sample *buffer;
+    /* parallel rendering (see vgmstream_enable_layer_threads) */
+    vgm_pool *pool;
+    void *tasks;
 } layered_layout_data;
 
 /* for compressed NWA */
@@ -1097,6 +1201,8 @@ typedef struct {
     clHCA_stInfo info;
 
     signed short *sample_buffer;
+    float *sample_buffer_f;     /* float output, allocated on first use */
+    int float_filled;           /* current block was extracted to sample_buffer_f */
     size_t samples_filled;
     size_t samples_consumed;
     size_t samples_to_discard;
@@ -1109,6 +1215,13 @@ typedef struct {
 } hca_codec_data;
 
 #ifdef VGM_USE_FFMPEG
+/* FFmpeg packet position, to seek without decoding from the beginning */
+typedef struct {
+    int64_t pos;                /* packet logical offset */
+    int64_t ts;                 /* packet dts, for demuxers without byte seeking */
+    int64_t sample;             /* decoded samples before the packet */
+} ffmpeg_seek_entry;
+
 typedef struct {
     /*** IO internals ***/
     STREAMFILE *streamfile;
@@ -1162,6 +1275,13 @@ typedef struct {
     // Seeking is not ideal, so rollback is necessary
     int samplesToDiscard;
 
+    // Packet index, filled while decoding
+    ffmpeg_seek_entry *seekIndex;
+    int seekIndexCount;
+    int seekIndexMax;
+    int64_t decodedSamples; // samples returned by the decoder since the beginning (including discards)
+    int64_t seekCheckPos; // expected offset of the first packet after an index seek, or -1
+    int32_t seekTarget; // requested sample of the last index seek, to retry from the beginning
 
 } ffmpeg_codec_data;
 #endif
@@ -1240,9 +1360,38 @@ VGMSTREAM * init_vgmstream(const char * const filename);
 /* init with custom IO via streamfile */
 VGMSTREAM * init_vgmstream_from_STREAMFILE(STREAMFILE *streamFile);
 
+/* Same, with a custom allocator for the stream's memory (NULL = default) and a max_bytes limit
+ * (0 = none) over which the stream's allocations fail (so opening or decoding it fails). */
+VGMSTREAM * init_vgmstream_from_STREAMFILE_alloc(STREAMFILE *streamFile, const vgmstream_allocator * allocator, size_t max_bytes);
+
+/* Open another subsong of the file vgmstream was opened from (streamFile is a new handle to that file,
+ * which gets stream_index = subsong), with the same format and no detection. Different subsongs of a
+ * stream can be opened in parallel, each with its own streamFile. */
+VGMSTREAM * init_vgmstream_subsong(VGMSTREAM * vgmstream, STREAMFILE *streamFile, int subsong);
+
+/* Set the default allocator for libvgmstream's memory (NULL = C library). Must be called before
+ * anything is opened, as memory is freed with the allocator that made it. */
+void vgmstream_set_allocator(const vgmstream_allocator * allocator);
+
+/* Get memory used by a stream (including its segments/layers/codec data done by vgmstream), or
+ * memory not tied to any stream if vgmstream is NULL. Returns 0 on error. */
+int vgmstream_get_alloc_stats(VGMSTREAM * vgmstream, vgmstream_alloc_stats * stats);
+
+/* Change the max bytes a stream may allocate (0 = no limit), or the global limit if vgmstream is NULL. */
+void vgmstream_set_alloc_limit(VGMSTREAM * vgmstream, size_t max_bytes);
+
 /* reset a VGMSTREAM to start of stream */
 void reset_vgmstream(VGMSTREAM * vgmstream);
 
+/* Seek to sample position (as if seek_sample samples were played from the start, including loops),
+ * using the fastest method the codec/layout supports (direct seek, checkpoints or decoding up to it). */
+void vgmstream_seek(VGMSTREAM * vgmstream, int32_t seek_sample);
+
+/* Same as vgmstream_seek, but if the seek needs decoding, abort_callback(arg) is called every few
+ * thousand samples and stops it when returning non-zero (for players, so a long seek doesn't block a
+ * stop or a newer seek). Returns 0 if aborted, then the stream must be seeked (or reset) again. */
+int vgmstream_seek_abortable(VGMSTREAM * vgmstream, int32_t seek_sample, int (*abort_callback)(void * arg), void * arg);
+
 /* close an open vgmstream */
 void close_vgmstream(VGMSTREAM * vgmstream);
 
@@ -1252,6 +1401,49 @@ int32_t get_vgmstream_play_samples(double looptimes, double fadeseconds, double
 /* Decode data into sample buffer */
 void render_vgmstream(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
 
+/* Render layers of layered streams (including nested/segmented ones) in parallel, in a worker pool
+ * shared by all streams (if compiled with VGM_USE_THREADS, otherwise one after another), using
+ * buffer_samples per layer at once (0=default, bigger buffers mean fewer but longer tasks). Custom
+ * STREAMFILEs must allow reads from different threads on reopened files. Returns 0 if not layered. */
+int vgmstream_enable_layer_threads(VGMSTREAM* vgmstream, int buffer_samples);
+
+/* Prepare segments of segmented streams (including nested/layered ones) ahead of time: while one
+ * segment plays the next one (or the loop segment) is reset and its first prefetch_samples are
+ * decoded in the shared worker pool, so changing segments doesn't stall on codec setup (0=disable).
+ * Without VGM_USE_THREADS this is done in the calling thread. Returns 0 if not segmented. */
+int vgmstream_enable_segment_prefetch(VGMSTREAM* vgmstream, int prefetch_samples);
+
+/* Get look-ahead counters of a segmented stream. Returns 0 if not segmented. */
+int vgmstream_get_segment_stats(VGMSTREAM* vgmstream, segmented_prefetch_stats* stats);
+
+/* Decode data into float sample buffer (nominally -1.0..1.0, not clipped). Lossy codecs that decode
+ * in float output directly, so no precision is lost; others are converted from PCM16. Can be mixed
+ * with render_vgmstream calls. */
+void render_vgmstream_f32(float * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
+
+/* Create a pool of closed streams, for reopening the same files often (ex. previews). Up to max_count
+ * idle streams (0=default) using max_bytes (0=no limit) are kept (with their files open), closing
+ * the least recently used. */
+vgmstream_pool * vgmstream_pool_init(int max_count, size_t max_bytes);
+
+/* Close idle streams and free the pool. Streams still open from it are closed normally later. */
+void vgmstream_pool_free(vgmstream_pool * pool);
+
+/* Open like init_vgmstream_from_STREAMFILE, but if a stream of the same file and subsong was closed
+ * it's returned instead, reset to the start (no parsing or allocations). Closing a stream opened this
+ * way returns it to the pool. Settings done on the stream after opening (loops, play config, caches,
+ * checkpoints, layer threads) are undone when closing. Pools may be used from several threads.
+ * Files are considered changed if their size or modification time differs, which misses rewrites of
+ * the same size within the file system's time resolution, files whose name can't be stat'd (custom
+ * STREAMFILEs), and companion files (ex. .txtp segments); use vgmstream_pool_flush for those. */
+VGMSTREAM * init_vgmstream_from_pool(vgmstream_pool * pool, STREAMFILE *streamFile);
+
+/* Close idle streams of a file (as returned by the STREAMFILE's get_name), or all if NULL. */
+void vgmstream_pool_flush(vgmstream_pool * pool, const char * filename);
+
+/* Get pool counters. */
+void vgmstream_get_pool_stats(vgmstream_pool * pool, vgmstream_pool_stats * stats);
+
 /* Write a description of the stream into array pointed by desc, which must be length bytes long.
  * Will always be null-terminated if length > 0 */
 void describe_vgmstream(VGMSTREAM * vgmstream, char * desc, int length);
@@ -1270,6 +1462,56 @@ void vgmstream_force_loop(VGMSTREAM* vgmstream, int loop_flag, int loop_start_sa
 /* Set number of max loops to do, then play up to stream end (for songs with proper endings) */
 void vgmstream_set_loop_target(VGMSTREAM* vgmstream, int loop_target);
 
+/* Enable seek checkpoints: decoder state is saved every interval samples (0=default) while rendering
+ * the first playthrough, up to max_count (0=default, interval doubles when reached). Returns 0 if the
+ * stream's codec/layout can't be checkpointed (state not fully in the channels). Set loop config first. */
+int vgmstream_enable_checkpoints(VGMSTREAM* vgmstream, int32_t interval, int max_count);
+
+/* Decode the whole first playthrough to build all checkpoints at once, then reset. */
+int vgmstream_build_checkpoints(VGMSTREAM* vgmstream);
+
+/* Reset and restore the closest checkpoint before sample (in the first playthrough). Returns the
+ * restored current sample (0 if none), so callers only need to decode and discard the difference. */
+int32_t vgmstream_restore_checkpoint(VGMSTREAM* vgmstream, int32_t sample);
+
+/* Serialize checkpoints to buf, to load them later without a decoding pass. Returns bytes written,
+ * or the needed size if buf is NULL (0 on error). */
+size_t vgmstream_save_checkpoints(VGMSTREAM* vgmstream, uint8_t * buf, size_t buf_size);
+
+/* Load serialized checkpoints (validated against the current stream). Returns 0 on failure. */
+int vgmstream_load_checkpoints(VGMSTREAM* vgmstream, const uint8_t * buf, size_t buf_size);
+
+/* Enable the loop cache: the loop is saved the first time it's played again after looping, and later
+ * loops copy it rather than decoding (for long or endless playback). Returns 0 if the stream doesn't
+ * loop, the loop needs more than max_bytes (0=default), or decoders carry state across loops (ADPCM
+ * history). Only render_vgmstream uses it. Forcing new loop points disables it. */
+int vgmstream_enable_loop_cache(VGMSTREAM* vgmstream, size_t max_bytes);
+
+/* Set the final length and fade out, applied by render_vgmstream(_f32): after the loops and fade the
+ * stream is silent. TXTP's suggested config (config_loop_count, etc) takes priority over the passed one.
+ * Loop points are changed as needed, so set it after other loop changes and before playing. Seeks are
+ * then clamped to the length. Returns 0 on error. */
+int vgmstream_set_play_config(VGMSTREAM* vgmstream, const vgmstream_play_config* config);
+
+/* Final number of samples to render (num_samples if no play config is set). */
+int32_t vgmstream_get_play_samples(VGMSTREAM* vgmstream);
+
+/* Samples rendered so far with the play config (goes past the length while playing forever). */
+int32_t vgmstream_get_play_position(VGMSTREAM* vgmstream);
+
+/* Change the play config's play_forever while playing (ex. a player's "loop forever" option). Turning
+ * it off continues to the length, or if past where the fade starts, fades out from the current position
+ * (the length changes, so re-read vgmstream_get_play_samples). */
+void vgmstream_set_play_forever(VGMSTREAM* vgmstream, int play_forever);
+
+/* Enable the block index for blocked layouts: block offsets and their first sample are saved while
+ * rendering, so seeks can jump to a block. Returns 0 if the stream's codec/layout can't start decoding
+ * at any block (state carried between blocks). */
+int vgmstream_enable_block_index(VGMSTREAM* vgmstream);
+
+/* Read all block headers (no decoding) to build the full block index at once. */
+int vgmstream_build_block_index(VGMSTREAM* vgmstream);
+
 /* -------------------------------------------------------------------------*/
 /* vgmstream "private" API                                                  */
 /* -------------------------------------------------------------------------*/
@@ -1277,6 +1519,16 @@ void vgmstream_set_loop_target(VGMSTREAM* vgmstream, int loop_target);
 /* Allocate memory and setup a VGMSTREAM */
 VGMSTREAM * allocate_vgmstream(int channel_count, int looped);
 
+/* Decode data into sample buffer ignoring the play config (for internal decoding, like seeks) */
+void render_vgmstream_main(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
+void render_vgmstream_f32_main(float * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
+
+/* Decode data into sample buffer using the stream's layout (no channel settings or loop cache) */
+void render_vgmstream_layout(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
+
+/* Return a stream opened from a pool to it. Returns 0 if it must be closed normally. */
+int recycle_vgmstream(VGMSTREAM * vgmstream);
+
 /* Get the number of samples of a single frame (smallest self-contained sample group, 1/N channels) */
 int get_vgmstream_samples_per_frame(VGMSTREAM * vgmstream);
 /* Get the number of bytes of a single frame (smallest self-contained byte group, 1/N channels) */
@@ -1289,6 +1541,13 @@ int get_vgmstream_shortframe_size(VGMSTREAM * vgmstream);
  * buffer already, and we have samples_to_do consecutive samples ahead of us. */
 void decode_vgmstream(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer);
 
+/* Same as decode_vgmstream but into a float buffer, if the stream's codec/layout supports it. */
+int decode_vgmstream_f32_supported(VGMSTREAM * vgmstream);
+void decode_vgmstream_f32(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, float * buffer);
+
+/* Copies channel state (ex. ch into loop_ch), only the parts of VGMSTREAMCHANNEL the codec uses. */
+void copy_vgmstream_channels(VGMSTREAM * vgmstream, VGMSTREAMCHANNEL * dst, const VGMSTREAMCHANNEL * src);
+
 /* Calculate number of consecutive samples to do (taking into account stopping for loop start and end) */
 int vgmstream_samples_to_do(int samples_this_block, int samples_per_frame, VGMSTREAM * vgmstream);
 
@@ -1299,6 +1558,53 @@ int vgmstream_do_loop(VGMSTREAM * vgmstream);
  * returns 0 on failure */
 int vgmstream_open_stream(VGMSTREAM * vgmstream, STREAMFILE *streamFile, off_t start_offset);
 
+/* codec info, to handle coding types without switching over all of them */
+#define CODEC_STATELESS     (1<<0) /* frames can be decoded from any offset (no state, or state in frame headers) */
+#define CODEC_CHANNEL_STATE (1<<1) /* all decoder state is in the VGMSTREAMCHANNELs (no codec_data) */
+#define CODEC_SEEKABLE      (1<<2) /* has its own seeking to any sample (needs codec_data) */
+#define CODEC_FLOAT         (1<<3) /* can decode to float directly (decode_f32) */
+#define CODEC_LOOP_HISTORY  (1<<4) /* keeps the ADPCM history at the loop end when looping */
+#define CODEC_CHANNEL_EXT   (1<<5) /* uses the extended part of VGMSTREAMCHANNEL */
+
+typedef struct codec_info {
+    coding_t type;
+    int flags;
+    int samples_per_frame;  /* fixed values, 0 if variable/unknown or if depending on config (see below) */
+    int frame_size;
+
+    /* handlers, NULL if not needed */
+    void (*decode)(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer);
+    int (*get_samples_per_frame)(VGMSTREAM * vgmstream);
+    int (*get_frame_size)(VGMSTREAM * vgmstream);
+    void (*reset)(VGMSTREAM * vgmstream);
+    void (*seek)(VGMSTREAM * vgmstream, int32_t num_sample);
+    void (*loop)(VGMSTREAM * vgmstream); /* if not set seek(loop_sample) is used */
+    void (*free)(VGMSTREAM * vgmstream); /* codec_data (or other codec allocations) */
+    void (*decode_f32)(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, float * buffer);
+} codec_info;
+
+/* Returns the info for a coding type (never NULL, unknown types have no handlers). */
+const codec_info * get_codec_info(coding_t type);
+
+/* loop cache internals */
+void render_loop_cache(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
+void sync_loop_cache(VGMSTREAM * vgmstream);
+void reset_loop_cache(loop_cache_data * data);
+void free_loop_cache(loop_cache_data * data);
+
+/* play config internals */
+void render_play_config(sample * buffer, float * buffer_f, int32_t sample_count, VGMSTREAM * vgmstream);
+int32_t clamp_play_config_seek(play_config_data * data, int32_t seek_sample);
+void seek_play_config(play_config_data * data, int32_t seek_sample);
+void reset_play_config(play_config_data * data);
+void free_play_config(play_config_data * data);
+
+/* seek checkpoint internals */
+int checkpoints_supported(VGMSTREAM * vgmstream);
+checkpoint_data * init_checkpoints(int channels, int32_t interval, int max_count);
+void free_checkpoints(checkpoint_data * data);
+void update_checkpoints(VGMSTREAM * vgmstream);
+
 /* get description info */
 const char * get_vgmstream_coding_description(coding_t coding_type);
 const char * get_vgmstream_layout_description(layout_t layout_type);
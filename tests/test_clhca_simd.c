@@ -0,0 +1,195 @@
+/*
+ * clHCA SIMD float loops: decoding must match the scalar code (bit-exact, or within 1 ulp-ish if the
+ * compiler contracts the scalar mul+adds into FMA), and prints the time per block of each.
+ * The library's clHCA is compared with a scalar copy built here with HCA_NO_SIMD.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "clHCA.h" /* library's (SIMD) clHCA */
+
+/* scalar clHCA (statics are private to this file, public functions are renamed) */
+#define HCA_NO_SIMD
+#define clHCA_isOurFile         scalar_clHCA_isOurFile
+#define clHCA_sizeof            scalar_clHCA_sizeof
+#define clHCA_clear             scalar_clHCA_clear
+#define clHCA_done              scalar_clHCA_done
+#define clHCA_new               scalar_clHCA_new
+#define clHCA_delete            scalar_clHCA_delete
+#define clHCA_DecodeHeader      scalar_clHCA_DecodeHeader
+#define clHCA_getInfo           scalar_clHCA_getInfo
+#define clHCA_DecodeBlock       scalar_clHCA_DecodeBlock
+#define clHCA_ReadSamples16     scalar_clHCA_ReadSamples16
+#define clHCA_ReadSamplesFloat  scalar_clHCA_ReadSamplesFloat
+#define clHCA_SetKey            scalar_clHCA_SetKey
+#define clHCA_TestBlock         scalar_clHCA_TestBlock
+#define clHCA_DecodeReset       scalar_clHCA_DecodeReset
+int clHCA_DecodeBlock(clHCA *, void *data, unsigned int size); /* used before defined */
+#include "../ext_libs/clHCA.c"
+#undef clHCA_new
+#undef clHCA_delete
+#undef clHCA_DecodeHeader
+#undef clHCA_DecodeBlock
+#undef clHCA_ReadSamples16
+#undef clHCA_ReadSamplesFloat
+
+#define TEST_CHANNELS 2
+#define TEST_FRAME_SIZE 0x1000 /* big enough for random spectra at max resolution */
+#define TEST_BLOCKS 500
+#define MAX_FLOAT_ERROR 1e-6 /* of full scale (1.0) */
+#define MAX_PCM16_ERROR 1
+
+/* v2.0 stereo header: base + stereo (intensity) + hfr bands, no ath/cipher */
+static int make_header(unsigned char * buf) {
+    static const unsigned char header[] = {
+        'H','C','A',0x00, 0x02,0x00, 0x00,0x30,
+        'f','m','t',0x00, TEST_CHANNELS, 0x00,0xBB,0x80, 0x00,0x00,0x01,0xF4, 0x00,0x00, 0x00,0x00,
+        'c','o','m','p', TEST_FRAME_SIZE >> 8,TEST_FRAME_SIZE & 0xFF, 0x01, 0x0F, 0x01, 0x00, 0x80, 0x60, 0x10, 0x04, 0x00, 0x00,
+        'p','a','d',0x00,
+    };
+    int size = 0x30;
+    unsigned short crc;
+
+    memset(buf, 0, size);
+    memcpy(buf, header, sizeof(header));
+    crc = crc16_checksum(buf, size - 2);
+    buf[size - 2] = crc >> 8;
+    buf[size - 1] = crc & 0xFF;
+    return size;
+}
+
+static void put_bits(unsigned char * buf, int * bit, int bitsize, unsigned int value) {
+    int i;
+    for (i = bitsize - 1; i >= 0; i--) {
+        if ((value >> i) & 1)
+            buf[*bit / 8] |= 0x80 >> (*bit % 8);
+        (*bit)++;
+    }
+}
+
+/* valid frame values (scalefactors, intensity, hfr scales) then random spectra */
+static void make_block(unsigned char * buf, const clHCA * hca) {
+    int bit = 0, i, ch;
+    unsigned short crc;
+
+    memset(buf, 0, TEST_FRAME_SIZE);
+    put_bits(buf, &bit, 16, 0xFFFF);
+    put_bits(buf, &bit, 9, rand() % 0x20);
+    put_bits(buf, &bit, 7, rand() % 0x80);
+    for (ch = 0; ch < hca->channels; ch++) {
+        const stChannel * channel = &hca->channel[ch];
+
+        put_bits(buf, &bit, 3, 6); /* normal scalefactors */
+        for (i = 0; i < channel->coded_scalefactor_count; i++)
+            put_bits(buf, &bit, 6, rand() % 64);
+        if (channel->type == STEREO_SECONDARY) {
+            for (i = 0; i < HCA_SUBFRAMES_PER_FRAME; i++)
+                put_bits(buf, &bit, 4, rand() % 15);
+        }
+        else {
+            for (i = 0; i < hca->hfr_group_count; i++)
+                put_bits(buf, &bit, 6, rand() % 64);
+        }
+    }
+    for (i = (bit + 7) / 8; i < TEST_FRAME_SIZE - 2; i++)
+        buf[i] = rand() & 0xFF;
+
+    crc = crc16_checksum(buf, TEST_FRAME_SIZE - 2);
+    buf[TEST_FRAME_SIZE - 2] = crc >> 8;
+    buf[TEST_FRAME_SIZE - 1] = crc & 0xFF;
+}
+
+static double get_seconds(clock_t start) {
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(void) {
+    unsigned char header[0x30];
+    unsigned char * blocks = NULL;
+    clHCA * simd = NULL;
+    clHCA * scalar = NULL;
+    float out_simd[HCA_SAMPLES_PER_FRAME * TEST_CHANNELS], out_scalar[HCA_SAMPLES_PER_FRAME * TEST_CHANNELS];
+    short pcm_simd[HCA_SAMPLES_PER_FRAME * TEST_CHANNELS], pcm_scalar[HCA_SAMPLES_PER_FRAME * TEST_CHANNELS];
+    double max_error = 0, time_simd = 0, time_scalar = 0;
+    int max_pcm_error = 0;
+    int i, j, header_size;
+    clock_t start;
+
+    simd = clHCA_new();
+    scalar = scalar_clHCA_new();
+    blocks = malloc(TEST_FRAME_SIZE * TEST_BLOCKS);
+    if (!simd || !scalar || !blocks) goto fail;
+
+    header_size = make_header(header);
+    if (clHCA_DecodeHeader(simd, header, header_size) < 0 || scalar_clHCA_DecodeHeader(scalar, header, header_size) < 0) {
+        printf("can't decode header\n");
+        goto fail;
+    }
+
+    srand(1234);
+    for (i = 0; i < TEST_BLOCKS; i++) {
+        make_block(blocks + i * TEST_FRAME_SIZE, scalar);
+    }
+
+    /* compare (decoding state carries over blocks, so both decode all) */
+    for (i = 0; i < TEST_BLOCKS; i++) {
+        unsigned char * block = blocks + i * TEST_FRAME_SIZE;
+
+        if (clHCA_DecodeBlock(simd, block, TEST_FRAME_SIZE) < 0 || scalar_clHCA_DecodeBlock(scalar, block, TEST_FRAME_SIZE) < 0) {
+            printf("can't decode block %i\n", i);
+            goto fail;
+        }
+
+        clHCA_ReadSamplesFloat(simd, out_simd);
+        scalar_clHCA_ReadSamplesFloat(scalar, out_scalar);
+        clHCA_ReadSamples16(simd, pcm_simd);
+        scalar_clHCA_ReadSamples16(scalar, pcm_scalar);
+
+        for (j = 0; j < HCA_SAMPLES_PER_FRAME * TEST_CHANNELS; j++) {
+            double error = fabs((double)out_simd[j] - (double)out_scalar[j]);
+            int pcm_error = abs(pcm_simd[j] - pcm_scalar[j]);
+            if (error > max_error || error != error)
+                max_error = error != error ? 1.0 : error;
+            if (pcm_error > max_pcm_error)
+                max_pcm_error = pcm_error;
+        }
+    }
+
+    printf("max error: float %g, pcm16 %i\n", max_error, max_pcm_error);
+    if (max_error > MAX_FLOAT_ERROR || max_pcm_error > MAX_PCM16_ERROR) {
+        printf("SIMD output differs from scalar\n");
+        goto fail;
+    }
+
+    /* benchmark (block decode + 16-bit conversion, like the HCA decoder) */
+    for (j = 0; j < 4; j++) {
+        start = clock();
+        for (i = 0; i < TEST_BLOCKS; i++) {
+            scalar_clHCA_DecodeBlock(scalar, blocks + i * TEST_FRAME_SIZE, TEST_FRAME_SIZE);
+            scalar_clHCA_ReadSamples16(scalar, pcm_scalar);
+        }
+        time_scalar += get_seconds(start);
+
+        start = clock();
+        for (i = 0; i < TEST_BLOCKS; i++) {
+            clHCA_DecodeBlock(simd, blocks + i * TEST_FRAME_SIZE, TEST_FRAME_SIZE);
+            clHCA_ReadSamples16(simd, pcm_simd);
+        }
+        time_simd += get_seconds(start);
+    }
+    printf("per block: scalar %.2f us, SIMD %.2f us\n",
+            time_scalar * 1000000.0 / (TEST_BLOCKS * 4), time_simd * 1000000.0 / (TEST_BLOCKS * 4));
+
+    free(blocks);
+    clHCA_delete(simd);
+    scalar_clHCA_delete(scalar);
+    printf("ok\n");
+    return 0;
+fail:
+    free(blocks);
+    if (simd) clHCA_delete(simd);
+    if (scalar) scalar_clHCA_delete(scalar);
+    return 1;
+}
@@ -0,0 +1,330 @@
+/*
+ * Stream pool: a stream reopened from the pool must play like a freshly opened one, whatever the
+ * previous opener set on it (loops, play config, caches, threads), and the pool must work when files
+ * are opened and closed from several threads at once. Files rewritten on disk must be parsed again.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+#include "../src/vgmstream.h"
+#include "../src/threads.h"
+
+#define TEST_SAMPLES 40000  /* a few loops */
+#define TASK_SAMPLES 3000
+#define TASK_OPENS 50
+#define TASK_COUNT 8
+
+static const char * test_files[] = {
+    "test_pool.bin",
+    "test_pool_l1.bin",
+    "test_pool_l2.bin",
+};
+static const char * test_layered = "test_pool.txtp";
+
+static int write_files(void) {
+    char name[0x40];
+    int i, j;
+
+    srand(1234);
+    for (i = 0; i < sizeof(test_files) / sizeof(test_files[0]); i++) {
+        int channels = i == 0 ? 2 : 1;
+        FILE * file = fopen(test_files[i], "wb");
+        if (!file) return 0;
+        for (j = 0; j < 0x4000; j++) {
+            fputc(rand() & 0xFF, file);
+        }
+        fclose(file);
+
+        snprintf(name, sizeof(name), "%s.txth", test_files[i]);
+        file = fopen(name, "w");
+        if (!file) return 0;
+        fprintf(file, "codec = IMA\n");
+        fprintf(file, "channels = %i\n", channels);
+        fprintf(file, "sample_rate = 32000\n");
+        fprintf(file, "num_samples = data_size\n");
+        fprintf(file, "loop_start_sample = 3000\n");
+        fprintf(file, "loop_end_sample = data_size\n");
+        fclose(file);
+    }
+
+    /* two mono layers (layer threads apply) */
+    {
+        FILE * file = fopen(test_layered, "w");
+        if (!file) return 0;
+        fprintf(file, "test_pool_l1.bin\ntest_pool_l2.bin\nmode = layers\n");
+        fclose(file);
+    }
+    return 1;
+}
+
+static void remove_files(void) {
+    char name[0x40];
+    int i;
+
+    for (i = 0; i < sizeof(test_files) / sizeof(test_files[0]); i++) {
+        remove(test_files[i]);
+        snprintf(name, sizeof(name), "%s.txth", test_files[i]);
+        remove(name);
+    }
+    remove(test_layered);
+}
+
+static VGMSTREAM * open_pooled(vgmstream_pool * pool, const char * filename) {
+    VGMSTREAM * vgmstream;
+    STREAMFILE * streamFile = open_stdio_streamfile(filename);
+    if (!streamFile) return NULL;
+
+    vgmstream = init_vgmstream_from_pool(pool, streamFile);
+    close_streamfile(streamFile);
+    return vgmstream;
+}
+
+/* what a player may set (changes length, loops and how it's rendered) */
+static void change_settings(VGMSTREAM * vgmstream) {
+    vgmstream_play_config config = {0};
+
+    vgmstream_force_loop(vgmstream, 1, 100, 5000);
+    vgmstream_set_loop_target(vgmstream, 3);
+
+    config.loop_count = 1;
+    config.fade_time = 1.0;
+    vgmstream_set_play_config(vgmstream, &config);
+
+    vgmstream_enable_loop_cache(vgmstream, 0);
+    vgmstream_enable_checkpoints(vgmstream, 1000, 8);
+    vgmstream_enable_layer_threads(vgmstream, 100);
+    vgmstream_set_alloc_limit(vgmstream, 0x10000000);
+}
+
+static int check_stream(VGMSTREAM * vgmstream, const VGMSTREAM * fresh, const sample * linear, int32_t samples, sample * buf) {
+    vgmstream_alloc_stats stats;
+
+    if (vgmstream->loop_flag != fresh->loop_flag
+            || vgmstream->loop_start_sample != fresh->loop_start_sample
+            || vgmstream->loop_end_sample != fresh->loop_end_sample
+            || vgmstream->loop_target != fresh->loop_target)
+        return 0;
+    if (vgmstream->play_config_data || vgmstream->loop_cache_data || vgmstream->checkpoint_data)
+        return 0;
+    vgmstream_get_alloc_stats(vgmstream, &stats);
+    if (stats.max_bytes != 0)
+        return 0;
+
+    render_vgmstream(buf, samples, vgmstream);
+    return memcmp(buf, linear, sizeof(sample) * vgmstream->channels * samples) == 0;
+}
+
+typedef struct {
+    vgmstream_pool * pool;
+    const char * filename;
+    const VGMSTREAM * fresh;
+    const sample * linear;
+    int errors;
+} pool_task;
+
+/* opens and closes the same file over and over, changing settings every other time */
+static void open_close_task(void * arg) {
+    pool_task * pt = arg;
+    sample buf[TASK_SAMPLES * 2];
+    int i;
+
+    for (i = 0; i < TASK_OPENS; i++) {
+        VGMSTREAM * vgmstream = open_pooled(pt->pool, pt->filename);
+        if (!vgmstream) {
+            pt->errors++;
+            continue;
+        }
+
+        if (!check_stream(vgmstream, pt->fresh, pt->linear, TASK_SAMPLES, buf))
+            pt->errors++;
+        if (i & 1)
+            change_settings(vgmstream);
+        close_vgmstream(vgmstream);
+    }
+}
+
+static int test_file(const char * filename) {
+    VGMSTREAM * fresh = NULL;
+    VGMSTREAM * vgmstream = NULL;
+    vgmstream_pool * pool = NULL;
+    vgmstream_pool_stats stats;
+    sample * linear = NULL;
+    sample * buf = NULL;
+    vgm_pool * workers = NULL;
+    vgm_task tasks[TASK_COUNT];
+    pool_task pts[TASK_COUNT];
+    int i, errors = 0, task_errors = 0;
+
+    fresh = init_vgmstream(filename);
+    if (!fresh || !fresh->loop_flag) {
+        printf("%s: can't open\n", filename);
+        goto fail;
+    }
+
+    linear = malloc(sizeof(sample) * fresh->channels * TEST_SAMPLES);
+    buf = malloc(sizeof(sample) * fresh->channels * TEST_SAMPLES);
+    if (!linear || !buf) goto fail;
+    render_vgmstream(linear, TEST_SAMPLES, fresh);
+
+    pool = vgmstream_pool_init(4, 0);
+    if (!pool) goto fail;
+
+    /* first opener changes everything it can */
+    vgmstream = open_pooled(pool, filename);
+    if (!vgmstream) goto fail;
+    change_settings(vgmstream);
+    render_vgmstream(buf, TEST_SAMPLES, vgmstream);
+    close_vgmstream(vgmstream);
+
+    /* next one gets it as parsed */
+    vgmstream = open_pooled(pool, filename);
+    if (!vgmstream) goto fail;
+    vgmstream_get_pool_stats(pool, &stats);
+    if (stats.hits != 1 || stats.misses != 1) {
+        printf("%s: stream not reused (%i hits, %i misses)\n", filename, stats.hits, stats.misses);
+        errors++;
+    }
+    if (!check_stream(vgmstream, fresh, linear, TEST_SAMPLES, buf)) {
+        printf("%s: reused stream keeps the previous settings\n", filename);
+        errors++;
+    }
+    close_vgmstream(vgmstream);
+
+    /* several threads at once (tasks run one after another without threads) */
+    workers = vgm_pool_acquire();
+    for (i = 0; i < TASK_COUNT; i++) {
+        pts[i].pool = pool;
+        pts[i].filename = filename;
+        pts[i].fresh = fresh;
+        pts[i].linear = linear;
+        pts[i].errors = 0;
+        vgm_task_submit(workers, &tasks[i], open_close_task, &pts[i]);
+    }
+    for (i = 0; i < TASK_COUNT; i++) {
+        vgm_task_wait(workers, &tasks[i]);
+        task_errors += pts[i].errors;
+    }
+    vgm_pool_release(workers);
+
+    if (task_errors) {
+        printf("%s: %i bad opens when used from several threads\n", filename, task_errors);
+        errors++;
+    }
+
+    vgmstream_get_pool_stats(pool, &stats);
+    if (stats.hits + stats.misses != 2 + TASK_COUNT * TASK_OPENS || stats.idle_count > 4) {
+        printf("%s: wrong pool counters (%i hits, %i misses, %i idle)\n", filename, stats.hits, stats.misses, stats.idle_count);
+        errors++;
+    }
+
+    vgmstream_pool_free(pool);
+    free(linear);
+    free(buf);
+    close_vgmstream(fresh);
+    return errors == 0;
+fail:
+    vgmstream_pool_free(pool);
+    free(linear);
+    free(buf);
+    close_vgmstream(fresh);
+    return 0;
+}
+
+/* rewrites a file with the same size (new data) */
+static int rewrite_file(const char * filename, time_t file_time) {
+    struct utimbuf times;
+    int j;
+    FILE * file = fopen(filename, "wb");
+    if (!file) return 0;
+    for (j = 0; j < 0x4000; j++) {
+        fputc(rand() & 0xFF, file);
+    }
+    fclose(file);
+
+    times.actime = file_time;
+    times.modtime = file_time;
+    return utime(filename, &times) == 0;
+}
+
+static int get_misses(vgmstream_pool * pool) {
+    vgmstream_pool_stats stats;
+    vgmstream_get_pool_stats(pool, &stats);
+    return stats.misses;
+}
+
+/* reopens after each change, expecting a new parse or not */
+static int test_changed_file(const char * filename) {
+    vgmstream_pool * pool = NULL;
+    VGMSTREAM * vgmstream;
+    struct stat st;
+    int errors = 0;
+
+    pool = vgmstream_pool_init(4, 0);
+    if (!pool) goto fail;
+
+    vgmstream = open_pooled(pool, filename);
+    if (!vgmstream || stat(filename, &st) != 0) goto fail;
+    close_vgmstream(vgmstream);
+
+    /* same size, newer */
+    if (!rewrite_file(filename, st.st_mtime + 10)) goto fail;
+    vgmstream = open_pooled(pool, filename);
+    if (!vgmstream) goto fail;
+    close_vgmstream(vgmstream);
+    if (get_misses(pool) != 2) {
+        printf("%s: rewritten file reused from the pool\n", filename);
+        errors++;
+    }
+
+    /* same size and time can't be noticed, but may be flushed */
+    if (!rewrite_file(filename, st.st_mtime + 10)) goto fail;
+    vgmstream = open_pooled(pool, filename);
+    if (!vgmstream) goto fail;
+    close_vgmstream(vgmstream);
+    if (get_misses(pool) != 2) {
+        printf("%s: unchanged file not reused from the pool\n", filename);
+        errors++;
+    }
+
+    vgmstream_pool_flush(pool, filename);
+    vgmstream = open_pooled(pool, filename);
+    if (!vgmstream) goto fail;
+    close_vgmstream(vgmstream);
+    if (get_misses(pool) != 3) {
+        printf("%s: flushed file reused from the pool\n", filename);
+        errors++;
+    }
+
+    vgmstream_pool_free(pool);
+    return errors == 0;
+fail:
+    printf("%s: can't reopen\n", filename);
+    vgmstream_pool_free(pool);
+    return 0;
+}
+
+int main(void) {
+    int ok = 1;
+
+    if (!write_files()) {
+        printf("can't write test files\n");
+        remove_files();
+        return 1;
+    }
+
+    ok &= test_file(test_files[0]);
+    ok &= test_file(test_layered);
+    ok &= test_changed_file(test_files[0]);
+
+    remove_files();
+
+    printf("%s\n", ok ? "ok" : "failed");
+    return !ok;
+}
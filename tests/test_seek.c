@@ -0,0 +1,318 @@
+/*
+ * vgmstream_seek: output after seeking must match decoding linearly up to the same position
+ * (loops included), and aborted seeks must leave a stream that can be seeked again. Saved checkpoints
+ * must load back, and broken ones must be rejected.
+ * MPEG is tested with data/mpeg_seek.mp3 (LAME CBR, most frames use the bit reservoir).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/vgmstream.h"
+#include "../src/util.h"
+
+#define TEST_SAMPLES 2000 /* compared after each seek */
+
+typedef struct {
+    const char * codec;
+    int interleave;
+    int is_seekable;      /* seeks without decoding (can't test aborts) */
+} test_stream;
+
+static const test_stream streams[] = {
+    {"PCM16LE", 0x02, 1},
+    {"IMA",     0x00, 0}, /* stateful, must decode to seek */
+    {"NGC_DSP", 0x08, 0},
+};
+
+static const char * test_filename = "test_seek.bin";
+static const char * test_txth = "test_seek.bin.txth";
+static const char * test_mpeg_filename = "test_seek.xwc";
+
+static int write_stream(const test_stream * ts) {
+    FILE * file;
+    int i;
+
+    file = fopen(test_filename, "wb");
+    if (!file) return 0;
+    srand(1234);
+    for (i = 0; i < 0x20000; i++) {
+        fputc(rand() & 0xFF, file);
+    }
+    fclose(file);
+
+    file = fopen(test_txth, "w");
+    if (!file) return 0;
+    fprintf(file, "codec = %s\n", ts->codec);
+    fprintf(file, "channels = 2\n");
+    fprintf(file, "sample_rate = 32000\n");
+    fprintf(file, "interleave = %i\n", ts->interleave);
+    fprintf(file, "num_samples = data_size\n");
+    fprintf(file, "loop_start_sample = 5000\n");
+    fprintf(file, "loop_end_sample = data_size\n");
+    fclose(file);
+    return 1;
+}
+
+static int abort_calls;
+static int abort_after_calls(void * arg) {
+    abort_calls++;
+    return abort_calls > *(int*)arg;
+}
+
+#ifdef VGM_USE_MPEG
+/* wraps the test MP3 (MPEG-1 Layer III frames only) in a minimal .xwc, which uses the custom MPEG
+ * decoder (and its frame index seeking) */
+static int write_mpeg_stream(void) {
+    static const int bitrates[16] = { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0 };
+    static const int sample_rates[4] = { 44100, 48000, 32000, 0 };
+    uint8_t header[0x800] = {0};
+    uint8_t * data = NULL;
+    FILE * file;
+    long data_size, offset = 0;
+    int32_t num_samples = 0;
+    int channels = 0;
+
+    file = fopen("data/mpeg_seek.mp3", "rb");
+    if (!file) return 0;
+    fseek(file, 0, SEEK_END);
+    data_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data = malloc(data_size);
+    if (!data || fread(data, 1, data_size, file) != data_size) {
+        fclose(file);
+        goto fail;
+    }
+    fclose(file);
+
+    while (offset + 4 <= data_size) {
+        uint32_t frame = get_32bitBE(data + offset);
+        int bitrate = bitrates[(frame >> 12) & 0xF];
+        int sample_rate = sample_rates[(frame >> 10) & 0x3];
+        if ((frame & 0xFFFE0000) != 0xFFFA0000 || !bitrate || !sample_rate) /* sync, MPEG-1, Layer III */
+            goto fail;
+
+        channels = ((frame >> 6) & 0x3) == 3 ? 1 : 2;
+        offset += 144 * bitrate * 1000 / sample_rate + ((frame >> 9) & 1);
+        num_samples += 1152;
+    }
+
+    put_32bitBE(header + 0x00, 0x00040000); /* version */
+    put_32bitBE(header + 0x04, 0x00900000);
+    put_32bitLE(header + 0x08, data_size);
+    put_32bitLE(header + 0x0c, channels);
+    put_32bitBE(header + 0x24, 0x4D504547); /* "MPEG" */
+    put_32bitLE(header + 0x28, num_samples);
+    put_32bitLE(header + 0x30, num_samples);
+    put_32bitLE(header + 0x34, data_size);
+
+    file = fopen(test_mpeg_filename, "wb");
+    if (!file) goto fail;
+    fwrite(header, 1, sizeof(header), file);
+    fwrite(data, 1, data_size, file);
+    fclose(file);
+
+    free(data);
+    return 1;
+fail:
+    printf("MPEG: can't read data/mpeg_seek.mp3\n");
+    free(data);
+    return 0;
+}
+#endif
+
+static int test_file(const char * filename, const char * name, int is_seekable, int loop_target) {
+    VGMSTREAM * vgmstream;
+    sample * linear = NULL;
+    sample * buf = NULL;
+    int32_t total, loop_samples;
+    int32_t offsets[20];
+    int i, offset_count = 0, errors = 0, channels;
+
+    vgmstream = init_vgmstream(filename);
+    if (!vgmstream) {
+        printf("%s: can't open\n", name);
+        return 0;
+    }
+    channels = vgmstream->channels;
+
+    /* two full loops and a bit, or until the end (after N loops) */
+    loop_samples = vgmstream->loop_end_sample - vgmstream->loop_start_sample;
+    if (!vgmstream->loop_flag) {
+        total = vgmstream->num_samples - TEST_SAMPLES;
+    }
+    else if (loop_target) {
+        vgmstream_set_loop_target(vgmstream, loop_target);
+        total = vgmstream->num_samples + loop_samples * (loop_target - 1) - TEST_SAMPLES;
+    }
+    else {
+        total = vgmstream->loop_end_sample + loop_samples * 2 + 1000;
+    }
+
+    linear = malloc(sizeof(sample) * channels * (total + TEST_SAMPLES));
+    buf = malloc(sizeof(sample) * channels * TEST_SAMPLES);
+    if (!linear || !buf) goto fail;
+
+    for (i = 0; i < total + TEST_SAMPLES; ) {
+        int samples = 777; /* odd size so blocks/frames don't line up */
+        if (samples > total + TEST_SAMPLES - i)
+            samples = total + TEST_SAMPLES - i;
+        render_vgmstream(linear + i * channels, samples, vgmstream);
+        i += samples;
+    }
+
+    /* start (MP3 encoder delay is ~1105 samples), around frames (1152 for MP3), loop points, end */
+    offsets[offset_count++] = 0;
+    offsets[offset_count++] = 1;
+    offsets[offset_count++] = 333;
+    offsets[offset_count++] = 1105;
+    offsets[offset_count++] = 1152;
+    offsets[offset_count++] = 1152*3 - 1;
+    offsets[offset_count++] = 1152*10 + 17;
+    if (vgmstream->loop_flag) {
+        offsets[offset_count++] = vgmstream->loop_start_sample - 1;
+        offsets[offset_count++] = vgmstream->loop_start_sample;
+        offsets[offset_count++] = vgmstream->loop_end_sample - 100;
+        offsets[offset_count++] = vgmstream->loop_end_sample;
+        offsets[offset_count++] = vgmstream->loop_end_sample + 12345;
+        offsets[offset_count++] = vgmstream->loop_end_sample + loop_samples + 7;
+    }
+    offsets[offset_count++] = total;
+    offsets[offset_count++] = 100; /* backwards */
+    offsets[offset_count++] = total / 2;
+    offsets[offset_count++] = total / 3 + 1;
+
+    for (i = 0; i < offset_count; i++) {
+        if (offsets[i] > total)
+            continue;
+        vgmstream_seek(vgmstream, offsets[i]);
+        render_vgmstream(buf, TEST_SAMPLES, vgmstream);
+        if (memcmp(buf, linear + offsets[i] * channels, sizeof(sample) * channels * TEST_SAMPLES) != 0) {
+            printf("%s: mismatch after seeking to %i (loop target %i)\n", name, offsets[i], loop_target);
+            errors++;
+        }
+    }
+
+    /* stop a seek that must decode, then seek again */
+    if (!is_seekable) {
+        int max_calls = 2;
+        int32_t offset = total / 2;
+
+        vgmstream_seek(vgmstream, 0);
+        abort_calls = 0;
+        if (vgmstream_seek_abortable(vgmstream, offset, abort_after_calls, &max_calls)) {
+            printf("%s: seek not aborted\n", name);
+            errors++;
+        }
+
+        vgmstream_seek(vgmstream, offset);
+        render_vgmstream(buf, TEST_SAMPLES, vgmstream);
+        if (memcmp(buf, linear + offset * channels, sizeof(sample) * channels * TEST_SAMPLES) != 0) {
+            printf("%s: mismatch after aborted seek\n", name);
+            errors++;
+        }
+    }
+
+    free(linear);
+    free(buf);
+    close_vgmstream(vgmstream);
+    return errors == 0;
+fail:
+    free(linear);
+    free(buf);
+    close_vgmstream(vgmstream);
+    return 0;
+}
+
+/* offsets in the serialized checkpoints (see checkpoints.c) */
+#define CP_INTERVAL     0x1c
+#define CP_COUNT        0x20
+#define CP_ENTRIES      0x28
+#define CP_ENTRY_SIZE(channels) (0x20 + 0x50 * (channels))
+
+static int load_changed(const uint8_t * saved, size_t size, uint8_t * buf, int offset, int32_t value) {
+    VGMSTREAM * vgmstream = init_vgmstream(test_filename);
+    int loaded;
+    if (!vgmstream) return -1;
+
+    memcpy(buf, saved, size);
+    if (offset >= 0)
+        put_32bitLE(buf + offset, value);
+    loaded = vgmstream_load_checkpoints(vgmstream, buf, size);
+    close_vgmstream(vgmstream);
+    return loaded;
+}
+
+static int test_checkpoint_load(const char * name) {
+    VGMSTREAM * vgmstream;
+    uint8_t * saved = NULL, * buf = NULL;
+    size_t size;
+    int channels, first, second, errors = 0;
+
+    vgmstream = init_vgmstream(test_filename);
+    if (!vgmstream) return 0;
+    channels = vgmstream->channels;
+    if (!vgmstream_enable_checkpoints(vgmstream, 1000, 0)) {
+        close_vgmstream(vgmstream); /* not supported */
+        return 1;
+    }
+    vgmstream_build_checkpoints(vgmstream);
+
+    size = vgmstream_save_checkpoints(vgmstream, NULL, 0);
+    saved = malloc(size);
+    buf = malloc(size);
+    if (!saved || !buf || vgmstream_save_checkpoints(vgmstream, saved, size) != size)
+        goto fail;
+    close_vgmstream(vgmstream);
+    vgmstream = NULL;
+
+    first = CP_ENTRIES + CP_ENTRY_SIZE(channels) * 1;
+    second = CP_ENTRIES + CP_ENTRY_SIZE(channels) * 2;
+
+    if (load_changed(saved, size, buf, -1, 0) != 1) {
+        printf("%s: saved checkpoints not loaded\n", name);
+        errors++;
+    }
+    if (load_changed(saved, size, buf, CP_INTERVAL, 0) != 0
+            || load_changed(saved, size, buf, CP_COUNT, get_32bitLE(saved + CP_COUNT) + 1) != 0
+            || load_changed(saved, size, buf, second + 0x00, get_32bitLE(saved + first + 0x00)) != 0  /* not increasing */
+            || load_changed(saved, size, buf, second + 0x20 + 0x00, 0x7FFFFFFF) != 0  /* channel offset past the file */
+            || load_changed(saved, size, buf, CP_INTERVAL, 0x7FFFFFFF) != 0) {    /* more checkpoints than fit */
+        printf("%s: broken checkpoints loaded\n", name);
+        errors++;
+    }
+
+    free(saved);
+    free(buf);
+    return errors == 0;
+fail:
+    free(saved);
+    free(buf);
+    close_vgmstream(vgmstream);
+    return 0;
+}
+
+int main(void) {
+    int i, ok = 1;
+
+    for (i = 0; i < sizeof(streams) / sizeof(streams[0]); i++) {
+        const test_stream * ts = &streams[i];
+        if (!write_stream(ts) || !test_file(test_filename, ts->codec, ts->is_seekable, 0) || !test_file(test_filename, ts->codec, ts->is_seekable, 2))
+            ok = 0;
+        if (!test_checkpoint_load(ts->codec))
+            ok = 0;
+    }
+
+#ifdef VGM_USE_MPEG
+    if (!write_mpeg_stream() || !test_file(test_mpeg_filename, "MPEG", 1, 0))
+        ok = 0;
+#else
+    printf("MPEG: skipped (needs VGM_USE_MPEG)\n");
+#endif
+
+    remove(test_filename);
+    remove(test_txth);
+    remove(test_mpeg_filename);
+
+    printf("%s\n", ok ? "ok" : "failed");
+    return !ok;
+}
@@ -0,0 +1,195 @@
+/*
+ * Segment prefetch: preparing the next segment ahead must give the same output as decoding segments
+ * in place (loops and seeks included), including segments with different layouts (a layered one next to
+ * plain ones). Segments with different channel counts can't be joined.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/vgmstream.h"
+
+#define TEST_SAMPLES 60000
+
+typedef struct {
+    const char * filename;
+    const char * codec;
+    int channels;
+    int size;
+} test_segment;
+
+static const test_segment segments[] = {
+    {"test_seg_a.bin", "PCM16LE", 2, 0x4000},
+    {"test_seg_b.bin", "IMA",     2, 0x2800},
+    {"test_seg_c.bin", "NGC_DSP", 2, 0x3800},
+    {"test_seg_m1.bin", "PCM16LE", 1, 0x2000},
+    {"test_seg_m2.bin", "PCM16LE", 1, 0x2000},
+};
+
+static const char * test_layered = "test_seg_layered.txtp";
+static const char * test_txtp = "test_seg.txtp";
+static const char * test_mixed = "test_seg_mixed.txtp";
+
+static int write_text(const char * filename, const char * text) {
+    FILE * file = fopen(filename, "w");
+    if (!file) return 0;
+    fputs(text, file);
+    fclose(file);
+    return 1;
+}
+
+static int write_segments(void) {
+    char txth[0x100], name[0x40];
+    int i, j;
+
+    srand(1234);
+    for (i = 0; i < sizeof(segments) / sizeof(segments[0]); i++) {
+        const test_segment * ts = &segments[i];
+        FILE * file = fopen(ts->filename, "wb");
+        if (!file) return 0;
+        for (j = 0; j < ts->size; j++) {
+            fputc(rand() & 0xFF, file);
+        }
+        fclose(file);
+
+        snprintf(name, sizeof(name), "%s.txth", ts->filename);
+        snprintf(txth, sizeof(txth),
+                "codec = %s\nchannels = %i\nsample_rate = 32000\ninterleave = %i\nnum_samples = data_size\n",
+                ts->codec, ts->channels, ts->channels > 1 ? 0x08 : 0);
+        if (!write_text(name, txth)) return 0;
+    }
+
+    /* two mono layers make a stereo segment */
+    if (!write_text(test_layered, "test_seg_m1.bin\ntest_seg_m2.bin\nmode = layers\n"))
+        return 0;
+    if (!write_text(test_txtp, "test_seg_a.bin\ntest_seg_b.bin\ntest_seg_layered.txtp\ntest_seg_c.bin\nloop_start_segment = 2\n"))
+        return 0;
+    if (!write_text(test_mixed, "test_seg_a.bin\ntest_seg_m1.bin\n"))
+        return 0;
+    return 1;
+}
+
+static void remove_segments(void) {
+    char name[0x40];
+    int i;
+
+    for (i = 0; i < sizeof(segments) / sizeof(segments[0]); i++) {
+        remove(segments[i].filename);
+        snprintf(name, sizeof(name), "%s.txth", segments[i].filename);
+        remove(name);
+    }
+    remove(test_layered);
+    remove(test_txtp);
+    remove(test_mixed);
+}
+
+/* decodes in odd sized chunks so segment changes fall in the middle */
+static void render(sample * buf, int32_t samples, VGMSTREAM * vgmstream) {
+    int32_t done = 0;
+    while (done < samples) {
+        int32_t todo = 777;
+        if (todo > samples - done)
+            todo = samples - done;
+        render_vgmstream(buf + done * vgmstream->channels, todo, vgmstream);
+        done += todo;
+    }
+}
+
+static int test_prefetch(const sample * linear, int prefetch_samples) {
+    VGMSTREAM * vgmstream;
+    segmented_prefetch_stats stats;
+    sample * buf = NULL;
+    int errors = 0, channels;
+    int32_t seek;
+
+    vgmstream = init_vgmstream(test_txtp);
+    if (!vgmstream) return 0;
+    channels = vgmstream->channels;
+
+    if (!vgmstream_enable_segment_prefetch(vgmstream, prefetch_samples)) {
+        printf("prefetch %i: can't enable\n", prefetch_samples);
+        goto fail;
+    }
+
+    buf = malloc(sizeof(sample) * channels * TEST_SAMPLES);
+    if (!buf) goto fail;
+
+    render(buf, TEST_SAMPLES, vgmstream);
+    if (memcmp(buf, linear, sizeof(sample) * channels * TEST_SAMPLES) != 0) {
+        printf("prefetch %i: mismatch\n", prefetch_samples);
+        errors++;
+    }
+
+    vgmstream_get_segment_stats(vgmstream, &stats);
+    if (stats.prepared == 0 || stats.ready == 0) {
+        printf("prefetch %i: nothing prepared (%i prepared, %i ready)\n", prefetch_samples, stats.prepared, stats.ready);
+        errors++;
+    }
+
+    /* seeks discard what was prepared */
+    for (seek = 100; seek < TEST_SAMPLES / 2; seek += 9001) {
+        vgmstream_seek(vgmstream, seek);
+        render(buf, TEST_SAMPLES / 2, vgmstream);
+        if (memcmp(buf, linear + seek * channels, sizeof(sample) * channels * (TEST_SAMPLES / 2)) != 0) {
+            printf("prefetch %i: mismatch after seeking to %i\n", prefetch_samples, seek);
+            errors++;
+        }
+    }
+
+    free(buf);
+    close_vgmstream(vgmstream);
+    return errors == 0;
+fail:
+    free(buf);
+    close_vgmstream(vgmstream);
+    return 0;
+}
+
+int main(void) {
+    VGMSTREAM * vgmstream = NULL;
+    sample * linear = NULL;
+    int ok = 1;
+
+    if (!write_segments()) {
+        printf("can't write test files\n");
+        remove_segments();
+        return 1;
+    }
+
+    /* reference, segments decoded in place */
+    vgmstream = init_vgmstream(test_txtp);
+    if (!vgmstream || vgmstream->channels != 2 || !vgmstream->loop_flag) {
+        printf("can't open segments\n");
+        ok = 0;
+        goto done;
+    }
+    linear = malloc(sizeof(sample) * vgmstream->channels * TEST_SAMPLES);
+    if (!linear) {
+        ok = 0;
+        goto done;
+    }
+    render(linear, TEST_SAMPLES, vgmstream);
+
+    /* less than, around and more than a segment (a few loops in TEST_SAMPLES) */
+    ok &= test_prefetch(linear, 1);
+    ok &= test_prefetch(linear, 1000);
+    ok &= test_prefetch(linear, 0x3000);
+    ok &= test_prefetch(linear, 0x10000);
+
+    /* mono segment after a stereo one */
+    {
+        VGMSTREAM * mixed = init_vgmstream(test_mixed);
+        if (mixed) {
+            printf("segments with different channels opened\n");
+            close_vgmstream(mixed);
+            ok = 0;
+        }
+    }
+
+done:
+    free(linear);
+    close_vgmstream(vgmstream);
+    remove_segments();
+
+    printf("%s\n", ok ? "ok" : "failed");
+    return !ok;
+}
@@ -0,0 +1,95 @@
+/*
+ * Wwise Vorbis setup cache: entries are shared by all streams, so they must outlive the (failed)
+ * format probe that added them and not count as memory of the stream being opened.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "../src/coding/vorbis_custom_utils_wwise.c" /* for the static cache functions */
+
+#ifdef VGM_USE_VORBIS
+static int check_cache(const uint8_t * ibuf, size_t ibuf_size, const uint8_t * obuf, size_t obuf_size, const vorbis_custom_codec_data * added) {
+    vorbis_custom_codec_data data;
+    uint8_t out[0x400];
+    size_t bytes;
+
+    memset(&data, 0, sizeof(data));
+    data.config.setup_type = added->config.setup_type;
+
+    bytes = setup_cache_get(out, sizeof(out), ibuf, ibuf_size, &data, 2);
+    if (bytes != obuf_size || memcmp(out, obuf, obuf_size) != 0)
+        return 0;
+    if (data.mode_bits != added->mode_bits || memcmp(data.mode_blockflag, added->mode_blockflag, sizeof(data.mode_blockflag)) != 0)
+        return 0;
+    return 1;
+}
+
+int main(void) {
+    vorbis_custom_codec_data data;
+    uint8_t ibuf[0x100], obuf[0x300];
+    vgm_alloc_scope * scope;
+    vgm_alloc_scope * previous;
+    vgm_alloc_mark mark;
+    vgmstream_alloc_stats stats;
+    void * reused[4];
+    int i;
+
+    for (i = 0; i < sizeof(ibuf); i++)
+        ibuf[i] = (uint8_t)(i * 7 + 1);
+    for (i = 0; i < sizeof(obuf); i++)
+        obuf[i] = (uint8_t)(i * 13 + 5);
+
+    memset(&data, 0, sizeof(data));
+    data.config.setup_type = WWV_INLINE_CODEBOOKS;
+    data.mode_bits = 2;
+    data.mode_blockflag[0] = 0;
+    data.mode_blockflag[1] = 1;
+    data.mode_blockflag[2] = 1;
+
+    /* a probe adds the setup, then fails later and drops everything it allocated */
+    scope = vgm_alloc_scope_new(NULL, 0);
+    previous = vgm_alloc_scope_enter(scope);
+    vgm_alloc_arena_begin(scope);
+    vgm_alloc_arena_mark(scope, &mark);
+
+    setup_cache_add(obuf, sizeof(obuf), ibuf, sizeof(ibuf), &data, 2);
+
+    vgm_alloc_scope_stats(scope, &stats);
+    if (stats.current_bytes != 0) {
+        printf("cache entry counted as stream memory (%u bytes)\n", (unsigned)stats.current_bytes);
+        return 1;
+    }
+
+    vgm_alloc_arena_rollback(scope, &mark);
+
+    /* next probe reuses the arena */
+    for (i = 0; i < 4; i++) {
+        reused[i] = vgm_malloc(sizeof(obuf));
+        if (reused[i]) memset(reused[i], 0xAA, sizeof(obuf));
+    }
+    if (!check_cache(ibuf, sizeof(ibuf), obuf, sizeof(obuf), &data)) {
+        printf("cache entry overwritten after probe rollback\n");
+        return 1;
+    }
+
+    /* stream closed: scope memory goes back to the system */
+    for (i = 0; i < 4; i++)
+        vgm_free(reused[i]);
+    vgm_alloc_arena_end(scope);
+    vgm_alloc_scope_leave(previous);
+    vgm_alloc_scope_unref(scope);
+
+    if (!check_cache(ibuf, sizeof(ibuf), obuf, sizeof(obuf), &data)) {
+        printf("cache entry lost after scope was freed\n");
+        return 1;
+    }
+
+    printf("ok\n");
+    return 0;
+}
+
+#else
+int main(void) {
+    printf("skipped (needs VGM_USE_VORBIS)\n");
+    return 0;
+}
+#endif
@@ -60,23 +60,14 @@ typedef struct {
     int downmix_channels;
 } winamp_settings;
 
-/* current song settings */
-typedef struct {
-    int song_play_forever;
-    double song_loop_count;
-    double song_fade_time;
-    double song_fade_delay;
-    int song_ignore_loop;
-    int song_really_force_loop;
-    int song_ignore_fade;
-} winamp_song_config;
-
 winamp_settings settings;
-winamp_song_config config;
+vgmstream_play_config config; /* current song settings */
 
 
 /* plugin state */
 VGMSTREAM * vgmstream = NULL;
+#define STREAM_POOL_MAX_BYTES (32*1024*1024)
+vgmstream_pool * stream_pool = NULL; /* files are opened for playlist info, then again to play them */
 HANDLE decode_thread_handle = INVALID_HANDLE_VALUE;
 short sample_buffer[(576*2) * 2]; /* at least 576 16-bit samples, stereo, doubled in case Winamp's DSP is active */
 
@@ -86,7 +77,6 @@ int seek_needed_samples = -1;
 int decode_pos_ms = 0;
 int decode_pos_samples = 0;
 int stream_length_samples = 0;
-int fade_samples = 0;
 int output_channels = 0;
 
 
@@ -285,7 +275,7 @@ static VGMSTREAM* init_vgmstream_winamp(const in_char *fn, int stream_index) {
     STREAMFILE *streamFile = open_winamp_streamfile_by_wpath(fn); //open_stdio_streamfile(fn);
     if (streamFile) {
         streamFile->stream_index = stream_index;
-        vgmstream = init_vgmstream_from_STREAMFILE(streamFile);
+        vgmstream = init_vgmstream_from_pool(stream_pool, streamFile);
         close_streamfile(streamFile);
     }
 
@@ -843,58 +833,18 @@ static void get_title(in_char * dst, int dst_size, const in_char * fn, VGMSTREAM
     }
 }
 
-static void set_config_defaults(winamp_song_config *current) {
-    current->song_play_forever = settings.loop_forever;
-    current->song_loop_count = settings.loop_count;
-    current->song_fade_time = settings.fade_seconds;
-    current->song_fade_delay = settings.fade_delay_seconds;
-    current->song_ignore_loop = settings.ignore_loop;
-    current->song_really_force_loop = 0;
-    current->song_ignore_fade = 0;
+static void set_config_defaults(vgmstream_play_config *current) {
+    memset(current, 0, sizeof(vgmstream_play_config));
+    current->play_forever = settings.loop_forever;
+    current->loop_count = settings.loop_count;
+    current->fade_time = settings.fade_seconds;
+    current->fade_delay = settings.fade_delay_seconds;
+    current->ignore_loop = settings.ignore_loop;
 }
 
-static void apply_config(VGMSTREAM * vgmstream, winamp_song_config *current) {
-
-    /* honor suggested config, if any (defined order matters)
-     * note that ignore_fade and play_forever should take priority */
-    if (vgmstream->config_loop_count) {
-        current->song_loop_count = vgmstream->config_loop_count;
-    }
-    if (vgmstream->config_fade_delay) {
-        current->song_fade_delay = vgmstream->config_fade_delay;
-    }
-    if (vgmstream->config_fade_time) {
-        current->song_fade_time = vgmstream->config_fade_time;
-    }
-    if (vgmstream->config_force_loop) {
-        current->song_really_force_loop = 1;
-    }
-    if (vgmstream->config_ignore_loop) {
-        current->song_ignore_loop = 1;
-    }
-    if (vgmstream->config_ignore_fade) {
-        current->song_ignore_fade = 1;
-    }
-
-    /* remove non-compatible options */
-    if (current->song_play_forever) {
-        current->song_ignore_fade = 0;
-        current->song_ignore_loop = 0;
-    }
-
-    /* change loop stuff, in no particular order */
-    if (current->song_really_force_loop) {
-        vgmstream_force_loop(vgmstream, 1, 0,vgmstream->num_samples);
-    }
-    if (current->song_ignore_loop) {
-        vgmstream_force_loop(vgmstream, 0, 0,0);
-        current->song_fade_time = 0;
-    }
-
-    /* loop N times, but also play stream end instead of fading out */
-    if (current->song_loop_count > 0 && current->song_ignore_fade) {
-        vgmstream_set_loop_target(vgmstream, (int)current->song_loop_count);
-    }
+/* loops and fade are applied when rendering (TXTP's suggested config takes priority) */
+static void apply_config(VGMSTREAM * vgmstream, vgmstream_play_config *current) {
+    vgmstream_set_play_config(vgmstream, current);
 }
 
 
@@ -936,10 +886,15 @@ void winamp_Init() {
 
     /* dynamically make a list of supported extensions */
     build_extension_list();
+
+    /* may be NULL (files are just opened normally) */
+    stream_pool = vgmstream_pool_init(0, STREAM_POOL_MAX_BYTES);
 }
 
 /* called at program quit */
 void winamp_Quit() {
+    vgmstream_pool_free(stream_pool);
+    stream_pool = NULL;
 }
 
 /* called before extension checks, to allow detection of mms://, etc */
@@ -999,6 +954,10 @@ int winamp_Play(const in_char *fn) {
     set_config_defaults(&config);
     apply_config(vgmstream, &config);
 
+    /* save decoder state while playing, for faster backwards seeking (ignored if not supported) */
+    vgmstream_enable_checkpoints(vgmstream, 0, 0);
+    vgmstream_enable_block_index(vgmstream);
+
     output_channels = vgmstream->channels;
     if (settings.downmix_channels > 0 && settings.downmix_channels < vgmstream->channels)
         output_channels = settings.downmix_channels;
@@ -1028,8 +987,7 @@ int winamp_Play(const in_char *fn) {
     decode_pos_ms = 0;
     decode_pos_samples = 0;
     paused = 0;
-    stream_length_samples = get_vgmstream_play_samples(config.song_loop_count,config.song_fade_time,config.song_fade_delay,vgmstream);
-    fade_samples = (int)(config.song_fade_time * vgmstream->sample_rate);
+    stream_length_samples = vgmstream_get_play_samples(vgmstream);
 
     /* start */
     decode_thread_handle = CreateThread(
@@ -1126,7 +1084,7 @@ int winamp_InfoBox(const in_char *fn, HWND hwnd) {
     else {
         /* some other file in playlist given by filename */
         VGMSTREAM * infostream = NULL;
-        winamp_song_config infoconfig = {0};
+        vgmstream_play_config infoconfig = {0};
         in_char filename[PATH_LIMIT];
         int stream_index = 0;
 
@@ -1177,7 +1135,7 @@ void winamp_GetFileInfo(const in_char *fn, in_char *title, int *length_in_ms) {
     else {
         /* some other file in playlist given by filename */
         VGMSTREAM * infostream = NULL;
-        winamp_song_config infoconfig = {0};
+        vgmstream_play_config infoconfig = {0};
         in_char filename[PATH_LIMIT];
         int stream_index = 0;
 
@@ -1198,7 +1156,7 @@ void winamp_GetFileInfo(const in_char *fn, in_char *title, int *length_in_ms) {
         if (length_in_ms) {
             *length_in_ms = -1000;
             if (infostream) {
-                int num_samples = get_vgmstream_play_samples(infoconfig.song_loop_count,infoconfig.song_fade_time,infoconfig.song_fade_delay,infostream);
+                int num_samples = vgmstream_get_play_samples(infostream);
                 *length_in_ms = num_samples * 1000LL /infostream->sample_rate;
             }
         }
@@ -1212,6 +1170,11 @@ void winamp_GetFileInfo(const in_char *fn, in_char *title, int *length_in_ms) {
 void winamp_EQSet(int on, char data[10], int preamp) {
 }
 
+/* stops a slow seek if playback is stopped or another seek is requested meanwhile */
+static int seek_aborted(void *arg) {
+    return decode_abort || seek_needed_samples != *(int*)arg;
+}
+
 /* the decode thread */
 DWORD WINAPI __stdcall decode(void *arg) {
     int max_buffer_samples = sizeof(sample_buffer) / sizeof(sample_buffer[0]) / 2 / vgmstream->channels;
@@ -1220,44 +1183,39 @@ DWORD WINAPI __stdcall decode(void *arg) {
     while (!decode_abort) {
         int samples_to_do;
         int output_bytes;
+        int seek_samples;
 
-        if (decode_pos_samples + max_buffer_samples > stream_length_samples
-                && (!settings.loop_forever || !vgmstream->loop_flag))
-            samples_to_do = stream_length_samples - decode_pos_samples;
-        else
-            samples_to_do = max_buffer_samples;
-
-        /* seek setup (max samples to skip if still seeking, mark done) */
+        /* seek (mark done) */
         if (seek_needed_samples != -1) {
-            /* reset if we need to seek backwards */
-            if (seek_needed_samples < decode_pos_samples) {
-                reset_vgmstream(vgmstream);
-                apply_config(vgmstream, &config); /* config is undone by reset */
-
-                decode_pos_samples = 0;
-                decode_pos_ms = 0;
-            }
-
             /* adjust seeking past file, can happen using the right (->) key
              * (should be done here and not in SetOutputTime due to threads/race conditions) */
             if (seek_needed_samples > max_samples) {
                 seek_needed_samples = max_samples;
             }
+            seek_samples = seek_needed_samples;
 
-            /* adjust max samples to seek */
-            if (decode_pos_samples < seek_needed_samples) {
-                samples_to_do = seek_needed_samples - decode_pos_samples;
-                if (samples_to_do > max_buffer_samples)
-                    samples_to_do = max_buffer_samples;
-            }
-            else {
+            if (!vgmstream_seek_abortable(vgmstream, seek_samples, seek_aborted, &seek_samples))
+                continue; /* handle the stop or new seek */
+
+            decode_pos_samples = seek_samples;
+            decode_pos_ms = decode_pos_samples * 1000LL / vgmstream->sample_rate;
+            if (seek_needed_samples == seek_samples)
                 seek_needed_samples = -1;
-            }
 
             /* flush Winamp buffers */
             input_module.outMod->Flush((int)decode_pos_ms);
         }
 
+        /* fades near the end (loop forever may be toggled while playing, and turning it off may move the end) */
+        vgmstream_set_play_forever(vgmstream, settings.loop_forever);
+        stream_length_samples = vgmstream_get_play_samples(vgmstream);
+
+        if (decode_pos_samples + max_buffer_samples > stream_length_samples
+                && (!settings.loop_forever || !vgmstream->loop_flag))
+            samples_to_do = stream_length_samples - decode_pos_samples;
+        else
+            samples_to_do = max_buffer_samples;
+
         output_bytes = (samples_to_do * output_channels * sizeof(short));
         if (input_module.dsp_isactive())
             output_bytes = output_bytes * 2; /* Winamp's DSP may need double samples */
@@ -1270,33 +1228,9 @@ DWORD WINAPI __stdcall decode(void *arg) {
             }
             Sleep(10);
         }
-        else if (seek_needed_samples != -1) { /* seek */
-            render_vgmstream(sample_buffer,samples_to_do,vgmstream);
-
-            /* discard decoded samples and keep seeking */
-            decode_pos_samples += samples_to_do;
-            decode_pos_ms = decode_pos_samples * 1000LL / vgmstream->sample_rate;
-        }
         else if (input_module.outMod->CanWrite() >= output_bytes) { /* decode */
             render_vgmstream(sample_buffer,samples_to_do,vgmstream);
 
-            /* fade near the end */
-            if (vgmstream->loop_flag && fade_samples > 0 && !settings.loop_forever) {
-                int samples_into_fade = decode_pos_samples - (stream_length_samples - fade_samples);
-                if (samples_into_fade + samples_to_do > 0) {
-                    int j,k;
-                    for (j=0; j < samples_to_do; j++, samples_into_fade++) {
-                        if (samples_into_fade > 0) {
-                            double fadedness = (double)(fade_samples-samples_into_fade)/fade_samples;
-                            for (k=0; k < vgmstream->channels; k++) {
-                                sample_buffer[j*vgmstream->channels+k] =
-                                    (short)(sample_buffer[j*vgmstream->channels+k]*fadedness);
-                            }
-                        }
-                    }
-                }
-            }
-
             /* downmix enabled (useful when the stream's channels are too much for Winamp's output) */
             if (settings.downmix_channels > 0 && settings.downmix_channels < vgmstream->channels) {
                 short temp_buffer[(576*2) * 2];